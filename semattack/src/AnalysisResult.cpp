@@ -22,10 +22,11 @@
  */
 
 #include "AnalysisResult.hpp"
+#include "depgraph/DepGraph.hpp"
 
 
 AnalysisResult::AnalysisResult()
-    : m_map()
+    : m_entries()
 {
 }
 
@@ -37,43 +38,55 @@ AnalysisResult::~AnalysisResult()
 
 const StrangerAutomaton* AnalysisResult::get(int node) const
 {
-    if (m_map.count(node) > 0) {
-        return m_map.at(node);
+    if (node >= DepGraph::FirstNodeId && DepGraph::nodeIndex(node) < m_entries.size()) {
+        return m_entries[DepGraph::nodeIndex(node)].second;
     }
     return nullptr;
 }
 
 void AnalysisResult::set(int node, const StrangerAutomaton* a)
 {
-    if (m_map[node] != nullptr) {
-        delete m_map[node];
+    if (node < DepGraph::FirstNodeId) {
+        throw std::out_of_range(stringbuilder() << "AnalysisResult: invalid node id " << node);
     }
-    m_map[node] = a;
+    std::size_t index = DepGraph::nodeIndex(node);
+    if (index >= m_entries.size()) {
+        m_entries.resize(index + 1, AnalysisResultEntry(AnalysisResultUnset, nullptr));
+    }
+    AnalysisResultEntry& entry = m_entries[index];
+    if (entry.second != nullptr) {
+        delete entry.second;
+    }
+    entry.first = node;
+    entry.second = a;
 }
 
 void AnalysisResult::clear()
 {
-    for (auto a : m_map) {
+    for (auto& a : m_entries) {
         if (a.second != nullptr) {
             delete a.second;
             a.second = nullptr;
         }
     }
-    m_map.clear();
+    m_entries.clear();
 }
 
 AnalysisResultConstIterator AnalysisResult::find(int node) const
 {
-    return m_map.find(node);
+    if (node < DepGraph::FirstNodeId || DepGraph::nodeIndex(node) >= m_entries.size()
+        || m_entries[DepGraph::nodeIndex(node)].first == AnalysisResultUnset) {
+        return end();
+    }
+    return AnalysisResultConstIterator(m_entries.begin() + DepGraph::nodeIndex(node), m_entries.end());
 }
 
 AnalysisResultConstIterator AnalysisResult::begin() const
 {
-    return m_map.begin();
+    return AnalysisResultConstIterator(m_entries.begin(), m_entries.end());
 }
 
 AnalysisResultConstIterator AnalysisResult::end() const
 {
-    return m_map.end();
+    return AnalysisResultConstIterator(m_entries.end(), m_entries.end());
 }
-
@@ -28,8 +28,37 @@
 
 #include "StrangerAutomaton.hpp"
 
-typedef std::map<int, const StrangerAutomaton*>::iterator AnalysisResultIterator;
-typedef std::map<int, const StrangerAutomaton*>::const_iterator AnalysisResultConstIterator;
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// A node id and its automaton
+typedef std::pair<int, const StrangerAutomaton*> AnalysisResultEntry;
+// Node id of the entries which are not set
+static const int AnalysisResultUnset = std::numeric_limits<int>::min();
+
+// Visits the entries of an AnalysisResult in order of their node ids
+class AnalysisResultConstIterator : public std::iterator<std::forward_iterator_tag, const AnalysisResultEntry> {
+public:
+    typedef std::vector<AnalysisResultEntry>::const_iterator Slot;
+
+    AnalysisResultConstIterator() : m_slot(), m_end() {}
+    AnalysisResultConstIterator(Slot slot, Slot end) : m_slot(slot), m_end(end) { skipEmpty(); }
+
+    const AnalysisResultEntry& operator*() const { return *m_slot; }
+    const AnalysisResultEntry* operator->() const { return &*m_slot; }
+    AnalysisResultConstIterator& operator++() { ++m_slot; skipEmpty(); return *this; }
+    AnalysisResultConstIterator operator++(int) { AnalysisResultConstIterator it(*this); ++*this; return it; }
+    bool operator==(const AnalysisResultConstIterator& other) const { return m_slot == other.m_slot; }
+    bool operator!=(const AnalysisResultConstIterator& other) const { return m_slot != other.m_slot; }
+
+private:
+    void skipEmpty() { while (m_slot != m_end && m_slot->first == AnalysisResultUnset) ++m_slot; }
+
+    Slot m_slot;
+    Slot m_end;
+};
 
 class AnalysisResult {
 
@@ -55,7 +84,9 @@ public:
     AnalysisResultConstIterator end() const;
 
 private:
-    std::map<int, const StrangerAutomaton*> m_map;
+    // Indexed by DepGraph::nodeIndex. Node ids of a depgraph are dense, so
+    // this is a lot smaller and faster than a map.
+    std::vector<AnalysisResultEntry> m_entries;
 };
 
 #endif /* ANALYSISRESULT_HPP_ */
@@ -22,6 +22,8 @@
  */
 #include "AttackPatterns.hpp"
 
+#include <algorithm>
+
 // Set of RegExps used to describe various attack patten contexts
 // WARNING: These cannot be copied directly as the quotes and slashes are escaped!
 
@@ -329,3 +331,52 @@ StrangerAutomaton* AttackPatterns::getAttackPatternForContext(AttackContext cont
     }
     return StrangerAutomaton::makeEmptyString();
 }
+
+/*
+ * computeInclusionLattice
+ *
+ * If the post image has no (non-empty) overlap with an attack pattern, it can also not
+ * overlap with any pattern included in it (e.g. HtmlPayload is included in LessThan).
+ * Check inclusion between all pairs once, so that the analysis can visit the more general
+ * patterns first and skip the intersections which are already decided.
+ */
+AttackPatternLattice AttackPatterns::computeInclusionLattice(const std::vector<AttackContext>& contexts)
+{
+    AttackPatternLattice lattice;
+    std::map<AttackContext, StrangerAutomaton*> patterns;
+    std::map<AttackContext, int> states;
+    for (auto c : contexts) {
+        if (patterns.find(c) == patterns.end()) {
+            StrangerAutomaton* a = getAttackPatternForContext(c);
+            patterns.insert(std::make_pair(c, a));
+            states.insert(std::make_pair(c, a->get_num_of_states()));
+            lattice.order.push_back(c);
+        }
+    }
+
+    for (auto sub : lattice.order) {
+        std::vector<AttackContext>& supersets = lattice.supersets[sub];
+        for (auto super : lattice.order) {
+            if ((sub != super) && patterns.at(sub)->checkInclusion(patterns.at(super))) {
+                supersets.push_back(super);
+            }
+        }
+    }
+
+    for (auto p : patterns) {
+        delete p.second;
+    }
+
+    // A strict superset always has fewer supersets itself, so this ordering puts
+    // every pattern after the patterns including it
+    std::stable_sort(lattice.order.begin(), lattice.order.end(),
+        [&lattice, &states](AttackContext a, AttackContext b) {
+            size_t na = lattice.supersets.at(a).size();
+            size_t nb = lattice.supersets.at(b).size();
+            if (na != nb) {
+                return na < nb;
+            }
+            return states.at(a) < states.at(b);
+        });
+    return lattice;
+}
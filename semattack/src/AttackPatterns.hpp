@@ -27,12 +27,27 @@
 #include "StrangerAutomaton.hpp"
 #include "AttackContext.hpp"
 
+#include <map>
+#include <vector>
+
+// Inclusion relation between the attack patterns of a set of contexts
+struct AttackPatternLattice {
+    // Contexts ordered so that each context comes after all contexts whose
+    // pattern includes it, smaller patterns first otherwise
+    std::vector<AttackContext> order;
+    // For each context, the other contexts whose pattern includes it
+    std::map<AttackContext, std::vector<AttackContext> > supersets;
+};
+
 class AttackPatterns {
 
 public:
 
     static StrangerAutomaton* getAttackPatternForContext(AttackContext context);
 
+    // Compute the inclusion lattice between the patterns of the given contexts
+    static AttackPatternLattice computeInclusionLattice(const std::vector<AttackContext>& contexts);
+
     static StrangerAutomaton* getLiteralPattern();
     static StrangerAutomaton* lessThanPattern();
 
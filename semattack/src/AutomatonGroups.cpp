@@ -415,7 +415,9 @@ AutomatonGroup* AutomatonGroups::getGroupForAutomaton(const StrangerAutomaton* a
       continue;
     }
     // Otherwise check
+    // Automata of the run wide store with the same structure share their DFA
     if ((automaton == existing) ||
+        ((automaton->dfa != nullptr) && (automaton->dfa == existing->dfa)) ||
         ((automaton->get_num_of_states()  == existing->get_num_of_states())
          && automaton->equals(existing))) {
       return &(*iter);
@@ -428,7 +430,8 @@ const AutomatonGroup* AutomatonGroups::getGroupForAutomaton(const StrangerAutoma
 {
   for (auto iter = m_groups.begin(); iter != m_groups.end(); ++iter) {
     const StrangerAutomaton* existing = iter->getAutomaton();
-    if (automaton->equals(existing)) {
+    if (((existing != nullptr) && (automaton->dfa != nullptr) && (automaton->dfa == existing->dfa))
+        || automaton->equals(existing)) {
       return &(*iter);
     }
   }
@@ -0,0 +1,205 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * DFAInterner.cpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+#include "DFAInterner.hpp"
+#include "PerfInfo.hpp"
+
+#include <deque>
+#include <vector>
+#include <boost/functional/hash.hpp>
+
+namespace {
+
+// Leaves get a value which can not be a BDD variable index
+const std::size_t LEAF_MARKER = ~static_cast<std::size_t>(0);
+
+// Walks the BDD of one state, numbering successor states in the order they are
+// first reached so the result does not depend on the original state numbers
+void hashBdd(bdd_manager* bddm, bdd_ptr p, std::vector<int>& order, int& next,
+             std::deque<int>& queue, std::size_t& seed)
+{
+  if (bdd_is_leaf(bddm, p)) {
+    int to = bdd_leaf_value(bddm, p);
+    if (order[to] < 0) {
+      order[to] = next++;
+      queue.push_back(to);
+    }
+    boost::hash_combine(seed, LEAF_MARKER);
+    boost::hash_combine(seed, order[to]);
+  } else {
+    boost::hash_combine(seed, bdd_ifindex(bddm, p));
+    hashBdd(bddm, bdd_then(bddm, p), order, next, queue, seed);
+    hashBdd(bddm, bdd_else(bddm, p), order, next, queue, seed);
+  }
+}
+
+// Walks the BDDs of two states in parallel, extending the state mapping
+bool matchBdd(const DFA* a, bdd_ptr pa, const DFA* b, bdd_ptr pb,
+              std::vector<int>& aToB, std::vector<int>& bToA, std::deque<int>& queue)
+{
+  bool leafa = bdd_is_leaf(a->bddm, pa);
+  bool leafb = bdd_is_leaf(b->bddm, pb);
+  if (leafa != leafb) {
+    return false;
+  }
+  if (leafa) {
+    int sa = bdd_leaf_value(a->bddm, pa);
+    int sb = bdd_leaf_value(b->bddm, pb);
+    if (aToB[sa] < 0 && bToA[sb] < 0) {
+      if (a->f[sa] != b->f[sb]) {
+        return false;
+      }
+      aToB[sa] = sb;
+      bToA[sb] = sa;
+      queue.push_back(sa);
+      return true;
+    }
+    return (aToB[sa] == sb) && (bToA[sb] == sa);
+  }
+  if (bdd_ifindex(a->bddm, pa) != bdd_ifindex(b->bddm, pb)) {
+    return false;
+  }
+  return matchBdd(a, bdd_then(a->bddm, pa), b, bdd_then(b->bddm, pb), aToB, bToA, queue)
+    && matchBdd(a, bdd_else(a->bddm, pa), b, bdd_else(b->bddm, pb), aToB, bToA, queue);
+}
+
+}
+
+std::size_t DFAInterner::canonicalHash(const DFA* dfa)
+{
+  std::size_t seed = 0;
+  boost::hash_combine(seed, dfa->ns);
+  std::vector<int> order(dfa->ns, -1);
+  std::deque<int> queue;
+  int next = 0;
+  order[dfa->s] = next++;
+  queue.push_back(dfa->s);
+  while (!queue.empty()) {
+    int state = queue.front();
+    queue.pop_front();
+    boost::hash_combine(seed, dfa->f[state]);
+    hashBdd(dfa->bddm, dfa->q[state], order, next, queue, seed);
+  }
+  return seed;
+}
+
+bool DFAInterner::isIsomorphic(const DFA* a, const DFA* b)
+{
+  if (a == b) {
+    return true;
+  }
+  if ((a->ns != b->ns) || (a->f[a->s] != b->f[b->s])) {
+    return false;
+  }
+  std::vector<int> aToB(a->ns, -1);
+  std::vector<int> bToA(b->ns, -1);
+  std::deque<int> queue;
+  aToB[a->s] = b->s;
+  bToA[b->s] = a->s;
+  queue.push_back(a->s);
+  while (!queue.empty()) {
+    int sa = queue.front();
+    queue.pop_front();
+    if (!matchBdd(a, a->q[sa], b, b->q[aToB[sa]], aToB, bToA, queue)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<DFA> DFAInterner::intern(DFA* dfa)
+{
+  PerfInfo& perfInfo = PerfInfo::getInstance();
+  boost::posix_time::ptime start_time = perfInfo.current_time();
+  // dfa belongs to the caller, so it is hashed and copied outside the lock
+  std::size_t hash = canonicalHash(dfa);
+  std::shared_ptr<DFA> stored;
+  {
+    Shard& shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto range = shard.table.equal_range(hash);
+    for (auto iter = range.first; iter != range.second; ) {
+      std::shared_ptr<DFA> candidate = iter->second.lock();
+      if (!candidate) {
+        iter = shard.table.erase(iter);
+      } else if (isIsomorphic(candidate.get(), dfa)) {
+        stored = candidate;
+        break;
+      } else {
+        ++iter;
+      }
+    }
+  }
+  if (stored) {
+    perfInfo.num_of_intern_hits++;
+  } else {
+    std::shared_ptr<DFA> copied(dfaCopy(dfa), StoredDfa{hash});
+    Shard& shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // Another thread may have stored the same DFA in the meantime. Each
+    // structure is stored once, so automata share the stored DFA exactly if
+    // they have the same structure.
+    auto range = shard.table.equal_range(hash);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+      std::shared_ptr<DFA> candidate = iter->second.lock();
+      if (candidate && isIsomorphic(candidate.get(), copied.get())) {
+        stored = candidate;
+        break;
+      }
+    }
+    if (!stored) {
+      shard.table.insert(std::make_pair(hash, std::weak_ptr<DFA>(copied)));
+      stored = copied;
+    }
+  }
+  perfInfo.num_of_intern++;
+  perfInfo.intern_total_time += perfInfo.current_time() - start_time;
+  return stored;
+}
+
+DFA* DFAInterner::copy(const std::shared_ptr<DFA>& stored)
+{
+  const StoredDfa* deleter = std::get_deleter<StoredDfa>(stored);
+  std::lock_guard<std::mutex> lock(shardFor(deleter->hash).mutex);
+  return dfaCopy(stored.get());
+}
+
+bool DFAInterner::isStored(const std::shared_ptr<DFA>& dfa)
+{
+  return std::get_deleter<StoredDfa>(dfa) != nullptr;
+}
+
+std::size_t DFAInterner::size()
+{
+  std::size_t alive = 0;
+  for (Shard& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (const auto& entry : shard.table) {
+      if (!entry.second.expired()) {
+        alive++;
+      }
+    }
+  }
+  return alive;
+}
@@ -0,0 +1,95 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * DFAInterner.hpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+#ifndef DFA_INTERNER_HPP_
+#define DFA_INTERNER_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#define export _export_
+#include "stranger/stranger_lib_internal.h"
+#include "stranger/stranger.h"
+#undef export
+
+// Run wide store of immutable DFAs, so that automata with the same structure
+// share a single DFA, whichever depgraph they belong to. MONA writes marks
+// into every DFA it reads, so stored DFAs are only read by the store, under
+// the lock of their shard. Automata working on a stored DFA take a copy of
+// it first. Stored DFAs are freed with the last automaton using them.
+class DFAInterner {
+public:
+
+    static DFAInterner& getInstance() {
+        static DFAInterner instance;
+        return instance;
+    }
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled; }
+
+    // Returns the stored DFA with the same structure as dfa, which is only
+    // read. A copy of dfa is stored if there is none yet.
+    std::shared_ptr<DFA> intern(DFA* dfa);
+
+    // Returns a copy of a stored DFA, which belongs to the caller
+    DFA* copy(const std::shared_ptr<DFA>& stored);
+
+    static bool isStored(const std::shared_ptr<DFA>& dfa);
+
+    // Number of stored DFAs which are still alive
+    std::size_t size();
+
+    // Hash which is equal for DFAs which only differ in the numbering of
+    // their states. Minimized DFAs of the same language get the same hash.
+    static std::size_t canonicalHash(const DFA* dfa);
+
+    // True if both DFAs are equal up to renaming of states
+    static bool isIsomorphic(const DFA* a, const DFA* b);
+
+private:
+    DFAInterner() : m_enabled(false) {}
+    DFAInterner(const DFAInterner&) = delete;
+    DFAInterner& operator=(const DFAInterner&) = delete;
+
+    // Deleter of stored DFAs, which remembers the shard they are in
+    struct StoredDfa {
+        std::size_t hash;
+        void operator()(DFA* dfa) const { dfaFree(dfa); }
+    };
+
+    static const std::size_t NUM_SHARDS = 16;
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_multimap<std::size_t, std::weak_ptr<DFA> > table;
+    };
+    Shard& shardFor(std::size_t hash) { return m_shards[hash % NUM_SHARDS]; }
+
+    bool m_enabled;
+    Shard m_shards[NUM_SHARDS];
+};
+
+#endif /* DFA_INTERNER_HPP_ */
@@ -0,0 +1,414 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * DotFileLoader.cpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+#include "DotFileLoader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace {
+
+  // Opens the file and sizes the buffer for its contents
+  int openFile(const fs::path& file, std::string& contents) {
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      close(fd);
+      return -1;
+    }
+    contents.resize(static_cast<std::size_t>(st.st_size));
+    return fd;
+  }
+
+}
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+// The submission and completion queues of an io_uring instance, used
+// through the raw system calls as liburing is not a dependency
+class DotFileLoader::Ring {
+public:
+  explicit Ring(unsigned entries)
+    : m_fd(-1), m_entries(0), m_to_submit(0)
+    , m_sq_ptr(MAP_FAILED), m_sq_size(0), m_cq_ptr(MAP_FAILED), m_cq_size(0)
+    , m_sqes(static_cast<io_uring_sqe*>(MAP_FAILED)), m_sqes_size(0)
+  {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (m_fd < 0) {
+      return;
+    }
+    m_entries = params.sq_entries;
+    m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+      m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+    }
+    m_sq_ptr = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+    if (single) {
+      m_cq_ptr = m_sq_ptr;
+    } else {
+      m_cq_ptr = mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+    }
+    m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    m_sqes = static_cast<io_uring_sqe*>(mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES));
+    if (m_sq_ptr == MAP_FAILED || m_cq_ptr == MAP_FAILED || m_sqes == MAP_FAILED) {
+      release();
+      return;
+    }
+
+    char* sq = static_cast<char*>(m_sq_ptr);
+    m_sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(m_cq_ptr);
+    m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  }
+
+  ~Ring() {
+    release();
+  }
+
+  bool isValid() const { return m_fd >= 0; }
+  unsigned size() const { return m_entries; }
+
+  // Queues a read into iov, the callers keep at most size() in flight
+  void prepareRead(int fd, const struct iovec* iov, std::uint64_t offset, std::uint64_t user_data) {
+    unsigned tail = *m_sq_tail;
+    unsigned index = tail & m_sq_mask;
+    struct io_uring_sqe* sqe = &m_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<std::uint64_t>(iov);
+    sqe->len = 1;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    m_sq_array[index] = index;
+    __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    m_to_submit++;
+  }
+
+  // Submits the queued reads and waits for at least one to complete
+  bool submitAndWait() {
+    for (;;) {
+      int submitted = static_cast<int>(syscall(__NR_io_uring_enter, m_fd, m_to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+      if (submitted >= 0) {
+        m_to_submit -= std::min(m_to_submit, static_cast<unsigned>(submitted));
+        return true;
+      }
+      if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        return false;
+      }
+    }
+  }
+
+  // Calls f(user_data, result) for every completed read
+  template <typename F>
+  void reap(F f) {
+    unsigned head = *m_cq_head;
+    unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      const struct io_uring_cqe& cqe = m_cqes[head & m_cq_mask];
+      f(cqe.user_data, cqe.res);
+    }
+    __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+  }
+
+private:
+  void release() {
+    if (m_sqes != MAP_FAILED) {
+      munmap(m_sqes, m_sqes_size);
+    }
+    if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr) {
+      munmap(m_cq_ptr, m_cq_size);
+    }
+    if (m_sq_ptr != MAP_FAILED) {
+      munmap(m_sq_ptr, m_sq_size);
+    }
+    m_sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    m_sq_ptr = m_cq_ptr = MAP_FAILED;
+    if (m_fd >= 0) {
+      close(m_fd);
+    }
+    m_fd = -1;
+  }
+
+  int m_fd;
+  unsigned m_entries;
+  unsigned m_to_submit;
+  void* m_sq_ptr;
+  std::size_t m_sq_size;
+  void* m_cq_ptr;
+  std::size_t m_cq_size;
+  struct io_uring_sqe* m_sqes;
+  std::size_t m_sqes_size;
+  unsigned* m_sq_head;
+  unsigned* m_sq_tail;
+  unsigned m_sq_mask;
+  unsigned* m_sq_array;
+  unsigned* m_cq_head;
+  unsigned* m_cq_tail;
+  unsigned m_cq_mask;
+  struct io_uring_cqe* m_cqes;
+};
+
+#else
+
+class DotFileLoader::Ring {
+public:
+  explicit Ring(unsigned) {}
+  bool isValid() const { return false; }
+};
+
+#endif
+
+DotFileLoader::DotFileLoader(unsigned depth, Callback callback)
+  : m_depth(depth > 0 ? depth : 1)
+  , m_callback(callback)
+  , m_ring(new Ring(m_depth))
+  , m_io_uring(m_ring->isValid())
+  , m_mutex()
+  , m_queued()
+  , m_queue()
+  , m_finished(false)
+  , m_threads()
+  , m_abandoned()
+{
+  if (m_io_uring) {
+    m_threads.emplace_back(&DotFileLoader::readIoUring, this);
+  } else {
+    m_ring.reset();
+    for (unsigned i = 0; i < m_depth; i++) {
+      m_threads.emplace_back(&DotFileLoader::readBlocking, this);
+    }
+  }
+}
+
+DotFileLoader::~DotFileLoader()
+{
+  finish();
+  m_ring.reset();
+  m_abandoned.clear();
+}
+
+void DotFileLoader::add(std::size_t id, const fs::path& file)
+{
+  {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(Request{id, file});
+  }
+  m_queued.notify_one();
+}
+
+void DotFileLoader::finish()
+{
+  {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished = true;
+  }
+  m_queued.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+  m_threads.clear();
+}
+
+bool DotFileLoader::next(Request& request, bool wait)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (wait) {
+    m_queued.wait(lock, [this]() { return m_finished || !m_queue.empty(); });
+  }
+  if (m_queue.empty()) {
+    return false;
+  }
+  request = std::move(m_queue.front());
+  m_queue.pop_front();
+  return true;
+}
+
+void DotFileLoader::readBlocking()
+{
+  Request request;
+  while (next(request, true)) {
+    std::shared_ptr<std::string> contents(new std::string());
+    int fd = openFile(request.file, *contents);
+    std::size_t done = 0;
+    while (fd >= 0 && done < contents->size()) {
+      ssize_t n = read(fd, &(*contents)[done], contents->size() - done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        close(fd);
+        fd = -1;
+      } else if (n == 0) {
+        // The file got shorter
+        contents->resize(done);
+      } else {
+        done += static_cast<std::size_t>(n);
+      }
+    }
+    if (fd < 0) {
+      contents.reset();
+    } else {
+      close(fd);
+    }
+    m_callback(request.id, request.file, contents);
+  }
+}
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+void DotFileLoader::readIoUring()
+{
+  struct Slot {
+    Request request;
+    int fd;
+    std::shared_ptr<std::string> contents;
+    std::size_t done;
+    struct iovec iov;
+  };
+  unsigned depth = std::min(m_depth, m_ring->size());
+  std::vector<Slot> slots(depth);
+  std::vector<unsigned> free_slots;
+  for (unsigned i = 0; i < depth; i++) {
+    free_slots.push_back(depth - 1 - i);
+  }
+
+  auto deliver = [this, &slots, &free_slots](unsigned i, bool ok) {
+    Slot& slot = slots[i];
+    close(slot.fd);
+    std::shared_ptr<const std::string> contents;
+    if (ok) {
+      contents = std::move(slot.contents);
+    }
+    slot.contents.reset();
+    free_slots.push_back(i);
+    m_callback(slot.request.id, slot.request.file, contents);
+  };
+  auto submit = [this, &slots](unsigned i) {
+    Slot& slot = slots[i];
+    slot.iov.iov_base = &(*slot.contents)[slot.done];
+    slot.iov.iov_len = slot.contents->size() - slot.done;
+    m_ring->prepareRead(slot.fd, &slot.iov, slot.done, i);
+  };
+
+  bool finished = false;
+  while (!finished || free_slots.size() < depth) {
+    // Fill the free slots, only block if nothing is in flight
+    while (!finished && !free_slots.empty()) {
+      Request request;
+      if (!next(request, free_slots.size() == depth)) {
+        finished = free_slots.size() == depth;
+        break;
+      }
+      std::shared_ptr<std::string> contents(new std::string());
+      int fd = openFile(request.file, *contents);
+      if (fd < 0) {
+        m_callback(request.id, request.file, nullptr);
+        continue;
+      }
+      unsigned i = free_slots.back();
+      free_slots.pop_back();
+      slots[i].request = std::move(request);
+      slots[i].fd = fd;
+      slots[i].contents = contents;
+      slots[i].done = 0;
+      if (contents->empty()) {
+        deliver(i, true);
+      } else {
+        submit(i);
+      }
+    }
+    if (free_slots.size() == depth) {
+      continue;
+    }
+
+    if (!m_ring->submitAndWait()) {
+      // Hand the files in flight back unread, the kernel may still write
+      // to their buffers until the ring is closed
+      for (unsigned i = 0; i < depth; i++) {
+        if (std::find(free_slots.begin(), free_slots.end(), i) == free_slots.end()) {
+          m_abandoned.push_back(slots[i].contents);
+          deliver(i, false);
+        }
+      }
+      // The remaining files are read like without io_uring
+      readBlocking();
+      return;
+    }
+    m_ring->reap([&slots, &deliver, &submit](std::uint64_t i, int result) {
+        Slot& slot = slots[i];
+        if (result == -EINTR || result == -EAGAIN) {
+          submit(i);
+        } else if (result < 0) {
+          deliver(i, false);
+        } else if (result == 0) {
+          // The file got shorter
+          slot.contents->resize(slot.done);
+          deliver(i, true);
+        } else {
+          slot.done += static_cast<std::size_t>(result);
+          if (slot.done < slot.contents->size()) {
+            submit(i);
+          } else {
+            deliver(i, true);
+          }
+        }
+      });
+  }
+}
+
+#else
+
+void DotFileLoader::readIoUring()
+{
+  readBlocking();
+}
+
+#endif
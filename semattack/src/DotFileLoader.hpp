@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * DotFileLoader.hpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+#ifndef DOT_FILE_LOADER_HPP_
+#define DOT_FILE_LOADER_HPP_
+
+#define BOOST_FILESYSTEM_VERSION 3
+#define BOOST_FILESYSTEM_NO_DEPRECATED
+#include <boost/filesystem.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+// Reads whole files on threads of its own, so the analysis threads never
+// wait for the disk.
+//
+// Up to depth reads are kept in flight. With io_uring a single thread
+// submits them; where the kernel does not support it (or it is not compiled
+// in), depth threads do blocking reads instead. The callback is called on
+// a loader thread for every file, with nullptr if the loader could not read
+// it. The callback may block to hold back further reads.
+class DotFileLoader {
+public:
+  typedef std::function<void(std::size_t id, const fs::path& file, std::shared_ptr<const std::string> contents)> Callback;
+
+  DotFileLoader(unsigned depth, Callback callback);
+  ~DotFileLoader();
+
+  // Queues a file, the id is passed on to the callback
+  void add(std::size_t id, const fs::path& file);
+  // Waits until the callback was called for all queued files
+  void finish();
+
+  bool usesIoUring() const { return m_io_uring; }
+
+private:
+  DotFileLoader(const DotFileLoader&) = delete;
+  DotFileLoader& operator=(const DotFileLoader&) = delete;
+
+  class Ring;
+
+  struct Request {
+    std::size_t id;
+    fs::path file;
+  };
+
+  // Blocks until a request is queued, returns false once finish was called
+  // and the queue is empty
+  bool next(Request& request, bool wait);
+  void readBlocking();
+  void readIoUring();
+
+  unsigned m_depth;
+  Callback m_callback;
+  std::unique_ptr<Ring> m_ring;
+  bool m_io_uring;
+
+  std::mutex m_mutex;
+  std::condition_variable m_queued;
+  std::deque<Request> m_queue;
+  bool m_finished;
+  std::vector<std::thread> m_threads;
+  // Buffers of reads given up on, kept until the ring is closed
+  std::vector<std::shared_ptr<std::string>> m_abandoned;
+};
+
+#endif /* DOT_FILE_LOADER_HPP_ */
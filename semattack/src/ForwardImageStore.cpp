@@ -0,0 +1,183 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * ForwardImageStore.cpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+#include "ForwardImageStore.hpp"
+#include "PerfInfo.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const char* MANIFEST_NAME = "manifest";
+
+// Tags of the images in the manifest, top and bottom are rebuilt on load
+const char TAG_TOP = 'T';
+const char TAG_BOTTOM = 'B';
+const char TAG_DFA = 'D';
+// A node without an image
+const char TAG_NONE = 'N';
+
+fs::path imagePath(const fs::path& entry, std::size_t i) {
+  return entry / fs::path(std::to_string(i) + ".sdfa");
+}
+
+}
+
+void ForwardImageStore::setDirectory(const fs::path& dir)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_dir = dir;
+  if (!m_dir.empty()) {
+    fs::create_directories(m_dir);
+  }
+}
+
+std::string ForwardImageStore::makeKey(int sanitizerHash, const StrangerAutomaton* input, bool doConcat, bool doSubstr)
+{
+  std::ostringstream key;
+  key << std::hex << static_cast<unsigned int>(sanitizerHash) << "-"
+      << input->fingerprint() << "-" << (doConcat ? "c" : "n") << (doSubstr ? "s" : "n");
+  return key.str();
+}
+
+bool ForwardImageStore::load(const std::string& key, const std::vector<std::size_t>& shape,
+                             std::vector<StrangerAutomaton*>& images)
+{
+  PerfInfo& perfInfo = PerfInfo::getInstance();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    perfInfo.num_of_store_lookups++;
+  }
+  fs::path entry = m_dir / fs::path(key);
+  std::ifstream manifest((entry / fs::path(MANIFEST_NAME)).string());
+  if (!manifest) {
+    return false;
+  }
+
+  std::size_t shapeSize = 0, imageCount = 0;
+  manifest >> shapeSize >> imageCount;
+  if (!manifest || shapeSize != shape.size()) {
+    return false;
+  }
+  for (std::size_t value : shape) {
+    std::size_t stored = 0;
+    if (!(manifest >> stored) || stored != value) {
+      return false;
+    }
+  }
+
+  std::vector<StrangerAutomaton*> loaded;
+  bool complete = true;
+  for (std::size_t i = 0; i < imageCount && complete; i++) {
+    char tag = 0;
+    manifest >> tag;
+    StrangerAutomaton* image = nullptr;
+    if (!manifest) {
+      complete = false;
+    } else if (tag == TAG_NONE) {
+      loaded.push_back(nullptr);
+      continue;
+    } else if (tag == TAG_TOP) {
+      image = StrangerAutomaton::makeTop();
+    } else if (tag == TAG_BOTTOM) {
+      image = StrangerAutomaton::makeBottom();
+    } else if (tag == TAG_DFA) {
+      image = StrangerAutomaton::importFromBinaryFile(imagePath(entry, i).string());
+    }
+    if (image == nullptr) {
+      complete = false;
+    } else {
+      loaded.push_back(image);
+    }
+  }
+
+  if (!complete) {
+    std::cout << "Ignoring incomplete forward image store entry " << entry << std::endl;
+    for (auto image : loaded) {
+      delete image;
+    }
+    return false;
+  }
+
+  images.insert(images.end(), loaded.begin(), loaded.end());
+  std::lock_guard<std::mutex> lock(m_mutex);
+  perfInfo.num_of_store_hits++;
+  return true;
+}
+
+void ForwardImageStore::save(const std::string& key, const std::vector<std::size_t>& shape,
+                             const std::vector<const StrangerAutomaton*>& images)
+{
+  fs::path entry = m_dir / fs::path(key);
+  if (fs::exists(entry)) {
+    return;
+  }
+  fs::path tmp = m_dir / fs::unique_path(key + ".tmp-%%%%-%%%%");
+  try {
+    fs::create_directories(tmp);
+    std::ofstream manifest((tmp / fs::path(MANIFEST_NAME)).string());
+    manifest << shape.size() << " " << images.size() << "\n";
+    for (std::size_t value : shape) {
+      manifest << value << " ";
+    }
+    manifest << "\n";
+    for (std::size_t i = 0; i < images.size(); i++) {
+      const StrangerAutomaton* image = images[i];
+      if (image == nullptr) {
+        manifest << TAG_NONE << "\n";
+      } else if (image->isTop()) {
+        manifest << TAG_TOP << "\n";
+      } else if (image->isBottom()) {
+        manifest << TAG_BOTTOM << "\n";
+      } else {
+        if (!image->exportToBinaryFile(imagePath(tmp, i).string())) {
+          throw fs::filesystem_error("Writing image failed", imagePath(tmp, i),
+                                     boost::system::errc::make_error_code(boost::system::errc::io_error));
+        }
+        manifest << TAG_DFA << "\n";
+      }
+    }
+    manifest.close();
+    if (!manifest) {
+      throw fs::filesystem_error("Writing manifest failed", tmp,
+                                 boost::system::errc::make_error_code(boost::system::errc::io_error));
+    }
+    // Fails if another process stored the same entry in the meantime
+    fs::rename(tmp, entry);
+  } catch (fs::filesystem_error const &e) {
+    boost::system::error_code ec;
+    fs::remove_all(tmp, ec);
+    if (!fs::exists(entry)) {
+      std::cout << "Could not write forward image store entry " << entry << ": " << e.what() << std::endl;
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  PerfInfo::getInstance().num_of_store_saves++;
+}
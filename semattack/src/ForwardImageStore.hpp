@@ -0,0 +1,79 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * ForwardImageStore.hpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+#ifndef FORWARD_IMAGE_STORE_HPP_
+#define FORWARD_IMAGE_STORE_HPP_
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "StrangerAutomaton.hpp"
+
+// On-disk store of forward analysis results, so a re-run over the same
+// depgraphs only pays for the backward analysis. Every entry is a directory
+// named after the key, holding one binary automaton per node image and a
+// manifest with the shape of the graph, which is compared before an entry is
+// used.
+// Entries are written to a temporary directory first and renamed into place,
+// so several processes can share a store.
+class ForwardImageStore {
+public:
+
+    static ForwardImageStore& getInstance() {
+        static ForwardImageStore instance;
+        return instance;
+    }
+
+    // An empty directory switches the store off
+    void setDirectory(const boost::filesystem::path& dir);
+    bool isEnabled() const { return !m_dir.empty(); }
+
+    // Key of the forward images of a depgraph with the given sanitizer hash,
+    // input and ImageComputer options
+    static std::string makeKey(int sanitizerHash, const StrangerAutomaton* input, bool doConcat, bool doSubstr);
+
+    // Reads the images of the entry into images, false on a miss or if the
+    // stored shape differs. Nodes saved without an image are nullptr.
+    bool load(const std::string& key, const std::vector<std::size_t>& shape,
+              std::vector<StrangerAutomaton*>& images);
+
+    // Writes the images, does nothing if the entry already exists. An image
+    // may be nullptr for a node that has none.
+    void save(const std::string& key, const std::vector<std::size_t>& shape,
+              const std::vector<const StrangerAutomaton*>& images);
+
+private:
+    ForwardImageStore() : m_dir() {}
+    ForwardImageStore(const ForwardImageStore&) = delete;
+    ForwardImageStore& operator=(const ForwardImageStore&) = delete;
+
+    std::mutex m_mutex;
+    boost::filesystem::path m_dir;
+};
+
+#endif /* FORWARD_IMAGE_STORE_HPP_ */
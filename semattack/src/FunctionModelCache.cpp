@@ -0,0 +1,133 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * FunctionModelCache.cpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+#include "FunctionModelCache.hpp"
+#include "DFAInterner.hpp"
+#include "PerfInfo.hpp"
+
+#include <iterator>
+#include <boost/functional/hash.hpp>
+
+void FunctionModelCache::setCapacity(std::size_t capacity)
+{
+  m_capacity = capacity;
+  for (Shard& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    while (shard.entries.size() > shardCapacity()) {
+      shard.evictLast();
+    }
+  }
+}
+
+void FunctionModelCache::Shard::evictLast()
+{
+  EntryIter last = std::prev(entries.end());
+  auto range = index.equal_range(last->hash);
+  for (auto iter = range.first; iter != range.second; ++iter) {
+    if (iter->second == last) {
+      index.erase(iter);
+      break;
+    }
+  }
+  entries.pop_back();
+}
+
+std::size_t FunctionModelCache::hashKey(const std::string& op, const std::vector<const DFA*>& inputs)
+{
+  std::size_t seed = 0;
+  boost::hash_combine(seed, op);
+  for (auto dfa : inputs) {
+    boost::hash_combine(seed, DFAInterner::canonicalHash(dfa));
+  }
+  return seed;
+}
+
+FunctionModelCache::EntryIter FunctionModelCache::Shard::find(const std::string& op, std::size_t hash,
+                                                              const std::vector<const DFA*>& inputs)
+{
+  auto range = index.equal_range(hash);
+  for (auto iter = range.first; iter != range.second; ++iter) {
+    const Entry& entry = *iter->second;
+    if (entry.op != op || entry.inputs.size() != inputs.size()) {
+      continue;
+    }
+    bool equal = true;
+    for (std::size_t i = 0; equal && i < inputs.size(); i++) {
+      equal = DFAInterner::isIsomorphic(entry.inputs[i].get(), inputs[i]);
+    }
+    if (equal) {
+      return iter->second;
+    }
+  }
+  return entries.end();
+}
+
+DFA* FunctionModelCache::lookup(const std::string& op, std::size_t hash,
+                                const std::vector<const DFA*>& inputs)
+{
+  PerfInfo& perfInfo = PerfInfo::getInstance();
+  Shard& shard = shardFor(hash);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  perfInfo.num_of_memo_lookups++;
+  EntryIter entry = shard.find(op, hash, inputs);
+  if (entry == shard.entries.end()) {
+    return NULL;
+  }
+  perfInfo.num_of_memo_hits++;
+  shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+  return dfaCopy(entry->result.get());
+}
+
+void FunctionModelCache::insert(const std::string& op, std::size_t hash,
+                                const std::vector<const DFA*>& inputs, const DFA* result)
+{
+  // The copies are made from the DFAs of the calling thread, outside the lock
+  Entry copied{op, hash, std::vector<OwnedDfa>(), OwnedDfa(dfaCopy(const_cast<DFA*>(result)), dfaFree)};
+  for (auto input : inputs) {
+    copied.inputs.push_back(OwnedDfa(dfaCopy(const_cast<DFA*>(input)), dfaFree));
+  }
+  PerfInfo& perfInfo = PerfInfo::getInstance();
+  Shard& shard = shardFor(hash);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  // Another thread may have computed the same result in the meantime
+  if (m_capacity == 0 || shard.find(op, hash, inputs) != shard.entries.end()) {
+    return;
+  }
+  shard.entries.push_front(std::move(copied));
+  shard.index.insert(std::make_pair(hash, shard.entries.begin()));
+  while (shard.entries.size() > shardCapacity()) {
+    shard.evictLast();
+    perfInfo.num_of_memo_evictions++;
+  }
+}
+
+std::size_t FunctionModelCache::size()
+{
+  std::size_t entries = 0;
+  for (Shard& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    entries += shard.entries.size();
+  }
+  return entries;
+}
@@ -0,0 +1,112 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * FunctionModelCache.hpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+#ifndef FUNCTION_MODEL_CACHE_HPP_
+#define FUNCTION_MODEL_CACHE_HPP_
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define export _export_
+#include "stranger/stranger_lib_internal.h"
+#include "stranger/stranger.h"
+#undef export
+
+// Process wide, bounded memo table of function model results. Entries are
+// keyed by the operation including its literal arguments and the canonical
+// hashes of the input DFAs. The cache keeps copies of the inputs and results
+// of its own and hands out copies, as MONA writes marks into every DFA it
+// reads and the cache is used by all threads. The table is split into shards
+// by hash, each with a lock of its own, and drops its least recently used
+// entry once it is full.
+class FunctionModelCache {
+public:
+
+    static FunctionModelCache& getInstance() {
+        static FunctionModelCache instance;
+        return instance;
+    }
+
+    // Inputs with fewer states in total are cheaper to compute again than to
+    // hash, look up and copy
+    static const int MIN_INPUT_STATES = 8;
+
+    // Maximum number of cached results, 0 switches the cache off
+    void setCapacity(std::size_t capacity);
+    bool isEnabled() const { return m_capacity > 0; }
+
+    static std::size_t hashKey(const std::string& op, const std::vector<const DFA*>& inputs);
+
+    // Returns a copy of the cached result of op applied to inputs, which
+    // belongs to the caller, or NULL
+    DFA* lookup(const std::string& op, std::size_t hash,
+                const std::vector<const DFA*>& inputs);
+
+    // Stores copies of the inputs and the result, which must be minimal
+    void insert(const std::string& op, std::size_t hash,
+                const std::vector<const DFA*>& inputs, const DFA* result);
+
+    std::size_t size();
+
+private:
+    FunctionModelCache() : m_capacity(0) {}
+    FunctionModelCache(const FunctionModelCache&) = delete;
+    FunctionModelCache& operator=(const FunctionModelCache&) = delete;
+
+    // The DFAs of an entry are only read with the lock of its shard held
+    typedef std::unique_ptr<DFA, void (*)(DFA*)> OwnedDfa;
+    struct Entry {
+        std::string op;
+        std::size_t hash;
+        std::vector<OwnedDfa> inputs;
+        OwnedDfa result;
+    };
+    typedef std::list<Entry>::iterator EntryIter;
+
+    static const std::size_t NUM_SHARDS = 16;
+    struct Shard {
+        std::mutex mutex;
+        // Most recently used entry first
+        std::list<Entry> entries;
+        std::unordered_multimap<std::size_t, EntryIter> index;
+
+        // Both must be called with mutex held
+        void evictLast();
+        EntryIter find(const std::string& op, std::size_t hash,
+                       const std::vector<const DFA*>& inputs);
+    };
+    Shard& shardFor(std::size_t hash) { return m_shards[hash % NUM_SHARDS]; }
+    // Each shard holds its part of the capacity, at least one entry
+    std::size_t shardCapacity() const { return (m_capacity + NUM_SHARDS - 1) / NUM_SHARDS; }
+
+    std::size_t m_capacity;
+    Shard m_shards[NUM_SHARDS];
+};
+
+#endif /* FUNCTION_MODEL_CACHE_HPP_ */
@@ -26,6 +26,9 @@
 #include "ImageComputer.hpp"
 #include "exceptions/StrangerException.hpp"
 #include "depgraph/RegExpNode.hpp"
+#include "SubtreeImageCache.hpp"
+
+#include <boost/functional/hash.hpp>
 
 using namespace std;
 
@@ -34,6 +37,8 @@ ImageComputer::ImageComputer()
     , m_doConcats(true)
     , m_doSubstr(true)
     , m_inputAuto(nullptr)
+    , m_exampleOnly(false)
+    , m_inputAutoFingerprint(0)
 {
 }
 
@@ -42,6 +47,8 @@ ImageComputer::ImageComputer(bool doConcats, bool doSubstr, StrangerAutomaton* i
     , m_doConcats(doConcats)
     , m_doSubstr(doSubstr)
     , m_inputAuto(inputAuto)
+    , m_exampleOnly(false)
+    , m_inputAutoFingerprint((inputAuto != nullptr && SubtreeImageCache::getInstance().isEnabled()) ? inputAuto->fingerprint() : 0)
 {
 }
 
@@ -63,6 +70,124 @@ ImageComputer::~ImageComputer() {
 
 PerfInfo* ImageComputer::perfInfo = &PerfInfo::getInstance();
 
+/*******************************************************************************************************************************/
+/*********** SUBTREE IMAGE REUSE METHODS ***************************************************************************************/
+/*******************************************************************************************************************************/
+
+/**
+ * Key of the forward image of the sub-DAG below a node in the subtree cache,
+ * 0 if it can not be shared. Apart from the structure the image depends on
+ * the language of the input node, the concat and substr options and, for
+ * replace operations, the URL flags of the graph metadata and the input
+ * automaton. The automata the key depends on are returned in inputs.
+ */
+std::size_t ImageComputer::subtreeKey(const DepGraph& depGraph, const DepGraphNode* node, const AnalysisResult& analysisResult,
+		std::vector<const StrangerAutomaton*>& inputs) const {
+	if (!SubtreeImageCache::getInstance().isEnabled() || node->getSubtreeHash() == 0) {
+		return 0;
+	}
+	std::size_t key = node->getSubtreeHash();
+	inputs.clear();
+	int input = node->getSubtreeInput();
+	if (input != -1) {
+		AnalysisResultConstIterator inputAuto = analysisResult.find(input);
+		if (inputAuto == analysisResult.end()) {
+			return 0;
+		}
+		boost::hash_combine(key, inputAuto->second->fingerprint());
+		inputs.push_back(inputAuto->second);
+	} else {
+		inputs.push_back(nullptr);
+	}
+	const Metadata& m = depGraph.get_metadata();
+	boost::hash_combine(key, m.is_initialized() && m.has_url_on_lhs_of_replace());
+	boost::hash_combine(key, m.is_initialized() && m.has_url_on_rhs_of_replace());
+	boost::hash_combine(key, m_inputAutoFingerprint);
+	inputs.push_back(m_inputAuto);
+	boost::hash_combine(key, m_doConcats);
+	boost::hash_combine(key, m_doSubstr);
+	return key;
+}
+
+/**
+ * Returns a copy of the cached image of node, nullptr on a miss
+ */
+StrangerAutomaton* ImageComputer::lookupSubtreeImage(const DepGraph& depGraph, const DepGraphNode* node, const AnalysisResult& analysisResult) const {
+	std::vector<const StrangerAutomaton*> inputs;
+	std::size_t key = subtreeKey(depGraph, node, analysisResult, inputs);
+	if (key == 0) {
+		return nullptr;
+	}
+	return SubtreeImageCache::getInstance().lookup(key, node->getSubtreeHash(), inputs);
+}
+
+/**
+ * Fills in the images of node and all nodes below it from the subtree cache.
+ * Returns false if they have not all been computed for another graph yet,
+ * nothing is filled in then. The nodes below are only walked once the image
+ * of node is found.
+ */
+bool ImageComputer::reuseSubtreeImages(const DepGraph& depGraph, DepGraphNode* node, AnalysisResult& analysisResult) {
+	if (analysisResult.find(node->getID()) != analysisResult.end()) {
+		return false;
+	}
+	StrangerAutomaton* image = lookupSubtreeImage(depGraph, node, analysisResult);
+	if (image == nullptr) {
+		return false;
+	}
+	std::vector<std::pair<DepGraphNode*, StrangerAutomaton*> > images;
+	images.push_back(std::make_pair(node, image));
+	NodeSet visited(depGraph);
+	visited.insert(node);
+	stack<DepGraphNode*> process_stack;
+	process_stack.push(node);
+	bool found = true;
+	while (found && !process_stack.empty()) {
+		DepGraphNode* curr = process_stack.top();
+		process_stack.pop();
+		for (auto succ_node : depGraph.getSuccessors(curr)) {
+			if (!visited.insert(succ_node) || analysisResult.find(succ_node->getID()) != analysisResult.end()) {
+				continue;
+			}
+			image = lookupSubtreeImage(depGraph, succ_node, analysisResult);
+			if (image == nullptr) {
+				found = false;
+				break;
+			}
+			images.push_back(std::make_pair(succ_node, image));
+			process_stack.push(succ_node);
+		}
+	}
+	for (auto& entry : images) {
+		if (found) {
+			entry.second->setID(entry.first->getID());
+			analysisResult.set(entry.first->getID(), entry.second);
+		} else {
+			delete entry.second;
+		}
+	}
+	if (found) {
+		perfInfo->num_of_subtree_reused_nodes += images.size();
+	}
+	return found;
+}
+
+/**
+ * Puts the image of node into the subtree cache, the nodes below it have
+ * been stored when their images were computed.
+ */
+void ImageComputer::storeSubtreeImage(const DepGraph& depGraph, const DepGraphNode* node, const AnalysisResult& analysisResult) {
+	std::vector<const StrangerAutomaton*> inputs;
+	std::size_t key = subtreeKey(depGraph, node, analysisResult, inputs);
+	if (key == 0) {
+		return;
+	}
+	AnalysisResultConstIterator image = analysisResult.find(node->getID());
+	if (image != analysisResult.end()) {
+		SubtreeImageCache::getInstance().insert(key, node->getSubtreeHash(), inputs, image->second);
+	}
+}
+
 /*******************************************************************************************************************************/
 /*********** SANITIZATION PATCH EXTRACTION METHODS *****************************************************************************/
 /*******************************************************************************************************************************/
@@ -83,17 +208,21 @@ void ImageComputer::doForwardAnalysis_SingleInput(
 		DepGraph& origDepGraph, DepGraph& inputDepGraph, AnalysisResult& analysisResult) {
 
 	stack<DepGraphNode*> process_stack;
-	set<DepGraphNode*> visited;
+	NodeSet visited(inputDepGraph);
 
 	process_stack.push( inputDepGraph.getRoot() );
 	while (!process_stack.empty()) {
 
 		DepGraphNode *curr = process_stack.top();
-		auto isNotVisited = visited.insert(curr);
-		NodesList successors = inputDepGraph.getSuccessors(curr);
+		bool isNotVisited = visited.insert(curr);
+		if (isNotVisited && reuseSubtreeImages(origDepGraph, curr, analysisResult)) {
+			process_stack.pop();
+			continue;
+		}
+		NodeSpan successors = inputDepGraph.getSuccessors(curr);
 
-		if (!successors.empty() && isNotVisited.second) {
-			for (NodesListConstReverseIterator it = successors.rbegin(); it != successors.rend(); it++) {
+		if (!successors.empty() && isNotVisited) {
+			for (NodeSpan::const_reverse_iterator it = successors.rbegin(); it != successors.rend(); it++) {
 				if (analysisResult.find((*it)->getID()) == analysisResult.end()) {
 					process_stack.push(*it);
 				}
@@ -111,17 +240,16 @@ void ImageComputer::doForwardAnalysis_SingleInput(
 void ImageComputer::doPostImageComputation_SingleInput(
     DepGraph& origDepGraph, DepGraph& inputDepGraph, DepGraphNode* node, AnalysisResult& analysisResult) {
 
-    NodesList successors = origDepGraph.getSuccessors(node);
+    NodeSpan successors = origDepGraph.getSuccessors(node);
 
     StrangerAutomaton* newAuto = nullptr;
-    DepGraphNormalNode* normalnode;
-    DepGraphOpNode* opNode;
-    DepGraphUninitNode* uninitNode;
-    if ((normalnode = dynamic_cast<DepGraphNormalNode*>(node)) != nullptr) {
+    if (node->getKind() == DepGraphNode::Normal) {
+        DepGraphNormalNode* normalnode = static_cast<DepGraphNormalNode*>(node);
     	if (successors.empty()) {
             newAuto = getLiteralorConstantNodeAuto(normalnode, false);
     	} else {
             // an interior node, union of all its successors
+            std::vector<const StrangerAutomaton*> succAutos;
             for (auto succ_node : successors) {
                 if (succ_node->getID() == node->getID() ) {
                     // avoid simple loops
@@ -132,24 +260,19 @@ void ImageComputer::doPostImageComputation_SingleInput(
                     cout << "exploring succ_node: " << succ_node->getID() << endl;
                     doForwardAnalysis_GeneralCase(origDepGraph, succ_node, analysisResult);
                 }
-
-                const StrangerAutomaton *succAuto = analysisResult.get(succ_node->getID());
-                if (newAuto == nullptr) {
-                    newAuto = succAuto->clone(node->getID());
-                } else {
-                    StrangerAutomaton* temp = newAuto;
-                    newAuto = newAuto->union_(succAuto, node->getID());
-                    delete temp;
-                }
+                succAutos.push_back(analysisResult.get(succ_node->getID()));
+            }
+            if (!succAutos.empty()) {
+                newAuto = StrangerAutomaton::unionAll(succAutos, node->getID());
             }
     	}
 
-    } else if ((opNode = dynamic_cast<DepGraphOpNode*>(node)) != nullptr) {
-        newAuto = makePostImageForOp_GeneralCase(origDepGraph, opNode, analysisResult);
-    } else if ((uninitNode = dynamic_cast<DepGraphUninitNode*>(node)) != nullptr) {
+    } else if (node->getKind() == DepGraphNode::Op) {
+        newAuto = makePostImageForOp_GeneralCase(origDepGraph, static_cast<DepGraphOpNode*>(node), analysisResult);
+    } else if (node->getKind() == DepGraphNode::Uninit) {
     	// input node that we are interested in should have been initialized already
     	if (analysisResult.find(node->getID()) == analysisResult.end()){
-            throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "input node id(" << uninitNode->getID() << ") automaton must be initizalized before analysis begins!");
+            throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "input node id(" << node->getID() << ") automaton must be initizalized before analysis begins!");
     	}
     	newAuto = analysisResult.get(node->getID())->clone();
     } else {
@@ -161,6 +284,7 @@ void ImageComputer::doPostImageComputation_SingleInput(
     }
 
     analysisResult.set(node->getID(), newAuto);
+    storeSubtreeImage(origDepGraph, node, analysisResult);
 }
 
 /*******************************************************************************************************************************/
@@ -176,14 +300,23 @@ AnalysisResult ImageComputer::doBackwardAnalysis_GeneralCase(
     const DepGraph& origDepGraph, const DepGraph& depGraph, const StrangerAutomaton* initialAuto, const AnalysisResult& fwAnalysisResult) {
 
     queue<const DepGraphNode*> process_queue;
-    set<const DepGraphNode*> visited;
+    NodeSet visited(depGraph);
     set<int> processed_SCCs;
 
     AnalysisResult bwAnalysisResult;
 
     try {
         // initialize root node
-        bwAnalysisResult.set(depGraph.getRoot()->getID(), initialAuto->clone());
+        if (m_exampleOnly && !initialAuto->isEmpty()) {
+            StrangerAutomaton* witness = initialAuto->generateSatisfyingSingleton();
+            if (witness == nullptr) {
+                throw StrangerException(AnalysisError::MonaException, "Null DFA pointer returned from MONA");
+            }
+            witness->setID(depGraph.getRoot()->getID());
+            bwAnalysisResult.set(depGraph.getRoot()->getID(), witness);
+        } else {
+            bwAnalysisResult.set(depGraph.getRoot()->getID(), initialAuto->clone());
+        }
 
         process_queue.push(depGraph.getRoot());
         while (!process_queue.empty()) {
@@ -201,11 +334,10 @@ AnalysisResult ImageComputer::doBackwardAnalysis_GeneralCase(
 
             process_queue.pop();
 
-            NodesList successors = depGraph.getSuccessors(curr);
+            NodeSpan successors = depGraph.getSuccessors(curr);
             if (!successors.empty()) {
                 for (auto succ_node : successors) {
-                    auto isNotVisited = visited.insert(succ_node);
-                    if (isNotVisited.second) {
+                    if (visited.insert(succ_node)) {
                         process_queue.push(succ_node);
                     }
                 }
@@ -225,17 +357,17 @@ void ImageComputer::doPreImageComputation_GeneralCase(
     const DepGraph& origDepGraph, const DepGraphNode* node,
     AnalysisResult& bwAnalysisResult, const AnalysisResult& fwAnalysisResult) {
 
-	NodesList predecessors = origDepGraph.getPredecessors(node);
-	NodesList successors = origDepGraph.getSuccessors(node);
-	const DepGraphNormalNode* normalNode = nullptr;
+	NodeSpan predecessors = origDepGraph.getPredecessors(node);
+	NodeSpan successors = origDepGraph.getSuccessors(node);
 	StrangerAutomaton *newAuto = nullptr, *tempAuto = nullptr;
 
-	if (dynamic_cast<const DepGraphNormalNode*>(node) || dynamic_cast<const DepGraphUninitNode*>(node) || dynamic_cast<const DepGraphOpNode*>(node)) {
+	DepGraphNode::Kind kind = node->getKind();
+	if (kind == DepGraphNode::Normal || kind == DepGraphNode::Uninit || kind == DepGraphNode::Op) {
 		if (predecessors.empty()) {
 			// root is already initialized
                     newAuto = bwAnalysisResult.get(node->getID())->clone();
-		} else if (successors.empty() && (normalNode = dynamic_cast<const DepGraphNormalNode*>(node))) {
-                        newAuto = getLiteralorConstantNodeAuto(normalNode, false);
+		} else if (successors.empty() && kind == DepGraphNode::Normal) {
+                        newAuto = getLiteralorConstantNodeAuto(node, false);
 		} else {
 			// the automa is union of all prodecessors and interstect with forward analysis result
                         const StrangerAutomaton* forwardAuto = fwAnalysisResult.find(node->getID())->second;
@@ -244,10 +376,10 @@ void ImageComputer::doPreImageComputation_GeneralCase(
 				if (pred_node == node) {
 					// ignore simple self loop (check correctness)
 					continue;
-				} else if (dynamic_cast<const DepGraphNormalNode*>(pred_node)) {
+				} else if (pred_node->getKind() == DepGraphNode::Normal) {
                                     predAuto = bwAnalysisResult.get(pred_node->getID())->clone(node->getID());
-				} else if (dynamic_cast<const DepGraphOpNode*>(pred_node)) {
-                                    predAuto = makePreImageForOpChild_GeneralCase(origDepGraph,dynamic_cast<const DepGraphOpNode*>(pred_node), node,
+				} else if (pred_node->getKind() == DepGraphNode::Op) {
+                                    predAuto = makePreImageForOpChild_GeneralCase(origDepGraph,static_cast<const DepGraphOpNode*>(pred_node), node,
                                                                                   bwAnalysisResult, fwAnalysisResult);
 			}
 
@@ -273,6 +405,17 @@ void ImageComputer::doPreImageComputation_GeneralCase(
 			tempAuto = newAuto;
 			newAuto = forwardAuto->intersect(newAuto, node->getID());
 			delete tempAuto;
+
+			// keep a single witness, so that the pre-images further down stay small
+			if (m_exampleOnly && !newAuto->isEmpty() && !newAuto->isSingleton()) {
+				tempAuto = newAuto;
+				newAuto = newAuto->generateSatisfyingSingleton();
+				delete tempAuto;
+				if (newAuto == nullptr) {
+					throw StrangerException(AnalysisError::MonaException, "Null DFA pointer returned from MONA");
+				}
+				newAuto->setID(node->getID());
+			}
 		}
 
 	} else {
@@ -297,16 +440,16 @@ void ImageComputer::doPreImageComputationForSCC_GeneralCase(const DepGraph& orig
 
 	int scc_id = origDepGraph.getSCCID(node);
 
-	map<int, int> visit_count;
+	std::vector<int> visit_count(origDepGraph.getNodeTableSize(), 0);
 	NodesList current_scc_nodes = origDepGraph.getSCCNodes(scc_id);
 
 	queue<DepGraphNode*> worklist;
-	set<DepGraphNode*> visited;
+	NodeSet visited(origDepGraph);
 
 	// initialize all scc_nodes to phi
 	for (auto& scc_node : current_scc_nodes) {
             bwAnalysisResult.set(scc_node->getID(), StrangerAutomaton::makePhi(scc_node->getID()));
-		visit_count[scc_node->getID()] = 0;
+		visit_count[DepGraph::nodeIndex(scc_node->getID())] = 0;
 	}
 
 	// add the predecessors to the worklist
@@ -331,10 +474,10 @@ void ImageComputer::doPreImageComputationForSCC_GeneralCase(const DepGraph& orig
 			StrangerAutomaton* tmp_auto = nullptr;
 			StrangerAutomaton* new_auto = nullptr;
 
-			if (dynamic_cast<const DepGraphNormalNode*>(curr_node) != nullptr) {
+			if (curr_node->getKind() == DepGraphNode::Normal) {
                             tmp_auto = bwAnalysisResult.get(curr_node->getID())->clone(); // may need clone
-			} else if (dynamic_cast<const DepGraphOpNode*>(curr_node) != nullptr) {
-				tmp_auto = makePreImageForOpChild_GeneralCase(origDepGraph, dynamic_cast<const DepGraphOpNode*>(curr_node), succ_node,
+			} else if (curr_node->getKind() == DepGraphNode::Op) {
+				tmp_auto = makePreImageForOpChild_GeneralCase(origDepGraph, static_cast<const DepGraphOpNode*>(curr_node), succ_node,
 						bwAnalysisResult, fwAnalysisResult);
 			} else {
 				throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "Node cannot be an element of SCC component!, node id: " << node->getID());
@@ -346,7 +489,7 @@ void ImageComputer::doPreImageComputationForSCC_GeneralCase(const DepGraph& orig
 
 			new_auto = tmp_auto->union_(prev_auto, succ_node->getID());
 
-			int new_visit_count = visit_count[succ_node->getID()] + 1;
+			int new_visit_count = visit_count[DepGraph::nodeIndex(succ_node->getID())] + 1;
 			if (new_visit_count > iteration)
 				iteration = new_visit_count;
 
@@ -358,8 +501,7 @@ void ImageComputer::doPreImageComputationForSCC_GeneralCase(const DepGraph& orig
 			}
 
 			if (!new_auto->checkInclusion(prev_auto, new_auto->getID(), prev_auto->getID())) {
-				auto isVisited = visited.insert(succ_node);
-				if (isVisited.second) {
+				if (visited.insert(succ_node)) {
 					worklist.push(succ_node);
 				}
 
@@ -368,13 +510,46 @@ void ImageComputer::doPreImageComputationForSCC_GeneralCase(const DepGraph& orig
 				delete tmp_auto;
 
 				bwAnalysisResult.set(succ_node->getID(), new_auto);
-				visit_count[succ_node->getID()] = new_visit_count;
+				visit_count[DepGraph::nodeIndex(succ_node->getID())] = new_visit_count;
 			}
 		}
 
 	} while( !worklist.empty() && iteration < 30000 );
 }
 
+/**
+ * Inverts a concat on a single string: if concatAuto is a singleton, try all
+ * splits of its string and keep the child part of the first split where both
+ * parts are in the forward images of the child and its sibling.
+ * Returns nullptr if there is no single string to split, the caller then
+ * falls back to the symbolic pre-image.
+ */
+StrangerAutomaton* ImageComputer::makeConcretePreImageForConcatChild(
+    const StrangerAutomaton* concatAuto, const StrangerAutomaton* childAuto,
+    const StrangerAutomaton* siblingAuto, bool childIsLeft, int id) {
+
+	if (!concatAuto->isSingleton()) {
+		return nullptr;
+	}
+	string target = concatAuto->getStr();
+	vector<string> childParts;
+	vector<string> siblingParts;
+	for (size_t i = 0; i <= target.size(); i++) {
+		string left = target.substr(0, i);
+		string right = target.substr(i);
+		childParts.push_back(childIsLeft ? left : right);
+		siblingParts.push_back(childIsLeft ? right : left);
+	}
+	vector<bool> childAccepts = childAuto->acceptsBatch(childParts);
+	vector<bool> siblingAccepts = siblingAuto->acceptsBatch(siblingParts);
+	for (size_t i = 0; i < childParts.size(); i++) {
+		if (childAccepts[i] && siblingAccepts[i]) {
+			return StrangerAutomaton::makeString(childParts[i], id);
+		}
+	}
+	return nullptr;
+}
+
 /**
  *
  */
@@ -383,14 +558,15 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
     AnalysisResult& bwAnalysisResult, const AnalysisResult& fwAnalysisResult) {
 
 	StrangerAutomaton* retMe = nullptr;
-	NodesList successors = depGraph.getSuccessors(opNode);
+	NodeSpan successors = depGraph.getSuccessors(opNode);
 	const StrangerAutomaton* opAuto = bwAnalysisResult.get(opNode->getID());
-	string opName = opNode->getName();
+	const string& opName = opNode->getName();
 
 
 
 	// __vlab_restrict
-	if (opName.find("__vlab_restrict") != string::npos) {
+	switch (opNode->getOpCode()) {
+	case DepGraphOpNode::VlabRestrict: {
 		boost::posix_time::ptime start_time = perfInfo->current_time();
 		if (successors.size() != 3) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "__vlab_restrict invalid number of arguments");
@@ -410,7 +586,9 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
 		perfInfo->pre_vlab_restrict_total_time += perfInfo->current_time() - start_time;
 		perfInfo->number_of_pre_vlab_restrict++;
 
-	} else if ((opName == ".") || (opName == "concat")) {
+		break;
+	}
+	case DepGraphOpNode::Concat: {
 		if (successors.size() < 2)
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "less than two successors for concat node " << opNode->getID());
 
@@ -439,7 +617,12 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
                                     }
 				} else {
                                         const StrangerAutomaton* rightSiblingAuto = fwAnalysisResult.find(rightSibling->getID())->second;
-					retMe = concatAuto->leftPreConcat(rightSiblingAuto, childNode->getID());
+					if (m_exampleOnly) {
+						retMe = makeConcretePreImageForConcatChild(concatAuto, leftIt->second, rightSiblingAuto, true, childNode->getID());
+					}
+					if (retMe == nullptr) {
+						retMe = concatAuto->leftPreConcat(rightSiblingAuto, childNode->getID());
+					}
 				}
 			}
 
@@ -461,7 +644,12 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
                                     }
 				} else {
                                         const StrangerAutomaton* leftSiblingAuto = fwAnalysisResult.find(leftSibling->getID())->second;
-					retMe = concatAuto->rightPreConcat(leftSiblingAuto, childNode->getID());
+					if (m_exampleOnly) {
+						retMe = makeConcretePreImageForConcatChild(concatAuto, rightIt->second, leftSiblingAuto, false, childNode->getID());
+					}
+					if (retMe == nullptr) {
+						retMe = concatAuto->rightPreConcat(leftSiblingAuto, childNode->getID());
+					}
 				}
 			}
 
@@ -469,35 +657,53 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "child (" << childNode->getID() << ") of concat (" << opNode->getID() << ") is not equal to any of the two successors.");
 		}
 
-	} else if (opName == "addslashes") {
+		break;
+	}
+	case DepGraphOpNode::AddSlashes: {
 		// only has one parameter ==>  string addslashes  ( string $str  )
 		retMe = StrangerAutomaton::pre_addslashes(opAuto,childNode->getID());
 
-	} else if (opName == "encodeAttrString") {
+		break;
+	}
+	case DepGraphOpNode::EncodeAttrString: {
         // only has one parameter ==>  string encodeAttrString  ( string $str  )
         retMe = StrangerAutomaton::pre_encodeAttrString(opAuto,childNode->getID());
-    } else if (opName == "encodeTextFragment") {
+		break;
+	}
+	case DepGraphOpNode::EncodeTextFragment: {
         // only has one parameter ==>  string addslashes  ( string $str  )
         retMe = StrangerAutomaton::pre_encodeTextFragment(opAuto,childNode->getID());
-    } else if (opName == "trim" ) {
+		break;
+	}
+	case DepGraphOpNode::Trim: {
 		// only has one parameter ==>  string trim  ( string $str  )
 		retMe = opAuto->preTrimSpaces(childNode->getID());
-	} else if (opName == "rtrim" ) {
+		break;
+	}
+	case DepGraphOpNode::RTrim: {
 		// only has one parameter ==>  string trim  ( string $str  )
 		retMe = opAuto->preTrimSpacesRigth(childNode->getID());
-	} else if (opName == "ltrim" ) {
+		break;
+	}
+	case DepGraphOpNode::LTrim: {
 		// only has one parameter ==>  string trim  ( string $str  )
 		retMe = opAuto->preTrimSpacesLeft(childNode->getID());
 
-	}  else if (opName == "strtoupper" ) {
+		break;
+	}
+	case DepGraphOpNode::ToUpperCase: {
 		// only has one parameter ==>  string strtoupper  ( string $str  )
 		retMe = opAuto->preToUpperCase(childNode->getID());
 
-	}  else if (opName == "strtolower" ) {
+		break;
+	}
+	case DepGraphOpNode::ToLowerCase: {
 		// only has one parameter ==>  string strtolower  ( string $str  )
 		retMe = opAuto->preToLowerCase(childNode->getID());
 
-	} else if (opName == "htmlspecialchars") {
+		break;
+	}
+	case DepGraphOpNode::HtmlSpecialChars: {
 		if (childNode->equals(successors[0])) {
 			string flagString = "ENT_COMPAT";
 			if (successors.size() > 1) {
@@ -509,15 +715,21 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
 		} else {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "SNH: child node (" << childNode->getID() << ") of htmlspecialchars (" << opNode->getID() << ") is not in backward path");
 		}
-	} else if (opName == "mysql_escape_string") {
+		break;
+	}
+	case DepGraphOpNode::MysqlEscapeString: {
 		// has one parameter
 		retMe = StrangerAutomaton::pre_mysql_escape_string(opAuto, childNode->getID());
 
-	}  else if (opName == "mysql_real_escape_string") {
+		break;
+	}
+	case DepGraphOpNode::MysqlRealEscapeString: {
 		// has one parameter
 		retMe = StrangerAutomaton::pre_mysql_real_escape_string(opAuto, childNode->getID());
 
-	} else if (opName == "preg_replace" || opName == "ereg_replace" || opName == "str_replace") {
+		break;
+	}
+	case DepGraphOpNode::Replace: {
 
 		if (successors.size() != 3) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "replace invalid number of arguments");
@@ -547,7 +759,9 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
 		} else {
 			retMe = subjectAuto->preReplace(patternAuto, replaceStr, childNode->getID());
 		}
-        } else if (opName == "str_replace_once") {
+		break;
+	}
+	case DepGraphOpNode::ReplaceOnce: {
             if (successors.size() != 3) {
                 throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "replace invalid number of arguments");
             }
@@ -561,7 +775,9 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
             string replaceStr = replaceAuto->getStr();
             retMe = subjectAuto->preReplaceOnce(patternAuto, replaceStr, childNode->getID());
 
-	} else if ((opName == "regex_match") || (opName == "regex_exec")) {
+		break;
+	}
+	case DepGraphOpNode::RegexMatch: {
 
 		if (successors.size() != 3) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "replace invalid number of arguments");
@@ -579,7 +795,9 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
                 int group = stoi(groupValue);
 
                 retMe = subjectAuto->preMatch(patternAuto, group, childNode->getID());
-	} else if (opName == "split") {
+		break;
+	}
+	case DepGraphOpNode::Split: {
                 // Model split as simply replacing the split character with an empty string
 		if (successors.size() != 2) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "replace invalid number of arguments: " << opNode->getID());
@@ -592,7 +810,9 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
 
 		retMe = subjectAuto->preReplace(patternAuto,"", childNode->getID());
 
-	} else if (opName == "substr"){
+		break;
+	}
+	case DepGraphOpNode::Substr: {
 
 		if (successors.size() < 2) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "substr invalid number of arguments");
@@ -626,12 +846,18 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
                     retMe = subjectAuto->clone(opNode->getID());
                 }
 
-	} else if (opName == "md5") {
+		break;
+	}
+	case DepGraphOpNode::Md5: {
 		retMe = StrangerAutomaton::makeAnyString(opNode->getID());
-	} else if (opName == "encodeURIComponent") {
+		break;
+	}
+	case DepGraphOpNode::EncodeURIComponent: {
                 // Backwards analysis, so perform the inversion function
                 retMe = StrangerAutomaton::decodeURIComponent(opAuto, opNode->getID());
-	} else if (opName == "decodeURIComponent") {
+		break;
+	}
+	case DepGraphOpNode::DecodeURIComponent: {
                 // Backwards analysis, so perform the inversion function
             if (opAuto->get_num_of_states() > 1000) {
                 std::cout << "Approximating BW analysis for " << opName << " nStates: " << opAuto->get_num_of_states() << std::endl;
@@ -639,27 +865,42 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
             } else {
 		retMe = StrangerAutomaton::encodeURIComponent(opAuto, opNode->getID());
             }
-	} else if (opName == "encodeURI") {
+		break;
+	}
+	case DepGraphOpNode::EncodeURI: {
                 // Backwards analysis, so perform the inversion function
                 retMe = StrangerAutomaton::decodeURI(opAuto, opNode->getID());
-	} else if (opName == "decodeURI") {
+		break;
+	}
+	case DepGraphOpNode::DecodeURI: {
                 // Backwards analysis, so perform the inversion function
                retMe = StrangerAutomaton::encodeURI(opAuto, opNode->getID());
-	} else if (opName == "escape") {
+		break;
+	}
+	case DepGraphOpNode::Escape: {
                 // Backwards analysis, so perform the inversion function
                 retMe = StrangerAutomaton::unescape(opAuto, opNode->getID());
-	} else if (opName == "unescape") {
+		break;
+	}
+	case DepGraphOpNode::Unescape: {
                 // Backwards analysis, so perform the inversion function
                retMe = StrangerAutomaton::escape(opAuto, opNode->getID());
-	} else if (opName == "JSON.stringify") {
+		break;
+	}
+	case DepGraphOpNode::JsonStringify: {
                 // Backwards analysis, so perform the inversion function
                 retMe = StrangerAutomaton::jsonParse(opAuto, opNode->getID());
-	} else if (opName == "JSON.parse") {
+		break;
+	}
+	case DepGraphOpNode::JsonParse: {
                 // Backwards analysis, so perform the inversion function
                 retMe = StrangerAutomaton::jsonStringify(opAuto, opNode->getID());
-	} else {
+		break;
+	}
+	default: {
 		throw StrangerException(AnalysisError::NotImplemented,  "Not implemented yet for regular validation phase: " + opName);
 	}
+	}
 
 	return retMe;
 }
@@ -668,9 +909,9 @@ StrangerAutomaton* ImageComputer::makePreImageForOpChild_GeneralCase(
 //
 string ImageComputer::getLiteralOrConstantValue( const DepGraphNode* node) {
     string retMe = "";
-    const DepGraphNormalNode* normalNode = dynamic_cast<const DepGraphNormalNode*>(node);
-    if (normalNode == nullptr)
+    if (node->getKind() != DepGraphNode::Normal)
         throw runtime_error("can not cast DepGraphNode into DepGraphNormalNode");
+    const DepGraphNormalNode* normalNode = static_cast<const DepGraphNormalNode*>(node);
     TacPlace* place = normalNode->getPlace();
     if (dynamic_cast<Literal*>(place) != nullptr || dynamic_cast<Constant*>(place) != nullptr || dynamic_cast<RegExpNode*>(place) !=
                                                                                                          nullptr) {
@@ -685,9 +926,9 @@ string ImageComputer::getLiteralOrConstantValue( const DepGraphNode* node) {
 
 // ********************************************************************************
 //
-bool ImageComputer::isLiteralOrConstant(const DepGraphNode* node, NodesList successors) {
-    if ((dynamic_cast<const DepGraphNormalNode*>(node) != nullptr)  && (successors.empty())){
-        const DepGraphNormalNode* normalNode = dynamic_cast<const DepGraphNormalNode*>(node);
+bool ImageComputer::isLiteralOrConstant(const DepGraphNode* node, const NodeSpan& successors) {
+    if (node->getKind() == DepGraphNode::Normal && successors.empty()) {
+        const DepGraphNormalNode* normalNode = static_cast<const DepGraphNormalNode*>(node);
         TacPlace* place = normalNode->getPlace();
         if (dynamic_cast<Literal*>(place) != nullptr || dynamic_cast<Constant*>(place) || dynamic_cast<RegExpNode*>(place) !=
                                                                                           nullptr)
@@ -700,9 +941,9 @@ bool ImageComputer::isLiteralOrConstant(const DepGraphNode* node, NodesList succ
 
 StrangerAutomaton* ImageComputer::getLiteralorConstantNodeAuto(const DepGraphNode* node, bool is_vlab_restrict) {
     StrangerAutomaton* retMe = nullptr;
-    const DepGraphNormalNode* normalNode = dynamic_cast<const DepGraphNormalNode*>(node);
-    if (normalNode == nullptr)
+    if (node->getKind() != DepGraphNode::Normal)
         throw runtime_error("can not cast DepGraphNode into DepGraphNormalNode");
+    const DepGraphNormalNode* normalNode = static_cast<const DepGraphNormalNode*>(node);
 	TacPlace* place = normalNode->getPlace();
 	if(dynamic_cast<RegExpNode*>(place) != nullptr) {
         string value = place->toString();
@@ -751,18 +992,22 @@ void ImageComputer::doForwardAnalysis_GeneralCase(DepGraph& depGraph, DepGraphNo
 
 
 	stack<DepGraphNode*> process_stack;
-	set<DepGraphNode*> visited;
+	NodeSet visited(depGraph);
 	set<int> processed_SCCs;
 
 	process_stack.push(node);
 	while (!process_stack.empty()) {
 
 		DepGraphNode *curr = process_stack.top();
-		auto isNotVisited = visited.insert(curr);
-		NodesList successors = depGraph.getSuccessors(curr);
+		bool isNotVisited = visited.insert(curr);
+		if (isNotVisited && reuseSubtreeImages(depGraph, curr, analysisResult)) {
+			process_stack.pop();
+			continue;
+		}
+		NodeSpan successors = depGraph.getSuccessors(curr);
 
-		if (!successors.empty() && isNotVisited.second) {
-			for (NodesListConstReverseIterator it = successors.rbegin(); it != successors.rend(); it++) {
+		if (!successors.empty() && isNotVisited) {
+			for (NodeSpan::const_reverse_iterator it = successors.rbegin(); it != successors.rend(); it++) {
 				if (analysisResult.find((*it)->getID()) == analysisResult.end()) {
 					process_stack.push(*it);
 				}
@@ -784,36 +1029,29 @@ void ImageComputer::doForwardAnalysis_GeneralCase(DepGraph& depGraph, DepGraphNo
 
 void ImageComputer::doPostImageComputation_GeneralCase(DepGraph& depGraph, DepGraphNode* node, AnalysisResult& analysisResult) {
 
-	NodesList successors = depGraph.getSuccessors(node);
+	NodeSpan successors = depGraph.getSuccessors(node);
 
 	StrangerAutomaton* newAuto = nullptr;
-	DepGraphNormalNode* normalNode;
-	DepGraphOpNode* opNode;
-	DepGraphUninitNode* uninitNode;
-	if ((normalNode = dynamic_cast<DepGraphNormalNode*>(node)) != nullptr) {
+	if (node->getKind() == DepGraphNode::Normal) {
 		if (successors.empty()) {
-			newAuto = getLiteralorConstantNodeAuto(normalNode, false);
+			newAuto = getLiteralorConstantNodeAuto(node, false);
 		} else {
 			// an interior node, union of all its successors
+			std::vector<const StrangerAutomaton*> succAutos;
 			for (auto succ_node : successors) {
 				if (succ_node->getID() == node->getID() ) {
 					// avoid simple loops
 					continue;
 				}
-
-				const StrangerAutomaton *succAuto = analysisResult.get(succ_node->getID());
-				if (newAuto == nullptr) {
-					newAuto = succAuto->clone(node->getID());
-				} else {
-					StrangerAutomaton* temp = newAuto;
-					newAuto = newAuto->union_(succAuto, node->getID());
-					delete temp;
-				}
+				succAutos.push_back(analysisResult.get(succ_node->getID()));
+			}
+			if (!succAutos.empty()) {
+				newAuto = StrangerAutomaton::unionAll(succAutos, node->getID());
 			}
 		}
-	} else if ((opNode = dynamic_cast<DepGraphOpNode*>(node)) != nullptr) {
-		newAuto = makePostImageForOp_GeneralCase(depGraph, opNode, analysisResult);
-	} else if ((uninitNode = dynamic_cast<DepGraphUninitNode*>(node)) != nullptr) {
+	} else if (node->getKind() == DepGraphNode::Op) {
+		newAuto = makePostImageForOp_GeneralCase(depGraph, static_cast<DepGraphOpNode*>(node), analysisResult);
+	} else if (node->getKind() == DepGraphNode::Uninit) {
 		newAuto = ImageComputer::uninit_node_default_initialization->clone(node->getID());
 	} else {
 		throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "Cannot figure out node type!, node id: " << node->getID());
@@ -823,6 +1061,7 @@ void ImageComputer::doPostImageComputation_GeneralCase(DepGraph& depGraph, DepGr
 		throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "Forward automaton cannot be computed!, node id: " << node->getID());
 	}
 	analysisResult.set(node->getID(), newAuto);
+	storeSubtreeImage(depGraph, node, analysisResult);
 }
 
 /**
@@ -836,16 +1075,16 @@ void ImageComputer::doPostImageComputationForSCC_GeneralCase(DepGraph& depGraph,
 
 	int scc_id = depGraph.getSCCID(node);
 
-	map<int, int> visit_count;
+	std::vector<int> visit_count(depGraph.getNodeTableSize(), 0);
 	NodesList current_scc_nodes = depGraph.getSCCNodes(scc_id);
 
 	queue<DepGraphNode*> worklist;
-	set<DepGraphNode*> visited;
+	NodeSet visited(depGraph);
 
 	// initialize all scc_nodes to phi
 	for (auto& scc_node : current_scc_nodes) {
             analysisResult.set(scc_node->getID(), StrangerAutomaton::makePhi(scc_node->getID()));
-            visit_count[scc_node->getID()] = 0;
+            visit_count[DepGraph::nodeIndex(scc_node->getID())] = 0;
 	}
 
 	// add the successors to the worklist (in a depgraph successors are parents during forward analysis)
@@ -869,10 +1108,10 @@ void ImageComputer::doPostImageComputationForSCC_GeneralCase(DepGraph& depGraph,
 			StrangerAutomaton* tmp_auto = nullptr;
 			StrangerAutomaton* new_auto = nullptr;
 
-			if (dynamic_cast<DepGraphNormalNode*>(pred_node) != nullptr) {
+			if (pred_node->getKind() == DepGraphNode::Normal) {
                             tmp_auto = analysisResult.get(curr_node->getID())->clone(); // may need clone
-			} else if (dynamic_cast<DepGraphOpNode*>(pred_node) != nullptr) {
-                            tmp_auto = makePostImageForOp_GeneralCase(depGraph, dynamic_cast<DepGraphOpNode*>(pred_node), analysisResult);
+			} else if (pred_node->getKind() == DepGraphNode::Op) {
+                            tmp_auto = makePostImageForOp_GeneralCase(depGraph, static_cast<DepGraphOpNode*>(pred_node), analysisResult);
 			} else {
                             throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "Node cannot be an element of SCC component!, node id: " << node->getID());
 			}
@@ -883,7 +1122,7 @@ void ImageComputer::doPostImageComputationForSCC_GeneralCase(DepGraph& depGraph,
 
 			new_auto = tmp_auto->union_(prev_auto, pred_node->getID());
 
-			int new_visit_count = visit_count[pred_node->getID()] + 1;
+			int new_visit_count = visit_count[DepGraph::nodeIndex(pred_node->getID())] + 1;
 			if (new_visit_count > iteration)
 				iteration = new_visit_count;
 
@@ -895,12 +1134,11 @@ void ImageComputer::doPostImageComputationForSCC_GeneralCase(DepGraph& depGraph,
 			}
 
 			if (!new_auto->checkInclusion(prev_auto, new_auto->getID(), prev_auto->getID())) {
-				auto isVisited = visited.insert(pred_node);
-				if (isVisited.second) {
+				if (visited.insert(pred_node)) {
 					worklist.push(pred_node);
 				}
 				analysisResult.set(pred_node->getID(), new_auto);
-				visit_count[pred_node->getID()] = new_visit_count;
+				visit_count[DepGraph::nodeIndex(pred_node->getID())] = new_visit_count;
 			}
 		}
 
@@ -912,12 +1150,13 @@ void ImageComputer::doPostImageComputationForSCC_GeneralCase(DepGraph& depGraph,
  * Recursive calls may only happen if the function is called from single input analysis functions
  */
 StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGraph, DepGraphOpNode* opNode, AnalysisResult& analysisResult) {
-	NodesList successors = depGraph.getSuccessors(opNode);
+	NodeSpan successors = depGraph.getSuccessors(opNode);
 	StrangerAutomaton* retMe = nullptr;
-	string opName = opNode->getName();
+	const string& opName = opNode->getName();
         //cout << "Computing : " << opName << endl;
 	// __vlab_restrict
-	if (opName.find("__vlab_restrict") != string::npos) {
+	switch (opNode->getOpCode()) {
+	case DepGraphOpNode::VlabRestrict: {
 		boost::posix_time::ptime start_time = perfInfo->current_time();
 		if (successors.size() != 3) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "__vlab_restrict invalid number of arguments: " << opNode->getID());
@@ -956,8 +1195,11 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 		perfInfo->vlab_restrict_total_time += perfInfo->current_time() - start_time;
 		perfInfo->number_of_vlab_restrict++;
 
-	} else if ((opName == ".") || (opName == "concat")) {
+		break;
+	}
+	case DepGraphOpNode::Concat: {
 		// TODO add option to ignore concats (heuristic)
+		std::vector<const StrangerAutomaton*> succAutos;
 		for (auto succ_node : successors){
 			if (analysisResult.find(succ_node->getID()) == analysisResult.end()) {
                             doForwardAnalysis_GeneralCase(depGraph, succ_node, analysisResult);
@@ -967,21 +1209,19 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
                             string value = getLiteralOrConstantValue(succ_node);
                             //std::cout << "Ignoring concat of string value: " << value << std::endl;
                         } else {
-                            if (retMe == nullptr) {
-                                retMe = succAuto->clone(opNode->getID());
-                            } else {
-                                //std::cout << "Doing concat with node " << succ_node->getID() << std::endl;
-                                StrangerAutomaton* temp = retMe;
-                                retMe = retMe->concatenate(succAuto, opNode->getID());
-                                delete temp;
-                            }
+                            succAutos.push_back(succAuto);
 			}
 		}
+		if (!succAutos.empty()) {
+			retMe = StrangerAutomaton::concatAll(succAutos, opNode->getID());
+		}
 		if (retMe == nullptr) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "Check successors of concatenation: " << opNode->getID());
 		}
 
-	} else if (opName == "preg_replace" || opName == "ereg_replace" || opName == "str_replace") {
+		break;
+	}
+	case DepGraphOpNode::Replace: {
 		if (successors.size() != 3) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "replace invalid number of arguments: " << opNode->getID());
 		}
@@ -1030,7 +1270,9 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 
 		retMe = StrangerAutomaton::general_replace(patternAuto,replaceAuto,subjectAuto, opNode->getID());
 
-	} else if (opName == "str_replace_once") {
+		break;
+	}
+	case DepGraphOpNode::ReplaceOnce: {
 		if (successors.size() != 3) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "replace invalid number of arguments: " << opNode->getID());
 		}
@@ -1079,7 +1321,9 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 
 		retMe = StrangerAutomaton::str_replace_once(patternAuto,replaceAuto,subjectAuto, opNode->getID());
 
-	} else if ((opName == "regex_match") || (opName == "regex_exec")) {
+		break;
+	}
+	case DepGraphOpNode::RegexMatch: {
 		if (successors.size() != 3) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "match invalid number of arguments: " << opNode->getID());
 		}
@@ -1109,7 +1353,9 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
                 
 		retMe = StrangerAutomaton::match(patternAuto, group, subjectAuto, opNode->getID());
 
-	} else if (opName == "split") {
+		break;
+	}
+	case DepGraphOpNode::Split: {
                 // Model split as simply replacing the split character with an empty string
 		if (successors.size() != 2) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "replace invalid number of arguments: " << opNode->getID());
@@ -1133,7 +1379,9 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 
                 delete replaceAuto;
 
-	} else if (opName == "addslashes") {
+		break;
+	}
+	case DepGraphOpNode::AddSlashes: {
 		if (successors.size() != 1) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "addslashes should have one child: " << opNode->getID());
 		}
@@ -1142,10 +1390,14 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 		StrangerAutomaton* slashesAuto = StrangerAutomaton::addslashes(paramAuto, opNode->getID());
 		retMe = slashesAuto;
 
-	} else if (opName == "stripslashes") {
+		break;
+	}
+	case DepGraphOpNode::StripSlashes: {
 		throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "stripslashes is not handled yet: " << opNode->getID());
 
-	} else if (opName == "mysql_escape_string") {
+		break;
+	}
+	case DepGraphOpNode::MysqlEscapeString: {
 		if (successors.size() < 1 || successors.size() > 2) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "mysql_escape_string wrong number of arguments: " << opNode->getID());
 		}
@@ -1154,7 +1406,9 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 		StrangerAutomaton* mysqlEscapeAuto = StrangerAutomaton::mysql_escape_string(paramAuto, opNode->getID());
 		retMe = mysqlEscapeAuto;
 
-	} else if (opName == "mysql_real_escape_string") {
+		break;
+	}
+	case DepGraphOpNode::MysqlRealEscapeString: {
 		if (successors.size() < 1 || successors.size() > 2) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "mysql_real_escape_string wrong number of arguments: " << opNode->getID());
 		}
@@ -1163,7 +1417,9 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 		StrangerAutomaton* mysqlEscapeAuto = StrangerAutomaton::mysql_real_escape_string(paramAuto, opNode->getID());
 		retMe = mysqlEscapeAuto;
 
-	} else if (opName == "htmlspecialchars") {
+		break;
+	}
+	case DepGraphOpNode::HtmlSpecialChars: {
                 const StrangerAutomaton* paramAuto = analysisResult.get(successors[0]->getID());
 		string flagString = "ENT_COMPAT";
 		if (successors.size() > 1) {
@@ -1176,7 +1432,9 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 		StrangerAutomaton* htmlSpecAuto = StrangerAutomaton::htmlSpecialChars(paramAuto, flagString, opNode->getID());
 		retMe = htmlSpecAuto;
 
-	} else if (opName == "nl2br"){
+		break;
+	}
+	case DepGraphOpNode::Nl2br: {
 		if (successors.size() < 1 || successors.size() > 2) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "nl2br wrong number of arguments: " << opNode->getID());
 		}
@@ -1185,7 +1443,9 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 		StrangerAutomaton* nl2brAuto = StrangerAutomaton::nl2br(paramAuto, opNode->getID());
 		retMe = nl2brAuto;
 
-	}  else if (opName == "substr"){
+		break;
+	}
+	case DepGraphOpNode::Substr: {
 		if (successors.size() < 2) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "SNH: substr invalid number of arguments: " << opNode->getID());
 		}
@@ -1225,20 +1485,27 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
                     //std::cout << "Ignoring substr operation" << std::endl;
                     retMe = subjectAuto->clone(opNode->getID());
                 }
-	} else if (opName == "strtoupper" || opName == "strtolower") {
+		break;
+	}
+	case DepGraphOpNode::ToUpperCase:
+	case DepGraphOpNode::ToLowerCase: {
 		if (successors.size() != 1) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << opName << " has more than one successor in depgraph" );
 		}
 
 		const StrangerAutomaton* paramAuto = analysisResult.get(successors[0]->getID());
-		if (opName == "strtoupper") {
+		if (opNode->getOpCode() == DepGraphOpNode::ToUpperCase) {
 			retMe = paramAuto->toUpperCase(opNode->getID());
 		}
-		else if (opName == "strtolower") {
+		else if (opNode->getOpCode() == DepGraphOpNode::ToLowerCase) {
 			retMe = paramAuto->toLowerCase(opNode->getID());
 		}
 
-	} else if (opName == "trim" || opName == "rtrim" || opName == "ltrim") {
+		break;
+	}
+	case DepGraphOpNode::Trim:
+	case DepGraphOpNode::RTrim:
+	case DepGraphOpNode::LTrim: {
 		if (successors.size() > 2) {
 			throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << opName << " has more than one successor in depgraph" );
 		} else if (successors.size() == 2) {
@@ -1250,57 +1517,77 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 		}
 
 		const StrangerAutomaton* paramAuto = analysisResult.get(successors[0]->getID());
-		if (opName == "trim")
+		if (opNode->getOpCode() == DepGraphOpNode::Trim)
 			retMe = paramAuto->trimSpaces(opNode->getID());
-		else if (opName == "rtrim") {
+		else if (opNode->getOpCode() == DepGraphOpNode::RTrim) {
 			retMe = paramAuto->trimSpacesRight(opNode->getID());
 		}
-		else if (opName == "ltrim") {
+		else if (opNode->getOpCode() == DepGraphOpNode::LTrim) {
 			retMe = paramAuto->trimSpacesLeft(opNode->getID());
 		}
 
-	} else if (opName == "md5") {
+		break;
+	}
+	case DepGraphOpNode::Md5: {
 		//conservative desicion
 		retMe = StrangerAutomaton::regExToAuto("/[aAbBcCdDeEfF0-9]{32,32}/",true, opNode->getID());
-	} else if (opName == "encodeURIComponent") {
+		break;
+	}
+	case DepGraphOpNode::EncodeURIComponent: {
                 const StrangerAutomaton* paramAuto = analysisResult.get(successors[0]->getID());
 		StrangerAutomaton* uriAuto = StrangerAutomaton::encodeURIComponent(paramAuto, opNode->getID());
 		retMe = uriAuto;
 
-	} else if (opName == "decodeURIComponent") {
+		break;
+	}
+	case DepGraphOpNode::DecodeURIComponent: {
                 const StrangerAutomaton* paramAuto = analysisResult.get(successors[0]->getID());
 		StrangerAutomaton* uriAuto = StrangerAutomaton::decodeURIComponent(paramAuto, opNode->getID());
 		retMe = uriAuto;
 
-	} else if (opName == "encodeURI") {
+		break;
+	}
+	case DepGraphOpNode::EncodeURI: {
                 const StrangerAutomaton* paramAuto = analysisResult.get(successors[0]->getID());
 		StrangerAutomaton* uriAuto = StrangerAutomaton::encodeURI(paramAuto, opNode->getID());
 		retMe = uriAuto;
 
-	} else if (opName == "decodeURI") {
+		break;
+	}
+	case DepGraphOpNode::DecodeURI: {
                 const StrangerAutomaton* paramAuto = analysisResult.get(successors[0]->getID());
 		StrangerAutomaton* uriAuto = StrangerAutomaton::decodeURI(paramAuto, opNode->getID());
 		retMe = uriAuto;
 
-	} else if (opName == "escape") {
+		break;
+	}
+	case DepGraphOpNode::Escape: {
                 const StrangerAutomaton* paramAuto = analysisResult.get(successors[0]->getID());
 		StrangerAutomaton* uriAuto = StrangerAutomaton::escape(paramAuto, opNode->getID());
 		retMe = uriAuto;
 
-	} else if (opName == "unescape") {
+		break;
+	}
+	case DepGraphOpNode::Unescape: {
                 const StrangerAutomaton* paramAuto = analysisResult.get(successors[0]->getID());
 		StrangerAutomaton* uriAuto = StrangerAutomaton::unescape(paramAuto, opNode->getID());
 		retMe = uriAuto;
 
-	} else if (opName == "JSON.stringify") {
+		break;
+	}
+	case DepGraphOpNode::JsonStringify: {
                 const StrangerAutomaton* paramAuto = analysisResult.get(successors[0]->getID());
 		StrangerAutomaton* json = StrangerAutomaton::jsonStringify(paramAuto, opNode->getID());
 		retMe = json;
-	} else if (opName == "JSON.parse") {
+		break;
+	}
+	case DepGraphOpNode::JsonParse: {
                 const StrangerAutomaton* paramAuto = analysisResult.get(successors[0]->getID());
 		StrangerAutomaton* json = StrangerAutomaton::jsonParse(paramAuto, opNode->getID());
 		retMe = json;
-	} else if (opName == "encodeTextFragment") {
+		break;
+	}
+	case DepGraphOpNode::EncodeTextFragment: {
                 if (successors.size() < 1 || successors.size() > 2) {
                     throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "encodeTextFragment wrong number of arguments: " << opNode->getID());
                 }
@@ -1308,7 +1595,9 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 
                 StrangerAutomaton* encodedAuto = StrangerAutomaton::encodeTextFragment(paramAuto, opNode->getID());
                 retMe = encodedAuto;
-        } else if (opName == "encodeAttrString") {
+		break;
+	}
+	case DepGraphOpNode::EncodeAttrString: {
             if (successors.size() < 1 || successors.size() > 2) {
                 throw StrangerException(AnalysisError::MalformedDepgraph, stringbuilder() << "encodeAttrString wrong number of arguments: " << opNode->getID());
             }
@@ -1316,7 +1605,9 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
 
         StrangerAutomaton* encodedAuto = StrangerAutomaton::encodeAttrString(paramAuto, opNode->getID());
         retMe = encodedAuto;
-    } else {
+		break;
+	}
+	default: {
             cout << "!!! Warning: Unmodeled builtin general function : " << opName << endl;
             f_unmodeled.push_back(opNode);
 
@@ -1328,7 +1619,8 @@ StrangerAutomaton* ImageComputer::makePostImageForOp_GeneralCase(DepGraph& depGr
             // Throw an exception
             
             throw StrangerException(AnalysisError::NotImplemented, stringbuilder() << "Unknown function " << opName);
-    }
+	}
+	}
 
         //retMe->printAutomatonVitals();
     return retMe;
@@ -36,6 +36,9 @@ public:
     ImageComputer(bool doConcats, bool doSubstr, StrangerAutomaton* inputAuto);
     virtual ~ImageComputer();
 
+    // Only track a single witness string per node in the backward analysis
+    void setExampleOnly(bool exampleOnly) { m_exampleOnly = exampleOnly; }
+
     /****************************************************************************************************/
     /*********** SINGLE INPUT POST-IMAGE COMPUTATION METHODS **********************************************/
     /****************************************************************************************************/
@@ -65,12 +68,21 @@ public:
 
 protected:
     std::string getLiteralOrConstantValue(const DepGraphNode* node);
-    bool isLiteralOrConstant(const DepGraphNode* node, NodesList successors);
+    bool isLiteralOrConstant(const DepGraphNode* node, const NodeSpan& successors);
     /**
     *
     * TODO pattern for __vlab_restrict and other replace operations handled differently. There are some cases not handled yet for this reason where a pattern variable flows into both functions.
     */
     StrangerAutomaton* getLiteralorConstantNodeAuto(const DepGraphNode* node, bool is_vlab_restrict);
+    // Reuse of forward images of sub-DAGs shared with other graphs
+    std::size_t subtreeKey(const DepGraph& depGraph, const DepGraphNode* node, const AnalysisResult& analysisResult,
+                           std::vector<const StrangerAutomaton*>& inputs) const;
+    StrangerAutomaton* lookupSubtreeImage(const DepGraph& depGraph, const DepGraphNode* node, const AnalysisResult& analysisResult) const;
+    bool reuseSubtreeImages(const DepGraph& depGraph, DepGraphNode* node, AnalysisResult& analysisResult);
+    void storeSubtreeImage(const DepGraph& depGraph, const DepGraphNode* node, const AnalysisResult& analysisResult);
+
+    StrangerAutomaton* makeConcretePreImageForConcatChild(const StrangerAutomaton* concatAuto, const StrangerAutomaton* childAuto,
+                                                          const StrangerAutomaton* siblingAuto, bool childIsLeft, int id);
 
 private:
 
@@ -80,6 +92,9 @@ private:
 
     bool m_doConcats;
     bool m_doSubstr;
+    bool m_exampleOnly;
+    // Part of the subtree cache keys, 0 without input automaton
+    std::size_t m_inputAutoFingerprint;
 
 };
 
@@ -27,10 +27,17 @@
 #include "AttackPatterns.hpp"
 #include "MultiAttack.hpp"
 #include "StrangerAutomaton.hpp"
+#include "DFAInterner.hpp"
+#include "FunctionModelCache.hpp"
+#include "SubtreeImageCache.hpp"
+#include "ForwardImageStore.hpp"
+#include "TarReader.hpp"
+#include "depgraph/CompressedFile.hpp"
 
 #include <iostream>
 #include <fstream>
 #include <thread>
+#include <sstream>
 #include <algorithm>
 #include <functional>
 #include <unordered_set>
@@ -38,23 +45,47 @@
 
 namespace asio = boost::asio;
 
+namespace {
+
+  // Dot files and tar archives, possibly compressed
+  bool isDotFile(const fs::path& file) {
+    return fs::path(uncompressedName(file.string())).extension() == ".dot";
+  }
+
+  bool isArchive(const fs::path& file) {
+    return fs::path(uncompressedName(file.string())).extension() == ".tar";
+  }
+
+}
+
 MultiAttack::MultiAttack(const std::string& graph_directory, const std::string& output_dir, const std::string& input_field_name, int max, StrangerAutomaton* input_auto)
   : m_graph_directory(graph_directory)
   , m_output_directory(output_dir)
   , m_input_name(input_field_name)
   , m_dot_paths()
+  , m_pack()
+  , m_manifest()
+  , m_loader()
+  , m_claims()
   , m_results()
   , m_result_hash_map()
   , m_automata()
   , m_groups()
   , m_analyzed_contexts()
+  , m_lattice()
+  , m_implied_verdicts(0)
   , results_mutex()
+  , m_load_mutex()
+  , m_scanned()
+  , m_unscanned(0)
   , m_nThreads(boost::thread::hardware_concurrency())
   , m_max(max)
+  , m_read_ahead(0)
   , m_concats(0)
   , m_compute_preimage(true)
   , m_output_dotfiles(true)
   , m_attack_forward(false)
+  , m_example_only(false)
   , m_no_exploit_match(true)
   , m_input_automaton(nullptr)
 {
@@ -163,7 +194,7 @@ void MultiAttack::printFiles(std::ostream& os) const {
 
 void MultiAttack::printResults(std::ostream& os, bool printFiles) const
 {
-  os << "# Found " << this->m_dot_paths.size() << " dot files" << std::endl;
+  os << "# Found " << (m_pack ? m_pack->size() : this->m_dot_paths.size()) << " dot files" << std::endl;
   os << "# Computed images with pool of " << m_nThreads << " threads." << std::endl;
   os << "# Printing Groups:" << std::endl;
   m_groups.printGroups(os, printFiles, m_analyzed_contexts);
@@ -201,7 +232,12 @@ void MultiAttack::computeAttackPatternOverlap(CombinedAnalysisResult* result, At
   try {
     fs::path dir(m_output_directory / result->getAttack()->getFile());
     BackwardAnalysisResult* bw = result->addBackwardAnalysis(context);
-    bw->doAnalysis(m_compute_preimage, m_singleton_intersection, m_attack_forward);
+    if (isImpliedSafe(result, context)) {
+      bw->setImpliedSafe();
+      m_implied_verdicts++;
+    } else {
+      bw->doAnalysis(m_compute_preimage, m_singleton_intersection, m_attack_forward, m_example_only);
+    }
     if (m_output_dotfiles) {
       bw->writeResultsToFile(dir);
     }
@@ -211,6 +247,25 @@ void MultiAttack::computeAttackPatternOverlap(CombinedAnalysisResult* result, At
   }
 }
 
+bool MultiAttack::isImpliedSafe(const CombinedAnalysisResult* result, AttackContext context) const
+{
+  // The post attack image is only computed for safe patterns, so nothing can be skipped
+  if (m_attack_forward) {
+    return false;
+  }
+  auto search = m_lattice.supersets.find(context);
+  if (search == m_lattice.supersets.end()) {
+    return false;
+  }
+  // No overlap with a more general pattern means no overlap with this one either
+  for (auto super : search->second) {
+    if (result->isFilterSuccessful(super)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void MultiAttack::computeAttackPatternOverlapForMetadata(CombinedAnalysisResult* result)
 {
   const std::string& file = result->getAttack()->getFileName();
@@ -218,7 +273,7 @@ void MultiAttack::computeAttackPatternOverlapForMetadata(CombinedAnalysisResult*
             << file
             << std::endl;
   fs::path dir(m_output_directory / result->getAttack()->getFile());
-  result->doMetadataSpecificAnalysis(dir, true, m_singleton_intersection, m_output_dotfiles, m_attack_forward);
+  result->doMetadataSpecificAnalysis(dir, true, m_singleton_intersection, m_output_dotfiles, m_attack_forward, m_example_only);
 }
 
 CombinedAnalysisResult* MultiAttack::findOrCreateResult(const fs::path& file, DepGraph& target_dep_graph, boost::asio::thread_pool &pool) {
@@ -271,11 +326,12 @@ void MultiAttack::doFwAnalysis(CombinedAnalysisResult* result) {
     // Forward Analysis
     result->getAttack()->init();
     result->getFwAnalysis().doAnalysis(m_concats);
-    postImage = result->getFwAnalysis().getPostImage();
     if (m_output_dotfiles) {
       result->getAttack()->writeResultsToFile(dir);
       result->getFwAnalysis().writeResultsToFile(dir);
     }
+    result->getFwAnalysis().handOff();
+    postImage = result->getFwAnalysis().getPostImage();
   } catch (std::exception const &e) {
     errored = true;
     std::cout << "EXCEPTION! In FW analysis: " << file << " in thread " << std::this_thread::get_id()
@@ -308,8 +364,8 @@ void MultiAttack::doBwAnalysis(CombinedAnalysisResult* result) {
   }
   const std::string file = result->getFileName();
 
-  // Backward analysis
-  for (auto c : m_analyzed_contexts) {
+  // Backward analysis, general patterns first so their safe verdicts carry over
+  for (auto c : m_lattice.order) {
       computeAttackPatternOverlap(result, c);
   }
 
@@ -326,32 +382,227 @@ void MultiAttack::doBwAnalysis(CombinedAnalysisResult* result) {
 }
 
 void MultiAttack::loadDepGraphs() {
-  findDotFiles();
   boost::asio::thread_pool pool(this->m_nThreads);
 
+  // Depgraphs are scanned as soon as they are found, so parsing overlaps
+  // with the directory traversal
   std::cout << "Parsing dependency graphs..." << std::endl;
-  // Add all files first
-  int n = 0;
-  for (const auto& file : this->m_dot_paths) {
-    n++;
-    if ((m_max > 0) && (n > m_max)) {
-      break;
+  if (fs::is_regular_file(this->m_graph_directory) && DepGraphPack::isPack(this->m_graph_directory.string())) {
+    m_pack.reset(new DepGraphPack(this->m_graph_directory.string()));
+    std::cout << "Found " << m_pack->size() << " dependency graphs in pack." << std::endl;
+    // The index has the sanitizer hash of every graph, so the graphs are
+    // grouped without reading their records
+    std::map<int, std::vector<std::size_t> > groups;
+    for (std::size_t i = 0; i < m_pack->size() && (m_max <= 0 || i < static_cast<std::size_t>(m_max)); i++) {
+      int hash = m_pack->getSanitizerHash(i);
+      if (hash == 0) {
+        // No sanitizer hash, or one that can not be told apart from none
+        asio::post(pool, std::bind(&MultiAttack::scanDepGraph, this, DepGraphSource{i, fs::path(), nullptr, false}, std::ref(pool)));
+      } else {
+        groups[hash].push_back(i);
+      }
+    }
+    for (auto& group : groups) {
+      asio::post(pool, std::bind(&MultiAttack::analysePackGroup, this, std::move(group.second), std::ref(pool)));
     }
-    asio::post(pool, [this, &pool, file]() {
-        try {
-          DepGraph target_dep_graph = DepGraph::parseDotFile(file.string());
-          {
-            this->findOrCreateResult(file, target_dep_graph, pool);
+  } else {
+    if (m_read_ahead > 0) {
+      m_loader.reset(new DotFileLoader(m_read_ahead, [this, &pool](std::size_t id, const fs::path& file, std::shared_ptr<const std::string> contents) {
+          if (contents) {
+            // Blocks the loader while the analysis is behind, so the read
+            // files do not pile up in memory
+            std::unique_lock<std::mutex> lock(this->m_load_mutex);
+            m_scanned.wait(lock, [this]() { return m_unscanned < maxUnscanned(); });
+            m_unscanned++;
           }
-        } catch(std::exception& e) {
-          cerr << "Error parsing " << file.string() << ": " << e.what() << "\n";
-        }
-      });
+          asio::post(pool, std::bind(&MultiAttack::scanDepGraph, this, DepGraphSource{id, file, contents, false}, std::ref(pool)));
+        }));
+      std::cout << "Reading dot files " << (m_loader->usesIoUring() ? "with io_uring" : "on loader threads")
+                << ", " << m_read_ahead << " reads in flight." << std::endl;
+    }
+    findDotFiles(pool);
+    if (m_loader) {
+      m_loader->finish();
+      m_loader.reset();
+    }
+    std::cout << "Found " << this->m_dot_paths.size() << " dependency graph files." << std::endl;
   }
   pool.join();
+  m_claims.clear();
   printStatus();
 }
 
+std::string MultiAttack::getName(const DepGraphSource& source) const {
+  return m_pack ? m_pack->getName(source.index) : source.file.string();
+}
+
+bool MultiAttack::parseDepGraph(const DepGraphSource& source, boost::asio::thread_pool &pool) {
+  std::string name = getName(source);
+  try {
+    DepGraph target_dep_graph = m_pack ? m_pack->getGraph(source.index)
+                                : source.contents ? DepGraph::parseString(*source.contents) : DepGraph::parseDotFile(name);
+    // Report functions without a model before any time is spent analysing them
+    OpNodesList unmodeled = target_dep_graph.getUnmodeledOpNodes();
+    if (!unmodeled.empty()) {
+      std::stringstream ss;
+      ss << "!!! Warning: " << name << " calls unmodeled functions:";
+      for (DepGraphOpNode* opNode : unmodeled) {
+        ss << " " << opNode->getName() << " (" << opNode->getID() << ")";
+      }
+      ss << std::endl;
+      std::cout << ss.str();
+    }
+    this->findOrCreateResult(name, target_dep_graph, pool);
+    return true;
+  } catch(std::exception& e) {
+    cerr << "Error parsing " << name << ": " << e.what() << "\n";
+    return false;
+  }
+}
+
+void MultiAttack::scanDepGraph(const DepGraphSource& source, boost::asio::thread_pool &pool) {
+  if (source.contents) {
+    const std::lock_guard<std::mutex> lock(this->m_load_mutex);
+    m_unscanned--;
+    m_scanned.notify_all();
+  }
+  // First only read the metadata, most depgraphs share their sanitizer with
+  // another one and never need to be parsed
+  Metadata metadata;
+  bool scanned = false;
+  try {
+    if (m_pack) {
+      scanned = m_pack->getMetadata(source.index, metadata);
+    } else if (source.contents) {
+      scanned = DepGraph::parseStringMetadata(*source.contents, metadata);
+    } else {
+      scanned = DepGraph::parseDotFileMetadata(source.file.string(), metadata);
+    }
+  } catch(std::exception&) {
+    // Parsed in full below, which reports the error
+  }
+  // Without a sanitizer hash in the header the depgraph is parsed on its own
+  if (!scanned) {
+    parseDepGraph(source, pool);
+    return;
+  }
+  if (!metadata.has_correct_exploit_match() && !this->m_no_exploit_match) {
+    return;
+  }
+
+  int hash = metadata.get_sanitizer_hash();
+  {
+    const std::lock_guard<std::mutex> lock(this->m_load_mutex);
+    auto search = m_claims.find(hash);
+    if (search == m_claims.end()) {
+      m_claims.insert(std::make_pair(hash, SanitizerClaim()));
+      asio::post(pool, std::bind(&MultiAttack::analyseSanitizer, this, hash, source, std::ref(pool)));
+      return;
+    }
+    if (!search->second.analysed) {
+      // Read again if it is needed after all, unless it is inside an archive
+      search->second.pending.push_back(PendingDepGraph{DepGraphSource{source.index, source.file, source.archived ? source.contents : nullptr, source.archived}, metadata});
+      return;
+    }
+  }
+  addDuplicateMetadata(metadata);
+}
+
+void MultiAttack::analyseSanitizer(int hash, const DepGraphSource& source, boost::asio::thread_pool &pool) {
+  bool parsed = parseDepGraph(source, pool);
+  std::vector<PendingDepGraph> pending;
+  {
+    const std::lock_guard<std::mutex> lock(this->m_load_mutex);
+    SanitizerClaim& claim = m_claims[hash];
+    if (!parsed) {
+      // Try the next depgraph with this sanitizer
+      if (claim.pending.empty()) {
+        m_claims.erase(hash);
+      } else {
+        DepGraphSource next = claim.pending.front().source;
+        claim.pending.erase(claim.pending.begin());
+        asio::post(pool, std::bind(&MultiAttack::analyseSanitizer, this, hash, next, std::ref(pool)));
+      }
+      return;
+    }
+    claim.analysed = true;
+    pending.swap(claim.pending);
+  }
+  for (const auto& p : pending) {
+    addDuplicateMetadata(p.metadata);
+  }
+}
+
+bool MultiAttack::readPackMetadata(std::size_t index, Metadata& metadata) const {
+  try {
+    return m_pack->getMetadata(index, metadata);
+  } catch(std::exception&) {
+    // Parsed in full, which reports the error
+    return false;
+  }
+}
+
+void MultiAttack::analysePackGroup(const std::vector<std::size_t>& group, boost::asio::thread_pool &pool) {
+  // Only the first graph of the group that can be parsed is decoded in full,
+  // of the others only the metadata is read. As in scanDepGraph, a graph
+  // without readable metadata is parsed on its own.
+  bool analysed = false;
+  for (std::size_t index : group) {
+    Metadata metadata;
+    bool scanned = readPackMetadata(index, metadata);
+    if (scanned && !metadata.has_correct_exploit_match() && !this->m_no_exploit_match) {
+      continue;
+    }
+    if (!scanned) {
+      parseDepGraph(DepGraphSource{index, fs::path(), nullptr, false}, pool);
+    } else if (analysed) {
+      addDuplicateMetadata(metadata);
+    } else {
+      analysed = parseDepGraph(DepGraphSource{index, fs::path(), nullptr, false}, pool);
+    }
+  }
+}
+
+void MultiAttack::addDuplicateMetadata(const Metadata& metadata) {
+  const std::lock_guard<std::mutex> lock(this->results_mutex);
+  auto search = this->m_result_hash_map.find(metadata.get_sanitizer_hash());
+  if (search != this->m_result_hash_map.end()) {
+    search->second->addMetadata(metadata);
+  }
+}
+
+void MultiAttack::setInterning(bool i) {
+  DFAInterner::getInstance().setEnabled(i);
+}
+
+void MultiAttack::setSharedBddStore(bool s) {
+  bddStoreSetEnabled(s);
+}
+
+void MultiAttack::setLazyMinimization(int maxStates) {
+  StrangerAutomaton::setLazyMinimization(maxStates);
+}
+
+void MultiAttack::setFunctionModelCache(int entries) {
+  FunctionModelCache::getInstance().setCapacity(entries > 0 ? entries : 0);
+}
+
+void MultiAttack::setSubtreeCache(int entries) {
+  SubtreeImageCache::getInstance().setCapacity(entries > 0 ? entries : 0);
+}
+
+void MultiAttack::setForwardImageStore(const std::string& dir) {
+  ForwardImageStore::getInstance().setDirectory(dir);
+}
+
+void MultiAttack::setResultFormat(ResultFormat format) {
+  SemAttack::setResultFormat(format);
+}
+
+void MultiAttack::setManifest(const std::string& manifest) {
+  m_manifest = manifest;
+}
+
 void MultiAttack::doAnalysis() {
   boost::asio::thread_pool pool(this->m_nThreads);
 
@@ -365,11 +616,17 @@ void MultiAttack::doAnalysis() {
   }
   pool.join();
   std::cout << "Forward analysis finished!" << std::endl;
+  std::cout << "Skipped " << m_implied_verdicts << " intersections implied by more general attack patterns." << std::endl;
+  if (DFAInterner::getInstance().isEnabled()) {
+    std::cout << "Stored DFAs still alive: " << DFAInterner::getInstance().size() << std::endl;
+  }
   printStatus();
   this->writeResultsToFile();  
 }
   
 void MultiAttack::compute() {
+  std::cout << "Computing inclusion between " << m_analyzed_contexts.size() << " attack patterns..." << std::endl;
+  m_lattice = AttackPatterns::computeInclusionLattice(m_analyzed_contexts);
   loadDepGraphs();
   doAnalysis();
 }
@@ -474,38 +731,129 @@ void MultiAttack::fillCommonPatterns() {
   m_groups.createGroup(a, "DoubleUriComponentEncoded");
 }
 
-void MultiAttack::findDotFiles() {
-  this->m_dot_paths = getDotFilesInDir(this->m_graph_directory);
-  std::cout << "Found " << this->m_dot_paths.size() << " dependency graph files." << std::endl;
-}
-
-std::vector<fs::path> MultiAttack::getDotFilesInDir(fs::path const &dir)
-{
-  return getFilesInPath(dir, ".dot");
+void MultiAttack::findDotFiles(boost::asio::thread_pool &pool) {
+  // Directories are listed on their own threads and the files handed to
+  // the pool as they turn up
+  boost::asio::thread_pool walker(this->m_nThreads);
+  std::atomic<bool> done(false);
+  if (!this->m_manifest.empty()) {
+    std::ifstream manifest(this->m_manifest.string());
+    if (!manifest) {
+      cerr << "Can not open manifest " << this->m_manifest.string() << "\n";
+    }
+    std::string line;
+    while (!done && getline(manifest, line)) {
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      // Relative paths are relative to the target directory
+      fs::path file(line);
+      if (!file.is_absolute()) {
+        file = this->m_graph_directory / file;
+      }
+      if (isArchive(file) && m_max > 0) {
+        // Keep the order of the manifest for --number
+        walkArchive(file, done, pool);
+      } else if (isArchive(file)) {
+        asio::post(walker, std::bind(&MultiAttack::walkArchive, this, file, std::ref(done), std::ref(pool)));
+      } else {
+        addDotFile(file, nullptr, done, pool);
+      }
+    }
+  } else if (fs::is_directory(this->m_graph_directory)) {
+    asio::post(walker, std::bind(&MultiAttack::walkDirectory, this, this->m_graph_directory, std::ref(done), std::ref(walker), std::ref(pool)));
+  } else if (fs::exists(this->m_graph_directory) && isArchive(this->m_graph_directory)) {
+    asio::post(walker, std::bind(&MultiAttack::walkArchive, this, this->m_graph_directory, std::ref(done), std::ref(pool)));
+  } else if (fs::exists(this->m_graph_directory) && isDotFile(this->m_graph_directory)) {
+    addDotFile(this->m_graph_directory, nullptr, done, pool);
+  }
+  walker.join();
 }
 
-/**
- * \brief   Return the filenames of all files that have the specified extension
- *          in the specified directory and all subdirectories.
- */
-std::vector<fs::path> MultiAttack::getFilesInPath(fs::path const & root, std::string const & ext)
-{
-  std::vector<fs::path> paths;
-
-  if (fs::exists(root)) {
-    // Recurse into directories
-    if (fs::is_directory(root)) {
-      for (auto const & entry : fs::recursive_directory_iterator(root)) {
-        if (fs::is_regular_file(entry) && entry.path().extension() == ext) {
-          paths.emplace_back(entry.path());
+void MultiAttack::walkDirectory(const fs::path& dir, std::atomic<bool>& done, boost::asio::thread_pool &walker, boost::asio::thread_pool &pool) {
+  try {
+    // Directory order depends on the file system, so the listing is sorted
+    std::vector<fs::path> entries;
+    for (auto const & entry : fs::directory_iterator(dir)) {
+      entries.push_back(entry.path());
+    }
+    std::sort(entries.begin(), entries.end());
+    for (auto const & entry : entries) {
+      if (done) {
+        return;
+      }
+      // Like recursive_directory_iterator, do not follow directory links
+      if (fs::is_directory(fs::symlink_status(entry))) {
+        // --number selects the first files in sorted order, so directories
+        // are then walked one after the other
+        if (m_max > 0) {
+          walkDirectory(entry, done, walker, pool);
+        } else {
+          asio::post(walker, std::bind(&MultiAttack::walkDirectory, this, entry, std::ref(done), std::ref(walker), std::ref(pool)));
+        }
+      } else if (fs::is_regular_file(entry) && isDotFile(entry)) {
+        addDotFile(entry, nullptr, done, pool);
+      } else if (fs::is_regular_file(entry) && isArchive(entry)) {
+        if (m_max > 0) {
+          walkArchive(entry, done, pool);
+        } else {
+          asio::post(walker, std::bind(&MultiAttack::walkArchive, this, entry, std::ref(done), std::ref(pool)));
         }
       }
-    // Single file
-    } else {
-      if (root.extension() == ext) {
-          paths.emplace_back(root);
+    }
+  } catch (fs::filesystem_error const &e) {
+    cerr << "Error listing " << dir.string() << ": " << e.what() << "\n";
+  }
+}
+
+void MultiAttack::walkArchive(const fs::path& archive, std::atomic<bool>& done, boost::asio::thread_pool &pool) {
+  // The archive is decompressed here while the pool analyses the depgraphs
+  // read so far
+  try {
+    boost::iostreams::filtering_istream in;
+    if (!openCompressedFile(archive.string(), in)) {
+      cerr << "Can not open archive " << archive.string() << "\n";
+      return;
+    }
+    TarReader reader(in);
+    std::string name;
+    while (!done && reader.next(name)) {
+      if (fs::path(name).extension() != ".dot") {
+        continue;
       }
+      std::shared_ptr<std::string> contents(new std::string());
+      reader.read(*contents);
+      addDotFile(archive / name, contents, done, pool);
     }
+  } catch (std::exception const &e) {
+    cerr << "Error reading archive " << archive.string() << ": " << e.what() << "\n";
+  }
+}
+
+void MultiAttack::addDotFile(const fs::path& file, std::shared_ptr<const std::string> archived, std::atomic<bool>& done, boost::asio::thread_pool &pool) {
+  std::unique_lock<std::mutex> lock(this->m_load_mutex);
+  if (archived) {
+    // Keep the archives from running far ahead of the analysis
+    m_scanned.wait(lock, [this, &done]() { return done || m_unscanned < maxUnscanned(); });
+  }
+  // --number counts the files as they are found, see walkDirectory
+  if (done) {
+    return;
+  }
+  this->m_dot_paths.push_back(file);
+  if ((m_max > 0) && (this->m_dot_paths.size() >= static_cast<std::size_t>(m_max))) {
+    done = true;
+    m_scanned.notify_all();
+  }
+  if (archived) {
+    m_unscanned++;
+    asio::post(pool, std::bind(&MultiAttack::scanDepGraph, this, DepGraphSource{this->m_dot_paths.size() - 1, file, archived, true}, std::ref(pool)));
+  } else if (m_loader && !isCompressedFile(file.string())) {
+    m_loader->add(this->m_dot_paths.size() - 1, file);
+  } else {
+    asio::post(pool, std::bind(&MultiAttack::scanDepGraph, this, DepGraphSource{this->m_dot_paths.size() - 1, file, nullptr, false}, std::ref(pool)));
   }
-  return paths;
 }
@@ -24,14 +24,22 @@
 #ifndef MULTIATTACK_HPP_
 #define MULTIATTACK_HPP_
 
+#include "AttackPatterns.hpp"
 #include "AutomatonGroups.hpp"
 #include "StrangerAutomaton.hpp"
+#include "DotFileLoader.hpp"
+#include "depgraph/DepGraphPack.hpp"
 
 #define BOOST_FILESYSTEM_VERSION 3
 #define BOOST_FILESYSTEM_NO_DEPRECATED
 #include <boost/filesystem.hpp>
 #include <boost/asio.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <thread>
 #include <vector>
@@ -57,29 +65,91 @@ public:
     void setPayloadAnalysis(bool a) { m_payload_analysis = a; }
     void setDotFiles(bool d) { m_output_dotfiles = d; }
     void setDoForwardAnalysisWithAttackPattern(bool f) { m_attack_forward = f; }
+    void setExampleOnly(bool e) { m_example_only = e; }
+    // Share one DFA between all automata with the same structure
+    void setInterning(bool i);
+    // Compute products in a BDD node store shared by all automata of a thread
+    void setSharedBddStore(bool s);
+    // Leave intersections and unions up to this size unminimized, 0 disables
+    void setLazyMinimization(int maxStates);
+
+    void setFunctionModelCache(int entries);
+
+    void setSubtreeCache(int entries);
+
+    void setForwardImageStore(const std::string& dir);
+
+    void setResultFormat(ResultFormat format);
+
+    // Read the dot files listed in this file instead of searching the target directory
+    void setManifest(const std::string& manifest);
+
+    // Read the dot files on a loader thread with this many reads in flight, 0 reads them on the analysis threads
+    void setReadAhead(int depth) { m_read_ahead = depth > 0 ? depth : 0; }
 private:
+    // A depgraph of the target, an entry of the pack or a dot file
+    struct DepGraphSource {
+      std::size_t index;
+      fs::path file;
+      // Set if the loader already read the file
+      std::shared_ptr<const std::string> contents;
+      // Inside an archive, only the contents can be read
+      bool archived;
+    };
+    struct PendingDepGraph {
+      DepGraphSource source;
+      Metadata metadata;
+    };
+    // The depgraphs with one sanitizer, only the first one found is parsed
+    struct SanitizerClaim {
+      SanitizerClaim() : analysed(false), pending() {}
+      bool analysed;
+      // Wait for the result of the first one
+      std::vector<PendingDepGraph> pending;
+    };
+
     void printResults(std::ostream& os, bool printFiles = false) const;
     void printFiles(std::ostream& os) const;
     void fillCommonPatterns();
-    void findDotFiles();
+    void findDotFiles(boost::asio::thread_pool &pool);
+    void walkDirectory(const fs::path& dir, std::atomic<bool>& done, boost::asio::thread_pool &walker, boost::asio::thread_pool &pool);
+    void walkArchive(const fs::path& archive, std::atomic<bool>& done, boost::asio::thread_pool &pool);
+    void addDotFile(const fs::path& file, std::shared_ptr<const std::string> archived, std::atomic<bool>& done, boost::asio::thread_pool &pool);
+    std::string getName(const DepGraphSource& source) const;
+    void scanDepGraph(const DepGraphSource& source, boost::asio::thread_pool &pool);
+    void analyseSanitizer(int hash, const DepGraphSource& source, boost::asio::thread_pool &pool);
+    // Returns false if the metadata can not be read or has no sanitizer hash
+    bool readPackMetadata(std::size_t index, Metadata& metadata) const;
+    // The graphs of the pack with one sanitizer hash, in pack order
+    void analysePackGroup(const std::vector<std::size_t>& group, boost::asio::thread_pool &pool);
+    bool parseDepGraph(const DepGraphSource& source, boost::asio::thread_pool &pool);
     CombinedAnalysisResult* findOrCreateResult(const fs::path& file, DepGraph& target_dep_graph, boost::asio::thread_pool &pool);
+    // Adds the metadata of a depgraph whose sanitizer is already analysed
+    void addDuplicateMetadata(const Metadata& metadata);
     void doFwAnalysis(CombinedAnalysisResult* result);
     void doBwAnalysis(CombinedAnalysisResult* result);
     void computeAttackPatternOverlap(CombinedAnalysisResult* result, AttackContext context);
+    bool isImpliedSafe(const CombinedAnalysisResult* result, AttackContext context) const;
     void computeAttackPatternOverlapForMetadata(CombinedAnalysisResult* result);
-    static std::vector<fs::path> getDotFilesInDir(fs::path const &dir);
-    static std::vector<fs::path> getFilesInPath(fs::path const & root, std::string const & ext);
 
     void loadDepGraphs();
     void doAnalysis();
     
     int countDone() const;
+    // Limit of m_unscanned, keeps the readers from running far ahead of the analysis
+    unsigned int maxUnscanned() const { return 16 * m_nThreads; }
 
     fs::path m_graph_directory;
     fs::path m_output_directory;
 
     std::string m_input_name;
     std::vector<fs::path> m_dot_paths;
+    // Set instead of m_dot_paths if the target is a depgraph pack
+    std::unique_ptr<DepGraphPack> m_pack;
+    fs::path m_manifest;
+    std::unique_ptr<DotFileLoader> m_loader;
+    // Sanitizer hashes seen while loading
+    std::map<int, SanitizerClaim> m_claims;
     // A list of all the results
     std::vector<CombinedAnalysisResult*> m_results;
     // A map of depgraph hashes to their results
@@ -89,18 +159,27 @@ private:
     // Results grouped by post image
     AutomatonGroups m_groups;
     std::vector<AttackContext> m_analyzed_contexts;
+    // Inclusion between the analyzed contexts, fixes the order of the backward analysis
+    AttackPatternLattice m_lattice;
+    std::atomic<unsigned int> m_implied_verdicts;
 
     std::mutex results_mutex;
+    std::mutex m_load_mutex;
+    // Archived or read ahead depgraphs waiting for their scan
+    std::condition_variable m_scanned;
+    unsigned int m_unscanned;
 
     // Configuration
     int m_max;
     unsigned int m_nThreads;
+    unsigned int m_read_ahead;
     bool m_concats;
     bool m_singleton_intersection;
     bool m_compute_preimage;
     bool m_payload_analysis;
     bool m_output_dotfiles;
     bool m_attack_forward;
+    bool m_example_only;
     bool m_no_exploit_match;
     StrangerAutomaton* m_input_automaton;
 };
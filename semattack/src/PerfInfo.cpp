@@ -23,6 +23,11 @@
 
 #include "PerfInfo.hpp"
 
+#define export _export_
+#include "stranger/stranger_lib_internal.h"
+#include "stranger/stranger.h"
+#undef export
+
 using namespace std;
 
 PerfInfo::PerfInfo() {
@@ -67,6 +72,11 @@ void PerfInfo::reset() {
 	 const_pre_concat_total_time = boost::posix_time::microseconds(0);
 	 replace_total_time = boost::posix_time::microseconds(0);
 	 pre_replace_total_time = boost::posix_time::microseconds(0);
+	 accepts_batch_total_time = boost::posix_time::microseconds(0);
+	 intern_total_time = boost::posix_time::microseconds(0);
+	 deferred_minimize_total_time = boost::posix_time::microseconds(0);
+	 union_all_total_time = boost::posix_time::microseconds(0);
+	 concat_all_total_time = boost::posix_time::microseconds(0);
 
 	 performance_time = boost::posix_time::microseconds(0);
 
@@ -108,6 +118,23 @@ void PerfInfo::reset() {
 	num_of_const_pre_concat = 0;
 	num_of_replace = 0;
 	num_of_pre_replace = 0;
+	num_of_accepts_batch = 0;
+	num_of_accepts_batch_strings = 0;
+	num_of_intern = 0;
+	num_of_intern_hits = 0;
+	num_of_lazy_results = 0;
+	num_of_deferred_minimize = 0;
+	num_of_union_all = 0;
+	num_of_concat_all = 0;
+	num_of_memo_lookups = 0;
+	num_of_memo_hits = 0;
+	num_of_memo_evictions = 0;
+	num_of_subtree_lookups = 0;
+	num_of_subtree_hits = 0;
+	num_of_subtree_reused_nodes = 0;
+	num_of_store_lookups = 0;
+	num_of_store_hits = 0;
+	num_of_store_saves = 0;
 
 	number_of_vlab_restrict = 0;
 	number_of_pre_vlab_restrict = 0;
@@ -186,10 +213,19 @@ void PerfInfo::print_operations_info() {
 	cout << "\t precisewiden : #" << num_of_precisewiden << " : " << precisewiden_total_time.total_microseconds() << endl;
 	cout << "\t coarsewiden : #" << num_of_coarsewiden << " : " << coarsewiden_total_time.total_microseconds() << endl;
 	cout << "\t concat : #" << num_of_concat << " : " << concat_total_time.total_microseconds() << endl;
+	cout << "\t union_all : #" << num_of_union_all << " : " << union_all_total_time.total_microseconds() << endl;
+	cout << "\t concat_all : #" << num_of_concat_all << " : " << concat_all_total_time.total_microseconds() << endl;
 	cout << "\t pre_concat : #" << num_of_pre_concat << " : " << pre_concat_total_time.total_microseconds() << endl;
 	cout << "\t const_pre_concat : #" << num_of_const_pre_concat << " : " << const_pre_concat_total_time.total_microseconds() << endl;
 	cout << "\t replace : #" << num_of_replace << " : " << replace_total_time.total_microseconds() << endl;
 	cout << "\t pre_replace : #" << num_of_pre_replace << " : " << pre_replace_total_time.total_microseconds() << endl;
+	cout << "\t accepts_batch : #" << num_of_accepts_batch << " (" << num_of_accepts_batch_strings << " strings) : " << accepts_batch_total_time.total_microseconds() << endl;
+	cout << "\t intern : #" << num_of_intern << " (" << num_of_intern_hits << " shared) : " << intern_total_time.total_microseconds() << endl;
+	cout << "\t function_memo : #" << num_of_memo_lookups << " (" << num_of_memo_hits << " hits, "
+		 << (num_of_memo_lookups > 0 ? 100 * num_of_memo_hits / num_of_memo_lookups : 0) << "%) : evictions #" << num_of_memo_evictions << endl;
+	cout << "\t subtree_cache : #" << num_of_subtree_lookups << " (" << num_of_subtree_hits << " hits) : reused nodes #" << num_of_subtree_reused_nodes << endl;
+	cout << "\t forward_store : #" << num_of_store_lookups << " (" << num_of_store_hits << " hits) : saves #" << num_of_store_saves << endl;
+	cout << "\t deferred_minimize : #" << num_of_deferred_minimize << " (" << num_of_lazy_results << " lazy results) : " << deferred_minimize_total_time.total_microseconds() << endl;
 	cout << "\t vlab_restrict : #" << number_of_vlab_restrict << " : " << vlab_restrict_total_time.total_microseconds() << endl;
 	cout << "\t pre_vlab_restrict : #" << number_of_pre_vlab_restrict << " : " << pre_vlab_restrict_total_time.total_microseconds() << endl;
 	cout << "\t addslahses : #" << number_of_addslashes << " : " << addslashes_total_time.total_microseconds() << endl;
@@ -214,5 +250,18 @@ void PerfInfo::print_operations_info() {
 	cout << "\t pre_trim_set : #" << number_of_pre_trim_set << " : " << pre_trim_set_total_time.total_microseconds() << endl;
 	cout << "\t substr : #" << number_of_substr << " : " << substr_total_time.total_microseconds() << endl;
 	cout << "\t pre_substr : #" << number_of_pre_substr << " : " << pre_substr_total_time.total_microseconds() << endl;
+
+	if (bddStoreIsEnabled()) {
+		BddStoreStats store;
+		bddStoreGetStats(&store);
+		cout << "\t bdd_store : products #" << store.products << " : nodes #" << store.created << " (" << store.shared << " shared)"
+			 << " : apply cache " << store.hits << "/" << store.lookups << " hits : collections #" << store.collections << endl;
+	}
+	if (memPoolEnabled()) {
+		MemPoolStats pool;
+		memPoolGetStats(&pool);
+		cout << "\t mem_pool : allocs #" << pool.allocs << " (" << pool.hits << " from pool, " << pool.large << " large)"
+			 << " : frees #" << pool.frees << " (" << pool.cached << " pooled) : cached bytes " << pool.cachedBytes << endl;
+	}
 }
 
@@ -83,6 +83,11 @@ public:
 	 boost::posix_time::time_duration const_pre_concat_total_time;
 	 boost::posix_time::time_duration replace_total_time;
 	 boost::posix_time::time_duration pre_replace_total_time;
+	 boost::posix_time::time_duration accepts_batch_total_time;
+	 boost::posix_time::time_duration intern_total_time;
+	 boost::posix_time::time_duration deferred_minimize_total_time;
+	 boost::posix_time::time_duration union_all_total_time;
+	 boost::posix_time::time_duration concat_all_total_time;
 
 	 boost::posix_time::time_duration performance_time;
 
@@ -99,6 +104,23 @@ public:
 	 unsigned int num_of_const_pre_concat;
 	 unsigned int num_of_replace;
 	 unsigned int num_of_pre_replace;
+	 unsigned int num_of_accepts_batch;
+	 unsigned long num_of_accepts_batch_strings;
+	 unsigned long num_of_intern;
+	 unsigned long num_of_intern_hits;
+	 unsigned long num_of_lazy_results;
+	 unsigned long num_of_deferred_minimize;
+	 unsigned long num_of_union_all;
+	 unsigned long num_of_concat_all;
+	 unsigned long num_of_memo_lookups;
+	 unsigned long num_of_memo_hits;
+	 unsigned long num_of_memo_evictions;
+	 unsigned long num_of_subtree_lookups;
+	 unsigned long num_of_subtree_hits;
+	 unsigned long num_of_subtree_reused_nodes;
+	 unsigned long num_of_store_lookups;
+	 unsigned long num_of_store_hits;
+	 unsigned long num_of_store_saves;
 
 
 //    Composed string operations
@@ -24,13 +24,35 @@
  *
  * Authors: Abdulbaki Aydin, Muath Alkhalaf, Thomas Barber
  */
+#include <set>
+#include <stack>
 #include <boost/filesystem.hpp>
 
 #include "SemAttack.hpp"
 #include "AttackPatterns.hpp"
+#include "ForwardImageStore.hpp"
 #include "exceptions/StrangerException.hpp"
 
 PerfInfo& SemAttack::perfInfo = PerfInfo::getInstance();
+ResultFormat SemAttack::resultFormat = ResultFormat::Dot;
+
+namespace {
+
+// Writes a as dot file and MONA BDD table and/or as binary automaton next to
+// the BDD table, depending on SemAttack::resultFormat
+void writeAutomaton(const StrangerAutomaton* a, const fs::path& dot_file, const fs::path& bdd_file, int with_sink)
+{
+  if (SemAttack::resultFormat != ResultFormat::Binary) {
+    a->toDotFileAscii(dot_file.string(), with_sink);
+    a->exportToFile(bdd_file.string());
+  }
+  if (SemAttack::resultFormat != ResultFormat::Dot) {
+    fs::path binary_file(bdd_file);
+    a->exportToBinaryFile(binary_file.replace_extension(".sdfa").string());
+  }
+}
+
+}
 
 namespace fs = boost::filesystem;
 
@@ -87,7 +109,17 @@ bool CombinedAnalysisResult::hasBackwardanalysisResult(AttackContext context) co
   return false;
 }
 
-BackwardAnalysisResult* CombinedAnalysisResult::doBackwardAnalysisForPayload(const std::string& payload, const fs::path& output_dir, bool computePreImage, bool singletonIntersection, bool outputDotfiles, bool attack_forward)
+bool CombinedAnalysisResult::isPayloadInAlphabet(const std::string& payload, const std::bitset<256>& alphabet)
+{
+  for (const unsigned char c : payload) {
+    if (!alphabet.test(c)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+BackwardAnalysisResult* CombinedAnalysisResult::doBackwardAnalysisForPayload(const std::string& payload, const fs::path& output_dir, bool computePreImage, bool singletonIntersection, bool outputDotfiles, bool attack_forward, bool exampleOnly, const std::bitset<256>* alphabet)
 {
   if (payload.empty()) {
     //std::cout << "Skipping empty payload." << std::endl;
@@ -99,13 +131,26 @@ BackwardAnalysisResult* CombinedAnalysisResult::doBackwardAnalysisForPayload(con
   if (m_stringAnalysisMap.find(payload) != m_stringAnalysisMap.end()) {
     // Just return existing analysis
     bw = m_stringAnalysisMap.at(payload);
+  } else if (alphabet != nullptr && !attack_forward && !isPayloadInAlphabet(payload, *alphabet)) {
+    // The post image never contains one of the payload characters, so the
+    // intersection is empty and there is no need for the full analysis
+    std::cout << "Ouput: " << output_dir.string() <<": Payload screened out by post image alphabet: " << payload << std::endl;
+    StrangerAutomaton* a = StrangerAutomaton::makeContainsString(payload);
+    bw = new BackwardAnalysisResult(m_fwAnalysis, a, payload);
+    delete a;
+    bw->setImpliedSafe();
+    if (outputDotfiles) {
+      bw->writeResultsToFile(output_dir);
+    }
+    bw->finishAnalysis();
+    m_stringAnalysisMap.insert(std::make_pair(payload, bw));
   } else {
     std::cout << "Ouput: " << output_dir.string() <<": Doing backward analysis for payload: " << payload << std::endl;
     try {
       StrangerAutomaton* a = StrangerAutomaton::makeContainsString(payload);
       //a->toDotAscii(1);
       bw = new BackwardAnalysisResult(m_fwAnalysis, a, payload);
-      bw->doAnalysis(computePreImage, singletonIntersection, attack_forward);
+      bw->doAnalysis(computePreImage, singletonIntersection, attack_forward, exampleOnly);
       if (bw && outputDotfiles) {
         bw->writeResultsToFile(output_dir);
       }
@@ -120,7 +165,7 @@ BackwardAnalysisResult* CombinedAnalysisResult::doBackwardAnalysisForPayload(con
   return bw;
 }
 
-void CombinedAnalysisResult::doMetadataSpecificAnalysis(const fs::path& output_dir, bool computePreImage, bool singletonIntersection, bool outputDotfiles, bool attack_forward)
+void CombinedAnalysisResult::doMetadataSpecificAnalysis(const fs::path& output_dir, bool computePreImage, bool singletonIntersection, bool outputDotfiles, bool attack_forward, bool exampleOnly)
 {
   // Create a specific payload for each metadata entry
   unsigned int i = 0;
@@ -130,6 +175,19 @@ void CombinedAnalysisResult::doMetadataSpecificAnalysis(const fs::path& output_d
   m_atLeastOnePayloadVulnerable = false;
   m_allPayloadsVulnerable = true;
   m_allPayloadsErrored = true;
+
+  // Cheap screen: payloads need every one of their characters in the post image
+  std::bitset<256> alphabet;
+  bool screen = false;
+  if (m_fwAnalysis.getPostImage() != nullptr) {
+    try {
+      alphabet = m_fwAnalysis.getPostImage()->getReachableAlphabet();
+      screen = true;
+    } catch (StrangerException const &e) {
+      std::cout << "doMetadataSpecificAnalysis::could not compute post image alphabet: " << e.what() << std::endl;
+    }
+  }
+
   for (const Metadata &m : m_metadata) {
     std::vector<BackwardAnalysisResult*> bws;
     for (auto& f : functions) {
@@ -137,7 +195,7 @@ void CombinedAnalysisResult::doMetadataSpecificAnalysis(const fs::path& output_d
         BackwardAnalysisResult* bw = nullptr;
         // Normal payload
         std::string payload = m.generate_exploit_from_scratch(f, b);
-        bw = doBackwardAnalysisForPayload(payload, output_dir, computePreImage, singletonIntersection, outputDotfiles, attack_forward);
+        bw = doBackwardAnalysisForPayload(payload, output_dir, computePreImage, singletonIntersection, outputDotfiles, attack_forward, exampleOnly, screen ? &alphabet : nullptr);
         if (bw != nullptr) {
           m_atLeastOnePayloadVulnerable |= bw->isVulnerable();
           if (!bw->isVulnerable()) {
@@ -154,7 +212,7 @@ void CombinedAnalysisResult::doMetadataSpecificAnalysis(const fs::path& output_d
         }
         // Attribute payload
         std::string attr_payload = m.generate_attribute_exploit_from_scratch(f, b);
-        bw = doBackwardAnalysisForPayload(attr_payload, output_dir, computePreImage, singletonIntersection, outputDotfiles, attack_forward);
+        bw = doBackwardAnalysisForPayload(attr_payload, output_dir, computePreImage, singletonIntersection, outputDotfiles, attack_forward, exampleOnly, screen ? &alphabet : nullptr);
         if (bw != nullptr) {
           m_atLeastOnePayloadVulnerable |= bw->isVulnerable();
           if (!bw->isVulnerable()) {
@@ -407,50 +465,20 @@ BackwardAnalysisResult::~BackwardAnalysisResult()
   finishAnalysis();
 }
 
-void BackwardAnalysisResult::doAnalysis(bool computePreImage, bool singletonIntersection, bool doPostAttack)
+void BackwardAnalysisResult::doAnalysis(bool computePreImage, bool singletonIntersection, bool doPostAttack, bool exampleOnly)
 {
   const StrangerAutomaton* postImage = m_fwResult.getPostImage();
-  m_intersection = this->getAttack()->computeAttackPatternOverlap(postImage, m_attack);
   m_isErrored = true;
   m_isSafe = false;
   m_isContained = false;
+  m_intersection = this->getAttack()->computeAttackPatternOverlap(postImage, m_attack);
   if ((m_intersection) && (!m_intersection->isNull())) {
     m_isErrored = false;
     if (this->isVulnerable()) {
       // Only compute BW analysis if vulnerable
       m_isSafe = false;
       m_isContained = postImage->checkInclusion(m_attack);
-      // Cache examples for printing
-      m_intersection_example = m_intersection->generateSatisfyingExample();
-      if (computePreImage) {
-        try {
-          AnalysisResult result;
-          if (singletonIntersection) {
-            StrangerAutomaton* singleton = m_intersection->generateSatisfyingSingleton();
-            result = this->getAttack()->computePreImage(singleton, m_fwResult.getFwAnalysisResult());
-            delete singleton;
-          } else {
-            result = this->getAttack()->computePreImage(m_intersection, m_fwResult.getFwAnalysisResult());
-          }
-          const StrangerAutomaton* preimage = this->getAttack()->getPreImage(result);
-          if (preimage != nullptr) {
-            m_preimage = new StrangerAutomaton(this->getAttack()->getPreImage(result));
-            m_preimage_example = m_preimage->generateSatisfyingExample();
-          } else {
-            m_preimage = nullptr;
-            m_preimage_example = "ERROR";
-            throw StrangerException(AnalysisError::MonaException, "Null DFA pointer returned from MONA");
-          }
-          //  clean up target analysis result
-        } catch (StrangerException const &e) {
-          std::cout << "EXCEPTION caught in bw analysis: " << e.what() << std::endl;
-          m_isErrored = true;
-          m_error = e.getError();
-          throw;
-        }
-      } else {
-        m_preimage_example = "N/A";
-      }
+      computeVulnerableResult(computePreImage, singletonIntersection, exampleOnly);
     } else {
       m_isSafe = true;
       if (doPostAttack) {
@@ -475,6 +503,58 @@ void BackwardAnalysisResult::doAnalysis(bool computePreImage, bool singletonInte
   }
 }
 
+void BackwardAnalysisResult::computeVulnerableResult(bool computePreImage, bool singletonIntersection, bool exampleOnly)
+{
+  const AnalysisResult& fwAnalysisResult = m_fwResult.getFwAnalysisResult();
+  // Cache examples for printing
+  m_intersection_example = m_intersection->generateSatisfyingExample();
+  if (computePreImage) {
+    try {
+      AnalysisResult result;
+      if (exampleOnly) {
+        result = this->getAttack()->computePreImage(m_intersection, fwAnalysisResult, true);
+        const StrangerAutomaton* witness = this->getAttack()->getPreImage(result);
+        if (witness == nullptr || witness->isEmpty()) {
+          // The witness chosen at some node has no input, use the complete pre-image
+          result = this->getAttack()->computePreImage(m_intersection, fwAnalysisResult);
+        }
+      } else if (singletonIntersection) {
+        StrangerAutomaton* singleton = m_intersection->generateSatisfyingSingleton();
+        result = this->getAttack()->computePreImage(singleton, fwAnalysisResult);
+        delete singleton;
+      } else {
+        result = this->getAttack()->computePreImage(m_intersection, fwAnalysisResult);
+      }
+      const StrangerAutomaton* preimage = this->getAttack()->getPreImage(result);
+      if (preimage != nullptr) {
+        m_preimage = new StrangerAutomaton(this->getAttack()->getPreImage(result));
+        m_preimage_example = m_preimage->generateSatisfyingExample();
+      } else {
+        m_preimage = nullptr;
+        m_preimage_example = "ERROR";
+        throw StrangerException(AnalysisError::MonaException, "Null DFA pointer returned from MONA");
+      }
+      //  clean up target analysis result
+    } catch (StrangerException const &e) {
+      std::cout << "EXCEPTION caught in bw analysis: " << e.what() << std::endl;
+      m_isErrored = true;
+      m_error = e.getError();
+      throw;
+    }
+  } else {
+    m_preimage_example = "N/A";
+  }
+}
+
+void BackwardAnalysisResult::setImpliedSafe()
+{
+  m_isErrored = false;
+  m_isSafe = true;
+  m_isContained = false;
+  m_intersection_example = "";
+  m_preimage_example = "N/A";
+}
+
 void BackwardAnalysisResult::finishAnalysis()
 {
   if (m_preimage) {
@@ -530,25 +610,22 @@ void BackwardAnalysisResult::writeResultsToFile(const fs::path& dir) const
   
   if (m_attack) {
     fs::path output_image_file(dir / fs::path("post_image_attack_" + this->getName() + ".dot"));
-    m_attack->toDotFileAscii(output_image_file.string(), with_sink);
     fs::path output_image_file_bdd(dir / fs::path("post_image_attack_" + this->getName() + ".bdd"));
-    m_attack->exportToFile(output_image_file_bdd.string());
+    writeAutomaton(m_attack, output_image_file, output_image_file_bdd, with_sink);
   }
 
   if (!this->isErrored()) {
     if (m_intersection) {
       fs::path output_file(dir / fs::path("post_image_intersection_" + this->getName() + ".dot"));
-      m_intersection->toDotFileAscii(output_file.string(), with_sink);
       fs::path output_file_bdd(dir / fs::path("post_image_intersection_" + this->getName() + ".bdd"));
-      m_intersection->exportToFile(output_file_bdd.string());
+      writeAutomaton(m_intersection, output_file, output_file_bdd, with_sink);
     }
     if (this->isVulnerable()) {
       const StrangerAutomaton* preimage = getPreImage();
       if (preimage) {
         fs::path output_file_pre(dir / fs::path("pre_image_" + this->getName() + ".dot"));
-        preimage->toDotFileAscii(output_file_pre.string(), with_sink);
         fs::path output_file_pre_bdd(dir / fs::path("pre_image_" + this->getName() + ".bdd"));
-        preimage->exportToFile(output_file_pre_bdd.string());
+        writeAutomaton(preimage, output_file_pre, output_file_pre_bdd, with_sink);
       }
     }
   }
@@ -585,7 +662,7 @@ ForwardAnalysisResult::ForwardAnalysisResult(const fs::path& target_dep_graph_fi
   : m_attack(new SemAttack(target_dep_graph_file_name, target_dep_graph_, input_field_name))
   , m_result()
   , m_error(AnalysisError::None)
-  , m_input(automaton->clone())
+  , m_input(automaton->copy(automaton->getID()))
   , m_postImage(nullptr)
 {
 }
@@ -599,10 +676,14 @@ ForwardAnalysisResult::~ForwardAnalysisResult()
     m_postImage = nullptr;
   }
 }
-void ForwardAnalysisResult::doAnalysis(bool doConcat)
+
+void ForwardAnalysisResult::doAnalysis(bool doConcat, bool doSubstr)
 {
   try {
-    m_result = m_attack->computeTargetFWAnalysis(m_input, doConcat);
+    if (!m_attack->loadTargetFWAnalysis(m_input, doConcat, doSubstr, m_result)) {
+      m_result = m_attack->computeTargetFWAnalysis(m_input, doConcat, doSubstr);
+      m_attack->storeTargetFWAnalysis(m_input, doConcat, doSubstr, m_result);
+    }
   } catch (StrangerException const &e) {
     m_postImage = nullptr;
     m_error = e.getError();
@@ -627,10 +708,8 @@ void ForwardAnalysisResult::writeResultsToFile(const fs::path& dir) const
   int with_sink = 1;
 
   fs::path output_file(dir / fs::path("post_image_ascii.dot"));
-  this->getPostImage()->toDotFileAscii(output_file.string(), with_sink);  
-
   fs::path output_file_bdd(dir / fs::path("post_image.bdd"));
-  this->getPostImage()->exportToFile(output_file_bdd.string());
+  writeAutomaton(this->getPostImage(), output_file, output_file_bdd, with_sink);
 }
 
 void ForwardAnalysisResult::finishAnalysis() {
@@ -641,6 +720,18 @@ void ForwardAnalysisResult::finishAnalysis() {
   m_result.clear();
 }
 
+void ForwardAnalysisResult::handOff() {
+  for (auto iter = m_result.begin(); iter != m_result.end(); ++iter) {
+    iter->second->handOff();
+  }
+  if (m_postImage) {
+    m_postImage->handOff();
+  }
+  if (m_input) {
+    m_input->handOff();
+  }
+}
+
 bool ForwardAnalysisResult::isErrored() const {
   return (m_postImage == nullptr);
 }
@@ -746,7 +837,7 @@ void SemAttack::printResults() const {
 /**
  * Computes sink post image for target, first time
  */
-AnalysisResult SemAttack::computeTargetFWAnalysis(const StrangerAutomaton* inputAuto, bool doConcat)
+AnalysisResult SemAttack::computeTargetFWAnalysis(const StrangerAutomaton* inputAuto, bool doConcat, bool doSubstr)
 {
     message("computing target sink post image...");
     AnalysisResult targetAnalysisResult;
@@ -781,7 +872,7 @@ AnalysisResult SemAttack::computeTargetFWAnalysis(const StrangerAutomaton* input
     // Copy the input
     targetAnalysisResult.set(target_uninit_field_node->getID(), inputAuto->clone());
 
-    ImageComputer targetAnalyzer(doConcat, false, inputAuto->clone());
+    ImageComputer targetAnalyzer(doConcat, doSubstr, inputAuto->clone());
 
     try {
         message("starting forward aalysis for target...");
@@ -796,6 +887,90 @@ AnalysisResult SemAttack::computeTargetFWAnalysis(const StrangerAutomaton* input
     return targetAnalysisResult;
 }
 
+/**
+ * Nodes of the target graph whose images are kept in the forward image store,
+ * in depth first pre-order from the root. For every node its subtree hash and
+ * number of successors are appended to shape.
+ */
+std::vector<const DepGraphNode*> SemAttack::getStoredNodes(std::vector<std::size_t>& shape) const
+{
+    std::vector<const DepGraphNode*> nodes;
+    NodeSet visited(target_dep_graph);
+    std::stack<const DepGraphNode*> process_stack;
+    process_stack.push(target_dep_graph.getRoot());
+    while (!process_stack.empty()) {
+        const DepGraphNode* curr = process_stack.top();
+        process_stack.pop();
+        if (!visited.insert(curr)) {
+            continue;
+        }
+        nodes.push_back(curr);
+        NodeSpan successors = target_dep_graph.getSuccessors(curr);
+        shape.push_back(curr->getSubtreeHash());
+        shape.push_back(successors.size());
+        for (auto it = successors.rbegin(); it != successors.rend(); it++) {
+            process_stack.push(*it);
+        }
+    }
+    return nodes;
+}
+
+bool SemAttack::loadTargetFWAnalysis(const StrangerAutomaton* inputAuto, bool doConcat, bool doSubstr, AnalysisResult& result)
+{
+    ForwardImageStore& store = ForwardImageStore::getInstance();
+    const Metadata& m = target_dep_graph.get_metadata();
+    if (!store.isEnabled() || !m.is_initialized()) {
+        return false;
+    }
+
+    std::vector<std::size_t> shape;
+    std::vector<const DepGraphNode*> nodes = getStoredNodes(shape);
+    std::vector<StrangerAutomaton*> images;
+    if (!store.load(ForwardImageStore::makeKey(m.get_sanitizer_hash(), inputAuto, doConcat, doSubstr), shape, images)) {
+        return false;
+    }
+    if (images.size() != nodes.size()) {
+        for (auto image : images) {
+            delete image;
+        }
+        return false;
+    }
+
+    message("loaded target analysis result from forward image store");
+    result.clear();
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        if (images[i] != nullptr) {
+            images[i]->setID(nodes[i]->getID());
+            result.set(nodes[i]->getID(), images[i]);
+        }
+    }
+    target_sink_auto = result.get(target_field_relevant_graph.getRoot()->getID());
+    return true;
+}
+
+void SemAttack::storeTargetFWAnalysis(const StrangerAutomaton* inputAuto, bool doConcat, bool doSubstr, const AnalysisResult& result) const
+{
+    ForwardImageStore& store = ForwardImageStore::getInstance();
+    const Metadata& m = target_dep_graph.get_metadata();
+    if (!store.isEnabled() || !m.is_initialized()) {
+        return;
+    }
+
+    std::vector<std::size_t> shape;
+    std::vector<const StrangerAutomaton*> images;
+    for (auto node : getStoredNodes(shape)) {
+        // Some nodes never get an image, such as the complement flag of
+        // __vlab_restrict, they are stored as missing
+        const StrangerAutomaton* image = result.get(node->getID());
+        if (image != nullptr && image->dfa == nullptr) {
+            // Only complete results are stored
+            return;
+        }
+        images.push_back(image);
+    }
+    store.save(ForwardImageStore::makeKey(m.get_sanitizer_hash(), inputAuto, doConcat, doSubstr), shape, images);
+}
+
 AnalysisResult SemAttack::computeTargetFWAnalysis()
 {
   return computeTargetFWAnalysis(StrangerAutomaton::makeAnyString(target_uninit_field_node->getID()));
@@ -849,11 +1024,12 @@ StrangerAutomaton* SemAttack::computeAttackPatternOverlap(const StrangerAutomato
 }
 
 AnalysisResult SemAttack::computePreImage(const StrangerAutomaton* intersection,
-                                          const AnalysisResult& result) const
+                                          const AnalysisResult& result, bool exampleOnly) const
 {
   try {
     message("starting backward analysis...");
     ImageComputer analyzer(false, false, nullptr);
+    analyzer.setExampleOnly(exampleOnly);
     AnalysisResult analysis_result = analyzer.doBackwardAnalysis_GeneralCase(
       this->target_dep_graph, this->target_field_relevant_graph, intersection, result);
     message("...finished backward analysis.");
@@ -26,6 +26,7 @@
 #ifndef SEMATTACK_HPP_
 #define SEMATTACK_HPP_
 
+#include <bitset>
 #include <unordered_map>
 #include <boost/filesystem.hpp>
 #include "StrangerAutomaton.hpp"
@@ -38,6 +39,9 @@
 
 namespace fs = boost::filesystem;
 
+// Formats of the automata written by writeResultsToFile, binary files are
+// written with StrangerAutomaton::exportToBinaryFile
+enum class ResultFormat { Dot, Binary, Both };
 
 
 class SemAttack {
@@ -54,7 +58,14 @@ public:
     AnalysisResult computeTargetFWAnalysis();
 
     // Compute the post image with custom input
-    AnalysisResult computeTargetFWAnalysis(const StrangerAutomaton* inputAuto, bool doConcat = false);
+    AnalysisResult computeTargetFWAnalysis(const StrangerAutomaton* inputAuto, bool doConcat = false, bool doSubstr = false);
+
+    // Read the result of computeTargetFWAnalysis from the forward image store,
+    // returns false if it is not stored
+    bool loadTargetFWAnalysis(const StrangerAutomaton* inputAuto, bool doConcat, bool doSubstr, AnalysisResult& result);
+
+    // Write the result of computeTargetFWAnalysis to the forward image store
+    void storeTargetFWAnalysis(const StrangerAutomaton* inputAuto, bool doConcat, bool doSubstr, const AnalysisResult& result) const;
 
     // Get the post-image from the analysis result
     const StrangerAutomaton* getPostImage(const AnalysisResult& result) const;
@@ -65,8 +76,9 @@ public:
 
     // Compute the pre-image from the intersection and the previously computed
     // analysis result from computeTargetFWAnalysis()
+    // If exampleOnly is set, only a single witness input is computed
     AnalysisResult computePreImage(const StrangerAutomaton* intersection,
-                                   const AnalysisResult& result) const;
+                                   const AnalysisResult& result, bool exampleOnly = false) const;
 
     const StrangerAutomaton* getPreImage(const AnalysisResult& result) const;
 
@@ -80,6 +92,9 @@ public:
     const fs::path& getFile() const { return target_dep_graph_file_name; }
     static PerfInfo& perfInfo;
 
+    static void setResultFormat(ResultFormat format) { resultFormat = format; }
+    static ResultFormat resultFormat;
+
 private:
     fs::path target_dep_graph_file_name;
     std::string input_field_name;
@@ -94,6 +109,7 @@ private:
     void message(const std::string& msg) const;
     void printAnalysisResults(AnalysisResult& result) const;
     void printNodeList(NodesList nodes) const;
+    std::vector<const DepGraphNode*> getStoredNodes(std::vector<std::size_t>& shape) const;
 
     bool m_print_dots;
     bool m_print;    
@@ -111,7 +127,7 @@ public:
         
     virtual ~ForwardAnalysisResult();
 
-    void doAnalysis(bool doConcat = false);
+    void doAnalysis(bool doConcat = false, bool doSubstr = false);
 
     const SemAttack* getAttack() const { return m_attack; }
     SemAttack* getAttack() { return m_attack; }
@@ -123,6 +139,8 @@ public:
     void writeResultsToFile(const fs::path& dir) const;
 
     void finishAnalysis();
+    // Prepares the results for the backward analysis, which may run on another thread
+    void handOff();
 private:
   SemAttack* m_attack;
   AnalysisResult m_result;
@@ -144,7 +162,10 @@ public:
 
     virtual ~BackwardAnalysisResult();
 
-    void doAnalysis(bool computePreImage = true, bool singletonIntersection = false, bool doPostAttack = false);
+    void doAnalysis(bool computePreImage = true, bool singletonIntersection = false, bool doPostAttack = false, bool exampleOnly = false);
+    // Record a safe result without computing the intersection, used when a more
+    // general attack pattern was already found to be safe
+    void setImpliedSafe();
     void finishAnalysis();
 
     const StrangerAutomaton* getPreImage() const { return m_preimage; }
@@ -168,6 +189,7 @@ public:
     const std::string& get_preimage_example() const { return m_preimage_example; }
 
 private:
+    void computeVulnerableResult(bool computePreImage, bool singletonIntersection, bool exampleOnly);
     const SemAttack* getAttack() const { return m_fwResult.getAttack(); }
     SemAttack* getAttack() { return m_fwResult.getAttack(); }
     ForwardAnalysisResult& m_fwResult;
@@ -211,7 +233,7 @@ public:
     BackwardAnalysisResult* addBackwardAnalysis(AttackContext context);
     bool hasBackwardanalysisResult(AttackContext context) const;
 
-    void doMetadataSpecificAnalysis(const fs::path& output_dir, bool computePreImage = true, bool singletonIntersection = false, bool outputDotfiles = true, bool attack_forward = false);
+    void doMetadataSpecificAnalysis(const fs::path& output_dir, bool computePreImage = true, bool singletonIntersection = false, bool outputDotfiles = true, bool attack_forward = false, bool exampleOnly = false);
 
     const SemAttack* getAttack() const { return m_fwAnalysis.getAttack(); }
     SemAttack* getAttack() { return m_fwAnalysis.getAttack(); }
@@ -254,7 +276,9 @@ public:
 
 private:
     BackwardAnalysisResult* doBackwardAnalysisForPayload(const std::string& payload, const fs::path& output_dir,
-                                                         bool computePreImage, bool singletonIntersection, bool outputDotfiles, bool attack_forward);
+                                                         bool computePreImage, bool singletonIntersection, bool outputDotfiles, bool attack_forward,
+                                                         bool exampleOnly, const std::bitset<256>* alphabet = nullptr);
+    static bool isPayloadInAlphabet(const std::string& payload, const std::bitset<256>& alphabet);
     fs::path m_inputfile;
     std::string m_input_name;
     bool m_done;
@@ -24,20 +24,49 @@
  * Authors: Abdulbaki Aydin, Muath Alkhalaf
  */
 #include "StrangerAutomaton.hpp"
+#include "DFAInterner.hpp"
+#include "FunctionModelCache.hpp"
 #include "exceptions/StrangerException.hpp"
 
+#include <boost/functional/hash.hpp>
+#include <functional>
+
 using namespace std;
 
+namespace {
+
+// Deleter of the shared DFA handle, which also marks DFAs of lazy results
+// that have not been minimized yet
+struct DfaRelease {
+    DfaRelease(bool pending = false) : pending(pending) {}
+    void operator()(DFA* dfa) const { dfaFree(dfa); }
+    bool pending;
+};
+
+// Deleter of the constants below, which are built once per thread and shared
+// by the automata made from them. MONA writes marks into the BDDs of every DFA
+// it reads, so a DFA must never be used by two threads at the same time, see
+// handOff.
+struct ThreadConstant {
+    void operator()(DFA* dfa) const { dfaFree(dfa); }
+};
+
+}
+
 StrangerAutomaton::StrangerAutomaton(DFA* dfa)
 {
 	init();
-	this->dfa = dfa;
+	setDfa(dfa);
 }
 
 StrangerAutomaton::StrangerAutomaton(const StrangerAutomaton* other)
 {
 	init();        
-	this->dfa = dfaCopy(other->dfa);
+	// DFAs are never modified once they belong to an automaton, apart from
+	// minimizing lazy results, so the copy shares the DFA of other. It has
+	// to stay in the same analysis task, see copy.
+	this->dfa = other->dfa;
+	this->dfaHandle = other->dfaHandle;
 }
 
 StrangerAutomaton::StrangerAutomaton()
@@ -48,19 +77,134 @@ void StrangerAutomaton::init()
 {
     top = false;
     bottom = false;
+    this->dfa = NULL;
     this->ID = -1;
     this->autoTraceID = traceID++;
 }
 
 StrangerAutomaton::~StrangerAutomaton()
 {
-    if (this->dfa != NULL ){
-        dfaFree(this->dfa);
-        this->dfa = NULL;
+    // The DFA is freed together with the last automaton sharing it
+    this->dfaHandle.reset();
+    this->dfa = NULL;
+}
+
+/**
+ * Takes ownership of dfa
+ */
+void StrangerAutomaton::setDfa(DFA* dfa)
+{
+    this->dfa = dfa;
+    if (dfa == NULL) {
+        this->dfaHandle.reset();
+    } else {
+        this->dfaHandle.reset(dfa, DfaRelease());
+    }
+}
+
+/**
+ * Wraps the result of a lazy operation
+ */
+StrangerAutomaton* StrangerAutomaton::makeLazyResult(DFA* dfa, bool minimized)
+{
+    if (minimized) {
+        return new StrangerAutomaton(dfa);
+    }
+    StrangerAutomaton* retMe = new StrangerAutomaton();
+    retMe->dfa = dfa;
+    retMe->dfaHandle.reset(dfa, DfaRelease(true));
+    perfInfo->num_of_lazy_results++;
+    return retMe;
+}
+
+StrangerAutomaton* StrangerAutomaton::makeConstant(const std::shared_ptr<DFA>& dfa)
+{
+    StrangerAutomaton* retMe = new StrangerAutomaton();
+    retMe->dfa = dfa.get();
+    retMe->dfaHandle = dfa;
+    return retMe;
+}
+
+DFA* StrangerAutomaton::ownDfa() const
+{
+    if (this->dfa != NULL && DFAInterner::isStored(this->dfaHandle)) {
+        this->dfa = DFAInterner::getInstance().copy(this->dfaHandle);
+        this->dfaHandle.reset(this->dfa, DfaRelease());
+    }
+    return this->dfa;
+}
+
+DFA* StrangerAutomaton::minimalDfa() const
+{
+    if (this->ownDfa() == NULL) {
+        return this->dfa;
+    }
+    DfaRelease* release = std::get_deleter<DfaRelease>(this->dfaHandle);
+    if (release != nullptr && release->pending) {
+        // Minimize in place, so all automata sharing the DFA see the result.
+        // They belong to the same analysis task, so no lock is needed.
+        release->pending = false;
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        DFA* minimal = dfaMinimize(this->dfa);
+        std::swap(*this->dfa, *minimal);
+        dfaFree(minimal);
+        perfInfo->deferred_minimize_total_time += perfInfo->current_time() - start_time;
+        perfInfo->num_of_deferred_minimize++;
+    }
+    return this->dfa;
+}
+
+const DFA* StrangerAutomaton::structureDfa() const
+{
+    if (this->dfa != NULL && DFAInterner::isStored(this->dfaHandle)) {
+        return this->dfa;
+    }
+    return this->minimalDfa();
+}
+
+StrangerAutomaton* StrangerAutomaton::memoize(const std::string& op, std::initializer_list<const StrangerAutomaton*> inputs,
+                                              int id, const std::function<StrangerAutomaton*()>& compute)
+{
+    FunctionModelCache& cache = FunctionModelCache::getInstance();
+    if (!cache.isEnabled()) {
+        return compute();
+    }
+    // top and bottom have no DFA to key the result on
+    std::vector<const DFA*> dfas;
+    int states = 0;
+    for (auto input : inputs) {
+        if (input->isTop() || input->isBottom() || input->dfa == NULL) {
+            return compute();
+        }
+        dfas.push_back(input->minimalDfa());
+        states += dfas.back()->ns;
+    }
+    if (states < FunctionModelCache::MIN_INPUT_STATES) {
+        return compute();
+    }
+    std::size_t hash = FunctionModelCache::hashKey(op, dfas);
+    DFA* cached = cache.lookup(op, hash, dfas);
+    if (cached != NULL) {
+        debug(stringbuilder() << id << " = memoized " << op);
+        StrangerAutomaton* retMe = new StrangerAutomaton(cached);
+        retMe->ID = id;
+        return retMe;
+    }
+
+    StrangerAutomaton* retMe = compute();
+    if (retMe->dfa != NULL && !retMe->isTop() && !retMe->isBottom()) {
+        cache.insert(op, hash, dfas, retMe->minimalDfa());
     }
+    return retMe;
+}
+
+void StrangerAutomaton::setLazyMinimization(int maxStates)
+{
+    lazyMinimizationStates = maxStates;
 }
 
 // some static members
+int StrangerAutomaton::lazyMinimizationStates = 0;
 int StrangerAutomaton::num_ascii_track = NUM_ASCII_TRACKS;
 int* StrangerAutomaton::indices_main = allocateAscIIIndexWithExtraBits(num_ascii_track, 2);
 unsigned* StrangerAutomaton::u_indices_main = getUnsignedIndices(num_ascii_track);
@@ -80,13 +224,21 @@ void StrangerAutomaton::setID(int id)
 
 char StrangerAutomaton::slash = '/';
 
-bool StrangerAutomaton::coarseWidening = false;
 
 PerfInfo* StrangerAutomaton::perfInfo = &PerfInfo::getInstance();
 
 
+/**
+ * Returns a DFA which may be modified by the caller. It is copied first if
+ * other automata share it.
+ */
 DFA* StrangerAutomaton::getDfa()
 {
+    this->minimalDfa();
+    if (this->dfa != NULL && this->dfaHandle.use_count() > 1) {
+        this->dfa = dfaCopy(this->dfa);
+        this->dfaHandle.reset(this->dfa, DfaRelease());
+    }
     return this->dfa;
 }
 
@@ -99,7 +251,7 @@ StrangerAutomaton* StrangerAutomaton::clone(int id) const
 		return makeTop(id);
         else {
 		debugToFile(stringbuilder() << "M[" << traceID << "] = dfaCopy(M["  << this->autoTraceID << "]);//" << id << " = clone(" << this->ID << ")");
-		StrangerAutomaton* retMe = new StrangerAutomaton(dfaCopy(this->dfa));
+		StrangerAutomaton* retMe = new StrangerAutomaton(this);
 		{
 			retMe->setID(id);
 			retMe->debugAutomaton();
@@ -113,6 +265,56 @@ StrangerAutomaton* StrangerAutomaton::clone() const
     return this->clone(-1);
 }
 
+/**
+ * Unlike clone, the copy gets a DFA of its own, or shares a DFA of the run
+ * wide store. Automata that are handed to another analysis task, or kept by a
+ * process wide cache, are copied so no DFA is used by two threads.
+ */
+StrangerAutomaton* StrangerAutomaton::copy(int id) const
+{
+	debug(stringbuilder() << id << " = copy(" << this->ID << ")");
+	StrangerAutomaton* retMe = new StrangerAutomaton();
+	retMe->top = this->top;
+	retMe->bottom = this->bottom;
+	if (this->dfa != NULL && DFAInterner::isStored(this->dfaHandle)) {
+		retMe->dfa = this->dfa;
+		retMe->dfaHandle = this->dfaHandle;
+	} else if (this->dfa != NULL) {
+		retMe->setDfa(dfaCopy(this->minimalDfa()));
+	}
+	retMe->setID(id);
+	return retMe;
+}
+
+/**
+ * Replaces the DFA by the one of the run wide store with the same structure.
+ * It is only read again through a copy, see ownDfa.
+ */
+void StrangerAutomaton::intern() const
+{
+	DFAInterner& interner = DFAInterner::getInstance();
+	if (this->dfa == NULL || !interner.isEnabled() || DFAInterner::isStored(this->dfaHandle)) {
+		return;
+	}
+	this->dfaHandle = interner.intern(this->minimalDfa());
+	this->dfa = this->dfaHandle.get();
+}
+
+/**
+ * Prepares the automaton for another thread. Automata sharing a constant of
+ * this thread get a DFA of their own, unless the DFA is moved to the run wide
+ * store anyway.
+ */
+void StrangerAutomaton::handOff() const
+{
+	if (DFAInterner::getInstance().isEnabled()) {
+		intern();
+	} else if (this->dfa != NULL && std::get_deleter<ThreadConstant>(this->dfaHandle) != nullptr) {
+		this->dfa = dfaCopy(this->dfa);
+		this->dfaHandle.reset(this->dfa, DfaRelease());
+	}
+}
+
 
 
 /**
@@ -260,7 +462,7 @@ StrangerAutomaton* StrangerAutomaton::makeContainsString(const std::string& s, i
 {
     StrangerAutomaton* aut = makeString(s, id);
     StrangerAutomaton* contained = new StrangerAutomaton(
-        dfa_star_M_star(aut->dfa, num_ascii_track, indices_main));
+        dfa_star_M_star(aut->minimalDfa(), num_ascii_track, indices_main));
     delete aut;
     return contained;
 }
@@ -347,10 +549,8 @@ StrangerAutomaton* StrangerAutomaton::makeAnyString(int id) {
     
     debugToFile(stringbuilder() << "M[" << traceID << "] = dfaAllStringASCIIExceptReserveWords(NUM_ASCII_TRACKS, indices_main);//" << id << " = makeAnyString()");
     
-    StrangerAutomaton* retMe = new StrangerAutomaton(
-                                                     dfaAllStringASCIIExceptReserveWords(
-                                                                                         num_ascii_track,
-                                                                                         indices_main));
+    static thread_local std::shared_ptr<DFA> anyString(dfaAllStringASCIIExceptReserveWords(num_ascii_track, indices_main), ThreadConstant());
+    StrangerAutomaton* retMe = makeConstant(anyString);
     {
         retMe->setID(id);
         retMe->debugAutomaton();
@@ -413,10 +613,8 @@ StrangerAutomaton* StrangerAutomaton::makeEmptyString(int id) {
     
     debugToFile(stringbuilder() << "M[" << traceID << "] = dfaASCIIOnlyNullString(NUM_ASCII_TRACKS, indices_main);//" << id << " = makeEmptyString()");
     
-    StrangerAutomaton* retMe = new StrangerAutomaton(
-                                                     dfaASCIIOnlyNullString(
-                                                                            num_ascii_track,
-                                                                            indices_main));
+    static thread_local std::shared_ptr<DFA> emptyString(dfaASCIIOnlyNullString(num_ascii_track, indices_main), ThreadConstant());
+    StrangerAutomaton* retMe = makeConstant(emptyString);
     
     {
         retMe->setID(id);
@@ -448,10 +646,8 @@ StrangerAutomaton* StrangerAutomaton::makeDot(int id) {
     
     debugToFile(stringbuilder() << "M[" << traceID << "] = dfaDot(NUM_ASCII_TRACKS, indices_main);//"<< id << " = makeDot()");
     
-    StrangerAutomaton* retMe = new StrangerAutomaton(
-                                                     dfaDot(
-                                                            num_ascii_track,
-                                                            indices_main));
+    static thread_local std::shared_ptr<DFA> dot(dfaDot(num_ascii_track, indices_main), ThreadConstant());
+    StrangerAutomaton* retMe = makeConstant(dot);
     
     {
         retMe->setID(id);
@@ -480,7 +676,8 @@ StrangerAutomaton* StrangerAutomaton::makePhi(int id) {
     
     debugToFile(stringbuilder() << "M[" << traceID << "] = dfaASCIINonString(NUM_ASCII_TRACKS, indices_main);//"<< id << " = makePhi()");
     
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaASCIINonString(num_ascii_track, indices_main));
+    static thread_local std::shared_ptr<DFA> phi(dfaASCIINonString(num_ascii_track, indices_main), ThreadConstant());
+    StrangerAutomaton* retMe = makeConstant(phi);
     {
         retMe->setID(id);
         retMe->debugAutomaton();
@@ -499,7 +696,7 @@ std::string StrangerAutomaton::generateSatisfyingExample() const
 {
     std::string str;
     if (!this->isEmpty()) {
-	char* example = dfaGenerateExample(this->dfa, num_ascii_track, u_indices_main);
+	char* example = dfaGenerateExample(this->minimalDfa(), num_ascii_track, u_indices_main);
 	if (example != NULL) {
             str = example;
             free(example);
@@ -510,7 +707,7 @@ std::string StrangerAutomaton::generateSatisfyingExample() const
 
 StrangerAutomaton* StrangerAutomaton::generateSatisfyingSingleton() const
 {
-    DFA* dfa = dfaGenerateSingleton(this->dfa, num_ascii_track, u_indices_main);
+    DFA* dfa = dfaGenerateSingleton(this->minimalDfa(), num_ascii_track, u_indices_main);
     if (dfa) {
         return new StrangerAutomaton(dfa);
     }
@@ -626,7 +823,7 @@ StrangerAutomaton* StrangerAutomaton::closure(int id) {
     debugToFile(stringbuilder() << "M[" << traceID << "] = dfa_closure_extrabit(M["<< this->autoTraceID << "], NUM_ASCII_TRACKS, indices_main);//"<<id << " = closure("  << this->ID <<  ")");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_closure_extrabit(this->dfa, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_closure_extrabit(this->minimalDfa(), num_ascii_track, indices_main));
     perfInfo->closure_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_closure++;
     
@@ -824,7 +1021,7 @@ StrangerAutomaton* StrangerAutomaton::complement(int id) const {
     debugToFile(stringbuilder() << "M[" << traceID << "] = dfa_negate(M[" << this->autoTraceID << "], NUM_ASCII_TRACKS, indices_main);//"<<id << " = complement("  << this->ID <<  ")");
     
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_negate(this->dfa, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_negate(this->minimalDfa(), num_ascii_track, indices_main));
     perfInfo->complement_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_complement++;
     
@@ -875,7 +1072,16 @@ StrangerAutomaton* StrangerAutomaton::union_(const StrangerAutomaton* otherAuto,
     debugToFile(stringbuilder() << "M[" << traceID << "] = dfa_union_with_emptycheck(M[" << this->autoTraceID << "], M["<< otherAuto->autoTraceID  << "], NUM_ASCII_TRACKS, indices_main);//"<<id << " = union_("  << this->ID <<  ", " << otherAuto->ID << ")");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_union_with_emptycheck(this->dfa, otherAuto->dfa, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = NULL;
+    if (lazyMinimizationStates > 0) {
+        // The inputs may be lazy results themselves, they are only shared
+        // within this analysis task
+        int minimized = 0;
+        DFA* result = dfa_union_lazy(this->ownDfa(), otherAuto->ownDfa(), lazyMinimizationStates, &minimized, num_ascii_track, indices_main);
+        retMe = makeLazyResult(result, minimized != 0);
+    } else {
+        retMe = new StrangerAutomaton(dfa_union_with_emptycheck(this->minimalDfa(), otherAuto->minimalDfa(), num_ascii_track, indices_main));
+    }
     perfInfo->union_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_union++;
     
@@ -949,7 +1155,15 @@ StrangerAutomaton* StrangerAutomaton::intersect(const StrangerAutomaton* otherAu
     debugToFile(stringbuilder() << "M[" << traceID << "] = dfa_intersect(M[" << this->autoTraceID << "], M["<< otherAuto->autoTraceID  << "]);//"<<id << " = intersect("  << this->ID <<  ", " << otherAuto->ID << ")");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_intersect(this->dfa, otherAuto->dfa));
+    StrangerAutomaton* retMe = NULL;
+    if (lazyMinimizationStates > 0) {
+        // See union_
+        int minimized = 0;
+        DFA* result = dfa_intersect_lazy(this->ownDfa(), otherAuto->ownDfa(), lazyMinimizationStates, &minimized);
+        retMe = makeLazyResult(result, minimized != 0);
+    } else {
+        retMe = new StrangerAutomaton(dfa_intersect(this->minimalDfa(), otherAuto->minimalDfa()));
+    }
     perfInfo->intersect_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_intersect++;
     
@@ -974,7 +1188,7 @@ StrangerAutomaton* StrangerAutomaton::productImpl(StrangerAutomaton* otherAuto,
     debugToFile(stringbuilder() << "M[" << traceID << "] = dfa_product_impl(M[" << this->autoTraceID << "], M["<< otherAuto->autoTraceID  << "]);//"<<id << " = intersect("  << this->ID <<  ", " << otherAuto->ID << ")");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_product_impl(this->dfa, otherAuto->dfa));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_product_impl(this->minimalDfa(), otherAuto->minimalDfa()));
     perfInfo->product_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_product++;
 
@@ -1018,16 +1232,10 @@ StrangerAutomaton* StrangerAutomaton::preciseWiden(const StrangerAutomaton* othe
     else if (otherAuto->isBottom())
         return this->clone(id);
     
-    if (coarseWidening) {
-        debugToFile(stringbuilder() << "setPreciseWiden();");
-        setPreciseWiden();
-        coarseWidening = false;
-    }
-    
-    debugToFile(stringbuilder() << "M[" << traceID << "] = dfaWiden(M[" << this->autoTraceID << "], M["<< otherAuto->autoTraceID  << "]);//"<<id << " = precise_widen("  << this->ID <<  ", " << otherAuto->ID << ")");
+    debugToFile(stringbuilder() << "M[" << traceID << "] = dfaWidenMode(M[" << this->autoTraceID << "], M["<< otherAuto->autoTraceID  << "], 0);//"<<id << " = precise_widen("  << this->ID <<  ", " << otherAuto->ID << ")");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaWiden(this->dfa, otherAuto->dfa));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaWidenMode(this->minimalDfa(), otherAuto->minimalDfa(), 0));
     perfInfo->precisewiden_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_precisewiden++;
     
@@ -1070,16 +1278,10 @@ StrangerAutomaton* StrangerAutomaton::coarseWiden(const StrangerAutomaton* other
     else if (otherAuto->isBottom())
         return this->clone(id);
     
-    if (!coarseWidening) {
-        debugToFile(stringbuilder() << "setCoarseWiden();");
-        setCoarseWiden();
-        coarseWidening = true;
-    }
-    
-    debugToFile(stringbuilder() << "M[" << traceID << "] = dfaWiden(M[" << this->autoTraceID << "], M["<< otherAuto->autoTraceID  << "]);//"<<id << " = coarse_widen("  << this->ID <<  ", " << otherAuto->ID << ")");
+    debugToFile(stringbuilder() << "M[" << traceID << "] = dfaWidenMode(M[" << this->autoTraceID << "], M["<< otherAuto->autoTraceID  << "], 1);//"<<id << " = coarse_widen("  << this->ID <<  ", " << otherAuto->ID << ")");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaWiden(this->dfa, otherAuto->dfa));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaWidenMode(this->minimalDfa(), otherAuto->minimalDfa(), 1));
     perfInfo->coarsewiden_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_coarsewiden++;
     {
@@ -1132,7 +1334,7 @@ StrangerAutomaton* StrangerAutomaton::concatenate(const StrangerAutomaton* other
     boost::posix_time::ptime start_time = perfInfo->current_time();
     // dfa_concat_extrabit returns new dfa structure in memory so no need to
     // worry about the two dfas of this and auto
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_concat(this->dfa, otherAuto->dfa, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_concat(this->minimalDfa(), otherAuto->minimalDfa(), num_ascii_track, indices_main));
     perfInfo->concat_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_concat++;
 
@@ -1163,6 +1365,94 @@ StrangerAutomaton* StrangerAutomaton::concatenate(const StrangerAutomaton* other
     return concatenate(otherAuto, traceID);
 }
 
+/**
+ * Returns a new automaton accepting the union of the languages of all
+ * automata in autos, computed with a single n-ary product.
+ * @param id
+ *            : id of node associated with this auto; used for debugging
+ *            purposes only
+ */
+StrangerAutomaton* StrangerAutomaton::unionAll(const std::vector<const StrangerAutomaton*>& autos, int id)
+{
+    debug(stringbuilder() << id <<  " = unionAll(" << autos.size() << " automata)");
+
+    // if top or bottom then do not use the c library as dfa == NULL
+    std::vector<DFA*> dfas;
+    const StrangerAutomaton* single = nullptr;
+    for (auto automaton : autos) {
+        if (automaton->isTop()) {
+            return makeTop(id);
+        } else if (!automaton->isBottom()) {
+            dfas.push_back(automaton->minimalDfa());
+            single = automaton;
+        }
+    }
+    if (dfas.empty()) {
+        return makeBottom(id);
+    } else if (dfas.size() == 1) {
+        return single->clone(id);
+    }
+
+    boost::posix_time::ptime start_time = perfInfo->current_time();
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_union_all(dfas.data(), (int) dfas.size(), num_ascii_track, indices_main));
+    perfInfo->union_all_total_time += perfInfo->current_time() - start_time;
+    perfInfo->num_of_union_all++;
+
+    {
+        retMe->setID(id);
+        retMe->debugAutomaton();
+    }
+    if (retMe->isNull()) {
+        throw StrangerException(AnalysisError::MonaException, "Null DFA pointer returned from MONA");
+    }
+    return retMe;
+}
+
+/**
+ * Returns a new automaton accepting the concatenation of the languages of
+ * all automata in autos, in order.
+ * @param id
+ *            : id of node associated with this auto; used for debugging
+ *            purposes only
+ */
+StrangerAutomaton* StrangerAutomaton::concatAll(const std::vector<const StrangerAutomaton*>& autos, int id)
+{
+    debug(stringbuilder() << id <<  " = concatAll(" << autos.size() << " automata)");
+
+    // if top or bottom then do not use the c library as dfa == NULL
+    std::vector<DFA*> dfas;
+    for (auto automaton : autos) {
+        if (automaton->isTop()) {
+            return makeTop(id);
+        }
+    }
+    for (auto automaton : autos) {
+        if (automaton->isBottom()) {
+            return makeBottom(id);
+        }
+        dfas.push_back(automaton->minimalDfa());
+    }
+    if (dfas.empty()) {
+        return makeEmptyString(id);
+    } else if (dfas.size() == 1) {
+        return autos.front()->clone(id);
+    }
+
+    boost::posix_time::ptime start_time = perfInfo->current_time();
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_concat_all(dfas.data(), (int) dfas.size(), num_ascii_track, indices_main));
+    perfInfo->concat_all_total_time += perfInfo->current_time() - start_time;
+    perfInfo->num_of_concat_all++;
+
+    {
+        retMe->setID(id);
+        retMe->debugAutomaton();
+    }
+    if (retMe->isNull()) {
+        throw StrangerException(AnalysisError::MonaException, "Null DFA pointer returned from MONA");
+    }
+    return retMe;
+}
+
 //***************************************************************************************
 //*                                  Backwards Concatenation                            *
 //***************************************************************************************
@@ -1190,7 +1480,7 @@ StrangerAutomaton* StrangerAutomaton::leftPreConcat(const StrangerAutomaton* rig
     debugToFile(stringbuilder() << "M[" << traceID << "] = dfa_pre_concat(M[" << this->autoTraceID << "], M[" << rightSiblingAuto->autoTraceID << "], 1, NUM_ASCII_TRACKS, indices_main);//" << id << " = leftPreConcat("  << this->ID <<  ", " << rightSiblingAuto->ID << ")");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_concat(this->dfa, rightSiblingAuto->dfa, 1, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_concat(this->minimalDfa(), rightSiblingAuto->minimalDfa(), 1, num_ascii_track, indices_main));
     perfInfo->pre_concat_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_pre_concat++;
     {
@@ -1240,7 +1530,7 @@ StrangerAutomaton* StrangerAutomaton::leftPreConcatConst(std::string rightSiblin
     debugToFile(stringbuilder() << "M[" << traceID << "] = dfa_pre_concat_const(M[" << this->autoTraceID << "], \"" << escapeSpecialChars(rightSiblingString) << "\", 1, NUM_ASCII_TRACKS, indices_main);//" <<id << " = rightPreConcatConst("  << this->ID <<  ", " << escapeSpecialChars(rightSiblingString) << ")");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_concat_const(this->dfa, rightSiblingString.c_str(), 1, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_concat_const(this->minimalDfa(), rightSiblingString.c_str(), 1, num_ascii_track, indices_main));
     perfInfo->const_pre_concat_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_const_pre_concat++;
     
@@ -1291,7 +1581,7 @@ StrangerAutomaton* StrangerAutomaton::rightPreConcat(const StrangerAutomaton* le
 				<< ")");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_concat(this->dfa, leftSiblingAuto->dfa, 2, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_concat(this->minimalDfa(), leftSiblingAuto->minimalDfa(), 2, num_ascii_track, indices_main));
     perfInfo->pre_concat_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_pre_concat++;
     {
@@ -1341,7 +1631,7 @@ StrangerAutomaton* StrangerAutomaton::rightPreConcatConst(std::string leftSiblin
 				<< escapeSpecialChars(leftSiblingString) << ")");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_concat_const(this->dfa, leftSiblingString.c_str(), 2, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_concat_const(this->minimalDfa(), leftSiblingString.c_str(), 2, num_ascii_track, indices_main));
     perfInfo->const_pre_concat_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_const_pre_concat++;
     
@@ -1486,19 +1776,21 @@ StrangerAutomaton* StrangerAutomaton::reg_replace(const StrangerAutomaton* patte
 				<< ", " << subjectAuto->ID << ")");
 
     
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_replace_extrabit(subjectAuto->dfa, patternAuto->dfa, replaceStr.c_str(), num_ascii_track, indices_main));
-    perfInfo->replace_total_time += perfInfo->current_time() - start_time;
-    perfInfo->num_of_replace++;
+    return memoize("reg_replace(" + replaceStr + ")", {subjectAuto, patternAuto}, id, [patternAuto, &replaceStr, subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfa_replace_extrabit(subjectAuto->minimalDfa(), patternAuto->minimalDfa(), replaceStr.c_str(), num_ascii_track, indices_main));
+        perfInfo->replace_total_time += perfInfo->current_time() - start_time;
+        perfInfo->num_of_replace++;
     
-    {
-        retMe->ID = id;
-//        retMe->debugAutomaton();
-    }
-    if (retMe->isNull()) {
-        throw StrangerException(AnalysisError::MonaException, "Null DFA pointer returned from MONA");
-    }
-    return retMe;
+        {
+            retMe->ID = id;
+    //        retMe->debugAutomaton();
+        }
+        if (retMe->isNull()) {
+            throw StrangerException(AnalysisError::MonaException, "Null DFA pointer returned from MONA");
+        }
+        return retMe;
+    });
 }
 
 
@@ -1537,15 +1829,15 @@ StrangerAutomaton* StrangerAutomaton::general_replace(const StrangerAutomaton* p
                     ((patternStr.length() == 0) && (!patternAuto->isEmpty()))) // Single NULL character (e.g. \x00)
                    && (replaceStr.length() > 0)) { // Not deleting
           std::cout << "Trying: replace_char_with_string: 0x" << std::hex << static_cast<int>(patternStr[0]) << std::dec << " --> " << replaceStr << std::endl;
-          retMe = new StrangerAutomaton(dfa_replace_char_with_string(subjectAuto->dfa, num_ascii_track, indices_main, patternStr[0], replaceStr.c_str()));
+          retMe = new StrangerAutomaton(dfa_replace_char_with_string(subjectAuto->minimalDfa(), num_ascii_track, indices_main, patternStr[0], replaceStr.c_str()));
         } else {
-          retMe = new StrangerAutomaton(dfa_replace_extrabit(subjectAuto->dfa, patternAuto->dfa, replaceStr.c_str(), num_ascii_track, indices_main));
+          retMe = new StrangerAutomaton(dfa_replace_extrabit(subjectAuto->minimalDfa(), patternAuto->minimalDfa(), replaceStr.c_str(), num_ascii_track, indices_main));
         }
       } else {
-        retMe = new StrangerAutomaton(dfa_replace_extrabit(subjectAuto->dfa, patternAuto->dfa, replaceStr.c_str(), num_ascii_track, indices_main));
+        retMe = new StrangerAutomaton(dfa_replace_extrabit(subjectAuto->minimalDfa(), patternAuto->minimalDfa(), replaceStr.c_str(), num_ascii_track, indices_main));
       } 
     } else {
-        retMe = new StrangerAutomaton(dfa_general_replace_extrabit(subjectAuto->dfa, patternAuto->dfa, replaceAuto->dfa, num_ascii_track, indices_main));
+        retMe = new StrangerAutomaton(dfa_general_replace_extrabit(subjectAuto->minimalDfa(), patternAuto->minimalDfa(), replaceAuto->minimalDfa(), num_ascii_track, indices_main));
     }
     perfInfo->replace_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_replace++;
@@ -1624,18 +1916,20 @@ StrangerAutomaton* StrangerAutomaton::str_replace(const StrangerAutomaton* searc
     debugToFile(stringbuilder() << "M[" << (traceID) << "] = dfa_replace_extrabit(M["<< subjectAuto->autoTraceID  << "], M[" << searchAuto->autoTraceID << "], \"" << replaceStr << "\" , NUM_ASCII_TRACKS, indices_main);//"<<id << " = str_replace(" << searchAuto->ID << ", " << replaceStr << ", "
 				<< subjectAuto->ID << ")");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_replace_extrabit(subjectAuto->dfa,searchAuto->dfa, replaceStr.c_str(), num_ascii_track, indices_main));
-    perfInfo->replace_total_time += perfInfo->current_time() - start_time;
-    perfInfo->num_of_replace++;
+    return memoize("str_replace(" + replaceStr + ")", {subjectAuto, searchAuto}, id, [searchAuto, &replaceStr, subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfa_replace_extrabit(subjectAuto->minimalDfa(),searchAuto->minimalDfa(), replaceStr.c_str(), num_ascii_track, indices_main));
+        perfInfo->replace_total_time += perfInfo->current_time() - start_time;
+        perfInfo->num_of_replace++;
     
-    {
-        retMe->ID = id;
-    }
-    if (retMe->isNull()) {
-        throw StrangerException(AnalysisError::MonaException, "Null DFA pointer returned from MONA");
-    }
-    return retMe;
+        {
+            retMe->ID = id;
+        }
+        if (retMe->isNull()) {
+            throw StrangerException(AnalysisError::MonaException, "Null DFA pointer returned from MONA");
+        }
+        return retMe;
+    });
 }
 
 /**
@@ -1663,7 +1957,7 @@ StrangerAutomaton* StrangerAutomaton::str_replace_once(const StrangerAutomaton*
     boost::posix_time::ptime start_time = perfInfo->current_time();
     std::string replaceStr = replaceAuto->getStr();
     StrangerAutomaton* retMe = new StrangerAutomaton(
-        dfa_replace_once_extrabit(subjectAuto->dfa, str->dfa, replaceStr.c_str(), num_ascii_track, indices_main)
+        dfa_replace_once_extrabit(subjectAuto->minimalDfa(), str->minimalDfa(), replaceStr.c_str(), num_ascii_track, indices_main)
         );
     perfInfo->replace_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_replace++;
@@ -1726,7 +2020,7 @@ StrangerAutomaton* StrangerAutomaton::preReplace(const StrangerAutomaton* search
     
     debugToFile(stringbuilder() << "M[" << (traceID) << "] = dfa_pre_replace_str(M[" << this->autoTraceID << "], M[" << searchAuto->autoTraceID << "], \"" << replaceString << "\" , NUM_ASCII_TRACKS, indices_main);//"<<id << " = preReplace("  << this->ID <<  ", " << searchAuto->ID << ")");
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_replace_str(this->dfa, searchAuto->dfa, replaceString.c_str(), num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_replace_str(this->minimalDfa(), searchAuto->minimalDfa(), replaceString.c_str(), num_ascii_track, indices_main));
     perfInfo->pre_replace_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_pre_replace++;
 
@@ -1772,7 +2066,7 @@ StrangerAutomaton* StrangerAutomaton::preReplaceOnce(const StrangerAutomaton* se
     
     debugToFile(stringbuilder() << "M[" << (traceID) << "] = dfa_pre_replace_str(M[" << this->autoTraceID << "], M[" << searchAuto->autoTraceID << "], \"" << replaceString << "\" , NUM_ASCII_TRACKS, indices_main);//"<<id << " = preReplace("  << this->ID <<  ", " << searchAuto->ID << ")");
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_replace_once_str(this->dfa, searchAuto->dfa, replaceString.c_str(), num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_pre_replace_once_str(this->minimalDfa(), searchAuto->minimalDfa(), replaceString.c_str(), num_ascii_track, indices_main));
     perfInfo->pre_replace_total_time += perfInfo->current_time() - start_time;
     perfInfo->num_of_pre_replace++;
 
@@ -1807,7 +2101,7 @@ StrangerAutomaton* StrangerAutomaton::preMatch(const StrangerAutomaton* pattern,
 
 StrangerAutomaton* StrangerAutomaton::getUnaryAutomaton(int id) const {
     debug(stringbuilder() << id <<  " = dfa_string_to_unaryDFA("  << this->ID << ")");
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_string_to_unaryDFA(this->dfa, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_string_to_unaryDFA(this->minimalDfa(), num_ascii_track, indices_main));
     retMe->ID = id;
     retMe->debugAutomaton();
     return retMe;
@@ -1824,7 +2118,7 @@ StrangerAutomaton* StrangerAutomaton::restrictLengthByOtherAutomaton(const Stran
 }
 
 StrangerAutomaton* StrangerAutomaton::restrictLengthByOtherAutomatonFinite(const StrangerAutomaton *otherAuto, int id) const {
-    P_DFAFiniteLengths pDFAFiniteLengths = dfaGetLengthsFiniteLang(otherAuto->dfa, num_ascii_track, indices_main);
+    P_DFAFiniteLengths pDFAFiniteLengths = dfaGetLengthsFiniteLang(otherAuto->minimalDfa(), num_ascii_track, indices_main);
     unsigned *lengths = pDFAFiniteLengths->lengths;
     const unsigned size = pDFAFiniteLengths->size;
 
@@ -1836,7 +2130,7 @@ StrangerAutomaton* StrangerAutomaton::restrictLengthByOtherAutomatonFinite(const
 //    vector<unsigned> vec(lengths, lengths + size);
 	debug(stringbuilder() << id <<  " = dfaRestrictByFiniteLengths("  << this->ID << ", " << otherAuto->ID << ")");
 //    cout << "lengths are: " << vec << endl;
-	StrangerAutomaton* retMe = new StrangerAutomaton(dfaRestrictByFiniteLengths(this->dfa, lengths, size, false, num_ascii_track, indices_main));
+	StrangerAutomaton* retMe = new StrangerAutomaton(dfaRestrictByFiniteLengths(this->minimalDfa(), lengths, size, false, num_ascii_track, indices_main));
 	retMe->ID = id;
 	retMe->debugAutomaton();
 
@@ -1849,7 +2143,7 @@ StrangerAutomaton* StrangerAutomaton::restrictLengthByOtherAutomatonFinite(const
 
 StrangerAutomaton* StrangerAutomaton::restrictLengthByUnaryAutomaton(const StrangerAutomaton* uL, int id) const {
     debug(stringbuilder() << id <<  " = dfa_restrict_by_unaryDFA("  << this->ID << ", " << uL->ID << ")");
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_restrict_by_unaryDFA(this->dfa, uL->dfa, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfa_restrict_by_unaryDFA(this->minimalDfa(), uL->minimalDfa(), num_ascii_track, indices_main));
     retMe->ID = id;
     retMe->debugAutomaton();
     return retMe;
@@ -1885,8 +2179,8 @@ bool StrangerAutomaton::checkIntersection(const StrangerAutomaton* otherAuto, in
     
     
     debugToFile(stringbuilder() << "check_intersection(M[" << this->autoTraceID << "],M["<< otherAuto->autoTraceID  << "], NUM_ASCII_TRACKS, indices_main);//check_intersection("  << this->ID <<  ", " << otherAuto->ID << ")");
-    int result = check_intersection(this->dfa,
-                                    otherAuto->dfa, num_ascii_track,
+    int result = check_intersection(this->minimalDfa(),
+                                    otherAuto->minimalDfa(), num_ascii_track,
                                     indices_main);
     
     {
@@ -1938,8 +2232,8 @@ bool StrangerAutomaton::checkInclusion(const StrangerAutomaton* otherAuto, int i
     }
     
     debugToFile(stringbuilder() << "check_inclusion(M[" << this->autoTraceID << "],M["<< otherAuto->autoTraceID  << "], NUM_ASCII_TRACKS, indices_main);//check_inclusion("  << this->ID <<  ", " << otherAuto->ID << ")");
-    int result = check_inclusion(this->dfa,
-                                 otherAuto->dfa, num_ascii_track,
+    int result = check_inclusion(this->minimalDfa(),
+                                 otherAuto->minimalDfa(), num_ascii_track,
                                  indices_main);
     
     {
@@ -1992,8 +2286,8 @@ bool StrangerAutomaton::checkEquivalence(const StrangerAutomaton* otherAuto, int
     }
     
     debugToFile(stringbuilder() << "check_equivalence(M[" << this->autoTraceID << "],M["<< otherAuto->autoTraceID  << "], NUM_ASCII_TRACKS, indices_main);//check_equivalence("  << this->ID <<  ", " << otherAuto->ID << ")");
-    int result = check_equivalence(this->dfa,
-                                   otherAuto->dfa,
+    int result = check_equivalence(this->minimalDfa(),
+                                   otherAuto->minimalDfa(),
                                    num_ascii_track,
                                    indices_main);
     
@@ -2031,7 +2325,7 @@ bool StrangerAutomaton::checkEquivalence(const StrangerAutomaton* otherAuto) con
  */
 bool StrangerAutomaton::isLengthFinite() const {
     std::string debugString = stringbuilder() << "isLengthFinite("  << this->ID << ") = ";
-    int result = ::isLengthFiniteTarjan(this->dfa, num_ascii_track, indices_main);
+    int result = ::isLengthFiniteTarjan(this->minimalDfa(), num_ascii_track, indices_main);
     debug(stringbuilder() << debugString << ( result == 0 ? false : true ));
     if (result == 0)
         return false;
@@ -2047,7 +2341,7 @@ unsigned StrangerAutomaton::getMaxLength() const {
             throw StrangerException(AnalysisError::InfiniteLength, "Length of this automaton is infinite! ID: " + this->ID);
 	}
 
-	P_DFAFiniteLengths finiteLengths = dfaGetLengthsFiniteLang(this->dfa, num_ascii_track, indices_main);
+	P_DFAFiniteLengths finiteLengths = dfaGetLengthsFiniteLang(this->minimalDfa(), num_ascii_track, indices_main);
 	const unsigned size = finiteLengths->size;
 	unsigned *lengths = finiteLengths->lengths;
 	unsigned max_length = lengths[size-1];
@@ -2067,7 +2361,7 @@ unsigned StrangerAutomaton::getMinLength() const {
             throw StrangerException(AnalysisError::InfiniteLength, "Length of this automaton is infinite! ID: " + this->ID);
 	}
 
-	P_DFAFiniteLengths finiteLengths = dfaGetLengthsFiniteLang(this->dfa, num_ascii_track, indices_main);
+	P_DFAFiniteLengths finiteLengths = dfaGetLengthsFiniteLang(this->minimalDfa(), num_ascii_track, indices_main);
 	unsigned *lengths = finiteLengths->lengths;
 	unsigned min_length = lengths[0];
 
@@ -2107,7 +2401,7 @@ bool StrangerAutomaton::checkEmptiness() const {
     }
 
     debugToFile(stringbuilder() << "check_emptiness(M[" << this->autoTraceID << "], NUM_ASCII_TRACKS, indices_main);//check_emptiness("  << this->ID <<  ")");
-    int result = check_emptiness(this->dfa, num_ascii_track,
+    int result = check_emptiness(this->minimalDfa(), num_ascii_track,
                                  indices_main);
     {
         debug(stringbuilder() << debugStr << (result == 0 ? false : true));
@@ -2148,14 +2442,124 @@ bool StrangerAutomaton::checkEmptyString() const {
     if (this->isBottom() || this->isTop())
         return false;
     debugToFile(stringbuilder() << "checkEmptyString(M[" << this->autoTraceID << "]);//checkEmptyString("  << this->ID <<  ")");
-    if (::checkEmptyString(this->dfa) == 1)
+    if (::checkEmptyString(this->minimalDfa()) == 1)
         return true;
     else
         return false;
 }
 
+/**
+ * checks membership of many concrete strings in L(this auto) at once.
+ * The DFA is compiled once into a dense table with 256 columns per state
+ * so that each character costs a single table lookup instead of a walk
+ * over the BDD paths of the current state as in checkMembership.
+ *
+ * @return a bitmap with bit i set iff strings[i] is accepted
+ */
+std::vector<bool> StrangerAutomaton::acceptsBatch(const std::vector<std::string>& strings) const {
+    debug(stringbuilder() << "acceptsBatch("  << this->ID <<  ", " << strings.size() << " strings)");
+    if (this->isBottom() || this->isNull()) {
+        return std::vector<bool>(strings.size(), false);
+    } else if (this->isTop()) {
+        return std::vector<bool>(strings.size(), true);
+    }
+
+    boost::posix_time::ptime start_time = perfInfo->current_time();
+    std::vector<bool> result(strings.size(), false);
+    int* table = dfaGetDenseTransitionTable(this->minimalDfa(), num_ascii_track, indices_main);
+    if (table == nullptr) {
+        throw StrangerException(AnalysisError::MonaException, "Null transition table returned from MONA");
+    }
+    const int* finals = this->minimalDfa()->f;
+    for (std::size_t i = 0; i < strings.size(); i++) {
+        int state = this->minimalDfa()->s;
+        for (const unsigned char c : strings[i]) {
+            state = table[state * 256 + c];
+        }
+        result[i] = (finals[state] == 1);
+    }
+    free(table);
+    perfInfo->accepts_batch_total_time += perfInfo->current_time() - start_time;
+    perfInfo->num_of_accepts_batch++;
+    perfInfo->num_of_accepts_batch_strings += strings.size();
+    return result;
+}
+
+/**
+ * returns the bytes which occur in some accepted string, i.e. the labels of
+ * transitions between states that are both reachable from the start state
+ * and can reach an accepting state.
+ * A string containing any other byte can not be in L(this auto).
+ */
+std::bitset<256> StrangerAutomaton::getReachableAlphabet() const {
+    std::bitset<256> alphabet;
+    if (this->isBottom() || this->isNull()) {
+        return alphabet;
+    } else if (this->isTop()) {
+        return alphabet.set();
+    }
+
+    const int ns = this->minimalDfa()->ns;
+    int* table = dfaGetDenseTransitionTable(this->minimalDfa(), num_ascii_track, indices_main);
+    if (table == nullptr) {
+        throw StrangerException(AnalysisError::MonaException, "Null transition table returned from MONA");
+    }
+
+    // forward reachability from the start state
+    std::vector<bool> reachable(ns, false);
+    std::vector<int> worklist;
+    reachable[this->minimalDfa()->s] = true;
+    worklist.push_back(this->minimalDfa()->s);
+    while (!worklist.empty()) {
+        int state = worklist.back();
+        worklist.pop_back();
+        for (int c = 0; c < 256; c++) {
+            int next = table[state * 256 + c];
+            if (!reachable[next]) {
+                reachable[next] = true;
+                worklist.push_back(next);
+            }
+        }
+    }
+
+    // backward reachability from the accepting states, iterated to a fixpoint
+    std::vector<bool> live(ns, false);
+    for (int i = 0; i < ns; i++) {
+        live[i] = (this->minimalDfa()->f[i] == 1);
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < ns; i++) {
+            if (live[i]) {
+                continue;
+            }
+            for (int c = 0; c < 256; c++) {
+                if (live[table[i * 256 + c]]) {
+                    live[i] = true;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < ns; i++) {
+        if (!reachable[i] || !live[i]) {
+            continue;
+        }
+        for (int c = 0; c < 256; c++) {
+            if (live[table[i * 256 + c]]) {
+                alphabet.set(c);
+            }
+        }
+    }
+    free(table);
+    return alphabet;
+}
+
 bool StrangerAutomaton::isSingleton() const {
-  char *s = ::isSingleton(this->dfa, num_ascii_track, indices_main);
+  char *s = ::isSingleton(this->minimalDfa(), num_ascii_track, indices_main);
   if (s == NULL) {
     return false;
   } else {
@@ -2165,7 +2569,7 @@ bool StrangerAutomaton::isSingleton() const {
 }
 
 string StrangerAutomaton::getStr() const {
-    char* result = ::isSingleton(this->dfa, num_ascii_track, indices_main);
+    char* result = ::isSingleton(this->minimalDfa(), num_ascii_track, indices_main);
     if (result == NULL){
         throw StrangerException(AnalysisError::MonaException, "Trying to get a string for an automaton with a nonSingleton language.");
     }
@@ -2191,30 +2595,57 @@ bool StrangerAutomaton::isTop() const {
     return (this->top == true);
 }
 
+std::size_t StrangerAutomaton::fingerprint() const {
+    if (isTop() || this->dfa == NULL) {
+        return isTop() ? 1 : 0;
+    }
+    std::size_t hash = DFAInterner::canonicalHash(this->structureDfa());
+    boost::hash_combine(hash, isBottom());
+    return hash;
+}
+
+bool StrangerAutomaton::isIsomorphicTo(const StrangerAutomaton* other) const {
+    if (isTop() != other->isTop() || isBottom() != other->isBottom()) {
+        return false;
+    }
+    if (this->dfa == NULL || other->dfa == NULL) {
+        return this->dfa == other->dfa;
+    }
+    // The store keeps one DFA of each structure
+    if (DFAInterner::isStored(this->dfaHandle) && DFAInterner::isStored(other->dfaHandle)) {
+        return this->dfa == other->dfa;
+    }
+    return DFAInterner::isIsomorphic(this->structureDfa(), other->structureDfa());
+}
+
 
 StrangerAutomaton* StrangerAutomaton::toUpperCase(int id) const
 {
     debug(stringbuilder() << id <<  " = dfaToUpperCase("  << this->ID << ")");
-	boost::posix_time::ptime start_time = perfInfo->current_time();
-	StrangerAutomaton* retMe = new StrangerAutomaton(dfaToUpperCase(this->dfa, num_ascii_track, indices_main));
-	perfInfo->to_uppercase_total_time += perfInfo->current_time() - start_time;
-	perfInfo->number_of_to_uppercase++;
+    return memoize("toUpperCase", {this}, id, [this, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaToUpperCase(this->minimalDfa(), num_ascii_track, indices_main));
+        perfInfo->to_uppercase_total_time += perfInfo->current_time() - start_time;
+        perfInfo->number_of_to_uppercase++;
 
-    retMe->setID(id);
-    return retMe;
+        retMe->setID(id);
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::toLowerCase(int id) const
 {
     debug(stringbuilder() << id <<  " = dfaToLowerCase("  << this->ID << ")");
 
-	boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaToLowerCase(this->dfa, num_ascii_track, indices_main));
-	perfInfo->to_lowercase_total_time += perfInfo->current_time() - start_time;
-	perfInfo->number_of_to_lowercase++;
+    return memoize("toLowerCase", {this}, id, [this, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaToLowerCase(this->minimalDfa(), num_ascii_track, indices_main));
+        perfInfo->to_lowercase_total_time += perfInfo->current_time() - start_time;
+        perfInfo->number_of_to_lowercase++;
 
-    retMe->setID(id);
-    return retMe;
+        retMe->setID(id);
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::preToUpperCase(int id) const {
@@ -2222,7 +2653,7 @@ StrangerAutomaton* StrangerAutomaton::preToUpperCase(int id) const {
     debug(stringbuilder() << id <<  " = dfaPreToUpperCase("  << this->ID << ")");
 
 	boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreToUpperCase(this->dfa, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreToUpperCase(this->minimalDfa(), num_ascii_track, indices_main));
 	perfInfo->pre_to_uppercase_total_time += perfInfo->current_time() - start_time;
 	perfInfo->number_of_pre_to_uppercase++;
 
@@ -2235,7 +2666,7 @@ StrangerAutomaton* StrangerAutomaton::preToLowerCase(int id) const {
     debug(stringbuilder() << id <<  " = dfaPreToLowerCase("  << this->ID << ")");
 
 	boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreToLowerCase(this->dfa, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreToLowerCase(this->minimalDfa(), num_ascii_track, indices_main));
 	perfInfo->pre_to_lowercase_total_time += perfInfo->current_time() - start_time;
 	perfInfo->number_of_pre_to_lowercase++;
 
@@ -2248,12 +2679,14 @@ StrangerAutomaton* StrangerAutomaton::trimSpaces(int id) const
 
     debug(stringbuilder() << id <<  " = dfaTrim(' ', "  << this->ID << ")");
 
-	boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaTrim(this->dfa, ' ', num_ascii_track, indices_main));
-	perfInfo->trim_spaces_total_time += perfInfo->current_time() - start_time;
-	perfInfo->number_of_trim_spaces++;
-    retMe->setID(id);
-    return retMe;
+    return memoize("trimSpaces", {this}, id, [this, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaTrim(this->minimalDfa(), ' ', num_ascii_track, indices_main));
+        perfInfo->trim_spaces_total_time += perfInfo->current_time() - start_time;
+        perfInfo->number_of_trim_spaces++;
+        retMe->setID(id);
+        return retMe;
+    });
 //	char ws[3] = {' ', '\n', '\t'};
 //	StrangerAutomaton* ret2 = trim(ws,id);
 //	ret2->setID(id);
@@ -2264,26 +2697,30 @@ StrangerAutomaton* StrangerAutomaton::trimSpacesLeft(int id) const {
 
     debug(stringbuilder() << id <<  " = dfaLeftTrim(' ', "  << this->ID << ")");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaLeftTrim(this->dfa, ' ', num_ascii_track, indices_main));
-	perfInfo->trim_spaces_left_total_time += perfInfo->current_time() - start_time;
-	perfInfo->number_of_trim_spaces_left++;
+    return memoize("trimSpacesLeft", {this}, id, [this, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaLeftTrim(this->minimalDfa(), ' ', num_ascii_track, indices_main));
+        perfInfo->trim_spaces_left_total_time += perfInfo->current_time() - start_time;
+        perfInfo->number_of_trim_spaces_left++;
 
-    retMe->setID(id);
-    return retMe;
+        retMe->setID(id);
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::trimSpacesRight(int id) const {
 
     debug(stringbuilder() << id <<  " = dfaRightTrim(' ', "  << this->ID << ")");
 
-	boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaRightTrim(this->dfa, ' ', num_ascii_track, indices_main));
-	perfInfo->trim_spaces_right_total_time += perfInfo->current_time() - start_time;
-	perfInfo->number_of_trim_spaces_rigth++;
+    return memoize("trimSpacesRight", {this}, id, [this, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaRightTrim(this->minimalDfa(), ' ', num_ascii_track, indices_main));
+        perfInfo->trim_spaces_right_total_time += perfInfo->current_time() - start_time;
+        perfInfo->number_of_trim_spaces_rigth++;
 
-    retMe->setID(id);
-    return retMe;
+        retMe->setID(id);
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::trim(char c, int id) const {
@@ -2291,7 +2728,7 @@ StrangerAutomaton* StrangerAutomaton::trim(char c, int id) const {
     debug(stringbuilder() << id <<  " = dfaTrim(" << this->ID << "," << c << ")");
 
 //    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaTrim(this->dfa, c, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaTrim(this->minimalDfa(), c, num_ascii_track, indices_main));
 
     retMe->setID(id);
     return retMe;
@@ -2301,7 +2738,7 @@ StrangerAutomaton* StrangerAutomaton::trimLeft(char c, int id) const {
     debug(stringbuilder() << id <<  " = dfaLeftTrim(" << this->ID << "," << c << ")");
 
 //	boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaLeftTrim(this->dfa, c, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaLeftTrim(this->minimalDfa(), c, num_ascii_track, indices_main));
 
 
     retMe->setID(id);
@@ -2312,7 +2749,7 @@ StrangerAutomaton* StrangerAutomaton::trimRight(char c, int id) const {
     debug(stringbuilder() << id <<  " = dfaRightTrim(" << this->ID << "," << c << ")");
 
 //    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaRightTrim(this->dfa, c, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaRightTrim(this->minimalDfa(), c, num_ascii_track, indices_main));
 
     retMe->setID(id);
     return retMe;
@@ -2322,7 +2759,7 @@ StrangerAutomaton* StrangerAutomaton::trim(char chars[], int id) const {
     debug(stringbuilder() << id <<  " = dfaTrimSet(" << this->ID << ",chars )\n");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaTrimSet(this->dfa, chars, (int)strlen(chars), num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaTrimSet(this->minimalDfa(), chars, (int)strlen(chars), num_ascii_track, indices_main));
 	perfInfo->trim_set_total_time += perfInfo->current_time() - start_time;
 	perfInfo->number_of_trim_set++;
 
@@ -2341,7 +2778,7 @@ StrangerAutomaton* StrangerAutomaton::preTrimSpaces(int id) const
     debug(stringbuilder() << id <<  " = dfaPreTrim(" << this->ID << ",' ')\n");
 
 	boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreTrim(this->dfa, ' ', num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreTrim(this->minimalDfa(), ' ', num_ascii_track, indices_main));
 //    StrangerAutomaton* a1 = new StrangerAutomaton(dfaPreTrim(retMe->dfa, '\n', num_ascii_track, indices_main));
 //    delete retMe;
 //    retMe = new StrangerAutomaton(dfaPreTrim(a1->dfa, '\t', num_ascii_track, indices_main));
@@ -2360,7 +2797,7 @@ StrangerAutomaton* StrangerAutomaton::preTrimSpacesLeft(int id) const
     debug(stringbuilder() << id <<  " = dfaPreTrimLeft(" << this->ID << ",' ')\n");
 
 	boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreLeftTrim(this->dfa, ' ', num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreLeftTrim(this->minimalDfa(), ' ', num_ascii_track, indices_main));
 	perfInfo->pre_trim_spaces_left_total_time += perfInfo->current_time() - start_time;
 	perfInfo->number_of_pre_trim_spaces_left++;
 
@@ -2373,7 +2810,7 @@ StrangerAutomaton* StrangerAutomaton::preTrimSpacesRigth(int id) const
     debug(stringbuilder() << id <<  " = dfaPreTrim(" << this->ID << ",' ')\n");
 
 	boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreRightTrim(this->dfa, ' ', num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreRightTrim(this->minimalDfa(), ' ', num_ascii_track, indices_main));
 	perfInfo->pre_trim_spaces_rigth_total_time += perfInfo->current_time() - start_time;
 	perfInfo->number_of_pre_trim_spaces_rigth++;
     retMe->setID(id);
@@ -2494,14 +2931,16 @@ StrangerAutomaton* StrangerAutomaton::addslashes(const StrangerAutomaton* subjec
 {
     debug(stringbuilder() << id << " = addSlashes(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaAddSlashes(subjectAuto->dfa, num_ascii_track, indices_main));
-    perfInfo->addslashes_total_time += perfInfo->current_time() - start_time;
-    perfInfo->number_of_addslashes++;
+    return memoize("addslashes", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaAddSlashes(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
+        perfInfo->addslashes_total_time += perfInfo->current_time() - start_time;
+        perfInfo->number_of_addslashes++;
 
-	retMe->ID = id;
-	retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+    	retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 
@@ -2512,7 +2951,7 @@ StrangerAutomaton* StrangerAutomaton::pre_addslashes(const StrangerAutomaton* su
 	debug(stringbuilder() << id << " = pre_addSlashes(" << subjectAuto->ID << ");");
 
 	boost::posix_time::ptime start_time = perfInfo->current_time();
-	StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreAddSlashes(subjectAuto->dfa, num_ascii_track, indices_main));
+	StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreAddSlashes(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
 	perfInfo->pre_addslashes_total_time += perfInfo->current_time() - start_time;
 	perfInfo->number_of_pre_addslashes++;
 
@@ -2526,14 +2965,16 @@ StrangerAutomaton* StrangerAutomaton::encodeAttrString(const StrangerAutomaton*
 
     debug(stringbuilder() << id << " = encodeAttrString(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaEncodeAttrString(subjectAuto->dfa, num_ascii_track, indices_main));
-    perfInfo->encodeattrstring_total_time += perfInfo->current_time() - start_time;
-    perfInfo->number_of_encodeattrstring++;
+    return memoize("encodeAttrString", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaEncodeAttrString(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
+        perfInfo->encodeattrstring_total_time += perfInfo->current_time() - start_time;
+        perfInfo->number_of_encodeattrstring++;
 
-    retMe->ID = id;
-    retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+        retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::pre_encodeAttrString(const StrangerAutomaton* subjectAuto, int id)
@@ -2542,7 +2983,7 @@ StrangerAutomaton* StrangerAutomaton::pre_encodeAttrString(const StrangerAutomat
     debug(stringbuilder() << id << " = pre_encodeAttrString(" << subjectAuto->ID << ");");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreEncodeAttrString(subjectAuto->dfa, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreEncodeAttrString(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
     perfInfo->pre_encodeattrstring_total_time += perfInfo->current_time() - start_time;
     perfInfo->number_of_pre_encodeattrstring++;
 
@@ -2556,14 +2997,16 @@ StrangerAutomaton* StrangerAutomaton::encodeTextFragment(const StrangerAutomaton
 
     debug(stringbuilder() << id << " = encodeTextFragment(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaEncodeTextFragment(subjectAuto->dfa, num_ascii_track, indices_main));
-    perfInfo->encodetextfragment_total_time += perfInfo->current_time() - start_time;
-    perfInfo->number_of_encodetextfragment++;
+    return memoize("encodeTextFragment", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaEncodeTextFragment(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
+        perfInfo->encodetextfragment_total_time += perfInfo->current_time() - start_time;
+        perfInfo->number_of_encodetextfragment++;
 
-    retMe->ID = id;
-    retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+        retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::pre_encodeTextFragment(const StrangerAutomaton* subjectAuto, int id)
@@ -2572,7 +3015,7 @@ StrangerAutomaton* StrangerAutomaton::pre_encodeTextFragment(const StrangerAutom
     debug(stringbuilder() << id << " = pre_encodeTextFragment(" << subjectAuto->ID << ");");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreEncodeTextFragment(subjectAuto->dfa, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreEncodeTextFragment(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
     perfInfo->pre_encodetextfragment_total_time += perfInfo->current_time() - start_time;
     perfInfo->number_of_pre_encodetextfragment++;
 
@@ -2586,14 +3029,16 @@ StrangerAutomaton* StrangerAutomaton::escapeHtmlTags(const StrangerAutomaton* su
 
     debug(stringbuilder() << id << " = escapeHtmlTags(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaHtmlEscapeTags(subjectAuto->dfa, num_ascii_track, indices_main));
-    perfInfo->escapehtmltags_total_time += perfInfo->current_time() - start_time;
-    perfInfo->number_of_escapehtmltags++;
+    return memoize("escapeHtmlTags", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaHtmlEscapeTags(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
+        perfInfo->escapehtmltags_total_time += perfInfo->current_time() - start_time;
+        perfInfo->number_of_escapehtmltags++;
 
-    retMe->ID = id;
-    retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+        retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::pre_escapeHtmlTags(const StrangerAutomaton* subjectAuto, int id)
@@ -2602,7 +3047,7 @@ StrangerAutomaton* StrangerAutomaton::pre_escapeHtmlTags(const StrangerAutomaton
     debug(stringbuilder() << id << " = pre_escapeHtmlTags(" << subjectAuto->ID << ");");
 
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreHtmlEscapeTags(subjectAuto->dfa, num_ascii_track, indices_main));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreHtmlEscapeTags(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
     perfInfo->pre_escapehtmltags_total_time += perfInfo->current_time() - start_time;
     perfInfo->number_of_pre_escapehtmltags++;
 
@@ -2627,14 +3072,16 @@ StrangerAutomaton* StrangerAutomaton::htmlSpecialChars(const StrangerAutomaton*
 
     debug(stringbuilder() << id << " = htmlSpecialChars(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaHtmlSpecialChars(subjectAuto->dfa, num_ascii_track, indices_main, _flag));
-    perfInfo->htmlspecialchars_total_time += perfInfo->current_time() - start_time;
-	perfInfo->number_of_htmlspecialchars++;
+    return memoize("htmlSpecialChars(" + flag + ")", {subjectAuto}, id, [subjectAuto, _flag, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaHtmlSpecialChars(subjectAuto->minimalDfa(), num_ascii_track, indices_main, _flag));
+        perfInfo->htmlspecialchars_total_time += perfInfo->current_time() - start_time;
+        perfInfo->number_of_htmlspecialchars++;
 
-	retMe->ID = id;
-	retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+    	retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 
@@ -2654,7 +3101,7 @@ StrangerAutomaton* StrangerAutomaton::preHtmlSpecialChars(const StrangerAutomato
 
     debug(stringbuilder() << id << " = preHtmlSpecialChars(" << subjectAuto->ID << ");");
     boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreHtmlSpecialChars(subjectAuto->dfa, num_ascii_track, indices_main, _flag));
+    StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreHtmlSpecialChars(subjectAuto->minimalDfa(), num_ascii_track, indices_main, _flag));
     perfInfo->pre_htmlspecialchars_total_time += perfInfo->current_time() - start_time;
     perfInfo->number_of_pre_htmlspecialchars++;
 
@@ -2714,14 +3161,16 @@ StrangerAutomaton* StrangerAutomaton::mysql_escape_string(const StrangerAutomato
 
     debug(stringbuilder() << id << " = mysql_escape_string(" << subjectAuto->ID << ");");
 
-	boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaMysqlEscapeString(subjectAuto->dfa, num_ascii_track, indices_main));
-    perfInfo->mysql_escape_string_total_time += perfInfo->current_time() - start_time;
-	perfInfo->number_of_mysql_escape_string++;
+    return memoize("mysql_escape_string", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaMysqlEscapeString(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
+        perfInfo->mysql_escape_string_total_time += perfInfo->current_time() - start_time;
+        perfInfo->number_of_mysql_escape_string++;
 
-	retMe->ID = id;
-	retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+    	retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::pre_mysql_escape_string(const StrangerAutomaton* subjectAuto, int id) {
@@ -2729,7 +3178,7 @@ StrangerAutomaton* StrangerAutomaton::pre_mysql_escape_string(const StrangerAuto
 	debug(stringbuilder() << id << " = pre_mysql_escape_string(" << subjectAuto->ID << ");");
 
 	boost::posix_time::ptime start_time = perfInfo->current_time();
-	StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreMysqlEscapeString(subjectAuto->dfa, num_ascii_track, indices_main));
+	StrangerAutomaton* retMe = new StrangerAutomaton(dfaPreMysqlEscapeString(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
     perfInfo->pre_mysql_escape_string_total_time += perfInfo->current_time() - start_time;
 	perfInfo->number_of_pre_mysql_escape_string++;
 
@@ -2840,103 +3289,119 @@ StrangerAutomaton* StrangerAutomaton::encodeURIComponent(const StrangerAutomaton
 {
     debug(stringbuilder() << id << " = encodeURIComponent(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaEncodeUriComponent(subjectAuto->dfa, num_ascii_track, indices_main));
+    return memoize("encodeURIComponent", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaEncodeUriComponent(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
 
-    retMe->ID = id;
-    retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+        retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::decodeURIComponent(const StrangerAutomaton* subjectAuto, int id)
 {
     debug(stringbuilder() << id << " = decodeURIComponent(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaDecodeUriComponent(subjectAuto->dfa, num_ascii_track, indices_main));
+    return memoize("decodeURIComponent", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaDecodeUriComponent(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
 
-    retMe->ID = id;
-    retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+        retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::encodeURI(const StrangerAutomaton* subjectAuto, int id)
 {
     debug(stringbuilder() << id << " = encodeURI(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaEncodeUri(subjectAuto->dfa, num_ascii_track, indices_main));
+    return memoize("encodeURI", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaEncodeUri(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
 
-    retMe->ID = id;
-    retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+        retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::decodeURI(const StrangerAutomaton* subjectAuto, int id)
 {
     debug(stringbuilder() << id << " = decodeURI(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaDecodeUri(subjectAuto->dfa, num_ascii_track, indices_main));
+    return memoize("decodeURI", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaDecodeUri(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
 
-    retMe->ID = id;
-    retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+        retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::escape(const StrangerAutomaton* subjectAuto, int id)
 {
     debug(stringbuilder() << id << " = escape(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaEscape(subjectAuto->dfa, num_ascii_track, indices_main));
+    return memoize("escape", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaEscape(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
 
-    retMe->ID = id;
-    retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+        retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::unescape(const StrangerAutomaton* subjectAuto, int id)
 {
     debug(stringbuilder() << id << " = unescape(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaUnescape(subjectAuto->dfa, num_ascii_track, indices_main));
+    return memoize("unescape", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaUnescape(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
 
-    retMe->ID = id;
-    retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+        retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::jsonStringify(const StrangerAutomaton* subjectAuto, int id)
 {
     debug(stringbuilder() << id << " = jsonStringify(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaJsonStringify(subjectAuto->dfa, num_ascii_track, indices_main));
+    return memoize("jsonStringify", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaJsonStringify(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
 
-    retMe->ID = id;
-    retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+        retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 StrangerAutomaton* StrangerAutomaton::jsonParse(const StrangerAutomaton* subjectAuto, int id)
 {
     debug(stringbuilder() << id << " = jsonParse(" << subjectAuto->ID << ");");
 
-    boost::posix_time::ptime start_time = perfInfo->current_time();
-    StrangerAutomaton* retMe = new StrangerAutomaton(dfaJsonParse(subjectAuto->dfa, num_ascii_track, indices_main));
+    return memoize("jsonParse", {subjectAuto}, id, [subjectAuto, id]() {
+        boost::posix_time::ptime start_time = perfInfo->current_time();
+        StrangerAutomaton* retMe = new StrangerAutomaton(dfaJsonParse(subjectAuto->minimalDfa(), num_ascii_track, indices_main));
 
-    retMe->ID = id;
-    retMe->debugAutomaton();
-    return retMe;
+        retMe->ID = id;
+        retMe->debugAutomaton();
+        return retMe;
+    });
 }
 
 void StrangerAutomaton::printAutomaton()
 {
 	std::cout.flush();
     debugToFile(stringbuilder() << "dfaPrintVerbose(M[" << this->autoTraceID << "]);");
-    dfaPrintVerbose(this->dfa);
+    dfaPrintVerbose(this->minimalDfa());
     debugToFile(stringbuilder() << "flush_output();");
     std::cout.flush();
 }
@@ -2945,7 +3410,7 @@ void StrangerAutomaton::printAutomatonVitals()
 {
 	std::cout.flush();
     debugToFile(stringbuilder() << "dfaPrintVitals(M[" << this->autoTraceID << "]);");
-    dfaPrintVitals(this->dfa);
+    dfaPrintVitals(this->minimalDfa());
     debugToFile(stringbuilder() << "flush_output();");
     std::cout.flush();
 }
@@ -2974,7 +3439,7 @@ void StrangerAutomaton::toDot() const
 	unsigned* indices_main_unsigned = getUnsignedIndices(num_ascii_track);
 	std::cout.flush();
     debugToFile(stringbuilder() << "dfaPrintGraphviz(M[" << this->autoTraceID << "], NUM_ASCII_TRACKS, indices_main);//dfaPrintGraphviz( this->ID)");
-    dfaPrintGraphviz(this->dfa, num_ascii_track, indices_main_unsigned);
+    dfaPrintGraphviz(this->minimalDfa(), num_ascii_track, indices_main_unsigned);
     delete[] indices_main_unsigned;
     debugToFile(stringbuilder() << "flush_output();");
     std::cout.flush();
@@ -2983,14 +3448,14 @@ void StrangerAutomaton::toDot() const
 void StrangerAutomaton::toDotFile(std::string file_name) const {
 	unsigned* indices_main_unsigned = getUnsignedIndices(num_ascii_track);
     debugToFile(stringbuilder() << "dfaPrintGraphvizFile(M[" << this->autoTraceID << "], NUM_ASCII_TRACKS, indices_main);//dfaPrintGraphviz( this->ID)");
-    dfaPrintGraphvizFile(this->dfa, file_name.c_str(), num_ascii_track, indices_main_unsigned);
+    dfaPrintGraphvizFile(this->minimalDfa(), file_name.c_str(), num_ascii_track, indices_main_unsigned);
     delete[] indices_main_unsigned;
 }
 
 void StrangerAutomaton::toDotBDDFile(std::string file_name) const {
 
     debugToFile(stringbuilder() << "dfaPrintBDD(M[" << this->autoTraceID << "], NUM_ASCII_TRACKS);");
-    dfaPrintBDD(this->dfa, file_name.c_str(), num_ascii_track);
+    dfaPrintBDD(this->minimalDfa(), file_name.c_str(), num_ascii_track);
 
 }
 
@@ -3007,9 +3472,9 @@ void StrangerAutomaton::toDotAscii(int printSink) const
     debugToFile(stringbuilder() << "dfaPrintGraphviz(M[" << this->autoTraceID << "], NUM_ASCII_TRACKS, indices_main);//dfaPrintGraphviz( this->ID)");
     //if the automaton is the empty language then we must enable printing the sink
     // if there is one state and it is a rejecting state
-    if (this->dfa->ns == 1 && this->dfa->f[0] == -1)
+    if (this->minimalDfa()->ns == 1 && this->minimalDfa()->f[0] == -1)
         printSink = 2;
-    dfaPrintGraphvizAsciiRange(this->dfa, num_ascii_track, indices_main, printSink);
+    dfaPrintGraphvizAsciiRange(this->minimalDfa(), num_ascii_track, indices_main, printSink);
     delete[] indices_main_unsigned;
     debugToFile(stringbuilder() << "flush_output();");
     std::cout.flush();
@@ -3021,9 +3486,9 @@ void StrangerAutomaton::toDotFileAscii(std::string file_name, int printSink) con
     //if the automaton is the empty language then we must enable printing the sink
     // if there is one state and it is a rejecting state
     if (this->dfa) {
-        if (this->dfa->ns == 1 && this->dfa->f[0] == -1)
+        if (this->minimalDfa()->ns == 1 && this->minimalDfa()->f[0] == -1)
             printSink = 2;
-        dfaPrintGraphvizAsciiRangeFile(this->dfa, file_name.c_str(), num_ascii_track, indices_main, printSink);
+        dfaPrintGraphvizAsciiRangeFile(this->minimalDfa(), file_name.c_str(), num_ascii_track, indices_main, printSink);
     } else {
         std::cout << "StrangerAutomaton::toDotFileAscii: this->dfa is null" << std::endl;
     }
@@ -3033,7 +3498,7 @@ void StrangerAutomaton::toDotFileAscii(std::string file_name, int printSink) con
 void StrangerAutomaton::exportToFile(const std::string& file_name) const
 {
     if (this->dfa) {
-        dfaExportBddTable(this->dfa, file_name.c_str(), num_ascii_track);
+        dfaExportBddTable(this->minimalDfa(), file_name.c_str(), num_ascii_track);
     }
 }
 
@@ -3042,6 +3507,23 @@ StrangerAutomaton* StrangerAutomaton::importFromFile(const std::string& file_nam
     return new StrangerAutomaton(dfaImportBddTable(file_name.c_str(), num_ascii_track));
 }
 
+bool StrangerAutomaton::exportToBinaryFile(const std::string& file_name) const
+{
+    if (this->dfa == NULL) {
+        return false;
+    }
+    return dfaExportBinary(this->minimalDfa(), file_name.c_str(), num_ascii_track) != 0;
+}
+
+StrangerAutomaton* StrangerAutomaton::importFromBinaryFile(const std::string& file_name)
+{
+    DFA* dfa = dfaImportBinary(file_name.c_str(), num_ascii_track);
+    if (dfa == NULL) {
+        return nullptr;
+    }
+    return new StrangerAutomaton(dfa);
+}
+
 int StrangerAutomaton::debugLevel = 0;
 
 void StrangerAutomaton::debug(std::string s)
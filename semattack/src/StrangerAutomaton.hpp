@@ -26,6 +26,7 @@
 #ifndef STRANGERAUTOMATON_HPP_
 #define STRANGERAUTOMATON_HPP_
 
+#include "DFAInterner.hpp"
 #include "PerfInfo.hpp"
 #include "StringBuilder.hpp"
 #include "RegExp.hpp"
@@ -34,6 +35,10 @@
 #include "stranger/stranger.h"
 #undef export
 
+#include <bitset>
+#include <functional>
+#include <initializer_list>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -45,11 +50,22 @@ public:
     StrangerAutomaton(const StrangerAutomaton* other);
     StrangerAutomaton(DFA* dfa);
     virtual ~StrangerAutomaton();
+    // Shares the DFA, the clone must only be used by the same analysis task
     StrangerAutomaton* clone(int id) const;
     StrangerAutomaton* clone() const;
+    // Has a DFA of its own, so it can be handed to another thread
+    StrangerAutomaton* copy(int id) const;
+    // Moves the DFA to the run wide store if interning is switched on, or
+    // stops sharing a constant of this thread. The automaton can be handed to
+    // another thread then.
+    void handOff() const;
     int getID() const;
     void setID(int id);
     DFA* getDfa();
+    // Results of intersect and union_ are only minimized once they have more
+    // than maxStates states, other results when they are used. 0 minimizes
+    // every result right away.
+    static void setLazyMinimization(int maxStates);
     static StrangerAutomaton* makeBottom(int id);
     static StrangerAutomaton* makeBottom();
     static StrangerAutomaton* makeTop(int id);
@@ -104,6 +120,10 @@ public:
     StrangerAutomaton* coarseWiden(const StrangerAutomaton* auto_) const;
     StrangerAutomaton* concatenate(const StrangerAutomaton* auto_, int id) const;
     StrangerAutomaton* concatenate(const StrangerAutomaton* auto_) const;
+    // Union and concatenation of all automata, in order, with a single
+    // construction instead of one per pair
+    static StrangerAutomaton* unionAll(const std::vector<const StrangerAutomaton*>& autos, int id);
+    static StrangerAutomaton* concatAll(const std::vector<const StrangerAutomaton*>& autos, int id);
     StrangerAutomaton* leftPreConcat(const StrangerAutomaton* rightSiblingAuto, int id) const;
     StrangerAutomaton* leftPreConcat(const StrangerAutomaton* rightSiblingAuto) const;
     StrangerAutomaton* leftPreConcatConst(std::string rightSiblingString, int id) const;
@@ -155,8 +175,16 @@ public:
     bool equals(const StrangerAutomaton* other) const;
     bool checkEmptiness() const;
     bool isEmpty() const;
+    // Hash of the language, equal for automata with the same minimal DFA
+    std::size_t fingerprint() const;
+    // True if both have the same minimal DFA, up to the numbering of states
+    bool isIsomorphicTo(const StrangerAutomaton* other) const;
     bool isNull() const;
     bool checkEmptyString() const;
+    // returns one bit per string, set if the string is in L(this auto)
+    std::vector<bool> acceptsBatch(const std::vector<std::string>& strings) const;
+    // returns the set of bytes appearing in at least one string of L(this auto)
+    std::bitset<256> getReachableAlphabet() const;
     bool isSingleton() const;    
     std::string getStr() const;
     bool isBottom() const;
@@ -258,6 +286,10 @@ public:
     void toDotBDDFile(std::string file_name) const;
     void exportToFile(const std::string& file_name) const;
     static StrangerAutomaton* importFromFile(const std::string& file_name);
+    // Compact binary format, returns false if the file could not be written
+    bool exportToBinaryFile(const std::string& file_name) const;
+    // Returns nullptr if the file is missing or not a valid binary automaton
+    static StrangerAutomaton* importFromBinaryFile(const std::string& file_name);
     static void openCtraceFile(std::string name);
     static void appendCtraceFile(std::string name);
     static void closeCtraceFile();
@@ -268,14 +300,14 @@ public:
     static unsigned *getUnsignedIndices(int length);
     int get_num_of_states() const {
         if (!this->isNull()) {
-            return this->dfa->ns;
+            return this->structureDfa()->ns;
         } else {
             return -1;
         }
     }
 
     unsigned get_num_of_bdd_nodes() const{
-        return bdd_size(this->dfa->bddm);
+        return bdd_size(this->minimalDfa()->bddm);
     }
 
     static PerfInfo* perfInfo;
@@ -327,8 +359,11 @@ public:
     StrangerAutomaton* preRestrict(const StrangerAutomaton* otherAuto){
         return this->preRestrict(otherAuto, traceID);
     };
-    DFA* dfa;
+    // Replaced by a copy when a DFA of the run wide store is read
+    mutable DFA* dfa;
 private:
+    // Owns dfa, shared between clones
+    mutable std::shared_ptr<DFA> dfaHandle;
 
     int ID;
     int autoTraceID;
@@ -342,10 +377,29 @@ private:
     static int tempTraceID;
     static int baseTempTraceID;
     static int debugLevel;
-    static bool coarseWidening;
     static char slash;
 	StrangerAutomaton();
 	void init();
+    void setDfa(DFA* dfa);
+    // Shares a DFA the calling thread keeps for the whole run
+    static StrangerAutomaton* makeConstant(const std::shared_ptr<DFA>& dfa);
+    void intern() const;
+    static StrangerAutomaton* makeLazyResult(DFA* dfa, bool minimized);
+    // The DFA to be used by intersect and union_, copies a DFA of the run
+    // wide store first
+    DFA* ownDfa() const;
+    // The DFA to be used by all other operations, minimizes a lazy result in
+    // place first
+    DFA* minimalDfa() const;
+    // The DFA to read the structure of only, a DFA of the run wide store is
+    // not copied. Unlike MONA operations this does not write into the DFA,
+    // so other threads may do the same at the same time.
+    const DFA* structureDfa() const;
+    static int lazyMinimizationStates;
+    // Returns the remembered result of a function model applied to inputs,
+    // on a miss calls compute and remembers its result
+    static StrangerAutomaton* memoize(const std::string& op, std::initializer_list<const StrangerAutomaton*> inputs,
+                                      int id, const std::function<StrangerAutomaton*()>& compute);
     static bool& initialized();
     static void resetTraceID();
     static std::string escapeSpecialChars(std::string s);
@@ -0,0 +1,147 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * SubtreeImageCache.cpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+#include "SubtreeImageCache.hpp"
+#include "PerfInfo.hpp"
+
+#include <iterator>
+
+void SubtreeImageCache::setCapacity(std::size_t capacity)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_capacity = capacity;
+  while (m_entries.size() > m_capacity) {
+    erase(std::prev(m_entries.end()));
+  }
+}
+
+void SubtreeImageCache::erase(EntryIter entry)
+{
+  // The entry is freed once no lookup uses it any more
+  m_index.erase((*entry)->key);
+  m_entries.erase(entry);
+}
+
+SubtreeImageCache::EntryPtr SubtreeImageCache::find(std::size_t key, std::size_t hash)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto iter = m_index.find(key);
+  if (iter == m_index.end() || (*iter->second)->hash != hash) {
+    return EntryPtr();
+  }
+  m_entries.splice(m_entries.begin(), m_entries, iter->second);
+  return *iter->second;
+}
+
+bool SubtreeImageCache::sameInputs(const Entry& entry, const std::vector<const StrangerAutomaton*>& inputs)
+{
+  if (entry.inputs.size() != inputs.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < inputs.size(); i++) {
+    if (!entry.inputs[i] || inputs[i] == NULL) {
+      if (entry.inputs[i] || inputs[i] != NULL) {
+        return false;
+      }
+    } else if (!entry.inputs[i]->isIsomorphicTo(inputs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+SubtreeImageCache::InputPtr SubtreeImageCache::findInput(const StrangerAutomaton* input, std::size_t fingerprint)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_inputs_mutex);
+    auto range = m_inputs.equal_range(fingerprint);
+    for (auto iter = range.first; iter != range.second; ) {
+      InputPtr kept = iter->second.lock();
+      if (!kept) {
+        iter = m_inputs.erase(iter);
+      } else if (kept->isIsomorphicTo(input)) {
+        return kept;
+      } else {
+        ++iter;
+      }
+    }
+  }
+  // input belongs to the caller, so it is copied outside the lock
+  InputPtr copy(input->copy(input->getID()));
+  std::lock_guard<std::mutex> lock(m_inputs_mutex);
+  m_inputs.insert(std::make_pair(fingerprint, std::weak_ptr<const StrangerAutomaton>(copy)));
+  return copy;
+}
+
+StrangerAutomaton* SubtreeImageCache::lookup(std::size_t key, std::size_t hash,
+                                             const std::vector<const StrangerAutomaton*>& inputs)
+{
+  PerfInfo& perfInfo = PerfInfo::getInstance();
+  perfInfo.num_of_subtree_lookups++;
+  EntryPtr entry = find(key, hash);
+  if (!entry || !sameInputs(*entry, inputs)) {
+    return NULL;
+  }
+  perfInfo.num_of_subtree_hits++;
+  std::lock_guard<std::mutex> lock(entry->mutex);
+  return entry->image->copy(entry->image->getID());
+}
+
+void SubtreeImageCache::insert(std::size_t key, std::size_t hash,
+                               const std::vector<const StrangerAutomaton*>& inputs,
+                               const StrangerAutomaton* image)
+{
+  if (!isEnabled()) {
+    return;
+  }
+  EntryPtr existing = find(key, hash);
+  if (existing && sameInputs(*existing, inputs)) {
+    // Another graph stored the same sub-DAG in the meantime
+    return;
+  }
+  // The new entry is built on the calling thread, outside the lock
+  EntryPtr entry = std::make_shared<Entry>();
+  entry->key = key;
+  entry->hash = hash;
+  for (auto input : inputs) {
+    entry->inputs.push_back(input != NULL ? findInput(input, input->fingerprint()) : InputPtr());
+  }
+  entry->image = image->copy(image->getID());
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto iter = m_index.find(key);
+  if (iter != m_index.end()) {
+    erase(iter->second);
+  }
+  m_entries.push_front(entry);
+  m_index[key] = m_entries.begin();
+  while (m_entries.size() > m_capacity) {
+    erase(std::prev(m_entries.end()));
+  }
+}
+
+std::size_t SubtreeImageCache::size()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
@@ -0,0 +1,110 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * SubtreeImageCache.hpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+#ifndef SUBTREE_IMAGE_CACHE_HPP_
+#define SUBTREE_IMAGE_CACHE_HPP_
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "StrangerAutomaton.hpp"
+
+// Process wide, bounded cache of the forward images of DepGraph sub-DAGs, so
+// a sanitizer shared by several graphs is only analysed once. An entry holds
+// the image of the top node of a sub-DAG, the images of the nodes below it
+// have entries of their own. Besides the subtree hash to check the structure
+// on a hit, an entry keeps the automata the image was computed from, which
+// have to be isomorphic to the ones of the lookup.
+class SubtreeImageCache {
+public:
+
+    static SubtreeImageCache& getInstance() {
+        static SubtreeImageCache instance;
+        return instance;
+    }
+
+    // Maximum number of cached images, 0 switches the cache off
+    void setCapacity(std::size_t capacity);
+    bool isEnabled() const { return m_capacity > 0; }
+
+    // Returns a copy of the cached image, NULL on a miss. The cache never
+    // shares a DFA with an automaton outside of it. Inputs may contain NULL
+    // for automata the image does not depend on.
+    StrangerAutomaton* lookup(std::size_t key, std::size_t hash,
+                              const std::vector<const StrangerAutomaton*>& inputs);
+
+    // Stores copies of image and inputs
+    void insert(std::size_t key, std::size_t hash,
+                const std::vector<const StrangerAutomaton*>& inputs,
+                const StrangerAutomaton* image);
+
+    std::size_t size();
+
+private:
+    SubtreeImageCache() : m_capacity(0) {}
+    SubtreeImageCache(const SubtreeImageCache&) = delete;
+    SubtreeImageCache& operator=(const SubtreeImageCache&) = delete;
+
+    typedef std::shared_ptr<const StrangerAutomaton> InputPtr;
+
+    // Entries are only changed before they are added. A lookup takes a
+    // reference under m_mutex and compares the inputs outside of it, which
+    // only reads their structure. Copying the image writes into its DFA, so
+    // it is done under the lock of the entry.
+    struct Entry {
+        Entry() : image(NULL) {}
+        ~Entry() { delete image; }
+        std::size_t key;
+        std::size_t hash;
+        std::vector<InputPtr> inputs;
+        StrangerAutomaton* image;
+        std::mutex mutex;
+    };
+    typedef std::shared_ptr<Entry> EntryPtr;
+    typedef std::list<EntryPtr>::iterator EntryIter;
+
+    // Must be called with m_mutex held
+    void erase(EntryIter entry);
+    // Returns the entry of key if it has the given hash, takes m_mutex
+    EntryPtr find(std::size_t key, std::size_t hash);
+    static bool sameInputs(const Entry& entry, const std::vector<const StrangerAutomaton*>& inputs);
+    // Returns the copy of input kept for other entries, or makes one
+    InputPtr findInput(const StrangerAutomaton* input, std::size_t fingerprint);
+
+    std::mutex m_mutex;
+    std::size_t m_capacity;
+    // Most recently used entry first
+    std::list<EntryPtr> m_entries;
+    std::unordered_map<std::size_t, EntryIter> m_index;
+    // Inputs of the entries by fingerprint, an image mostly shares them with
+    // the images of the nodes below it
+    std::mutex m_inputs_mutex;
+    std::unordered_multimap<std::size_t, std::weak_ptr<const StrangerAutomaton> > m_inputs;
+};
+
+#endif /* SUBTREE_IMAGE_CACHE_HPP_ */
@@ -0,0 +1,178 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * TarReader.cpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+#include "TarReader.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+  const std::size_t BLOCK = 512;
+
+  // Numeric fields are octal, or big endian base-256 if the top bit is set
+  std::size_t parseNumber(const char* field, std::size_t length) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(field);
+    std::size_t value = 0;
+    if (bytes[0] & 0x80) {
+      for (std::size_t i = 1; i < length; i++) {
+        value = (value << 8) | bytes[i];
+      }
+      return value;
+    }
+    for (std::size_t i = 0; i < length && field[i] != '\0' && field[i] != ' '; i++) {
+      if (field[i] < '0' || field[i] > '7') {
+        throw std::runtime_error("error reading tar archive: invalid number in header");
+      }
+      value = value * 8 + (field[i] - '0');
+    }
+    return value;
+  }
+
+  std::string parseString(const char* field, std::size_t length) {
+    return std::string(field, strnlen(field, length));
+  }
+
+  // The value of the path record of a pax header, empty if there is none
+  std::string parsePaxPath(const std::string& records) {
+    std::size_t pos = 0;
+    while (pos < records.size()) {
+      std::size_t space = records.find(' ', pos);
+      if (space == std::string::npos) {
+        break;
+      }
+      std::size_t length = std::stoul(records.substr(pos, space - pos));
+      if (length == 0 || pos + length > records.size()) {
+        break;
+      }
+      // "<length> <key>=<value>\n"
+      std::string record = records.substr(space + 1, pos + length - space - 2);
+      if (record.compare(0, 5, "path=") == 0) {
+        return record.substr(5);
+      }
+      pos += length;
+    }
+    return std::string();
+  }
+
+}
+
+TarReader::TarReader(std::istream& in)
+  : m_in(in)
+  , m_size(0)
+  , m_has_data(false)
+{
+}
+
+bool TarReader::next(std::string& name)
+{
+  if (m_has_data) {
+    skipData();
+  }
+  std::string long_name;
+  char header[BLOCK];
+  while (readHeader(header)) {
+    m_size = parseNumber(header + 124, 12);
+    m_has_data = true;
+    char type = header[156];
+    if (type == 'L') {
+      // GNU long name of the next file
+      readData(long_name);
+      long_name = parseString(long_name.data(), long_name.size());
+    } else if (type == 'x') {
+      std::string records;
+      readData(records);
+      long_name = parsePaxPath(records);
+    } else if (type == '0' || type == '\0' || type == '7') {
+      if (!long_name.empty()) {
+        name = long_name;
+      } else if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0') {
+        name = parseString(header + 345, 155) + "/" + parseString(header, 100);
+      } else {
+        name = parseString(header, 100);
+      }
+      return true;
+    } else {
+      // Directories, links and global pax headers
+      skipData();
+      long_name.clear();
+    }
+  }
+  return false;
+}
+
+void TarReader::read(std::string& contents)
+{
+  if (!m_has_data) {
+    throw std::logic_error("tar archive entry read twice");
+  }
+  readData(contents);
+}
+
+bool TarReader::readHeader(char* header)
+{
+  if (!m_in.read(header, BLOCK)) {
+    // Some writers leave out the end of archive blocks
+    if (m_in.gcount() == 0 && m_in.eof() && !m_in.bad()) {
+      return false;
+    }
+    throw std::runtime_error("error reading tar archive: truncated header");
+  }
+  bool zero = true;
+  unsigned checksum = 0;
+  for (std::size_t i = 0; i < BLOCK; i++) {
+    unsigned char c = static_cast<unsigned char>(header[i]);
+    zero &= c == 0;
+    // The checksum field counts as spaces
+    checksum += (i >= 148 && i < 156) ? ' ' : c;
+  }
+  if (zero) {
+    return false;
+  }
+  if (checksum != parseNumber(header + 148, 8)) {
+    throw std::runtime_error("error reading tar archive: header checksum mismatch");
+  }
+  return true;
+}
+
+void TarReader::readData(std::string& data)
+{
+  data.resize(m_size);
+  if (m_size > 0 && !m_in.read(&data[0], m_size)) {
+    throw std::runtime_error("error reading tar archive: truncated file");
+  }
+  std::size_t padding = (BLOCK - m_size % BLOCK) % BLOCK;
+  m_in.ignore(padding);
+  m_has_data = false;
+}
+
+void TarReader::skipData()
+{
+  std::size_t length = m_size + (BLOCK - m_size % BLOCK) % BLOCK;
+  if (length > 0 && (!m_in.ignore(length) || static_cast<std::size_t>(m_in.gcount()) != length)) {
+    throw std::runtime_error("error reading tar archive: truncated file");
+  }
+  m_has_data = false;
+}
@@ -0,0 +1,56 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * TarReader.hpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+#ifndef TAR_READER_HPP_
+#define TAR_READER_HPP_
+
+#include <cstddef>
+#include <istream>
+#include <string>
+
+// Reads the files of a tar archive one after the other, without seeking, so
+// the stream can be a decompressing one. Understands ustar archives with GNU
+// long names and pax path records. Throws std::runtime_error if the archive
+// is damaged.
+class TarReader {
+public:
+  explicit TarReader(std::istream& in);
+
+  // Moves to the next regular file, returns false at the end of the archive
+  bool next(std::string& name);
+  // Reads the contents of the current file, otherwise next skips them
+  void read(std::string& contents);
+
+private:
+  bool readHeader(char* header);
+  void readData(std::string& data);
+  void skipData();
+
+  std::istream& m_in;
+  std::size_t m_size;
+  bool m_has_data;
+};
+
+#endif /* TAR_READER_HPP_ */
@@ -20,7 +20,7 @@ ValidationImageComputer::ValidationImageComputer() : ImageComputer() {
 AnalysisResult ValidationImageComputer::doBackwardAnalysis_ValidationCase(DepGraph& origDepGraph, DepGraph& depGraph, StrangerAutomaton* initialAuto) {
 
     queue<DepGraphNode*> process_queue;
-    set<DepGraphNode*> visited;
+    NodeSet visited(depGraph);
     set<int> processed_SCCs;
 
     bool has_validation = false;
@@ -38,9 +38,10 @@ AnalysisResult ValidationImageComputer::doBackwardAnalysis_ValidationCase(DepGra
         DepGraphNode *curr = process_queue.front();
 
         if (!has_validation) {
-            if (dynamic_cast< DepGraphNormalNode*>(curr) || dynamic_cast< DepGraphUninitNode*>(curr) || dynamic_cast< DepGraphOpNode*>(curr)) {
-                if (dynamic_cast< DepGraphOpNode*>(curr) ) {
-                    DepGraphOpNode* op = dynamic_cast< DepGraphOpNode*>(curr);
+            DepGraphNode::Kind kind = curr->getKind();
+            if (kind == DepGraphNode::Normal || kind == DepGraphNode::Uninit || kind == DepGraphNode::Op) {
+                if (kind == DepGraphNode::Op) {
+                    DepGraphOpNode* op = static_cast< DepGraphOpNode*>(curr);
                     if (op->getName().find("__vlab_restrict") != string::npos) {
                         has_validation = true;
                         message = "validation function found!!!";
@@ -64,11 +65,10 @@ AnalysisResult ValidationImageComputer::doBackwardAnalysis_ValidationCase(DepGra
 
         process_queue.pop();
 
-        NodesList successors = depGraph.getSuccessors(curr);
+        NodeSpan successors = depGraph.getSuccessors(curr);
         if (!successors.empty()) {
             for (auto succ_node : successors) {
-                auto isNotVisited = visited.insert(succ_node);
-                if (isNotVisited.second) {
+                if (visited.insert(succ_node)) {
                     bwValidationPatchResult.set(succ_node->getID(), initialAuto);
                     process_queue.push(succ_node);
                 }
@@ -87,17 +87,17 @@ AnalysisResult ValidationImageComputer::doBackwardAnalysis_ValidationCase(DepGra
  */
 void ValidationImageComputer::doPreImageComputation_ValidationCase(DepGraph& origDepGraph, DepGraphNode* node, AnalysisResult& bwAnalysisResult) {
 
-    NodesList predecessors = origDepGraph.getPredecessors(node);
-    NodesList successors = origDepGraph.getSuccessors(node);
-    DepGraphNormalNode* normalNode = nullptr;
+    NodeSpan predecessors = origDepGraph.getPredecessors(node);
+    NodeSpan successors = origDepGraph.getSuccessors(node);
     StrangerAutomaton *newAuto = nullptr, *tempAuto = nullptr;
 
-    if (dynamic_cast< DepGraphNormalNode*>(node) || dynamic_cast< DepGraphUninitNode*>(node) || dynamic_cast< DepGraphOpNode*>(node)) {
+    DepGraphNode::Kind kind = node->getKind();
+    if (kind == DepGraphNode::Normal || kind == DepGraphNode::Uninit || kind == DepGraphNode::Op) {
         if (predecessors.empty()) {
             // root is already initialized
             newAuto = bwAnalysisResult.get(node->getID())->clone();
-        } else if (successors.empty() && (normalNode = dynamic_cast< DepGraphNormalNode*>(node))) {
-            newAuto = ImageComputer::getLiteralorConstantNodeAuto(normalNode, false);
+        } else if (successors.empty() && kind == DepGraphNode::Normal) {
+            newAuto = ImageComputer::getLiteralorConstantNodeAuto(node, false);
         } else {
 
             for (auto pred_node : predecessors) {
@@ -105,10 +105,10 @@ void ValidationImageComputer::doPreImageComputation_ValidationCase(DepGraph& ori
                 if (pred_node == node) {
                     // ignore simple self loop (check correctness)
                     continue;
-                } else if (dynamic_cast< DepGraphNormalNode*>(pred_node)) {
+                } else if (pred_node->getKind() == DepGraphNode::Normal) {
                     predAuto = bwAnalysisResult.get(pred_node->getID())->clone();
-                } else if (dynamic_cast< DepGraphOpNode*>(pred_node)) {
-                    predAuto = makePreImageForOpChild_ValidationCase(origDepGraph, dynamic_cast< DepGraphOpNode*>(pred_node), node, bwAnalysisResult);
+                } else if (pred_node->getKind() == DepGraphNode::Op) {
+                    predAuto = makePreImageForOpChild_ValidationCase(origDepGraph, static_cast< DepGraphOpNode*>(pred_node), node, bwAnalysisResult);
                 }
 
                 if (predAuto == nullptr) {
@@ -148,16 +148,16 @@ void ValidationImageComputer::doPreImageComputationForSCC_ValidationCase(DepGrap
 
     int scc_id = origDepGraph.getSCCID(node);
 
-    map<int, int> visit_count;
+    std::vector<int> visit_count(origDepGraph.getNodeTableSize(), 0);
     NodesList current_scc_nodes = origDepGraph.getSCCNodes(scc_id);
 
     queue<DepGraphNode*> worklist;
-    set<DepGraphNode*> visited;
+    NodeSet visited(origDepGraph);
 
     // initialize all scc_nodes to phi
     for (auto& scc_node : current_scc_nodes) {
         bwAnalysisResult.set(scc_node->getID(), StrangerAutomaton::makePhi(scc_node->getID()));
-        visit_count[scc_node->getID()] = 0;
+        visit_count[DepGraph::nodeIndex(scc_node->getID())] = 0;
     }
 
     // add the predecessors to the worklist
@@ -181,10 +181,10 @@ void ValidationImageComputer::doPreImageComputationForSCC_ValidationCase(DepGrap
             const StrangerAutomaton* tmp_auto = nullptr;
             StrangerAutomaton* new_auto = nullptr;
 
-            if (dynamic_cast<DepGraphNormalNode*>(curr_node) != nullptr) {
+            if (curr_node->getKind() == DepGraphNode::Normal) {
                 tmp_auto = bwAnalysisResult.get(curr_node->getID()); // may need clone
-            } else if (dynamic_cast<DepGraphOpNode*>(curr_node) != nullptr) {
-                tmp_auto = makePreImageForOpChild_ValidationCase(origDepGraph, dynamic_cast< DepGraphOpNode*>(curr_node), succ_node, bwAnalysisResult);
+            } else if (curr_node->getKind() == DepGraphNode::Op) {
+                tmp_auto = makePreImageForOpChild_ValidationCase(origDepGraph, static_cast< DepGraphOpNode*>(curr_node), succ_node, bwAnalysisResult);
             } else {
                 throw StrangerException(stringbuilder() << "Node cannot be an element of SCC component!, node id: " << node->getID());
             }
@@ -195,7 +195,7 @@ void ValidationImageComputer::doPreImageComputationForSCC_ValidationCase(DepGrap
 
             new_auto = tmp_auto->union_(prev_auto, succ_node->getID());
 
-            int new_visit_count = visit_count[succ_node->getID()] + 1;
+            int new_visit_count = visit_count[DepGraph::nodeIndex(succ_node->getID())] + 1;
             if (new_visit_count > iteration)
                 iteration = new_visit_count;
 
@@ -207,13 +207,12 @@ void ValidationImageComputer::doPreImageComputationForSCC_ValidationCase(DepGrap
             }
 
             if (!new_auto->checkInclusion(prev_auto, new_auto->getID(), prev_auto->getID())) {
-                auto isVisited = visited.insert(succ_node);
-                if (isVisited.second) {
+                if (visited.insert(succ_node)) {
                     worklist.push(succ_node);
                 }
 
                 bwAnalysisResult.set(succ_node->getID(), new_auto);
-                visit_count[succ_node->getID()] = new_visit_count;
+                visit_count[DepGraph::nodeIndex(succ_node->getID())] = new_visit_count;
             }
         }
 
@@ -228,7 +227,7 @@ StrangerAutomaton* ValidationImageComputer::makePreImageForOpChild_ValidationCas
                                                                         DepGraphNode* childNode, AnalysisResult& bwAnalysisResult) {
 
     StrangerAutomaton* retMe = nullptr;
-    NodesList successors = depGraph.getSuccessors(opNode);
+    NodeSpan successors = depGraph.getSuccessors(opNode);
     const StrangerAutomaton* opAuto = bwAnalysisResult.get(opNode->getID());
     string opName = opNode->getName();
 
@@ -0,0 +1,78 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * CompressedFile.cpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+#include "CompressedFile.hpp"
+
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#ifdef HAVE_BOOST_IOSTREAMS_FILTER_ZSTD_HPP
+#include <boost/iostreams/filter/zstd.hpp>
+#endif
+
+#include <stdexcept>
+
+namespace {
+
+    bool endsWith(const std::string& s, const std::string& suffix) {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+}
+
+bool isCompressedFile(const std::string& fname)
+{
+    return uncompressedName(fname) != fname;
+}
+
+std::string uncompressedName(const std::string& fname)
+{
+    if (endsWith(fname, ".gz") || endsWith(fname, ".tgz")) {
+        return endsWith(fname, ".gz") ? fname.substr(0, fname.size() - 3) : fname.substr(0, fname.size() - 4) + ".tar";
+    }
+    if (endsWith(fname, ".zst") || endsWith(fname, ".tzst")) {
+        return endsWith(fname, ".zst") ? fname.substr(0, fname.size() - 4) : fname.substr(0, fname.size() - 5) + ".tar";
+    }
+    return fname;
+}
+
+bool openCompressedFile(const std::string& fname, boost::iostreams::filtering_istream& in)
+{
+    boost::iostreams::file_source source(fname, std::ios::in | std::ios::binary);
+    if (!source.is_open()) {
+        return false;
+    }
+    if (endsWith(fname, ".gz") || endsWith(fname, ".tgz")) {
+        in.push(boost::iostreams::gzip_decompressor());
+    } else if (endsWith(fname, ".zst") || endsWith(fname, ".tzst")) {
+#ifdef HAVE_BOOST_IOSTREAMS_FILTER_ZSTD_HPP
+        in.push(boost::iostreams::zstd_decompressor());
+#else
+        // Boost.Iostreams has zstd since 1.70
+        throw std::runtime_error("Can not read " + fname + ", built without zstd support");
+#endif
+    }
+    in.push(source);
+    return true;
+}
@@ -0,0 +1,45 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * CompressedFile.hpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+#ifndef SEMREP_COMPRESSEDFILE_HPP
+#define SEMREP_COMPRESSEDFILE_HPP
+
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <string>
+
+// Dot files and corpus archives may be compressed with gzip (.gz, .tgz) or
+// zstd (.zst, .tzst), they are decompressed while they are read. zstd needs
+// Boost.Iostreams 1.70, configure leaves it out for older versions.
+
+bool isCompressedFile(const std::string& fname);
+
+// The name without the compression extension, .tgz and .tzst become .tar
+std::string uncompressedName(const std::string& fname);
+
+// Sets up the stream to read the file, returns false if it can not be opened
+bool openCompressedFile(const std::string& fname, boost::iostreams::filtering_istream& in);
+
+#endif //SEMREP_COMPRESSEDFILE_HPP
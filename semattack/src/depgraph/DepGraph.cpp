@@ -25,9 +25,12 @@
 
 #include "DepGraph.hpp"
 #include "RegExpNode.hpp"
+#include "CompressedFile.hpp"
+
+#include <boost/functional/hash.hpp>
 using namespace std;
 
-DepGraph::DepGraph() : metadata() {
+DepGraph::DepGraph() : frozen(false), metadata() {
     root = nullptr;
     topLeaf = nullptr;
     label = "";
@@ -40,9 +43,13 @@ DepGraph::DepGraph(const DepGraph& other)  : metadata(other.metadata) {
     this->nodes = other.nodes;
     this->topLeaf = other.topLeaf;
     this->edges = other.edges;
-    this->currentID = other.currentID;
-    this->currentSccID = other.currentSccID;
-    this->currentOrder = other.currentOrder;
+    this->reverse_edges = other.reverse_edges;
+    this->frozen = other.frozen;
+    this->node_table = other.node_table;
+    this->succ_offsets = other.succ_offsets;
+    this->succ_list = other.succ_list;
+    this->pred_offsets = other.pred_offsets;
+    this->pred_list = other.pred_list;
     this->label = other.label;
     this->labelloc = other.labelloc;
     this->scc_components = other.scc_components;
@@ -54,9 +61,13 @@ DepGraph& DepGraph::operator=(const DepGraph &other) {
     this->nodes = other.nodes;
     this->topLeaf = other.topLeaf;
     this->edges = other.edges;
-    this->currentID = other.currentID;
-    this->currentSccID = other.currentSccID;
-    this->currentOrder = other.currentOrder;
+    this->reverse_edges = other.reverse_edges;
+    this->frozen = other.frozen;
+    this->node_table = other.node_table;
+    this->succ_offsets = other.succ_offsets;
+    this->succ_list = other.succ_list;
+    this->pred_offsets = other.pred_offsets;
+    this->pred_list = other.pred_list;
     this->label = other.label;
     this->labelloc = other.labelloc;
     this->scc_components = other.scc_components;
@@ -69,36 +80,82 @@ bool DepGraph::operator<(const DepGraph &other) {
     return this->getNumOfNodes() < other.getNumOfNodes();
 }
 
-int DepGraph::currentID = 0;
-int DepGraph::currentSccID = 0;
-int DepGraph::currentOrder = 0;
+NodeSpan DepGraph::getPredecessors(const DepGraphNode* node) const {
+    if (frozen) {
+        if (!isFrozenNode(node)) {
+            return NodeSpan();
+        }
+        std::size_t index = nodeIndex(node->getID());
+        return NodeSpan(pred_list.data() + pred_offsets[index], pred_list.data() + pred_offsets[index + 1]);
+    }
+    EdgesMapConstIterator it = reverse_edges.find(node);
+    if (it == reverse_edges.end()) {
+        return NodeSpan();
+    }
+    return NodeSpan(it->second.data(), it->second.data() + it->second.size());
+}
 
-NodesList DepGraph::getPredecessors(const DepGraphNode* node) const {
-    NodesList retMe;
-	for (EdgesMapConstIterator it = edges.begin(); it != edges.end(); ++it) {
-		const DepGraphNode* from = it->first;
-		NodesList toList = it->second;
-		NodesListIterator it2 = std::find_if(toList.begin(), toList.end(), std::bind2nd(NodeEqual(), node));
-		if (it2 != toList.end()) {
-			retMe.push_back(const_cast<DepGraphNode*>(from));
-		}
-	}
-	return retMe;
+NodeSpan DepGraph::getSuccessors(const DepGraphNode* node) const {
+    if (frozen) {
+        if (!isFrozenNode(node)) {
+            return NodeSpan();
+        }
+        std::size_t index = nodeIndex(node->getID());
+        return NodeSpan(succ_list.data() + succ_offsets[index], succ_list.data() + succ_offsets[index + 1]);
+    }
+    EdgesMapConstIterator it = edges.find(node);
+    if (it == edges.end()) {
+        return NodeSpan();
+    }
+    return NodeSpan(it->second.data(), it->second.data() + it->second.size());
 }
 
-NodesList DepGraph::getSuccessors(const DepGraphNode* node) const {
-    NodesList retMe;
-	EdgesMapConstIterator it = edges.find(node);
-	if (it != edges.end()) {
-		NodesList toList = it->second;
-        retMe = NodesList(toList.size());
-        copy(toList.begin(), toList.end(), retMe.begin());
-//		for (NodesListConstIterator it2 = toList.begin(); it2 != toList.end(); ++it2){
-//			const DepGraphNode* pNode = *it2;
-//			retMe.push_back(pNode);
-//		}
-	}
-	return retMe;
+bool DepGraph::isFrozenNode(const DepGraphNode* node) const {
+    int id = node->getID();
+    return id >= FirstNodeId && nodeIndex(id) < node_table.size() && node_table[nodeIndex(id)] != nullptr;
+}
+
+std::size_t DepGraph::getNodeTableSize() const {
+    if (frozen) {
+        return node_table.size();
+    }
+    return nodes.empty() ? 0 : nodeIndex(nodes.rbegin()->first) + 1;
+}
+
+void DepGraph::freeze() {
+    if (!nodes.empty() && nodes.begin()->first < FirstNodeId) {
+        throw runtime_error(stringbuilder() << "Can not freeze dep graph with node ID " << nodes.begin()->first);
+    }
+    std::size_t limit = nodes.empty() ? 0 : nodeIndex(nodes.rbegin()->first) + 1;
+    node_table.assign(limit, nullptr);
+    for (NodesMapConstIterator it = nodes.begin(); it != nodes.end(); ++it) {
+        node_table[nodeIndex(it->first)] = it->second;
+    }
+
+    succ_offsets.assign(limit + 1, 0);
+    for (EdgesMapConstIterator it = edges.begin(); it != edges.end(); ++it) {
+        succ_offsets[nodeIndex(it->first->getID()) + 1] = it->second.size();
+    }
+    pred_offsets.assign(limit + 1, 0);
+    for (EdgesMapConstIterator it = reverse_edges.begin(); it != reverse_edges.end(); ++it) {
+        pred_offsets[nodeIndex(it->first->getID()) + 1] = it->second.size();
+    }
+    for (std::size_t i = 0; i < limit; i++) {
+        succ_offsets[i + 1] += succ_offsets[i];
+        pred_offsets[i + 1] += pred_offsets[i];
+    }
+
+    succ_list.clear();
+    succ_list.reserve(succ_offsets.back());
+    for (EdgesMapConstIterator it = edges.begin(); it != edges.end(); ++it) {
+        succ_list.insert(succ_list.end(), it->second.begin(), it->second.end());
+    }
+    pred_list.clear();
+    pred_list.reserve(pred_offsets.back());
+    for (EdgesMapConstIterator it = reverse_edges.begin(); it != reverse_edges.end(); ++it) {
+        pred_list.insert(pred_list.end(), it->second.begin(), it->second.end());
+    }
+    frozen = true;
 }
 
 OpNodesList DepGraph::getFuncsNodes(const std::vector<std::string> funcsNames) {
@@ -114,6 +171,18 @@ OpNodesList DepGraph::getFuncsNodes(const std::vector<std::string> funcsNames) {
 	return retMe;
 }
 
+OpNodesList DepGraph::getUnmodeledOpNodes() const {
+    OpNodesList retMe;
+	for (NodesMapConstIterator it = nodes.begin(); it != nodes.end(); ++it) {
+		if (it->second->getKind() == DepGraphNode::Op) {
+			DepGraphOpNode* opNode = static_cast<DepGraphOpNode*>(it->second);
+			if (!opNode->isModeled())
+				retMe.push_back(opNode);
+		}
+	}
+	return retMe;
+}
+
 NodesList DepGraph::getNodes() {
 	NodesList retMe;
 	for (NodesMapConstIterator it = nodes.begin(); it != nodes.end(); it++) {
@@ -148,8 +217,8 @@ DepGraphUninitNode* DepGraph::findPixyInputNode(string name){
 	    for (auto nodePair : nodes){
 	   		DepGraphUninitNode* uninitNode = dynamic_cast<DepGraphUninitNode*>(nodePair.second);
 			if (uninitNode != NULL) {
-				NodesList preds = this->getPredecessors(uninitNode);
-				for (NodesListIterator it = preds.begin(); it != preds.end();it++ ) {
+				NodeSpan preds = this->getPredecessors(uninitNode);
+				for (NodeSpan::const_iterator it = preds.begin(); it != preds.end();it++ ) {
 					DepGraphNormalNode* varNode = dynamic_cast<DepGraphNormalNode*>(*it);
 					if (varNode != NULL) {
 						Variable* o = dynamic_cast<Variable*>(varNode->getPlace());
@@ -180,13 +249,14 @@ DepGraph DepGraph::getInputRelevantGraph(DepGraphNode* inputNode) {
 	inputDepGraph.addNode(inputNode);
 	this->doGetInputRelevantGraph(inputNode, inputDepGraph);
 	inputDepGraph.setTopLeaf(this->root);
+	inputDepGraph.freeze();
 	return inputDepGraph;
 }
 
 void DepGraph::doGetInputRelevantGraph(DepGraphNode* node,
 	    			DepGraph& inputDepGraph)
 {
-	NodesList preds = this->getPredecessors(node);
+	NodeSpan preds = this->getPredecessors(node);
 
     for (auto pred : preds) {
 	   // if this node has already been added to the inputDepGraph graph...
@@ -210,6 +280,12 @@ void DepGraph::addEdge(DepGraphNode* from, DepGraphNode* to) {
 		throw runtime_error("Adding an edge with from/to that does not exist before");
 	}
 	this->edges[from].push_back(to);
+	NodesList& preds = this->reverse_edges[to];
+	NodesListIterator pos = std::lower_bound(preds.begin(), preds.end(), from, NodeLessThan());
+	if (pos == preds.end() || (*pos)->getID() != from->getID()) {
+		preds.insert(pos, from);
+	}
+	this->frozen = false;
 }
 
 //  *********************************************************************************
@@ -221,10 +297,14 @@ DepGraphNode* DepGraph::addNode(DepGraphNode* node) {
 		throw runtime_error(stringbuilder() << "Can not add Node with ID " << node->getID() << " to dep graph. It already exists.");
 	}
 	this->nodes[node->getID()] = node;
+	this->frozen = false;
 	return node;
 }
 
 DepGraphNode* DepGraph::getNode(const int id){
+    if (frozen) {
+        return id >= FirstNodeId && nodeIndex(id) < node_table.size() ? node_table[nodeIndex(id)] : NULL;
+    }
     NodesMapConstIterator cIt = nodes.find(id);
     if (cIt == nodes.end())
         return NULL;
@@ -233,29 +313,256 @@ DepGraphNode* DepGraph::getNode(const int id){
 }
 //  *********************************************************************************
 bool DepGraph::containsNode(const DepGraphNode* node) {
+	if (frozen) {
+		return isFrozenNode(node);
+	}
 	NodesMapConstIterator it = nodes.find(node->getID());
 	return (it != nodes.end());
 }
 
 std::string DepGraph::escapeLiteral(const std::string& litValue)
 {
-    std::string result = litValue;
     //if we are not parsing a regular expression then remove escaping
     //surprisingly, dot special chars (\,") are also special to our
     // regular expression engine
-    static boost::regex bsDQuote("\\\\\"");//this will match \"
-    std::string newStr = "\"";
-    result = boost::regex_replace(result, bsDQuote, newStr);
-    static boost::regex bsBs("\\\\\\\\");//this will match \\ (do not remove this text. Really unless you remove the two backslashes)
-    newStr = "\\";
-    result = boost::regex_replace(result, bsBs, newStr);
+    // first \" becomes ", then \\ becomes a single backslash
+    std::string unquoted;
+    unquoted.reserve(litValue.size());
+    for (std::size_t i = 0; i < litValue.size(); i++) {
+        if (litValue[i] == '\\' && i + 1 < litValue.size() && litValue[i + 1] == '"') {
+            i++;
+        }
+        unquoted.push_back(litValue[i]);
+    }
+    std::string result;
+    result.reserve(unquoted.size());
+    for (std::size_t i = 0; i < unquoted.size(); i++) {
+        if (unquoted[i] == '\\' && i + 1 < unquoted.size() && unquoted[i + 1] == '\\') {
+            i++;
+        }
+        result.push_back(unquoted[i]);
+    }
     return result;
 }
 
+namespace {
+
+// Lexer for the dot files of parseStream. It works on the buffer holding the
+// whole file, without copying lines, and accepts exactly the lines the
+// regular expressions in the comments did.
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool isWord(char c) {
+    return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool startsWith(const char* begin, const char* end, const char* prefix) {
+    std::size_t n = strlen(prefix);
+    return static_cast<std::size_t>(end - begin) >= n && memcmp(begin, prefix, n) == 0;
+}
+
+bool endsWith(const char* begin, const char* end, const char* suffix) {
+    std::size_t n = strlen(suffix);
+    return static_cast<std::size_t>(end - begin) >= n && memcmp(end - n, suffix, n) == 0;
+}
+
+// Reads "n<digits>" at pos and returns the node id, which is one less than
+// the number in the dot file
+bool lexNodeName(const char*& pos, const char* end, int& id) {
+    if (pos == end || *pos != 'n' || pos + 1 == end || !isDigit(pos[1])) {
+        return false;
+    }
+    long value = 0;
+    for (pos++; pos != end && isDigit(*pos); pos++) {
+        value = value * 10 + (*pos - '0');
+        if (value > std::numeric_limits<int>::max()) {
+            throw out_of_range("error parsing the dependency graph dot file. Node number out of range");
+        }
+    }
+    id = static_cast<int>(value) - 1;
+    return true;
+}
+
+// Sets the type and value of a node from its label
+void lexNodeLabel(const char* begin, const char* end, DotToken& token) {
+    // Input: (.+)
+    if (startsWith(begin, end, "Input: ") && end - begin > 7) {
+        token.type = DotToken::Uninit;
+        token.value.clear();
+    // Var: (.+)
+    } else if (startsWith(begin, end, "Var: ") && end - begin > 5) {
+        token.type = DotToken::Var;
+        token.value.assign(begin + 5, end);
+    // Return: (.+)
+    } else if (startsWith(begin, end, "Return: ") && end - begin > 8) {
+        token.type = DotToken::Var;
+        token.value.assign(begin + 8, end);
+    // RegExp: (.*)
+    } else if (startsWith(begin, end, "RegExp: ")) {
+        token.type = DotToken::RegExp;
+        token.value.assign(begin + 8, end);
+    // Lit: (.*)
+    } else if (startsWith(begin, end, "Lit: ")) {
+        token.type = DotToken::Lit;
+        token.value = DepGraph::escapeLiteral(std::string(begin + 5, end));
+    // (.+)
+    } else {
+        token.type = DotToken::Op;
+        token.value.assign(begin, end);
+    }
+}
+
+// ^\s*n(\d+)\s\[(.*)\];$ with the description shape=(.+), label="(.+)"
+bool lexNode(const char* begin, const char* end, DotToken& token) {
+    const char* pos = begin;
+    while (pos != end && isSpace(*pos)) {
+        pos++;
+    }
+    if (!lexNodeName(pos, end, token.id) || end - pos < 4 || !isSpace(pos[0]) || pos[1] != '['
+        || !endsWith(pos, end, "];")) {
+        return false;
+    }
+    const char* description = pos + 2;
+    const char* description_end = end - 2;
+
+    // The shape is as long as possible, so the label starts after the last
+    // separator which leaves a non-empty label
+    const char* separator = ", label=\"";
+    const std::size_t separator_length = strlen(separator);
+    const char* label = nullptr;
+    if (startsWith(description, description_end, "shape=") && endsWith(description, description_end, "\"")) {
+        for (std::ptrdiff_t i = description_end - description - 2 - separator_length; i > 6; i--) {
+            if (memcmp(description + i, separator, separator_length) == 0) {
+                label = description + i;
+                break;
+            }
+        }
+    }
+    if (label == nullptr) {
+        throw invalid_argument("error parsing the dependency graph dot file. Can not parse node description");
+    }
+    token.target = -1;
+    token.shape.assign(description + 6, label);
+    lexNodeLabel(label + separator_length, description_end - 1, token);
+    return true;
+}
+
+// ^\s*n(\d+)\s->\sn(\d+)(\[(.*)\])?;$
+bool lexEdge(const char* begin, const char* end, DotToken& token) {
+    const char* pos = begin;
+    while (pos != end && isSpace(*pos)) {
+        pos++;
+    }
+    if (!lexNodeName(pos, end, token.id) || end - pos < 4 || !isSpace(pos[0]) || pos[1] != '-'
+        || pos[2] != '>' || !isSpace(pos[3])) {
+        return false;
+    }
+    pos += 4;
+    if (!lexNodeName(pos, end, token.target)) {
+        return false;
+    }
+    if (pos == end || !((end - pos == 1 && *pos == ';') || (*pos == '[' && end - pos >= 3 && endsWith(pos, end, "];")))) {
+        return false;
+    }
+    token.type = DotToken::Edge;
+    token.shape.clear();
+    token.value.clear();
+    return true;
+}
+
+// ^//[^$]*$ with the metadata ^// ([\.\w]+): (.+)
+bool lexMetadata(const char* begin, const char* end, DotToken& token) {
+    if (!startsWith(begin, end, "// ") || memchr(begin, '$', end - begin) != nullptr) {
+        return false;
+    }
+    const char* key = begin + 3;
+    const char* pos = key;
+    while (pos != end && (isWord(*pos) || *pos == '.')) {
+        pos++;
+    }
+    if (pos == key || !startsWith(pos, end, ": ") || end - pos < 3) {
+        return false;
+    }
+    token.type = DotToken::Metadata;
+    token.id = -1;
+    token.target = -1;
+    token.shape.assign(key, pos);
+    token.value.assign(pos + 2, end);
+    return true;
+}
+
+// Sets the metadata of a comment line at the top of a dot file. The metadata
+// comes before the graph, so this returns false at the first other line
+bool lexHeaderLine(const char* begin, const char* end, DotToken& token, Metadata& metadata, bool& hasSanitizerHash) {
+    if (end != begin && end[-1] == '\r') {
+        end--;
+    }
+    if (end == begin) {
+        return true;
+    }
+    if (!startsWith(begin, end, "//")) {
+        return false;
+    }
+    if (lexMetadata(begin, end, token)) {
+        metadata.set_field(token.shape, token.value);
+        hasSanitizerHash |= token.shape == "DepGraph.sanitizer_hash";
+    }
+    return true;
+}
+
+// Calls onToken for the node, edge and metadata lines, the token is reused
+template <typename F>
+void lexDot(const char* data, std::size_t length, F onToken) {
+    DotToken token;
+    const char* end = data + length;
+    for (const char* begin = data; begin < end;) {
+        const char* line_end = static_cast<const char*>(memchr(begin, '\n', end - begin));
+        const char* next = line_end ? line_end + 1 : end;
+        if (line_end == nullptr) {
+            line_end = end;
+        }
+        if (line_end != begin && line_end[-1] == '\r') {
+            line_end--;
+        }
+        if (lexNode(begin, line_end, token) || lexEdge(begin, line_end, token)
+            || lexMetadata(begin, line_end, token)) {
+            onToken(token);
+        }
+        begin = next;
+    }
+}
+
+std::string readStream(std::istream& stream) {
+    // Unlike operator<<, the iterators pass on the errors of the stream
+    // buffer, such as a corrupt compressed file
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+}
+
 DepGraph DepGraph::parseDotFile(const std::string& fname) {
+    if (isCompressedFile(fname)) {
+        try {
+            boost::iostreams::filtering_istream in;
+            if (!openCompressedFile(fname, in)) {
+                return DepGraph();
+            }
+            return DepGraph::parseStream(in);
+        } catch (exception const &e) {
+            cerr << "Can not construct depGraph from file " << fname << ". Following exception happened:\n" << e.what();
+            throw;
+        }
+    }
     std::ifstream ifs;
     try {
-        ifs.open(fname, std::ifstream::in);
+        ifs.open(fname, std::ifstream::in | std::ifstream::binary);
         DepGraph depGraph = DepGraph::parseStream(ifs);
         ifs.close();
         return depGraph;
@@ -267,130 +574,107 @@ DepGraph DepGraph::parseDotFile(const std::string& fname) {
     }
 }
 
+bool DepGraph::parseDotFileMetadata(const std::string& fname, Metadata& metadata) {
+    boost::iostreams::filtering_istream ifs;
+    if (!openCompressedFile(fname, ifs)) {
+        return false;
+    }
+    DotToken token;
+    bool hasSanitizerHash = false;
+    std::string line;
+    while (getline(ifs, line) && lexHeaderLine(line.data(), line.data() + line.size(), token, metadata, hasSanitizerHash)) {
+    }
+    return hasSanitizerHash;
+}
+
+bool DepGraph::parseStringMetadata(const std::string& str, Metadata& metadata) {
+    DotToken token;
+    bool hasSanitizerHash = false;
+    const char* end = str.data() + str.size();
+    for (const char* begin = str.data(); begin < end;) {
+        const char* line_end = static_cast<const char*>(memchr(begin, '\n', end - begin));
+        if (line_end == nullptr) {
+            line_end = end;
+        }
+        if (!lexHeaderLine(begin, line_end, token, metadata, hasSanitizerHash)) {
+            break;
+        }
+        begin = line_end + 1;
+    }
+    return hasSanitizerHash;
+}
+
 DepGraph DepGraph::parseString(const std::string& str) {
-    cout << endl << "\t------ Got string " << str << " ------" << endl;
-    stringstream ss;
-    ss  << str;
-    return DepGraph::parseStream(ss);
+    return DepGraph::parseBuffer(str.data(), str.size());
 }
 
 DepGraph DepGraph::parseStream(std::istream &stream) {
+    if (!stream.good()) {
+        return DepGraph();
+    }
+    std::string buffer = readStream(stream);
+    return DepGraph::parseBuffer(buffer.data(), buffer.size());
+}
+
+DepGraph DepGraph::parseBuffer(const char* data, std::size_t length) {
     DepGraph depGraph;
+    lexDot(data, length, [&depGraph](const DotToken& token) { depGraph.addToken(token); });
+    depGraph.calculateSCCs();
+    depGraph.calculateSubtreeHashes();
+    return depGraph;
+}
 
-    cout << endl << "\t------ inside parseStream :) " <<  " ------" << endl;
-    // This is how a node line looks like
-    //  n18 [shape=box, label="/home/muath/pixy_output/test/vuln01.php : 13\nVar: $www\nFunc: _main\nID: 17, SCCID: -1, order: -1\n\n"];
-    boost::smatch sm;
-    boost::regex regxNode("^\\s*n(\\d+)\\s\\[(.*)\\];$");
-    boost::regex regxEdge("^\\s*n(\\d+)\\s->\\sn(\\d+)(\\[(.*)\\])?;$");
-    //second group of regex node
-    boost::regex regxNodeDescription("shape=(.+), label=\"(.+)\"");
-    //second group of regex nodeDescription
-    boost::regex regxNodeUninit("Input: (.+)");
-    boost::regex regxNodeReturn("Return: (.+)");
-    boost::regex regxNodeVar("Var: (.+)");
-    boost::regex regxNodeLit("Lit: (.*)");
-    boost::regex regxNodeRegExp("RegExp: (.*)");
-    boost::regex regxNodeOp("(.+)");
-    boost::regex regxStrangerRegEx("/(.+)/");
-    boost::regex regxComment("^//[^$]*$");
-    boost::regex regxMetadata("^// ([\\.\\w]+): (.+)");
-    string nodeName;
-    string nodeDescription;
-    string edge;
-    int nodeID;
-    int fromNodeID;
-    int toNodeID;
-    string nodeType;
-    string nodeLabel;
-    string nodeShape;
-    string varName;
-    string litValue;
-    string opName;        
-    string inputLine;
-
-    std::stringstream cout_local;
-    
-    while (stream.good()) {
-        getline(stream, inputLine);
-        cout_local << "\t parsing : " << inputLine << endl;
-        if (boost::regex_match(inputLine, sm, regxNode)){
-
-            //process node
-            nodeID = std::stoi(sm[1]) - 1;
-            nodeDescription = sm[2];
-
-            if (boost::regex_match(nodeDescription, sm, regxNodeDescription)) {
-                nodeShape = sm[1];
-                nodeLabel = sm[2];
-                DepGraphNode* node = NULL;
-                if (boost::regex_match(nodeLabel, sm, regxNodeUninit)){
-                    node = new DepGraphUninitNode(nodeID, -1, -1);
-                    depGraph.addNode(node);
-                } else if (boost::regex_match(nodeLabel, sm, regxNodeVar)){
-                    varName = sm[1];
-                    TacPlace* place = new Variable(varName, "noFunc");
-                    node = new DepGraphNormalNode("noFile", -1, nodeID, -1, -1, place);
-                    depGraph.addNode(node);
-                } else if (boost::regex_match(nodeLabel, sm, regxNodeReturn)){
-                    varName = sm[1];
-                    TacPlace* place = new Variable(varName, "noFunc");
-                    node = new DepGraphNormalNode("noFile", -1, nodeID, -1, -1, place);
-                    depGraph.addNode(node);
-                } else if (boost::regex_match(nodeLabel, sm, regxNodeRegExp)){
-                    litValue = sm[1];
-                    cout_local << "RegExp litval:  " << litValue << endl;
-                    TacPlace* place = new RegExpNode(litValue);
-                    node = new DepGraphNormalNode("noFile", -1, nodeID, -1, -1, place);
-                    depGraph.addNode(node);
-                } else if (boost::regex_match(nodeLabel, sm, regxNodeLit)){
-                    litValue = sm[1];
-                    cout_local << "litval original:  " << litValue << endl;
-                    litValue = DepGraph::escapeLiteral(litValue);
-                    cout_local << "result litval:  " << litValue << endl;
-                    TacPlace* place = new Literal(litValue);
-                    node = new DepGraphNormalNode("noFile", -1, nodeID, -1, -1, place);
-                    depGraph.addNode(node);
-                } else if (boost::regex_match(nodeLabel, sm, regxNodeOp)){
-                    opName = sm[1];
-                    node = new DepGraphOpNode("noFile", -1, nodeID, -1, -1, opName, false);
-                    depGraph.addNode(node);
-                    cout_local << "Op: " << opName << endl;
-                }
-                else {
-                    throw invalid_argument("error parsing the dependency graph dot file. Can not parse node label (type)");
-                }
-                DepGraphNormalNode* root;
-                if (nodeShape == "doubleoctagon" && (root = dynamic_cast<DepGraphNormalNode*>(node)) != NULL ) {
-                    depGraph.setRoot(root);
-                }
-                node->setShape(nodeShape);
-            } else {
-                throw invalid_argument("error parsing the dependency graph dot file. Can not parse node description");
-            }
-        } else if (boost::regex_match(inputLine, sm, regxEdge)) {
-            //process edge
-            fromNodeID = std::stoi(sm[1]) - 1;
-            toNodeID = std::stoi(sm[2]) - 1;
-            DepGraphNode* fromNode = depGraph.getNode(fromNodeID);
-            DepGraphNode* toNode = depGraph.getNode(toNodeID);
-            depGraph.addEdge(fromNode, toNode);
-            cout_local << "Found edge: " << fromNodeID << "(" << fromNode << ") --> " << toNodeID << "(" << toNode << ")" << endl;
-        } else if (boost::regex_match(inputLine, sm, regxComment)) {
-            //process metadata
-            if(boost::regex_match(inputLine, sm, regxMetadata)) {
-                std::string key = sm[1];
-                std::string value = sm[2];
-                depGraph.metadata.set_field(key, value);
-            }
-        }
+void DepGraph::tokenizeStream(std::istream &stream, std::vector<DotToken>& tokens) {
+    if (!stream.good()) {
+        return;
     }
+    std::string buffer = readStream(stream);
+    lexDot(buffer.data(), buffer.size(), [&tokens](const DotToken& token) { tokens.push_back(token); });
+}
 
+DepGraph DepGraph::parseTokens(const std::vector<DotToken>& tokens) {
+    DepGraph depGraph;
+    for (const auto& token : tokens) {
+        depGraph.addToken(token);
+    }
     depGraph.calculateSCCs();
-
+    depGraph.calculateSubtreeHashes();
     return depGraph;
 }
 
+void DepGraph::addToken(const DotToken& token) {
+    DepGraphNode* node = NULL;
+    switch (token.type) {
+    case DotToken::Uninit:
+        node = new DepGraphUninitNode(token.id, -1, -1);
+        break;
+    case DotToken::Var:
+        node = new DepGraphNormalNode("noFile", -1, token.id, -1, -1, new Variable(token.value, "noFunc"));
+        break;
+    case DotToken::RegExp:
+        node = new DepGraphNormalNode("noFile", -1, token.id, -1, -1, new RegExpNode(token.value));
+        break;
+    case DotToken::Lit:
+        node = new DepGraphNormalNode("noFile", -1, token.id, -1, -1, new Literal(token.value));
+        break;
+    case DotToken::Op:
+        node = new DepGraphOpNode("noFile", -1, token.id, -1, -1, token.value, false);
+        break;
+    case DotToken::Edge:
+        this->addEdge(this->getNode(token.id), this->getNode(token.target));
+        return;
+    case DotToken::Metadata:
+        this->metadata.set_field(token.shape, token.value);
+        return;
+    }
+    this->addNode(node);
+    DepGraphNormalNode* root;
+    if (token.shape == "doubleoctagon" && (root = dynamic_cast<DepGraphNormalNode*>(node)) != NULL ) {
+        this->setRoot(root);
+    }
+    node->setShape(token.shape);
+}
+
 DepGraph DepGraph::parsePixyDotFile(std::string fname) {
     DepGraph depGraph;
 
@@ -525,6 +809,7 @@ DepGraph DepGraph::parsePixyDotFile(std::string fname) {
     }
 
     depGraph.calculateSCCs();
+    depGraph.calculateSubtreeHashes();
 
     return depGraph;
 }
@@ -585,13 +870,16 @@ void DepGraph::dumpDot(string fname) const{
 }
 
 void DepGraph::calculateSCCs() {
+	if (!frozen) {
+		freeze();
+	}
 	int time_count = 0;
-	map<int, int> lowlink;
-	map<int, bool> used;
+	std::vector<int> lowlink(node_table.size(), 0);
+	std::vector<char> used(node_table.size(), false);
 	stack<int> process_stack;
 
     for (auto node_ptr : getNodes()) {
-      if (!used[node_ptr->getID()]) {
+      if (!used[nodeIndex(node_ptr->getID())]) {
     	  dfsSCC(node_ptr, time_count, lowlink, used, process_stack);
       }
     }
@@ -601,19 +889,109 @@ void DepGraph::calculateSCCs() {
     return;
 }
 
-void DepGraph::dfsSCC(DepGraphNode* node, int& time_count, map<int, int>& lowlink, map<int, bool>& used, stack<int>& process_stack) {
+/**
+ * Hash of the node itself: its kind and op name or literal value, but not
+ * variable names or ids, which differ between otherwise equal graphs.
+ */
+std::size_t DepGraph::nodeHash(const DepGraphNode* node) const {
+	std::size_t seed = 0;
+	if (node->getKind() == DepGraphNode::Normal) {
+		const TacPlace* place = static_cast<const DepGraphNormalNode*>(node)->getPlace();
+		if (dynamic_cast<const Literal*>(place) != nullptr) {
+			boost::hash_combine(seed, std::string("Lit"));
+			boost::hash_combine(seed, place->toString());
+		} else if (dynamic_cast<const RegExpNode*>(place) != nullptr) {
+			boost::hash_combine(seed, std::string("RegExp"));
+			boost::hash_combine(seed, place->toString());
+		} else if (dynamic_cast<const Constant*>(place) != nullptr) {
+			boost::hash_combine(seed, std::string("Const"));
+			boost::hash_combine(seed, place->toString());
+		} else {
+			boost::hash_combine(seed, std::string("Var"));
+		}
+	} else if (node->getKind() == DepGraphNode::Op) {
+		boost::hash_combine(seed, std::string("Op"));
+		boost::hash_combine(seed, static_cast<const DepGraphOpNode*>(node)->getName());
+	} else {
+		boost::hash_combine(seed, std::string("Input"));
+	}
+	return seed;
+}
+
+/**
+ * Merkle style hash of every sub-DAG, computed from the node hash and the
+ * hashes of the successors in order. Graphs which share a sanitizer get the
+ * same hash for its nodes, whatever code surrounds it. Sub-DAGs containing a
+ * cycle or depending on more than one input get hash 0 and are never reused.
+ */
+void DepGraph::calculateSubtreeHashes() {
+	// 1: successors pushed, 2: hash computed
+	std::vector<int> state(getNodeTableSize(), 0);
+	stack<DepGraphNode*> process_stack;
+
+	for (auto node_ptr : getNodes()) {
+		if (state[nodeIndex(node_ptr->getID())] != 0) {
+			continue;
+		}
+		process_stack.push(node_ptr);
+		while (!process_stack.empty()) {
+			DepGraphNode* curr = process_stack.top();
+			int& curr_state = state[nodeIndex(curr->getID())];
+			NodeSpan successors = getSuccessors(curr);
+			if (curr_state == 0) {
+				curr_state = 1;
+				for (NodeSpan::const_reverse_iterator it = successors.rbegin(); it != successors.rend(); it++) {
+					if (state[nodeIndex((*it)->getID())] == 0) {
+						process_stack.push(*it);
+					}
+				}
+				continue;
+			}
+			process_stack.pop();
+			if (curr_state == 2) {
+				continue;
+			}
+			curr_state = 2;
+
+			std::size_t hash = nodeHash(curr);
+			int input = curr->getKind() == DepGraphNode::Uninit ? curr->getID() : -1;
+			for (auto succ_node : successors) {
+				// successors still on the stack are part of a cycle
+				if (hash == 0 || state[nodeIndex(succ_node->getID())] != 2 || succ_node->getSubtreeHash() == 0) {
+					hash = 0;
+					break;
+				}
+				int succ_input = succ_node->getSubtreeInput();
+				if (input == -1) {
+					input = succ_input;
+				} else if (succ_input != -1 && succ_input != input) {
+					hash = 0;
+					break;
+				}
+				boost::hash_combine(hash, succ_node->getSubtreeHash());
+			}
+			if (isSCCElement(curr)) {
+				hash = 0;
+			}
+			curr->setSubtreeHash(hash);
+			curr->setSubtreeInput(hash == 0 ? -1 : input);
+		}
+	}
+}
+
+void DepGraph::dfsSCC(DepGraphNode* node, int& time_count, std::vector<int>& lowlink, std::vector<char>& used, stack<int>& process_stack) {
 	int u = node->getID();
-	lowlink[u] = time_count++;
-	used[u] = true;
+	lowlink[nodeIndex(u)] = time_count++;
+	used[nodeIndex(u)] = true;
 	process_stack.push(u);
 	bool is_component_root = true;
 
 	for (auto succ_node : getSuccessors(node)) {
 		int v = succ_node->getID();
-		if (!used[v])
+		if (!used[nodeIndex(v)])
 			dfsSCC(succ_node, time_count, lowlink, used, process_stack);
-		if (lowlink[u] > lowlink[v]) {
-			lowlink[u] = lowlink[v];
+		if (lowlink[nodeIndex(u)] > lowlink[nodeIndex(v)]) {
+			lowlink[nodeIndex(u)] = lowlink[nodeIndex(v)];
 			is_component_root = false;
 		}
 	}
@@ -626,7 +1004,7 @@ void DepGraph::dfsSCC(DepGraphNode* node, int& time_count, map<int, int>& lowlin
 			process_stack.pop();
 			scc_component.push_back(getNode(k));
 			scc_map[k] = u;
-			lowlink[k] = INT_MAX;
+			lowlink[nodeIndex(k)] = INT_MAX;
 			if (k == u)
 				break;
 		}
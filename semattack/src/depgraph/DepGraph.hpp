@@ -40,6 +40,7 @@
 #include <set>
 #include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <boost/regex.hpp>
 
 struct NodeLessThan : public std::binary_function<const DepGraphNode*, const DepGraphNode*, bool> {
@@ -64,6 +65,29 @@ typedef std::vector<DepGraphNode*>::const_iterator NodesListConstIterator;
 typedef std::vector<DepGraphNode*>::reverse_iterator NodesListReverseIterator;
 typedef std::vector<DepGraphNode *>::const_reverse_iterator NodesListConstReverseIterator;
 
+// A view of the successors or predecessors of a node, valid until the graph
+// is changed
+class NodeSpan {
+public:
+    typedef DepGraphNode* const* const_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    NodeSpan() : first(nullptr), last(nullptr) {}
+    NodeSpan(const_iterator first, const_iterator last) : first(first), last(last) {}
+
+    const_iterator begin() const { return first; }
+    const_iterator end() const { return last; }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(last); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(first); }
+    std::size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    DepGraphNode* operator[](std::size_t i) const { return first[i]; }
+
+private:
+    const_iterator first;
+    const_iterator last;
+};
+
 typedef std::map<const DepGraphNode*, NodesList, NodeLessThan> EdgesMap;
 typedef std::map<const DepGraphNode*, NodesList, NodeLessThan>::iterator EdgesMapIterator;
 typedef std::map<const DepGraphNode*, NodesList, NodeLessThan>::const_iterator EdgesMapConstIterator;
@@ -76,6 +100,21 @@ typedef std::vector<DepGraphUninitNode*> UninitNodesList;
 typedef std::vector<DepGraphUninitNode*>::iterator UninitNodesListIterator;
 typedef std::vector<DepGraphUninitNode*>::const_iterator UninitNodesListConstIterator;
 
+// A node, edge or metadata line of a depgraph dot file, see
+// DepGraph::tokenizeStream
+struct DotToken {
+    enum Type { Uninit, Var, RegExp, Lit, Op, Edge, Metadata };
+    Type type;
+    // node id, source node of an edge
+    int id;
+    // target node of an edge
+    int target;
+    // node shape, metadata key
+    std::string shape;
+    // variable name, escaped literal, regexp or op name, metadata value
+    std::string value;
+};
+
 typedef std::map<int, NodesList> SccNodes;
 typedef std::map<int, NodesList>::iterator SccNodesIterator;
 typedef std::map<int, NodesList>::const_iterator SccNodesConstIterator;
@@ -85,14 +124,16 @@ typedef std::map<int, NodesList>::const_iterator SccNodesConstIterator;
 class DepGraph {
 public:
     DepGraph();
-    DepGraph(DepGraphNormalNode* root) : metadata() { this->root = root; this->addNode(root); this->topLeaf = nullptr;};
+    DepGraph(DepGraphNormalNode* root) : frozen(false), metadata() { this->root = root; this->addNode(root); this->topLeaf = nullptr;};
     DepGraph(const DepGraph& other);
     DepGraph& operator=(const DepGraph &other);
     bool operator<(const DepGraph &other);
     virtual ~DepGraph() {};
 
-    NodesList getPredecessors(const DepGraphNode* node) const;
-    NodesList getSuccessors(const DepGraphNode* node) const;
+    // Predecessors are ordered by node id and listed once, successors in the
+    // order their edges were added
+    NodeSpan getPredecessors(const DepGraphNode* node) const;
+    NodeSpan getSuccessors(const DepGraphNode* node) const;
 
     DepGraphNormalNode* getRoot() {
         return this->root;
@@ -118,6 +159,13 @@ public:
         return ((int)nodes.size());
     };
 
+    // Node ids are the node numbers of the dot file minus one
+    static const int FirstNodeId = -1;
+    // Position of a node in tables indexed by node id
+    static std::size_t nodeIndex(int id) { return id - FirstNodeId; }
+    // Size of tables indexed by node id, one past the highest node id
+    std::size_t getNodeTableSize() const;
+
     int getNumOfEdges() const {
         int num = 0;
         for (EdgesMapConstIterator it = edges.begin(); it != edges.end(); ++it){
@@ -131,13 +179,23 @@ public:
     UninitNodesList getUninitNodes() ;
 
     OpNodesList getFuncsNodes(const std::vector<std::string> funcsNames) ;
+    // Op nodes the image computation has no model for
+    OpNodesList getUnmodeledOpNodes() const;
 
     DepGraph getInputRelevantGraph(DepGraphNode* inputNode) ;
 
     DepGraphUninitNode* findInputNode(string name);
     DepGraphUninitNode* findPixyInputNode(string name);
 
+    // Packs the nodes and edges into flat arrays indexed by node id for
+    // traversal, adding a node or an edge undoes it. Node ids must not be
+    // below FirstNodeId.
+    void freeze();
+
+    // Freezes the graph if it is not yet
     void calculateSCCs();
+    // Must be called after calculateSCCs
+    void calculateSubtreeHashes();
 
     bool isSCCElement(const DepGraphNode* node) const;
     int getSCCID(const DepGraphNode* node) const;
@@ -156,14 +214,28 @@ public:
     std::string toDot() const;
     void dumpDot(string fname) const;
 
+    // Compressed dot files (.dot.gz, .dot.zst) are decompressed while parsing
     static DepGraph parseDotFile(const std::string& fname);
     static DepGraph parseString(const std::string& s);
+    // Reads only the metadata comments at the top of a dot file, returns
+    // true if they contain the sanitizer hash
+    static bool parseDotFileMetadata(const std::string& fname, Metadata& metadata);
+    static bool parseStringMetadata(const std::string& s, Metadata& metadata);
     static DepGraph parsePixyDotFile(std::string fname);
+
+    // Splits a depgraph dot file into tokens, which can be stored and turned
+    // into the graph later with parseTokens
+    static void tokenizeStream(std::istream &stream, std::vector<DotToken>& tokens);
+    static DepGraph parseTokens(const std::vector<DotToken>& tokens);
+    // Removes the dot escaping of a literal label
+    static std::string escapeLiteral(const std::string& litValue);
     
     std::string label;
     std::string labelloc;
 protected:
     static DepGraph parseStream(std::istream &stream);
+    static DepGraph parseBuffer(const char* data, std::size_t length);
+    void addToken(const DotToken& token);
 // map from a node to *the same* node;
 	NodesMap nodes;
 
@@ -176,10 +248,18 @@ protected:
 
 	// edges (from -> to)
 	EdgesMap edges;
-
-	static int currentID;
-	static int currentSccID;
-	static int currentOrder;
+	// reverse edges (to -> from), sorted by id and without duplicates
+	EdgesMap reverse_edges;
+
+	// built by freeze: the nodes by nodeIndex (nullptr for unused ids) and
+	// the compressed sparse rows of edges and reverse_edges. The row of node
+	// index i holds the entries from offsets[i] to offsets[i + 1].
+	bool frozen;
+	NodesList node_table;
+	std::vector<std::size_t> succ_offsets;
+	NodesList succ_list;
+	std::vector<std::size_t> pred_offsets;
+	NodesList pred_list;
 
 	// members for scc nodes (computed with tarjan's algorithm)
 	SccNodes scc_components;
@@ -188,15 +268,40 @@ protected:
 
 	Metadata metadata;
 
-	void dfsSCC(DepGraphNode* node, int& time_count, map<int, int>& lowlink, map<int, bool>& used, stack<int>& process_stack);
+	void dfsSCC(DepGraphNode* node, int& time_count, std::vector<int>& lowlink, std::vector<char>& used, stack<int>& process_stack);
 
 	void printSCCInfo();
 
+	std::size_t nodeHash(const DepGraphNode* node) const;
+	// Whether the node is in the frozen node table
+	bool isFrozenNode(const DepGraphNode* node) const;
+
 	void doGetInputRelevantGraph(DepGraphNode* node,
 				DepGraph& inputDepGraph) ;
+};
+
+// A set of nodes of one graph, indexed by node id
+class NodeSet {
+public:
+    explicit NodeSet(const DepGraph& graph) : members(graph.getNodeTableSize(), false) {}
+
+    // Returns false if the node already was in the set
+    bool insert(const DepGraphNode* node) {
+        std::size_t index = DepGraph::nodeIndex(node->getID());
+        if (index >= members.size()) {
+            members.resize(index + 1, false);
+        }
+        bool inserted = !members[index];
+        members[index] = true;
+        return inserted;
+    }
+    bool contains(const DepGraphNode* node) const {
+        std::size_t index = DepGraph::nodeIndex(node->getID());
+        return index < members.size() && members[index];
+    }
 
 private:
-        static std::string escapeLiteral(const std::string& litValue);
+    std::vector<bool> members;
 };
 
 // Like a Depgraph, but owns its node pointers (and deletes the in the descrutor)
@@ -25,6 +25,7 @@
 
 
 void DepGraphNode::init() {
+    kind = Base;
     // Node ID
     id = -1;
     // topological sort node
@@ -35,6 +36,8 @@ void DepGraphNode::init() {
     nonprocessedParents = -1;
     
     shape = "";
+    subtreeHash = 0;
+    subtreeInput = -1;
 }
 
 DepGraphNode::~DepGraphNode() {
@@ -65,6 +68,18 @@ void DepGraphNode::setSccID(int sccID){
 int DepGraphNode::getSccID() const {
 	return sccID;
 }
+void DepGraphNode::setSubtreeHash(std::size_t subtreeHash){
+	this->subtreeHash = subtreeHash;
+}
+std::size_t DepGraphNode::getSubtreeHash() const {
+	return subtreeHash;
+}
+void DepGraphNode::setSubtreeInput(int subtreeInput){
+	this->subtreeInput = subtreeInput;
+}
+int DepGraphNode::getSubtreeInput() const {
+	return subtreeInput;
+}
 bool DepGraphNode::equals(const DepGraphNode* node) const{
 	return this->id == node->id;
 }
@@ -25,28 +25,35 @@
 #define DEPGRAPHNODE_HPP_
 
 #include "../StringBuilder.hpp"
+#include <cstddef>
 #include <string>
 #include <stdexcept>
 
 class DepGraphNode {
 public:
+    // Set by the constructor of each subclass, so traversals can tell the
+    // node types apart without a dynamic_cast
+    enum Kind { Base, Normal, Op, Uninit, Scc };
+
     DepGraphNode()
     {
         init();
     };
 
     DepGraphNode(std::string filename, int origLineno, int id, int order, int sccID)
-    : fileName(filename), origLineno(origLineno), id(id), order(order), sccID(sccID)
+    : fileName(filename), origLineno(origLineno), kind(Base), id(id), order(order), sccID(sccID)
     {
-        nonprocessedParents = -1; shape = "";
+        nonprocessedParents = -1; shape = ""; subtreeHash = 0; subtreeInput = -1;
     };
 
 	DepGraphNode(const DepGraphNode& other)
-		: fileName(other.fileName), origLineno(other.origLineno), id(other.id), order(other.order),
-		  sccID(other.sccID), nonprocessedParents(other.nonprocessedParents), shape(other.shape)
+		: fileName(other.fileName), origLineno(other.origLineno), kind(other.kind), id(other.id), order(other.order),
+		  sccID(other.sccID), nonprocessedParents(other.nonprocessedParents), shape(other.shape),
+		  subtreeHash(other.subtreeHash), subtreeInput(other.subtreeInput)
     {
     };
 
+	Kind getKind() const { return kind; }
 	int getNonprocessedParents() const;
 	void setNonprocessedParents(int nonprocessedParents);
 	void setID(int id);
@@ -55,6 +62,12 @@ public:
 	int getOrder() const;
 	void setSccID(int sccID);
 	int getSccID() const;
+	// Structural hash of the sub-DAG below this node, 0 if it contains a cycle
+	void setSubtreeHash(std::size_t subtreeHash);
+	std::size_t getSubtreeHash() const;
+	// The single input node the sub-DAG depends on, -1 if there is none
+	void setSubtreeInput(int subtreeInput);
+	int getSubtreeInput() const;
     std::string getFileName() const { return this->fileName;};
     int getOrigLineNo() const { return this->origLineno; };
 	virtual bool equals(const DepGraphNode* pOther) const;
@@ -73,6 +86,7 @@ public:
 protected:
 	std::string fileName;
 	int origLineno;
+	Kind kind;
     std::string shape;
     void init();
 
@@ -86,6 +100,10 @@ private:
 	int sccID;
 	// tells number of parents which has not been processed in computation yet
 	int nonprocessedParents;
+	// structural hash of the node and all its successors
+	std::size_t subtreeHash;
+	// id of the uninit node below this node
+	int subtreeInput;
 
 };
 
@@ -35,6 +35,7 @@ class DepGraphNormalNode: public DepGraphNode {
 public:
 	DepGraphNormalNode(std::string filename, int origLineno, int id, int order, int sccID, TacPlace* place) : DepGraphNode(filename, origLineno, id, order, sccID), place(place)
     {
+        kind = Normal;
         isTainted = false;
     };
 
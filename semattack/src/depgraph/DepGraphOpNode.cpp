@@ -33,6 +33,63 @@ DepGraphOpNode::~DepGraphOpNode() {
 	// TODO Auto-generated destructor stub
 }
 
+namespace {
+
+struct OpCodeName {
+	const char* name;
+	DepGraphOpNode::OpCode code;
+};
+
+const OpCodeName opCodeNames[] = {
+	{ ".", DepGraphOpNode::Concat },
+	{ "concat", DepGraphOpNode::Concat },
+	{ "preg_replace", DepGraphOpNode::Replace },
+	{ "ereg_replace", DepGraphOpNode::Replace },
+	{ "str_replace", DepGraphOpNode::Replace },
+	{ "str_replace_once", DepGraphOpNode::ReplaceOnce },
+	{ "regex_match", DepGraphOpNode::RegexMatch },
+	{ "regex_exec", DepGraphOpNode::RegexMatch },
+	{ "split", DepGraphOpNode::Split },
+	{ "substr", DepGraphOpNode::Substr },
+	{ "addslashes", DepGraphOpNode::AddSlashes },
+	{ "stripslashes", DepGraphOpNode::StripSlashes },
+	{ "mysql_escape_string", DepGraphOpNode::MysqlEscapeString },
+	{ "mysql_real_escape_string", DepGraphOpNode::MysqlRealEscapeString },
+	{ "htmlspecialchars", DepGraphOpNode::HtmlSpecialChars },
+	{ "nl2br", DepGraphOpNode::Nl2br },
+	{ "strtoupper", DepGraphOpNode::ToUpperCase },
+	{ "strtolower", DepGraphOpNode::ToLowerCase },
+	{ "trim", DepGraphOpNode::Trim },
+	{ "rtrim", DepGraphOpNode::RTrim },
+	{ "ltrim", DepGraphOpNode::LTrim },
+	{ "md5", DepGraphOpNode::Md5 },
+	{ "encodeURIComponent", DepGraphOpNode::EncodeURIComponent },
+	{ "decodeURIComponent", DepGraphOpNode::DecodeURIComponent },
+	{ "encodeURI", DepGraphOpNode::EncodeURI },
+	{ "decodeURI", DepGraphOpNode::DecodeURI },
+	{ "escape", DepGraphOpNode::Escape },
+	{ "unescape", DepGraphOpNode::Unescape },
+	{ "JSON.stringify", DepGraphOpNode::JsonStringify },
+	{ "JSON.parse", DepGraphOpNode::JsonParse },
+	{ "encodeTextFragment", DepGraphOpNode::EncodeTextFragment },
+	{ "encodeAttrString", DepGraphOpNode::EncodeAttrString },
+};
+
+}
+
+DepGraphOpNode::OpCode DepGraphOpNode::resolveOpCode(const std::string& name) {
+	// Any name containing __vlab_restrict is a restriction
+	if (name.find("__vlab_restrict") != std::string::npos) {
+		return VlabRestrict;
+	}
+	for (const OpCodeName& entry : opCodeNames) {
+		if (name == entry.name) {
+			return entry.code;
+		}
+	}
+	return Unmodeled;
+}
+
     // returns a name that can be used in dot file representation
     std::string DepGraphOpNode::dotName() const {
         return stringbuilder() << "OP: " << DepGraphNode::escapeDot(this->name, 0) << " (" << this->origLineno << ")" <<
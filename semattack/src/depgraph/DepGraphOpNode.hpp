@@ -28,12 +28,51 @@
 
 class DepGraphOpNode: public DepGraphNode {
 public:
-	DepGraphOpNode(std::string filename, int origLineno, int id, int order, int sccID, std::string opname, bool builtin) : DepGraphNode(filename, origLineno, id, order, sccID), name(opname), builtin(builtin){};
+	// The function models of the image computers. The op name is resolved
+	// once when the node is created, see resolveOpCode.
+	enum OpCode {
+		Unmodeled,
+		VlabRestrict,
+		Concat,
+		Replace,
+		ReplaceOnce,
+		RegexMatch,
+		Split,
+		Substr,
+		AddSlashes,
+		StripSlashes,
+		MysqlEscapeString,
+		MysqlRealEscapeString,
+		HtmlSpecialChars,
+		Nl2br,
+		ToUpperCase,
+		ToLowerCase,
+		Trim,
+		RTrim,
+		LTrim,
+		Md5,
+		EncodeURIComponent,
+		DecodeURIComponent,
+		EncodeURI,
+		DecodeURI,
+		Escape,
+		Unescape,
+		JsonStringify,
+		JsonParse,
+		EncodeTextFragment,
+		EncodeAttrString
+	};
+
+	DepGraphOpNode(std::string filename, int origLineno, int id, int order, int sccID, std::string opname, bool builtin) : DepGraphNode(filename, origLineno, id, order, sccID), name(opname), builtin(builtin){ kind = Op; code = resolveOpCode(name); };
 	DepGraphOpNode(const DepGraphOpNode& other)
-			: DepGraphNode(other), name(other.name), builtin(other.builtin) {	};
+			: DepGraphNode(other), name(other.name), builtin(other.builtin), code(other.code) {	};
 	virtual ~DepGraphOpNode();
+	// The model for a function name, new models are registered here
+	static OpCode resolveOpCode(const std::string& name);
 	std::string dotNameShortest() const;
-	std::string getName() const {return this->name;};
+	const std::string& getName() const {return this->name;};
+	OpCode getOpCode() const { return this->code; };
+	bool isModeled() const { return this->code != Unmodeled; };
 	bool isBuiltin() const {return this->builtin;};
 	bool equals (const DepGraphNode* compX) const;
 	std::string dotName() const;
@@ -44,6 +83,7 @@ public:
 private:
     std::string name;
 	bool builtin;    // builtin function?
+	OpCode code;
 
 };
 
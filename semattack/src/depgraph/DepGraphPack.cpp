@@ -0,0 +1,356 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * DepGraphPack.cpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+
+#include "DepGraphPack.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+    const char PACK_MAGIC[8] = {'D', 'G', 'P', 'A', 'C', 'K', '\r', '\n'};
+    const std::uint32_t PACK_VERSION = 1;
+    const std::uint32_t PACK_BYTE_ORDER = 0x01020304;
+
+    struct PackHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint64_t count;
+        std::uint64_t names_offset;
+        std::uint64_t index_offset;
+        // Size of the whole pack, 0 until the writer has finished
+        std::uint64_t size;
+    };
+
+    std::uint64_t fnv1a(const char* data, std::size_t length) {
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (std::size_t i = 0; i < length; i++) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    void append(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void appendString(std::string& out, const std::string& s) {
+        append<std::uint32_t>(out, static_cast<std::uint32_t>(s.size()));
+        out.append(s);
+    }
+
+    // Reads from a record, throws if the record is too short
+    class RecordReader {
+    public:
+        RecordReader(const char* data, std::size_t length) : m_pos(data), m_end(data + length) {}
+
+        bool done() const { return m_pos == m_end; }
+
+        template <typename T>
+        T read() {
+            T value;
+            need(sizeof(T));
+            std::memcpy(&value, m_pos, sizeof(T));
+            m_pos += sizeof(T);
+            return value;
+        }
+
+        std::string readString() {
+            std::uint32_t length = read<std::uint32_t>();
+            need(length);
+            std::string s(m_pos, length);
+            m_pos += length;
+            return s;
+        }
+
+    private:
+        void need(std::size_t n) const {
+            if (static_cast<std::size_t>(m_end - m_pos) < n) {
+                throw std::invalid_argument("error reading depgraph pack: truncated record");
+            }
+        }
+
+        const char* m_pos;
+        const char* m_end;
+    };
+
+    void readToken(RecordReader& reader, DotToken& token) {
+        std::uint8_t type = reader.read<std::uint8_t>();
+        if (type > DotToken::Metadata) {
+            throw std::invalid_argument("error reading depgraph pack: invalid token type");
+        }
+        token.type = static_cast<DotToken::Type>(type);
+        token.id = reader.read<std::int32_t>();
+        token.target = reader.read<std::int32_t>();
+        token.shape = reader.readString();
+        token.value = reader.readString();
+    }
+
+}
+
+struct DepGraphPack::IndexEntry {
+    // Relative to the names
+    std::uint64_t name_offset;
+    std::uint32_t name_length;
+    std::int32_t sanitizer_hash;
+    std::uint64_t hash;
+    // Relative to the records
+    std::uint64_t record_offset;
+    std::uint64_t record_length;
+};
+
+DepGraphPack::DepGraphPack(const std::string& fname)
+    : m_data(nullptr)
+    , m_size(0)
+    , m_count(0)
+    , m_index(nullptr)
+    , m_names(nullptr)
+    , m_records(nullptr)
+{
+    static_assert(sizeof(IndexEntry) == 40, "index entries are read in place");
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("can not open depgraph pack " + fname);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(PackHeader))) {
+        close(fd);
+        throw std::invalid_argument("error reading depgraph pack: " + fname + " is too short");
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+    void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("can not map depgraph pack " + fname);
+    }
+    m_data = static_cast<const char*>(mapped);
+
+    PackHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+    if (std::memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0
+        || header.version != PACK_VERSION
+        || header.byte_order != PACK_BYTE_ORDER
+        || header.size != m_size
+        || header.names_offset < sizeof(PackHeader)
+        || header.names_offset > header.index_offset
+        || header.index_offset % sizeof(std::uint64_t) != 0
+        || header.index_offset > m_size
+        || header.count > (m_size - header.index_offset) / sizeof(IndexEntry)) {
+        munmap(mapped, m_size);
+        throw std::invalid_argument("error reading depgraph pack: " + fname + " is not a valid pack");
+    }
+    m_count = header.count;
+    m_records = m_data + sizeof(PackHeader);
+    m_names = m_data + header.names_offset;
+    m_index = m_data + header.index_offset;
+}
+
+DepGraphPack::~DepGraphPack()
+{
+    munmap(const_cast<char*>(m_data), m_size);
+}
+
+bool DepGraphPack::isPack(const std::string& fname)
+{
+    std::ifstream in(fname, std::ios::binary);
+    char magic[sizeof(PACK_MAGIC)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0;
+}
+
+const DepGraphPack::IndexEntry& DepGraphPack::getEntry(std::size_t i) const
+{
+    if (i >= m_count) {
+        throw std::out_of_range("depgraph pack index out of range");
+    }
+    const IndexEntry& entry = reinterpret_cast<const IndexEntry*>(m_index)[i];
+    std::size_t namesSize = m_index - m_names;
+    std::size_t recordsSize = m_names - m_records;
+    if (entry.name_offset > namesSize || entry.name_length > namesSize - entry.name_offset
+        || entry.record_offset > recordsSize || entry.record_length > recordsSize - entry.record_offset) {
+        throw std::invalid_argument("error reading depgraph pack: invalid index entry");
+    }
+    return entry;
+}
+
+std::string DepGraphPack::getName(std::size_t i) const
+{
+    const IndexEntry& entry = getEntry(i);
+    return std::string(m_names + entry.name_offset, entry.name_length);
+}
+
+int DepGraphPack::getSanitizerHash(std::size_t i) const
+{
+    return getEntry(i).sanitizer_hash;
+}
+
+std::uint64_t DepGraphPack::getHash(std::size_t i) const
+{
+    return getEntry(i).hash;
+}
+
+DepGraph DepGraphPack::getGraph(std::size_t i) const
+{
+    std::vector<DotToken> tokens;
+    readTokens(i, tokens);
+    return DepGraph::parseTokens(tokens);
+}
+
+bool DepGraphPack::getMetadata(std::size_t i, Metadata& metadata) const
+{
+    // Like the header of a dot file, the metadata tokens come first, the
+    // rest of the record is neither decoded nor checked
+    const IndexEntry& entry = getEntry(i);
+    RecordReader reader(m_records + entry.record_offset, entry.record_length);
+    bool hasSanitizerHash = false;
+    DotToken token;
+    while (!reader.done()) {
+        readToken(reader, token);
+        if (token.type != DotToken::Metadata) {
+            break;
+        }
+        metadata.set_field(token.shape, token.value);
+        hasSanitizerHash |= token.shape == "DepGraph.sanitizer_hash";
+    }
+    return hasSanitizerHash;
+}
+
+void DepGraphPack::readTokens(std::size_t i, std::vector<DotToken>& tokens) const
+{
+    const IndexEntry& entry = getEntry(i);
+    const char* record = m_records + entry.record_offset;
+    if (fnv1a(record, entry.record_length) != entry.hash) {
+        throw std::invalid_argument("error reading depgraph pack: checksum mismatch for " + getName(i));
+    }
+
+    RecordReader reader(record, entry.record_length);
+    while (!reader.done()) {
+        DotToken token;
+        readToken(reader, token);
+        tokens.push_back(std::move(token));
+    }
+}
+
+DepGraphPackWriter::DepGraphPackWriter(const std::string& fname)
+    : m_out(fname, std::ios::binary | std::ios::trunc)
+    , m_fname(fname)
+    , m_records_size(0)
+    , m_entries()
+    , m_finished(false)
+{
+    if (!m_out) {
+        throw std::runtime_error("can not create depgraph pack " + fname);
+    }
+    // The header is written again by finish
+    PackHeader header;
+    std::memset(&header, 0, sizeof(header));
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+DepGraphPackWriter::~DepGraphPackWriter()
+{
+    if (!m_finished) {
+        try {
+            finish();
+        } catch (...) {
+        }
+    }
+}
+
+void DepGraphPackWriter::add(const std::string& name, std::istream& dot)
+{
+    std::vector<DotToken> tokens;
+    DepGraph::tokenizeStream(dot, tokens);
+    // Only graphs which can be built are packed
+    DepGraph graph = DepGraph::parseTokens(tokens);
+
+    std::string record;
+    for (const auto& token : tokens) {
+        append<std::uint8_t>(record, static_cast<std::uint8_t>(token.type));
+        append<std::int32_t>(record, token.id);
+        append<std::int32_t>(record, token.target);
+        appendString(record, token.shape);
+        appendString(record, token.value);
+    }
+    m_out.write(record.data(), record.size());
+
+    Entry entry;
+    entry.name = name;
+    entry.sanitizer_hash = graph.get_metadata().get_sanitizer_hash();
+    entry.hash = fnv1a(record.data(), record.size());
+    entry.offset = m_records_size;
+    entry.length = record.size();
+    m_entries.push_back(entry);
+    m_records_size += record.size();
+}
+
+void DepGraphPackWriter::finish()
+{
+    m_finished = true;
+    PackHeader header;
+    std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = PACK_VERSION;
+    header.byte_order = PACK_BYTE_ORDER;
+    header.count = m_entries.size();
+    header.names_offset = sizeof(PackHeader) + m_records_size;
+
+    std::uint64_t names_size = 0;
+    for (const auto& entry : m_entries) {
+        m_out.write(entry.name.data(), entry.name.size());
+        names_size += entry.name.size();
+    }
+    // The index is read in place
+    std::uint64_t padding = (sizeof(std::uint64_t) - (header.names_offset + names_size) % sizeof(std::uint64_t)) % sizeof(std::uint64_t);
+    m_out.write("\0\0\0\0\0\0\0", padding);
+    header.index_offset = header.names_offset + names_size + padding;
+
+    std::uint64_t name_offset = 0;
+    for (const auto& entry : m_entries) {
+        std::string index;
+        append<std::uint64_t>(index, name_offset);
+        append<std::uint32_t>(index, static_cast<std::uint32_t>(entry.name.size()));
+        append<std::int32_t>(index, entry.sanitizer_hash);
+        append<std::uint64_t>(index, entry.hash);
+        append<std::uint64_t>(index, entry.offset);
+        append<std::uint64_t>(index, entry.length);
+        m_out.write(index.data(), index.size());
+        name_offset += entry.name.size();
+    }
+    header.size = static_cast<std::uint64_t>(m_out.tellp());
+
+    m_out.seekp(0);
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_out.close();
+    if (!m_out) {
+        throw std::runtime_error("error writing depgraph pack " + m_fname);
+    }
+}
@@ -0,0 +1,109 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * DepGraphPack.hpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+
+#ifndef SEMREP_DEPGRAPHPACK_HPP
+#define SEMREP_DEPGRAPHPACK_HPP
+
+#include "DepGraph.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// A corpus of depgraph dot files in a single file, so a large corpus can be
+// opened without touching every file.
+//
+// The pack starts with a header, followed by the records, the names and the
+// index. A record holds the DotTokens of one dot file, the index entry of a
+// graph its name, sanitizer hash, record hash and the record position. The
+// file is mapped into memory and only the records of the requested graphs
+// are read.
+class DepGraphPack {
+public:
+    explicit DepGraphPack(const std::string& fname);
+    ~DepGraphPack();
+
+    // True if the file starts with the pack header
+    static bool isPack(const std::string& fname);
+
+    std::size_t size() const { return m_count; }
+    std::string getName(std::size_t i) const;
+    // Taken from the index, 0 if the graph has none
+    int getSanitizerHash(std::size_t i) const;
+    // Hash of the tokens of the graph
+    std::uint64_t getHash(std::size_t i) const;
+    DepGraph getGraph(std::size_t i) const;
+    // Reads only the metadata at the start of the record, returns true if it
+    // contains the sanitizer hash
+    bool getMetadata(std::size_t i, Metadata& metadata) const;
+
+private:
+    DepGraphPack(const DepGraphPack&) = delete;
+    DepGraphPack& operator=(const DepGraphPack&) = delete;
+
+    struct IndexEntry;
+    const IndexEntry& getEntry(std::size_t i) const;
+    void readTokens(std::size_t i, std::vector<DotToken>& tokens) const;
+
+    const char* m_data;
+    std::size_t m_size;
+    std::size_t m_count;
+    const char* m_index;
+    const char* m_names;
+    const char* m_records;
+};
+
+// Writes a DepGraphPack, graphs are added one after the other
+class DepGraphPackWriter {
+public:
+    explicit DepGraphPackWriter(const std::string& fname);
+    ~DepGraphPackWriter();
+
+    // Adds the dot file, throws if it can not be parsed
+    void add(const std::string& name, std::istream& dot);
+    // Writes names and index, must be called once all graphs are added
+    void finish();
+
+    std::size_t size() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        std::string name;
+        int sanitizer_hash;
+        std::uint64_t hash;
+        std::uint64_t offset;
+        std::uint64_t length;
+    };
+
+    std::ofstream m_out;
+    std::string m_fname;
+    std::uint64_t m_records_size;
+    std::vector<Entry> m_entries;
+    bool m_finished;
+};
+
+#endif //SEMREP_DEPGRAPHPACK_HPP
@@ -24,8 +24,7 @@
 #include "DepGraphSccNode.hpp"
 
 DepGraphSccNode::DepGraphSccNode() {
-	// TODO Auto-generated constructor stub
-
+	kind = Scc;
 }
 
 DepGraphSccNode::~DepGraphSccNode() {
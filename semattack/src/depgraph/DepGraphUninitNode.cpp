@@ -24,8 +24,7 @@
 #include "DepGraphUninitNode.hpp"
 
 DepGraphUninitNode::DepGraphUninitNode() {
-	// TODO Auto-generated constructor stub
-
+	kind = Uninit;
 }
 
 DepGraphUninitNode::~DepGraphUninitNode() {
@@ -29,7 +29,7 @@
 class DepGraphUninitNode: public DepGraphNode {
 public:
     DepGraphUninitNode();
-	DepGraphUninitNode(int id, int order, int sccID) : DepGraphNode("", -1, id, order, sccID){ };
+	DepGraphUninitNode(int id, int order, int sccID) : DepGraphNode("", -1, id, order, sccID){ kind = Uninit; };
 	DepGraphUninitNode(const DepGraphUninitNode& other)
 			:  DepGraphNode(other) {	};
 	virtual ~DepGraphUninitNode();
@@ -0,0 +1,110 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/*
+ * depgraph_pack.cpp
+ *
+ * Copyright (C) 2022 SAP SE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include "depgraph/DepGraphPack.hpp"
+
+using namespace std;
+using namespace boost;
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+
+// Packs all dot files below target, names are the paths multiattack would
+// use for the files, so the output directories stay the same
+void make_pack(const string& target, const string& output_file) {
+  vector<fs::path> paths;
+  fs::path root(target);
+  if (fs::is_directory(root)) {
+    for (auto const & entry : fs::recursive_directory_iterator(root)) {
+      if (fs::is_regular_file(entry) && entry.path().extension() == ".dot") {
+        paths.emplace_back(entry.path());
+      }
+    }
+  } else if (root.extension() == ".dot") {
+    paths.emplace_back(root);
+  }
+  cout << "Found " << paths.size() << " dependency graph files." << endl;
+
+  DepGraphPackWriter writer(output_file);
+  for (const auto& path : paths) {
+    try {
+      ifstream in(path.string());
+      writer.add(path.string(), in);
+    } catch(std::exception& e) {
+      cerr << "Error parsing " << path.string() << ": " << e.what() << "\n";
+    }
+    if ((writer.size() % 10000) == 0) {
+      cout << "Packed " << writer.size() << " dependency graphs." << endl;
+    }
+  }
+  writer.finish();
+  cout << "Packed " << writer.size() << " dependency graphs into " << output_file << endl;
+}
+
+void usage() {
+    cout << "Usage: depgraph-pack <target> <output>\n";
+}
+
+int main(int argc, char *argv[]) {
+    try {
+
+        po::options_description desc("Allowed options");
+        desc.add_options()
+          ("help", "produce help message")
+          ("target,t", po::value<string>()->required(), "Path to dependency graph file or directory.")
+          ("output,o", po::value<string>()->required(), "Path to the pack file to write.");
+
+        po::positional_options_description p;
+        p.add("target", 1);
+        p.add("output", 1);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).
+                  options(desc).positional(p).run(), vm);
+
+        if (vm.count("help"))
+        {
+            usage();
+            cout << desc << "\n";
+            return 0;
+        }
+
+        po::notify(vm);
+
+        make_pack(vm["target"].as<string>(), vm["output"].as<string>());
+
+    } catch(std::exception& e) {
+           cerr << "Error: " << e.what() << "\n";
+           exit(EXIT_FAILURE);
+    }
+    catch(...)
+    {
+        cerr << "Unknown error!" << "\n";
+        return false;
+    }
+
+}
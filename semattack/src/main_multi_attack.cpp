@@ -37,7 +37,9 @@ namespace po = boost::program_options;
 
 void call_sem_attack(const string& target_name, const string& output_dir, const string& field_name, int max,
                      bool concats, bool singleton_intersection, bool preImage, bool encode, bool payload,
-                     bool attackPatterns, bool attack_forward, bool dotfiles)
+                     bool attackPatterns, bool attack_forward, bool dotfiles, bool example_only, bool intern, bool shared_bdd,
+                     int lazy_minimization, int memo_entries, int subtree_entries, const string& store_dir, ResultFormat format,
+                     const string& manifest, int read_ahead)
 {
     try {
         cout << endl << "\t------ Starting Analysis for: " << field_name << " ------" << endl;
@@ -59,6 +61,16 @@ void call_sem_attack(const string& target_name, const string& output_dir, const
         attack.setPayloadAnalysis(payload);
         attack.setDoForwardAnalysisWithAttackPattern(attack_forward);
         attack.setDotFiles(dotfiles);
+        attack.setExampleOnly(example_only);
+        attack.setInterning(intern);
+        attack.setSharedBddStore(shared_bdd);
+        attack.setLazyMinimization(lazy_minimization);
+        attack.setFunctionModelCache(memo_entries);
+        attack.setSubtreeCache(subtree_entries);
+        attack.setForwardImageStore(store_dir);
+        attack.setResultFormat(format);
+        attack.setManifest(manifest);
+        attack.setReadAhead(read_ahead);
 
         if (attackPatterns) {
           attack.addAttackPattern(AttackContext::LessThan);
@@ -121,7 +133,7 @@ int main(int argc, char *argv[]) {
         desc.add_options()
           ("help",         "produce help message")
           ("verbose,v",    po::value<string>()->implicit_value("0"), "verbosity level")
-          ("target,t",     po::value<string>()->required(), "Path to dependency graph file for target function.")
+          ("target,t",     po::value<string>()->required(), "Path to dependency graph file or directory, a tar archive of dot files, or a pack written by depgraph-pack. Files ending in .gz or .zst (if built with zstd support) are decompressed.")
           ("output,o",     po::value<string>()->required(), "Path to output directory.")
           ("fieldname,f",  po::value<string>()->required(), "Name of the input field for which sanitization code needs to be repaired.")
           ("concat,c",     po::value<bool>()->default_value(false), "Compute concat operations")
@@ -132,7 +144,17 @@ int main(int argc, char *argv[]) {
           ("payload,y",    po::value<bool>()->default_value(true), "Use payload string attack patterns")
           ("attack,a",     po::value<bool>()->default_value(true), "Use fixed attack patterns")
           ("attackfw,k",   po::value<bool>()->default_value(false), "Do forward analysis with attack pattern if there is no intersection with post image")
-          ("dotfiles,d",   po::value<bool>()->default_value(true), "Output all dot output files to disk");
+          ("dotfiles,d",   po::value<bool>()->default_value(true), "Output all dot output files to disk")
+          ("example,x",    po::value<bool>()->default_value(false), "Only compute a single example input instead of the full pre-image")
+          ("intern,i",     po::value<bool>()->default_value(false), "Keep the forward results in a run wide store, sharing one DFA between all automata with the same structure")
+          ("sharedbdd,g",  po::value<bool>()->default_value(false), "Compute products in a BDD node store shared by all automata of a thread")
+          ("lazymin,l",    po::value<int>()->default_value(0), "Only minimize intersections and unions above this number of states before they are used (0 minimizes all results)")
+          ("memo,m",       po::value<int>()->default_value(0), "Remember up to this many function model results keyed by their input language (0 switches it off)")
+          ("subtree,r",    po::value<int>()->default_value(0), "Share up to this many forward images of sanitizer sub-graph nodes between all depgraphs (0 switches it off)")
+          ("store,u",      po::value<string>()->default_value(""), "Directory to keep forward analysis results in, keyed by sanitizer hash, so re-runs skip the forward analysis")
+          ("format,q",     po::value<string>()->default_value("dot"), "Format of the automata in the output directory: dot, binary or both")
+          ("manifest,j",   po::value<string>()->default_value(""), "File listing the dot files to analyse, one per line relative to the target directory, instead of searching it")
+          ("readahead,z",  po::value<int>()->default_value(0), "Read dot files on a loader thread (io_uring where available) with this many reads in flight (0 reads them on the analysis threads)");
 
         po::positional_options_description p;
         p.add("target", 1);
@@ -151,6 +173,15 @@ int main(int argc, char *argv[]) {
 
         po::notify(vm);
 
+        ResultFormat format = ResultFormat::Dot;
+        if (vm["format"].as<string>() == "binary") {
+          format = ResultFormat::Binary;
+        } else if (vm["format"].as<string>() == "both") {
+          format = ResultFormat::Both;
+        } else if (vm["format"].as<string>() != "dot") {
+          throw po::validation_error(po::validation_error::invalid_option_value, "format", vm["format"].as<string>());
+        }
+
         if (vm.count("target") && vm.count("fieldname")) {
           cout << boolalpha
                << "Calling multiattack with target: " << vm["target"].as<string>()
@@ -164,6 +195,16 @@ int main(int argc, char *argv[]) {
                << ", Fixed attack patterns: " << vm["payload"].as<bool>()
                << ", Do forward analysis with attack pattern if there is no intersection with post image: " << vm["attackfw"].as<bool>()
                << ", Output dot files: " << vm["dotfiles"].as<bool>()
+               << ", Example only pre-image: " << vm["example"].as<bool>()
+               << ", Intern automata: " << vm["intern"].as<bool>()
+               << ", Shared BDD store: " << vm["sharedbdd"].as<bool>()
+               << ", Lazy minimization threshold: " << vm["lazymin"].as<int>()
+               << ", Function model memo entries: " << vm["memo"].as<int>()
+               << ", Subtree cache entries: " << vm["subtree"].as<int>()
+               << ", Forward image store: " << vm["store"].as<string>()
+               << ", Result format: " << vm["format"].as<string>()
+               << ", Manifest: " << vm["manifest"].as<string>()
+               << ", Read ahead: " << vm["readahead"].as<int>()
                << "\n";
 
             call_sem_attack(vm["target"].as<string>(),
@@ -177,7 +218,17 @@ int main(int argc, char *argv[]) {
                             vm["payload"].as<bool>(),
                             vm["attack"].as<bool>(),
                             vm["attackfw"].as<bool>(),
-                            vm["dotfiles"].as<bool>()
+                            vm["dotfiles"].as<bool>(),
+                            vm["example"].as<bool>(),
+                            vm["intern"].as<bool>(),
+                            vm["sharedbdd"].as<bool>(),
+                            vm["lazymin"].as<int>(),
+                            vm["memo"].as<int>(),
+                            vm["subtree"].as<int>(),
+                            vm["store"].as<string>(),
+                            format,
+                            vm["manifest"].as<string>(),
+                            vm["readahead"].as<int>()
               );
         }
         else {
@@ -0,0 +1,91 @@
+#!/bin/bash
+
+# Runs multiattack on the depgraphs in formats/ in every input and output
+# format and compares the summary with the one of the plain dot files.
+#
+# Usage: check_formats.sh [path to multiattack]
+
+TEST_DIR=$(cd "$(dirname "$0")" && pwd)
+MULTIATTACK=${1:-${TEST_DIR}/../src/multiattack}
+FORMATS=${TEST_DIR}/formats
+WORK=$(mktemp -d)
+trap 'rm -rf "${WORK}"' EXIT
+FAILED=0
+
+# run <name> <multiattack options>
+run() {
+    local name=$1
+    shift
+    if ! "${MULTIATTACK}" --fieldname x --output "${WORK}/${name}" "$@" > "${WORK}/${name}.log" 2>&1; then
+        echo "FAIL ${name}: multiattack failed"
+        tail -n 20 "${WORK}/${name}.log"
+        FAILED=1
+        return 1
+    fi
+}
+
+# run_zstd <name> <multiattack options>, skipped if built without zstd support
+run_zstd() {
+    run "$@" || return 1
+    if grep -q "without zstd support" "${WORK}/$1.log"; then
+        echo "SKIP $1: built without zstd support"
+        return 1
+    fi
+}
+
+# compare <name> [<baseline>], with the summary of the plain dot files by default
+compare() {
+    if diff "${WORK}/${2:-dot}/semattack_summary.csv" "${WORK}/$1/semattack_summary.csv" > "${WORK}/$1.diff"; then
+        echo "OK   $1"
+    else
+        echo "FAIL $1: summary differs"
+        cat "${WORK}/$1.diff"
+        FAILED=1
+    fi
+}
+
+# check_binary <name> <directory>, all binary automata start with the magic
+check_binary() {
+    local count=0
+    local file
+    while read -r file; do
+        if [ "$(head -c 6 "${file}")" != "STRDFA" ]; then
+            echo "FAIL $1: ${file} is no binary automaton"
+            FAILED=1
+            return
+        fi
+        count=$((count + 1))
+    done < <(find "$2" -name '*.sdfa')
+    if [ ${count} -eq 0 ]; then
+        echo "FAIL $1: no binary automata written"
+        FAILED=1
+    else
+        echo "OK   $1 (${count} automata)"
+    fi
+}
+
+if [ ! -x "${MULTIATTACK}" ]; then
+    echo "multiattack not found at ${MULTIATTACK}"
+    exit 1
+fi
+
+run dot --target "${FORMATS}/depgraphs" --dotfiles false || exit 1
+
+# Binary automata, written as results and read back from the forward image store
+run binary --target "${FORMATS}/depgraphs" --format binary && compare binary && check_binary binary "${WORK}/binary"
+run store_save --target "${FORMATS}/depgraphs" --dotfiles false --store "${WORK}/store" && check_binary store_save "${WORK}/store"
+run store_load --target "${FORMATS}/depgraphs" --dotfiles false --store "${WORK}/store" && compare store_load
+
+# Depgraph pack, written by depgraph-pack from formats/depgraphs
+run pack --target "${FORMATS}/depgraphs.dgpack" --dotfiles false && compare pack
+
+# Tar archives of formats/depgraphs and compressed dot files
+run tar --target "${FORMATS}/depgraphs.tar" --dotfiles false && compare tar
+run tar_gz --target "${FORMATS}/depgraphs.tar.gz" --dotfiles false && compare tar_gz
+run_zstd tar_zst --target "${FORMATS}/depgraphs.tar.zst" --dotfiles false && compare tar_zst
+run dot_31 --target "${FORMATS}/depgraphs/finding_31.dot" --dotfiles false
+run dot_gz --target "${FORMATS}/finding_31.dot.gz" --dotfiles false && compare dot_gz dot_31
+run dot_550 --target "${FORMATS}/depgraphs/finding_550.dot" --dotfiles false
+run_zstd dot_zst --target "${FORMATS}/finding_550.dot.zst" --dotfiles false && compare dot_zst dot_550
+
+exit ${FAILED}
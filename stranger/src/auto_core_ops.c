@@ -985,12 +985,19 @@ DFA *dfa_union_empty_M(DFA *M, int var, int *indices) {
   return result;
 }
 
+// Uses the shared BDD node store of the calling thread if it is switched on
+static DFA *dfa_product(DFA *M1, DFA *M2, dfaProductType ff) {
+  if (bddStoreIsEnabled())
+    return dfaProductShared(M1, M2, ff);
+  return dfaProduct(M1, M2, ff);
+}
+
 // DO NOT USE. Does not handle empty string correctly.
 // use dfa_union_with_emptycheck instead
 DFA *dfa_union(M1, M2)
 DFA *M1;DFA *M2; {
   DFA *result, *tmp;
-  result = dfaProduct(M1, M2, dfaOR);
+  result = dfa_product(M1, M2, dfaOR);
     tmp = dfaMinimize(result);
     dfaFree(result);
     return tmp;
@@ -1002,7 +1009,7 @@ DFA *M1;DFA *M2; {
  * regardless.
  */
 DFA *dfa_union_with_emptycheck(DFA* M1, DFA* M2, int var, int* indices){
-  DFA* tmpM = dfaProduct(M1, M2, dfaOR);
+  DFA* tmpM = dfa_product(M1, M2, dfaOR);
   if( DEBUG_SIZE_INFO )
     printf("\t peak : union : states %d : bddnodes %u \n", tmpM->ns, bdd_size(tmpM->bddm) );
   DFA *result = dfaMinimize(tmpM);
@@ -1018,7 +1025,7 @@ DFA *dfa_union_with_emptycheck(DFA* M1, DFA* M2, int var, int* indices){
 DFA *dfa_product_impl(M1, M2)
   DFA *M1;DFA *M2; {
   DFA *result, *tmpM;
-  tmpM = dfaProduct(M1, M2, dfaIMPL);
+  tmpM = dfa_product(M1, M2, dfaIMPL);
   if( DEBUG_SIZE_INFO )
     printf("\t peak : intersect : states %d : bddnodes %u \n", tmpM->ns, bdd_size(tmpM->bddm) );
   result = dfaMinimize(tmpM);
@@ -1029,7 +1036,7 @@ DFA *dfa_product_impl(M1, M2)
 DFA *dfa_intersect(M1, M2)
   DFA *M1;DFA *M2; {
   DFA *result, *tmpM;
-  tmpM = dfaProduct(M1, M2, dfaAND);
+  tmpM = dfa_product(M1, M2, dfaAND);
   if( DEBUG_SIZE_INFO )
     printf("\t peak : intersect : states %d : bddnodes %u \n", tmpM->ns, bdd_size(tmpM->bddm) );
   result = dfaMinimize(tmpM);
@@ -1037,13 +1044,39 @@ DFA *dfa_intersect(M1, M2)
   return result;
 }
 
+// Minimizes the product M only if it grew past max_states
+static DFA *minimize_above(DFA *M, int max_states, int *minimized) {
+  DFA *result;
+  if (M->ns <= max_states) {
+    *minimized = 0;
+    return M;
+  }
+  result = dfaMinimize(M);
+  dfaFree(M);
+  *minimized = 1;
+  return result;
+}
+
+DFA *dfa_intersect_lazy(DFA *M1, DFA *M2, int max_states, int *minimized) {
+  return minimize_above(dfa_product(M1, M2, dfaAND), max_states, minimized);
+}
+
+DFA *dfa_union_lazy(DFA *M1, DFA *M2, int max_states, int *minimized, int var, int *indices) {
+  // adding the empty string needs a minimal automaton
+  if (checkEmptyString(M1) || checkEmptyString(M2)) {
+    *minimized = 1;
+    return dfa_union_with_emptycheck(M1, M2, var, indices);
+  }
+  return minimize_above(dfa_product(M1, M2, dfaOR), max_states, minimized);
+}
+
 DFA *dfa_negate(M1, var, indices)
   DFA *M1;int var;int *indices; {
   DFA *result, *tmpM3;
   DFA *tmpM1 = dfaAllStringASCIIExceptReserveWords(var, indices);
   DFA *tmpM2 = dfaCopy(M1);
   dfaNegation(tmpM2);
-  tmpM3 = dfaProduct(tmpM1, tmpM2, dfaAND);
+  tmpM3 = dfa_product(tmpM1, tmpM2, dfaAND);
   dfaFree(tmpM1);
   dfaFree(tmpM2);
   if( DEBUG_SIZE_INFO )
@@ -1610,6 +1643,178 @@ DFA *dfa_concat_extrabit(M1, M2, var, indices)
     }
     return tmp1;
   }
+// Transitions of one state collected for dfaStoreException
+typedef struct {
+  char *exeps;
+  int *to_states;
+  int count, allocated, len;
+} ConcatPaths;
+
+// Adds the paths of p which do not go to sink. to_offset is the first state
+// of the target automaton in the result, its sink is left out if
+// drop_sink is set.
+static void concat_add_paths(ConcatPaths *cp, bdd_manager *bddm, bdd_ptr p, int sink,
+                             int to_offset, int drop_sink, char extrabit, int var, int *indices) {
+  paths state_paths, pp;
+  trace_descr tp;
+  int j;
+  char *exep;
+
+  state_paths = pp = make_paths(bddm, p);
+  while (pp) {
+    if (pp->to != sink) {
+      if (cp->count == cp->allocated) {
+        cp->allocated *= 2;
+        cp->exeps = (char *) realloc(cp->exeps, cp->allocated * (cp->len + 1) * sizeof(char));
+        cp->to_states = (int *) realloc(cp->to_states, cp->allocated * sizeof(int));
+      }
+      cp->to_states[cp->count] = to_offset + pp->to - ((drop_sink && (int) pp->to > sink) ? 1 : 0);
+      exep = cp->exeps + cp->count * (cp->len + 1);
+      for (j = 0; j < var; j++) {
+        for (tp = pp->trace; tp && (tp->index != indices[j]); tp = tp->next);
+        if (tp)
+          exep[j] = tp->value ? '1' : '0';
+        else
+          exep[j] = 'X';
+      }
+      exep[var] = extrabit;
+      exep[cp->len] = '\0';
+      cp->count++;
+    }
+    pp = pp->next;
+  }
+  kill_paths(state_paths);
+}
+
+/*
+ * Generalizes dfa_concat_extrabit to M[0]M[1]...M[n-1] with a single
+ * projection. M[1] to M[n-1] must not accept the empty string, accepting
+ * states of M[k] jump to M[k+1] on the extra bit only.
+ */
+static DFA *dfa_concat_chain_extrabit(DFA **M, int n, int var, int *indices) {
+  DFA *result, *tmpM;
+  DFABuilder *b;
+  ConcatPaths cp;
+  char *statuces;
+  int *offsets, *sinks;
+  int i, k, loc, newns;
+  int len = var + 1; //one extra bit
+
+  offsets = (int *) malloc(n * sizeof(int));
+  sinks = (int *) malloc(n * sizeof(int));
+  // sinks of M[1..n-1] are merged into the sink of M[0]
+  newns = 0;
+  for (k = 0; k < n; k++) {
+    sinks[k] = find_sink(M[k]);
+    assert(sinks[k] > -1);
+    offsets[k] = newns;
+    newns += (k == 0) ? M[k]->ns : M[k]->ns - 1;
+  }
+
+  cp.len = len;
+  cp.allocated = 64;
+  cp.exeps = (char *) malloc(cp.allocated * (len + 1) * sizeof(char));
+  cp.to_states = (int *) malloc(cp.allocated * sizeof(int));
+  statuces = (char *) malloc((newns + 1) * sizeof(char));
+
+  b = dfaSetup(newns, len, indices);
+  for (k = 0; k < n; k++) {
+    for (i = 0; i < M[k]->ns; i++) {
+      if (k > 0 && i == sinks[k])
+        continue;
+      cp.count = 0;
+      concat_add_paths(&cp, M[k]->bddm, M[k]->q[i], sinks[k], offsets[k], k > 0, '0', var, indices);
+      if (k < n - 1 && M[k]->f[i] == 1)
+        concat_add_paths(&cp, M[k + 1]->bddm, M[k + 1]->q[M[k + 1]->s], sinks[k + 1],
+                         offsets[k + 1], 1, '1', var, indices);
+      dfaAllocExceptions(b, cp.count);
+      for (cp.count--; cp.count >= 0; cp.count--)
+        dfaStoreException(b, cp.to_states[cp.count], cp.exeps + cp.count * (len + 1));
+      dfaStoreState(b, sinks[0]);
+
+      loc = offsets[k] + i - ((k > 0 && i > sinks[k]) ? 1 : 0);
+      statuces[loc] = (k == n - 1 && M[k]->f[i] == 1) ? '+' : '-';
+    }
+  }
+  statuces[newns] = '\0';
+  tmpM = dfaBuild(b, statuces);
+  result = dfaMinimize(tmpM);
+  dfaFree(tmpM);
+  tmpM = dfaProject(result, (unsigned) var);
+  dfaFree(result);
+  result = dfaMinimize(tmpM);
+  dfaFree(tmpM);
+
+  free(cp.exeps);
+  free(cp.to_states);
+  free(statuces);
+  free(offsets);
+  free(sinks);
+  return result;
+}
+
+/*
+ * Concatenation of M[0] ... M[n-1]. Runs of operands which do not accept
+ * the empty string are concatenated with a single projection, the others
+ * one by one with dfa_concat.
+ */
+DFA *dfa_concat_all(DFA **M, int n, int var, int *indices) {
+  DFA *result, *tmp;
+  DFA **chain;
+  int i, j, k;
+
+  if (n <= 0 || M[0] == NULL)
+    return NULL;
+  result = dfaCopy(M[0]);
+  chain = (DFA **) malloc(n * sizeof(DFA *));
+  for (i = 1; i < n; i = j) {
+    if (M[i] == NULL) {
+      dfaFree(result);
+      result = NULL;
+      break;
+    }
+    for (j = i; j < n && M[j] != NULL && !checkEmptyString(M[j]); j++);
+    if (j == i) {
+      tmp = dfa_concat(result, M[i], var, indices);
+      j = i + 1;
+    } else {
+      chain[0] = result;
+      for (k = i; k < j; k++)
+        chain[k - i + 1] = M[k];
+      tmp = dfa_concat_chain_extrabit(chain, j - i + 1, var, indices);
+    }
+    dfaFree(result);
+    result = tmp;
+    if (result == NULL)
+      break;
+  }
+  free(chain);
+  return result;
+}
+
+/*
+ * Union of M[0] ... M[n-1] with a single n-ary product and minimization.
+ */
+DFA *dfa_union_all(DFA **M, int n, int var, int *indices) {
+  DFA *result, *tmpM;
+  int i;
+
+  if (n <= 0)
+    return NULL;
+  tmpM = dfaProductAll(M, n, dfaOR);
+  result = dfaMinimize(tmpM);
+  dfaFree(tmpM);
+  for (i = 0; i < n; i++) {
+    if (checkEmptyString(M[i])) {
+      tmpM = dfa_union_empty_M(result, var, indices);
+      dfaFree(result);
+      result = tmpM;
+      break;
+    }
+  }
+  return result;
+}
+
 ////Take Output DFA
 //DFA *dfa_replace(M1, M2, M3, var, indices)
 //  DFA *M1;DFA *M2;DFA *M3;int var;int *indices; {
@@ -3294,8 +3499,8 @@ int check_equivalence(M1, M2, var, indices)
       return 0;
   }
 
-  M[0] = dfaProduct(M1, M2, dfaIMPL);
-  M[1] = dfaProduct(M2, M1, dfaIMPL);
+  M[0] = dfa_product(M1, M2, dfaIMPL);
+  M[1] = dfa_product(M2, M1, dfaIMPL);
   M[2] = dfa_intersect(M[0], M[1]);
   M[3] = dfa_negate(M[2], var, indices);
   result = check_emptiness(M[3], var, indices);
@@ -3519,6 +3724,53 @@ int checkMembership(DFA* M, char* string, int var, int* indices){
   return ((M->f[endState])==1) ? 1 : 0;;
 }
 
+/*
+ * Compiles the transitions of M into a dense table with 256 columns per
+ * state: table[s * 256 + c] is the state reached from s on byte c.
+ * The bits of c are matched against indices[0..var-1] MSB first, the same
+ * layout bintostr uses. BDD variables outside of indices take the low branch.
+ * Used for running many concrete strings against the same automaton without
+ * decoding the BDD for each character. Caller must free the returned table.
+ */
+int *dfaGetDenseTransitionTable(DFA *M, int var, int *indices){
+  int i, j, c, maxIndex, shift;
+  int *table, *position;
+  unsigned index;
+  bdd_ptr node;
+
+  assert(M != NULL);
+
+  maxIndex = 0;
+  for (j = 0; j < var; j++)
+    if (indices[j] > maxIndex)
+      maxIndex = indices[j];
+  position = (int *) malloc((maxIndex + 1) * sizeof(int));
+  for (j = 0; j <= maxIndex; j++)
+    position[j] = -1;
+  for (j = 0; j < var; j++)
+    position[indices[j]] = j;
+
+  table = (int *) malloc((size_t) M->ns * 256 * sizeof(int));
+  for (i = 0; i < M->ns; i++) {
+    for (c = 0; c < 256; c++) {
+      node = M->q[i];
+      while (!bdd_is_leaf(M->bddm, node)) {
+        index = bdd_ifindex(M->bddm, node);
+        shift = (index <= (unsigned) maxIndex && position[index] >= 0) ?
+            var - 1 - position[index] : -1;
+        if (shift >= 0 && shift < 8 && ((c >> shift) & 1))
+          node = bdd_then(M->bddm, node);
+        else
+          node = bdd_else(M->bddm, node);
+      }
+      table[i * 256 + c] = (int) bdd_leaf_value(M->bddm, node);
+    }
+  }
+
+  free(position);
+  return table;
+}
+
 /**
  * Given char ci, fills s with ASCII decimal value of n as a
  * string.
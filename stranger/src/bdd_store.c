@@ -0,0 +1,650 @@
+/*
+ * Stranger
+ * Copyright (C) 2013-2014 University of California Santa Barbara.
+ *
+ * Modifications Copyright SAP SE. 2020-2022.  All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+/*
+ * Per thread, hash-consed store of BDD nodes used to compute products.
+ *
+ * The transition BDDs of both operands are imported into the store of the
+ * calling thread, so equal BDDs of different automata get the same node id.
+ * The product BDD of two nodes is memoized in an apply cache which is kept
+ * across operations, so products with the same operands (e.g. the same
+ * attack pattern or constant) reuse the work of earlier operations. Only the
+ * result is written into the private bdd_manager of the new DFA.
+ *
+ * No node is referenced from outside once an operation has finished, so the
+ * store is collected at the start of an operation when it grew past its
+ * budget.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "stranger.h"
+
+// Node index of imported leaves, lo is the state
+#define STORE_LEAF 0xFFFFFFFFu
+// Node index of product leaves, lo and hi are the states of both operands
+#define STORE_PAIR 0xFFFFFFFEu
+#define NO_NODE 0xFFFFFFFFu
+
+#define INITIAL_NODES 4096
+#define CACHE_SIZE (1u << 16)
+// Collect the store at the start of an operation above this number of nodes
+#define MAX_NODES (1u << 22)
+
+typedef struct {
+    unsigned index;
+    unsigned lo, hi;
+    unsigned next;   // next node of the same unique table bucket
+    unsigned stamp;  // last walk visiting this node
+    bdd_ptr out;     // node of the result DFA, valid if stamp is current
+} StoreNode;
+
+typedef struct {
+    unsigned a, b;
+    unsigned result;
+} CacheEntry;
+
+typedef struct {
+    StoreNode *nodes;
+    unsigned used, allocated;
+    unsigned *buckets;  // allocated entries, allocated is a power of two
+    CacheEntry *cache;
+    unsigned stamp;
+    BddStoreStats stats;
+} BddStore;
+
+// Maps keys to values with open addressing, used for imports and states
+typedef struct {
+    unsigned long *keys;
+    unsigned *values;
+    unsigned size, used;  // size is a power of two
+} StoreMap;
+
+#define EMPTY_KEY (~0UL)
+
+static int storeEnabled = 0;
+static BddStoreStats globalStats;
+
+static pthread_once_t storeKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t storeKey;
+static __thread BddStore *threadStore = NULL;
+
+static unsigned hashTriple(unsigned a, unsigned b, unsigned c) {
+    unsigned long h = (unsigned long) a * 0x9E3779B97F4A7C15UL;
+    h ^= (unsigned long) b * 0xC2B2AE3D27D4EB4FUL + (h >> 29);
+    h ^= (unsigned long) c * 0x165667B19E3779F9UL + (h >> 31);
+    return (unsigned) (h ^ (h >> 32));
+}
+
+static void mapInit(StoreMap *map, unsigned expected) {
+    unsigned i;
+    map->size = 16;
+    while (map->size < 2 * expected)
+        map->size <<= 1;
+    map->used = 0;
+    map->keys = (unsigned long *) malloc(map->size * sizeof(unsigned long));
+    map->values = (unsigned *) malloc(map->size * sizeof(unsigned));
+    for (i = 0; i < map->size; i++)
+        map->keys[i] = EMPTY_KEY;
+}
+
+static void mapFree(StoreMap *map) {
+    free(map->keys);
+    free(map->values);
+}
+
+static unsigned *findSlot(StoreMap *map, unsigned long key) {
+    unsigned i = hashTriple((unsigned) key, (unsigned) (key >> 32), 0) & (map->size - 1);
+    while (map->keys[i] != EMPTY_KEY && map->keys[i] != key)
+        i = (i + 1) & (map->size - 1);
+    return &map->values[i];
+}
+
+static void mapGrow(StoreMap *map) {
+    StoreMap bigger;
+    unsigned i;
+    mapInit(&bigger, map->size);
+    for (i = 0; i < map->size; i++)
+        if (map->keys[i] != EMPTY_KEY) {
+            unsigned *slot = findSlot(&bigger, map->keys[i]);
+            bigger.keys[slot - bigger.values] = map->keys[i];
+            *slot = map->values[i];
+        }
+    bigger.used = map->used;
+    mapFree(map);
+    *map = bigger;
+}
+
+// Returns the value slot of key, which is added if it is not in the map yet.
+// The slot is only valid until the next call.
+static unsigned *mapSlot(StoreMap *map, unsigned long key, int *found) {
+    unsigned *slot;
+    if (2 * (map->used + 1) > map->size)
+        mapGrow(map);
+    slot = findSlot(map, key);
+    *found = (map->keys[slot - map->values] == key);
+    if (!*found) {
+        map->keys[slot - map->values] = key;
+        map->used++;
+    }
+    return slot;
+}
+
+static void freeStore(void *arg) {
+    BddStore *store = (BddStore *) arg;
+    free(store->nodes);
+    free(store->buckets);
+    free(store->cache);
+    free(store);
+    threadStore = NULL;
+}
+
+static void createStoreKey(void) {
+    pthread_key_create(&storeKey, freeStore);
+}
+
+static void clearStore(BddStore *store) {
+    unsigned i;
+    store->used = 0;
+    for (i = 0; i < store->allocated; i++)
+        store->buckets[i] = NO_NODE;
+    for (i = 0; i < CACHE_SIZE; i++)
+        store->cache[i].result = NO_NODE;
+}
+
+static BddStore *getStore(void) {
+    BddStore *store = threadStore;
+    if (store == NULL) {
+        store = (BddStore *) calloc(1, sizeof(BddStore));
+        store->allocated = INITIAL_NODES;
+        store->nodes = (StoreNode *) malloc(store->allocated * sizeof(StoreNode));
+        store->buckets = (unsigned *) malloc(store->allocated * sizeof(unsigned));
+        store->cache = (CacheEntry *) malloc(CACHE_SIZE * sizeof(CacheEntry));
+        clearStore(store);
+        pthread_once(&storeKeyOnce, createStoreKey);
+        pthread_setspecific(storeKey, store);
+        threadStore = store;
+    }
+    return store;
+}
+
+static void growStore(BddStore *store) {
+    unsigned i, b;
+    store->allocated *= 2;
+    store->nodes = (StoreNode *) realloc(store->nodes, store->allocated * sizeof(StoreNode));
+    store->buckets = (unsigned *) realloc(store->buckets, store->allocated * sizeof(unsigned));
+    for (i = 0; i < store->allocated; i++)
+        store->buckets[i] = NO_NODE;
+    for (i = 0; i < store->used; i++) {
+        b = hashTriple(store->nodes[i].index, store->nodes[i].lo, store->nodes[i].hi) & (store->allocated - 1);
+        store->nodes[i].next = store->buckets[b];
+        store->buckets[b] = i;
+    }
+}
+
+// Returns the unique node with the given index and children
+static unsigned findNode(BddStore *store, unsigned index, unsigned lo, unsigned hi) {
+    unsigned b, id;
+    StoreNode *node;
+
+    if (index < STORE_PAIR && lo == hi)
+        return lo;
+    b = hashTriple(index, lo, hi) & (store->allocated - 1);
+    for (id = store->buckets[b]; id != NO_NODE; id = store->nodes[id].next) {
+        node = &store->nodes[id];
+        if (node->index == index && node->lo == lo && node->hi == hi) {
+            store->stats.shared++;
+            return id;
+        }
+    }
+    if (store->used == store->allocated) {
+        growStore(store);
+        b = hashTriple(index, lo, hi) & (store->allocated - 1);
+    }
+    id = store->used++;
+    node = &store->nodes[id];
+    node->index = index;
+    node->lo = lo;
+    node->hi = hi;
+    node->stamp = 0;
+    node->next = store->buckets[b];
+    store->buckets[b] = id;
+    store->stats.created++;
+    return id;
+}
+
+static unsigned importBdd(BddStore *store, StoreMap *imported, bdd_manager *bddm, bdd_ptr p) {
+    unsigned l, r, index, lo, hi;
+    unsigned *slot;
+    int found;
+
+    slot = mapSlot(imported, p, &found);
+    if (found)
+        return *slot;
+    LOAD_lri(&bddm->node_table[p], l, r, index);
+    if (index == BDD_LEAF_INDEX) {
+        lo = findNode(store, STORE_LEAF, l, 0);
+    } else {
+        lo = importBdd(store, imported, bddm, l);
+        hi = importBdd(store, imported, bddm, r);
+        lo = findNode(store, index, lo, hi);
+    }
+    // slot may have moved while importing the children
+    *mapSlot(imported, p, &found) = lo;
+    return lo;
+}
+
+static unsigned *importDfa(BddStore *store, DFA *a) {
+    StoreMap imported;
+    unsigned *roots = (unsigned *) malloc(a->ns * sizeof(unsigned));
+    int i;
+    mapInit(&imported, a->ns * 4);
+    for (i = 0; i < a->ns; i++)
+        roots[i] = importBdd(store, &imported, a->bddm, a->q[i]);
+    mapFree(&imported);
+    return roots;
+}
+
+// Product BDD of nodes a and b, its leaves are pairs of operand states
+static unsigned pairBdd(BddStore *store, unsigned a, unsigned b) {
+    CacheEntry *entry = &store->cache[hashTriple(a, b, 1) & (CACHE_SIZE - 1)];
+    StoreNode na, nb;
+    unsigned result;
+
+    store->stats.lookups++;
+    if (entry->result != NO_NODE && entry->a == a && entry->b == b) {
+        store->stats.hits++;
+        return entry->result;
+    }
+    na = store->nodes[a];
+    nb = store->nodes[b];
+    if (na.index == STORE_LEAF && nb.index == STORE_LEAF)
+        result = findNode(store, STORE_PAIR, na.lo, nb.lo);
+    else if (na.index == nb.index)
+        result = findNode(store, na.index, pairBdd(store, na.lo, nb.lo), pairBdd(store, na.hi, nb.hi));
+    else if (na.index < nb.index)
+        result = findNode(store, na.index, pairBdd(store, na.lo, b), pairBdd(store, na.hi, b));
+    else
+        result = findNode(store, nb.index, pairBdd(store, a, nb.lo), pairBdd(store, a, nb.hi));
+
+    entry->a = a;
+    entry->b = b;
+    entry->result = result;
+    return result;
+}
+
+typedef struct {
+    StoreMap states;
+    unsigned *left, *right;
+    unsigned count, allocated;
+} ProductStates;
+
+static unsigned productState(ProductStates *ps, unsigned l, unsigned r) {
+    int found;
+    unsigned *slot = mapSlot(&ps->states, ((unsigned long) l << 32) | r, &found);
+    unsigned state;
+    if (found)
+        return *slot;
+    if (ps->count == ps->allocated) {
+        ps->allocated *= 2;
+        ps->left = (unsigned *) realloc(ps->left, ps->allocated * sizeof(unsigned));
+        ps->right = (unsigned *) realloc(ps->right, ps->allocated * sizeof(unsigned));
+    }
+    state = ps->count++;
+    ps->left[state] = l;
+    ps->right[state] = r;
+    *slot = state;
+    return state;
+}
+
+// Numbers the product states reachable through node id
+static void discoverStates(BddStore *store, ProductStates *ps, unsigned id) {
+    StoreNode *node = &store->nodes[id];
+    if (node->stamp == store->stamp)
+        return;
+    node->stamp = store->stamp;
+    if (node->index == STORE_PAIR) {
+        productState(ps, node->lo, node->hi);
+    } else {
+        unsigned lo = node->lo, hi = node->hi;
+        discoverStates(store, ps, lo);
+        discoverStates(store, ps, hi);
+    }
+}
+
+static bdd_ptr emitBdd(BddStore *store, ProductStates *ps, DFA *d, unsigned id) {
+    StoreNode node = store->nodes[id];
+    bdd_ptr out;
+    if (node.stamp == store->stamp)
+        return node.out;
+    if (node.index == STORE_PAIR)
+        out = bdd_find_leaf_hashed_add_root(d->bddm, productState(ps, node.lo, node.hi));
+    else
+        out = bdd_find_node_hashed_add_root(d->bddm, emitBdd(store, ps, d, node.lo),
+                                            emitBdd(store, ps, d, node.hi), node.index);
+    store->nodes[id].stamp = store->stamp;
+    store->nodes[id].out = out;
+    return out;
+}
+
+static void nextStamp(BddStore *store) {
+    unsigned i;
+    if (++store->stamp == 0) {
+        for (i = 0; i < store->used; i++)
+            store->nodes[i].stamp = 0;
+        store->stamp = 1;
+    }
+}
+
+static int productStatus(int fa, int fb, dfaProductType ff) {
+    bool a = (fa == 1), b = (fb == 1), accept;
+    switch (ff) {
+    case dfaAND:
+        accept = a && b;
+        break;
+    case dfaOR:
+        accept = a || b;
+        break;
+    case dfaIMPL:
+        accept = !a || b;
+        break;
+    default:
+        accept = (a == b);
+        break;
+    }
+    return accept ? 1 : -1;
+}
+
+static bool hasDontCare(DFA *a) {
+    int i;
+    for (i = 0; i < a->ns; i++)
+        if (a->f[i] == 0)
+            return true;
+    return false;
+}
+
+static void addStats(BddStoreStats *stats) {
+    __sync_fetch_and_add(&globalStats.products, stats->products);
+    __sync_fetch_and_add(&globalStats.created, stats->created);
+    __sync_fetch_and_add(&globalStats.shared, stats->shared);
+    __sync_fetch_and_add(&globalStats.lookups, stats->lookups);
+    __sync_fetch_and_add(&globalStats.hits, stats->hits);
+    __sync_fetch_and_add(&globalStats.collections, stats->collections);
+    memset(stats, 0, sizeof(BddStoreStats));
+}
+
+DFA *dfaProductShared(DFA *a, DFA *b, dfaProductType ff) {
+    BddStore *store;
+    ProductStates ps;
+    unsigned *rootsA, *rootsB, *roots;
+    unsigned i, rootsAllocated;
+    DFA *d;
+
+    // Don't care states are left to MONA
+    if (hasDontCare(a) || hasDontCare(b))
+        return dfaProduct(a, b, ff);
+
+    store = getStore();
+    if (store->used > MAX_NODES) {
+        clearStore(store);
+        store->stats.collections++;
+    }
+    store->stats.products++;
+    rootsA = importDfa(store, a);
+    rootsB = importDfa(store, b);
+
+    mapInit(&ps.states, a->ns + b->ns);
+    ps.count = 0;
+    ps.allocated = 16;
+    ps.left = (unsigned *) malloc(ps.allocated * sizeof(unsigned));
+    ps.right = (unsigned *) malloc(ps.allocated * sizeof(unsigned));
+    productState(&ps, a->s, b->s);
+
+    // The state list grows while it is traversed
+    nextStamp(store);
+    rootsAllocated = 16;
+    roots = (unsigned *) malloc(rootsAllocated * sizeof(unsigned));
+    for (i = 0; i < ps.count; i++) {
+        if (i == rootsAllocated) {
+            rootsAllocated *= 2;
+            roots = (unsigned *) realloc(roots, rootsAllocated * sizeof(unsigned));
+        }
+        roots[i] = pairBdd(store, rootsA[ps.left[i]], rootsB[ps.right[i]]);
+        discoverStates(store, &ps, roots[i]);
+    }
+
+    d = dfaMake(ps.count);
+    d->ns = ps.count;
+    d->s = 0;
+    nextStamp(store);
+    for (i = 0; i < ps.count; i++) {
+        d->q[i] = emitBdd(store, &ps, d, roots[i]);
+        d->f[i] = productStatus(a->f[ps.left[i]], b->f[ps.right[i]], ff);
+    }
+
+    free(roots);
+    free(rootsA);
+    free(rootsB);
+    free(ps.left);
+    free(ps.right);
+    mapFree(&ps.states);
+    addStats(&store->stats);
+    return d;
+}
+
+// Tuples of operand states of the first level + 1 operands. A tuple is
+// the number of a tuple of the previous level and the state of one operand.
+typedef struct {
+    StoreMap tuples;
+    unsigned *prev, *state;
+    unsigned count, allocated;
+    StoreMap cache;  // BDDs folded into this level, valid for one operation
+} TupleLevel;
+
+static unsigned tupleNumber(TupleLevel *level, unsigned prev, unsigned state) {
+    int found;
+    unsigned *slot = mapSlot(&level->tuples, ((unsigned long) prev << 32) | state, &found);
+    unsigned tuple;
+    if (found)
+        return *slot;
+    if (level->count == level->allocated) {
+        level->allocated *= 2;
+        level->prev = (unsigned *) realloc(level->prev, level->allocated * sizeof(unsigned));
+        level->state = (unsigned *) realloc(level->state, level->allocated * sizeof(unsigned));
+    }
+    tuple = level->count++;
+    level->prev[tuple] = prev;
+    level->state[tuple] = state;
+    *slot = tuple;
+    return tuple;
+}
+
+// Folds the BDD b of one operand into the BDD acc of the previous level
+static unsigned tupleBdd(BddStore *store, TupleLevel *level, unsigned acc, unsigned b) {
+    unsigned long key = ((unsigned long) acc << 32) | b;
+    unsigned *slot = findSlot(&level->cache, key);
+    StoreNode na, nb;
+    unsigned result;
+    int found;
+
+    if (level->cache.keys[slot - level->cache.values] == key)
+        return *slot;
+    na = store->nodes[acc];
+    nb = store->nodes[b];
+    if (na.index == STORE_LEAF && nb.index == STORE_LEAF)
+        result = findNode(store, STORE_LEAF, tupleNumber(level, na.lo, nb.lo), 0);
+    else if (na.index == nb.index)
+        result = findNode(store, na.index, tupleBdd(store, level, na.lo, nb.lo), tupleBdd(store, level, na.hi, nb.hi));
+    else if (na.index < nb.index)
+        result = findNode(store, na.index, tupleBdd(store, level, na.lo, b), tupleBdd(store, level, na.hi, b));
+    else
+        result = findNode(store, nb.index, tupleBdd(store, level, acc, nb.lo), tupleBdd(store, level, acc, nb.hi));
+    *mapSlot(&level->cache, key, &found) = result;
+    return result;
+}
+
+static bdd_ptr emitTupleBdd(BddStore *store, DFA *d, unsigned id) {
+    StoreNode node = store->nodes[id];
+    bdd_ptr out;
+    if (node.stamp == store->stamp)
+        return node.out;
+    if (node.index == STORE_LEAF)
+        out = bdd_find_leaf_hashed_add_root(d->bddm, node.lo);
+    else
+        out = bdd_find_node_hashed_add_root(d->bddm, emitTupleBdd(store, d, node.lo),
+                                            emitTupleBdd(store, d, node.hi), node.index);
+    store->nodes[id].stamp = store->stamp;
+    store->nodes[id].out = out;
+    return out;
+}
+
+DFA *dfaProductAll(DFA **dfas, int n, dfaProductType ff) {
+    BddStore *store;
+    TupleLevel *levels;
+    unsigned **operandRoots;
+    unsigned *roots, *states;
+    unsigned i, tuple, acc, rootsAllocated;
+    int k, accept, any, all, pairwise;
+    DFA *d, *tmp;
+
+    assert(n > 0 && (ff == dfaAND || ff == dfaOR));
+    if (n == 1)
+        return dfaCopy(dfas[0]);
+    // Without the store, and for don't care states, MONA folds the operands
+    // pairwise
+    pairwise = !bddStoreIsEnabled();
+    for (k = 0; k < n && !pairwise; k++)
+        pairwise = hasDontCare(dfas[k]);
+    if (pairwise) {
+        d = dfaProduct(dfas[0], dfas[1], ff);
+        for (k = 2; k < n; k++) {
+            tmp = dfaProduct(d, dfas[k], ff);
+            dfaFree(d);
+            d = tmp;
+        }
+        return d;
+    }
+
+    store = getStore();
+    if (store->used > MAX_NODES) {
+        clearStore(store);
+        store->stats.collections++;
+    }
+    store->stats.products++;
+    operandRoots = (unsigned **) malloc(n * sizeof(unsigned *));
+    for (k = 0; k < n; k++)
+        operandRoots[k] = importDfa(store, dfas[k]);
+
+    // levels[k] combines the first k + 1 operands, levels[0] is not used
+    levels = (TupleLevel *) calloc(n, sizeof(TupleLevel));
+    for (k = 1; k < n; k++) {
+        mapInit(&levels[k].tuples, 64);
+        mapInit(&levels[k].cache, 64);
+        levels[k].allocated = 16;
+        levels[k].prev = (unsigned *) malloc(levels[k].allocated * sizeof(unsigned));
+        levels[k].state = (unsigned *) malloc(levels[k].allocated * sizeof(unsigned));
+    }
+
+    // The initial state is the first tuple of the last level
+    tuple = dfas[0]->s;
+    for (k = 1; k < n; k++)
+        tuple = tupleNumber(&levels[k], tuple, dfas[k]->s);
+
+    // Tuples of the last level are the product states. They are only added
+    // as leaves of product BDDs, so all of them are reachable.
+    states = (unsigned *) malloc(n * sizeof(unsigned));
+    rootsAllocated = 16;
+    roots = (unsigned *) malloc(rootsAllocated * sizeof(unsigned));
+    for (i = 0; i < levels[n - 1].count; i++) {
+        if (i == rootsAllocated) {
+            rootsAllocated *= 2;
+            roots = (unsigned *) realloc(roots, rootsAllocated * sizeof(unsigned));
+        }
+        tuple = i;
+        for (k = n - 1; k > 0; k--) {
+            states[k] = levels[k].state[tuple];
+            tuple = levels[k].prev[tuple];
+        }
+        states[0] = tuple;
+        acc = operandRoots[0][states[0]];
+        for (k = 1; k < n; k++)
+            acc = tupleBdd(store, &levels[k], acc, operandRoots[k][states[k]]);
+        roots[i] = acc;
+    }
+
+    d = dfaMake(levels[n - 1].count);
+    d->ns = levels[n - 1].count;
+    d->s = 0;
+    nextStamp(store);
+    for (i = 0; i < (unsigned) d->ns; i++) {
+        d->q[i] = emitTupleBdd(store, d, roots[i]);
+        tuple = i;
+        any = 0;
+        all = 1;
+        for (k = n - 1; k >= 0; k--) {
+            unsigned state = (k > 0) ? levels[k].state[tuple] : tuple;
+            accept = (dfas[k]->f[state] == 1);
+            any = any || accept;
+            all = all && accept;
+            if (k > 0)
+                tuple = levels[k].prev[tuple];
+        }
+        d->f[i] = ((ff == dfaAND) ? all : any) ? 1 : -1;
+    }
+
+    for (k = 0; k < n; k++) {
+        free(operandRoots[k]);
+        if (k > 0) {
+            mapFree(&levels[k].tuples);
+            mapFree(&levels[k].cache);
+            free(levels[k].prev);
+            free(levels[k].state);
+        }
+    }
+    free(operandRoots);
+    free(levels);
+    free(states);
+    free(roots);
+    addStats(&store->stats);
+    return d;
+}
+
+void bddStoreSetEnabled(int enabled) {
+    storeEnabled = enabled;
+}
+
+int bddStoreIsEnabled(void) {
+    return storeEnabled;
+}
+
+void bddStoreGetStats(BddStoreStats *stats) {
+    stats->products = __sync_fetch_and_add(&globalStats.products, 0);
+    stats->created = __sync_fetch_and_add(&globalStats.created, 0);
+    stats->shared = __sync_fetch_and_add(&globalStats.shared, 0);
+    stats->lookups = __sync_fetch_and_add(&globalStats.lookups, 0);
+    stats->hits = __sync_fetch_and_add(&globalStats.hits, 0);
+    stats->collections = __sync_fetch_and_add(&globalStats.collections, 0);
+}
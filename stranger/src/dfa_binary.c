@@ -0,0 +1,277 @@
+/*
+ * Stranger
+ * Copyright (C) 2013-2014 University of California Santa Barbara.
+ *
+ * Modifications Copyright SAP SE. 2020-2022.  All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+/*
+ * Binary DFA file format, a compact replacement of the textual MONA format
+ * written by dfaExportBddTable.
+ *
+ * The file is a DfaBinaryHeader followed by four sections of 32 bit words in
+ * the byte order of the writer:
+ *
+ *   behaviour  states words, the BDD node of every state
+ *   final      (states + 31) / 32 words, bit set for accepting states
+ *   reject     (states + 31) / 32 words, bit set for rejecting states
+ *   bdd        bdd_nodes triples (index, lo, hi), leaves have index
+ *              BINARY_LEAF and the state in lo
+ *
+ * A state with neither bit set is a don't care state.
+ *
+ * The BDD nodes are in post-order, so the children of a node always come
+ * before it. The states and the BDD sections each have a FNV-1a checksum in
+ * the header. Import maps the file and builds the bdd_manager in a single
+ * pass over the nodes, without parsing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "stranger.h"
+
+#define BINARY_MAGIC "STRDFA\r\n"
+#define BINARY_VERSION 1u
+#define BINARY_BYTE_ORDER 0x01020304u
+#define BINARY_LEAF 0xFFFFFFFFu
+
+typedef struct {
+    char magic[8];
+    unsigned version;
+    unsigned byte_order;
+    unsigned vars;
+    unsigned states;
+    unsigned initial;
+    unsigned bdd_nodes;
+    unsigned states_checksum;  // behaviour, final and reject sections
+    unsigned bdd_checksum;
+} DfaBinaryHeader;
+
+static unsigned fnv1a(const void *data, size_t length, unsigned hash) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    size_t i;
+    for (i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+#define FNV_OFFSET 2166136261u
+
+static size_t bitmapWords(unsigned states) {
+    return (states + 31) / 32;
+}
+
+static size_t statesSectionWords(unsigned states) {
+    return states + 2 * bitmapWords(states);
+}
+
+typedef struct {
+    unsigned *words;  // triples (index, lo, hi)
+    unsigned count, allocated;
+} NodeArray;
+
+// Appends the BDD below p in post-order, the mark of a node is its position + 1
+static void exportNode(bdd_manager *bddm, bdd_ptr p, NodeArray *nodes, int var, int *ok) {
+    unsigned index, lo, hi;
+
+    if (bdd_mark(bddm, p) != 0)
+        return;
+    if (bdd_is_leaf(bddm, p)) {
+        index = BINARY_LEAF;
+        lo = bdd_leaf_value(bddm, p);
+        hi = 0;
+    } else {
+        exportNode(bddm, bdd_else(bddm, p), nodes, var, ok);
+        exportNode(bddm, bdd_then(bddm, p), nodes, var, ok);
+        index = bdd_ifindex(bddm, p);
+        // The format can not represent variables beyond var
+        if (index >= (unsigned) var)
+            *ok = 0;
+        lo = bdd_mark(bddm, bdd_else(bddm, p)) - 1;
+        hi = bdd_mark(bddm, bdd_then(bddm, p)) - 1;
+    }
+    if (nodes->count == nodes->allocated) {
+        nodes->allocated *= 2;
+        nodes->words = (unsigned *) realloc(nodes->words, 3 * (size_t) nodes->allocated * sizeof(unsigned));
+    }
+    nodes->words[3 * nodes->count] = index;
+    nodes->words[3 * nodes->count + 1] = lo;
+    nodes->words[3 * nodes->count + 2] = hi;
+    bdd_set_mark(bddm, p, ++nodes->count);
+}
+
+int dfaExportBinary(DFA *a, const char *file_name, int var) {
+    DfaBinaryHeader header;
+    NodeArray nodes;
+    unsigned *states, *behaviour, *final, *reject;
+    size_t stateWords;
+    unsigned i;
+    int ok = 1;
+    FILE *file;
+
+    nodes.count = 0;
+    nodes.allocated = 64;
+    nodes.words = (unsigned *) malloc(3 * (size_t) nodes.allocated * sizeof(unsigned));
+    /* remove all marks in a->bddm */
+    bdd_prepare_apply1(a->bddm);
+    for (i = 0; i < (unsigned) a->ns; i++)
+        exportNode(a->bddm, a->q[i], &nodes, var, &ok);
+
+    stateWords = statesSectionWords(a->ns);
+    states = (unsigned *) calloc(stateWords, sizeof(unsigned));
+    behaviour = states;
+    final = behaviour + a->ns;
+    reject = final + bitmapWords(a->ns);
+    for (i = 0; i < (unsigned) a->ns; i++) {
+        behaviour[i] = bdd_mark(a->bddm, a->q[i]) - 1;
+        if (a->f[i] == 1)
+            final[i / 32] |= 1u << (i % 32);
+        else if (a->f[i] == -1)
+            reject[i / 32] |= 1u << (i % 32);
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+    header.version = BINARY_VERSION;
+    header.byte_order = BINARY_BYTE_ORDER;
+    header.vars = (unsigned) var;
+    header.states = a->ns;
+    header.initial = a->s;
+    header.bdd_nodes = nodes.count;
+    header.states_checksum = fnv1a(states, stateWords * sizeof(unsigned), FNV_OFFSET);
+    header.bdd_checksum = fnv1a(nodes.words, 3 * (size_t) nodes.count * sizeof(unsigned), FNV_OFFSET);
+
+    if (ok) {
+        if ((file = fopen(file_name, "wb")) == 0) {
+            ok = 0;
+        } else {
+            if (fwrite(&header, sizeof(header), 1, file) != 1
+                || fwrite(states, sizeof(unsigned), stateWords, file) != stateWords
+                || fwrite(nodes.words, 3 * sizeof(unsigned), nodes.count, file) != nodes.count)
+                ok = 0;
+            if (fclose(file) != 0)
+                ok = 0;
+        }
+    }
+
+    free(states);
+    free(nodes.words);
+    return ok;
+}
+
+// Checks everything the import relies on, so a truncated or foreign file
+// can not produce a broken DFA
+static int checkBinary(const DfaBinaryHeader *header, size_t size, int var) {
+    const unsigned *words = (const unsigned *) (header + 1);
+    const unsigned *bdd;
+    size_t stateWords;
+    unsigned i;
+
+    if (size < sizeof(DfaBinaryHeader)
+        || memcmp(header->magic, BINARY_MAGIC, sizeof(header->magic)) != 0
+        || header->version != BINARY_VERSION
+        || header->byte_order != BINARY_BYTE_ORDER
+        || header->vars != (unsigned) var
+        || header->states == 0 || header->initial >= header->states)
+        return 0;
+    stateWords = statesSectionWords(header->states);
+    if (size != sizeof(DfaBinaryHeader) + (stateWords + 3 * (size_t) header->bdd_nodes) * sizeof(unsigned))
+        return 0;
+    bdd = words + stateWords;
+    if (fnv1a(words, stateWords * sizeof(unsigned), FNV_OFFSET) != header->states_checksum
+        || fnv1a(bdd, 3 * (size_t) header->bdd_nodes * sizeof(unsigned), FNV_OFFSET) != header->bdd_checksum)
+        return 0;
+
+    for (i = 0; i < header->states; i++)
+        if (words[i] >= header->bdd_nodes)
+            return 0;
+    for (i = 0; i < header->bdd_nodes; i++) {
+        if (bdd[3 * i] == BINARY_LEAF) {
+            if (bdd[3 * i + 1] >= header->states)
+                return 0;
+        } else if (bdd[3 * i] >= (unsigned) var
+                   || bdd[3 * i + 1] >= i || bdd[3 * i + 2] >= i) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+DFA *dfaImportBinary(const char *file_name, int var) {
+    struct stat st;
+    void *mapped;
+    const DfaBinaryHeader *header;
+    const unsigned *behaviour, *final, *reject, *bdd;
+    bdd_ptr *nodes;
+    unsigned i;
+    int fd;
+    DFA *a = NULL;
+
+    if ((fd = open(file_name, O_RDONLY)) < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(DfaBinaryHeader)) {
+        close(fd);
+        return NULL;
+    }
+    mapped = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        return NULL;
+
+    header = (const DfaBinaryHeader *) mapped;
+    if (checkBinary(header, (size_t) st.st_size, var)) {
+        behaviour = (const unsigned *) (header + 1);
+        final = behaviour + header->states;
+        reject = final + bitmapWords(header->states);
+        bdd = behaviour + statesSectionWords(header->states);
+
+        a = dfaMake(header->states);
+        a->ns = header->states;
+        a->s = header->initial;
+        nodes = (bdd_ptr *) malloc(((size_t) header->bdd_nodes + 1) * sizeof(bdd_ptr));
+        for (i = 0; i < header->bdd_nodes; i++) {
+            if (bdd[3 * i] == BINARY_LEAF)
+                nodes[i] = bdd_find_leaf_hashed_add_root(a->bddm, bdd[3 * i + 1]);
+            else
+                nodes[i] = bdd_find_node_hashed_add_root(a->bddm, nodes[bdd[3 * i + 1]],
+                                                         nodes[bdd[3 * i + 2]], bdd[3 * i]);
+        }
+        for (i = 0; i < header->states; i++) {
+            a->q[i] = nodes[behaviour[i]];
+            if (final[i / 32] & (1u << (i % 32)))
+                a->f[i] = 1;
+            else if (reject[i / 32] & (1u << (i % 32)))
+                a->f[i] = -1;
+            else
+                a->f[i] = 0;
+        }
+        free(nodes);
+    }
+
+    munmap(mapped, (size_t) st.st_size);
+    return a;
+}
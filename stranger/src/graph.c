@@ -246,7 +246,7 @@ void dfaFreeTransitionRelation(pTransitionRelation p_transitionRelation){
     free(p_transitionRelation->adjList);
     free(p_transitionRelation->degrees);
     if (p_transitionRelation->acceptsSize > 0)
-        free(p_transitionRelation->accepts);
+        mem_free(p_transitionRelation->accepts);
     free(p_transitionRelation);
 }
 
@@ -407,18 +407,25 @@ void dfaPrintTransitionRelationNoShift(pTransitionRelation p_transitionRelation)
 #define GRAY 1
 #define BLACK 2
 
-int numOfNodes;  // number of nodes
-int numOfEdges;  // number of edges
 struct edge {
     int tail,head,type;
 };
 typedef struct edge edgeType;
-edgeType *edgeTab;
-int *firstEdge;  // Table indicating first in range of edges with a common tail
 
-int *vertexStatus,*secondDFSrestarts;
-
-int tailThenHead(const void* xin, const void* yin)
+/*
+ Working state of a single isLengthFiniteTarjan call. It is kept per call so
+ that several threads can check different automata at the same time.
+ */
+typedef struct _SCCContext {
+    int numOfNodes;  // number of nodes
+    int numOfEdges;  // number of edges
+    edgeType *edgeTab;
+    int *firstEdge;  // Table indicating first in range of edges with a common tail
+    int *vertexStatus,*secondDFSrestarts;
+    int finishIndex;
+} SCCContext;
+
+static int tailThenHead(const void* xin, const void* yin)
 // Used in calls to qsort() and bsearch() for dfa_to_graph()
 {
     int result;
@@ -433,10 +440,9 @@ int tailThenHead(const void* xin, const void* yin)
         return x->head - y->head;
 }
 
-bool dfa_to_graph(DFA *M)
+static bool dfa_to_graph(SCCContext *ctx, DFA *M)
 {
     int i,j;
-    bool selfCyclesFound = false;
     pTransitionRelation p_transitionRelation = dfaGetTransitionRelation(M);
     //if we detect a self cycle then that is enough to abort looking for cycles
     if (p_transitionRelation->selfCycles) {
@@ -445,13 +451,13 @@ bool dfa_to_graph(DFA *M)
     }
         
 //    dfaPrintTransitionRelation(p_transitionRelation);
-    numOfNodes = p_transitionRelation->num_of_nodes;
-    numOfEdges = p_transitionRelation->num_of_edges;
+    ctx->numOfNodes = p_transitionRelation->num_of_nodes;
+    ctx->numOfEdges = p_transitionRelation->num_of_edges;
 
-//    printf("Number of vertices = %d ,edges = %d\n",numOfNodes,numOfEdges);
+//    printf("Number of vertices = %d ,edges = %d\n",ctx->numOfNodes,ctx->numOfEdges);
 
-    edgeTab=(edgeType*) malloc((size_t) numOfEdges * sizeof(edgeType));
-    if (!edgeTab)
+    ctx->edgeTab=(edgeType*) malloc((size_t) ctx->numOfEdges * sizeof(edgeType));
+    if (!ctx->edgeTab)
     {
         printf("edgeTab malloc failed %dn",__LINE__);
         exit(0);
@@ -459,127 +465,125 @@ bool dfa_to_graph(DFA *M)
     
     // read edges
     int e = 0;
-    for (i=0; i < numOfNodes; i++)
+    for (i=0; i < ctx->numOfNodes; i++)
     {
         unsigned *nodeAdjList = p_transitionRelation->adjList[i];
         for (j = 0; j < p_transitionRelation->degrees[i]; j++){
-            edgeTab[e].tail=i;
-            edgeTab[e].head=nodeAdjList[j];
+            ctx->edgeTab[e].tail=i;
+            ctx->edgeTab[e].head=nodeAdjList[j];
             e++;
         }
     }
-    assert(e == numOfEdges);
+    assert(e == ctx->numOfEdges);
     
     // sort edges
-    qsort(edgeTab,numOfEdges,sizeof(edgeType),tailThenHead);
+    qsort(ctx->edgeTab,ctx->numOfEdges,sizeof(edgeType),tailThenHead);
     
     // Coalesce duplicates into a single edge
     j=0;
-    for (i=1; i<numOfEdges; i++)
-        if (edgeTab[j].tail==edgeTab[i].tail
-            && edgeTab[j].head==edgeTab[i].head) {
+    for (i=1; i<ctx->numOfEdges; i++)
+        if (ctx->edgeTab[j].tail==ctx->edgeTab[i].tail
+            && ctx->edgeTab[j].head==ctx->edgeTab[i].head) {
 
         }
         else
         {
             j++;
-            edgeTab[j].tail=edgeTab[i].tail;
-            edgeTab[j].head=edgeTab[i].head;
+            ctx->edgeTab[j].tail=ctx->edgeTab[i].tail;
+            ctx->edgeTab[j].head=ctx->edgeTab[i].head;
         }
-    numOfEdges=j+1;
+    ctx->numOfEdges=j+1;
     
     // For each vertex as a tail, determine first in range of edgeTab entries
-    firstEdge=(int*) malloc((numOfNodes+1)*sizeof(int));
-    if (!firstEdge)
+    ctx->firstEdge=(int*) malloc((ctx->numOfNodes+1)*sizeof(int));
+    if (!ctx->firstEdge)
     {
         printf("malloc failed %dn",__LINE__);
         exit(0);
     }
     j=0;
-    for (i=0; i<numOfNodes; i++)
+    for (i=0; i<ctx->numOfNodes; i++)
     {
-        firstEdge[i]=j;
+        ctx->firstEdge[i]=j;
         for ( ;
-             j<numOfEdges && edgeTab[j].tail==i;
+             j<ctx->numOfEdges && ctx->edgeTab[j].tail==i;
              j++)
             ;
     }
-    firstEdge[numOfNodes]=numOfEdges;
+    ctx->firstEdge[ctx->numOfNodes]=ctx->numOfEdges;
     
     dfaFreeTransitionRelation(p_transitionRelation);
     return false;
 }
 
-int finishIndex;
-
-void DFSvisit(int node)
+static void DFSvisit(SCCContext *ctx, int node)
 {
     int i,v;
     
-    vertexStatus[node]=GRAY;
+    ctx->vertexStatus[node]=GRAY;
     
-    for (i=firstEdge[node];i<firstEdge[node+1];i++)
+    for (i=ctx->firstEdge[node];i<ctx->firstEdge[node+1];i++)
     {
-        v=edgeTab[i].head;
-        if (vertexStatus[v]==WHITE)
-            DFSvisit(v);
+        v=ctx->edgeTab[i].head;
+        if (ctx->vertexStatus[v]==WHITE)
+            DFSvisit(ctx, v);
     }
-    vertexStatus[node]=BLACK;
-    secondDFSrestarts[--finishIndex]=node;
+    ctx->vertexStatus[node]=BLACK;
+    ctx->secondDFSrestarts[--ctx->finishIndex]=node;
 }
 
-void reverseEdges()
+static void reverseEdges(SCCContext *ctx)
 {
     int a,b,i,j;
     
-    for (i=0; i<numOfEdges; i++)
+    for (i=0; i<ctx->numOfEdges; i++)
     {
-        a=edgeTab[i].tail;
-        b=edgeTab[i].head;
-        edgeTab[i].tail=b;
-        edgeTab[i].head=a;
+        a=ctx->edgeTab[i].tail;
+        b=ctx->edgeTab[i].head;
+        ctx->edgeTab[i].tail=b;
+        ctx->edgeTab[i].head=a;
     }
     
     // sort edges
-    qsort(edgeTab,numOfEdges,sizeof(edgeType),tailThenHead);
+    qsort(ctx->edgeTab,ctx->numOfEdges,sizeof(edgeType),tailThenHead);
     
     // For each vertex as a tail, determine first in range of edgeTab entries
-    if (!firstEdge)
+    if (!ctx->firstEdge)
     {
         printf("malloc failed %dn",__LINE__);
         exit(0);
     }
     j=0;
-    for (i=0; i<numOfNodes; i++)
+    for (i=0; i<ctx->numOfNodes; i++)
     {
-        firstEdge[i]=j;
+        ctx->firstEdge[i]=j;
         for ( ;
-             j<numOfEdges && edgeTab[j].tail==i;
+             j<ctx->numOfEdges && ctx->edgeTab[j].tail==i;
              j++)
             ;
     }
-    firstEdge[numOfNodes]=numOfEdges;
+    ctx->firstEdge[ctx->numOfNodes]=ctx->numOfEdges;
 }
 
 //returns true if it is called more than once. This indicates
 //an SCC of more than one node
-bool DFSvisit2(int node, int sink)
+static bool DFSvisit2(SCCContext *ctx, int node, int sink)
 {
     int i,v;
     bool multipleCalls = false;
 //    int state = (node < sink)? node : node + 1;
 //    printf("%d\n",state); // Indicate that node is in SCC for this restart
-    vertexStatus[node]=GRAY;
+    ctx->vertexStatus[node]=GRAY;
     
-    for (i=firstEdge[node];i<firstEdge[node+1];i++)
+    for (i=ctx->firstEdge[node];i<ctx->firstEdge[node+1];i++)
     {
-        v=edgeTab[i].head;
-        if (vertexStatus[v]==WHITE){
+        v=ctx->edgeTab[i].head;
+        if (ctx->vertexStatus[v]==WHITE){
             multipleCalls = true;
-            DFSvisit2(v, sink);
+            DFSvisit2(ctx, v, sink);
         }
     }
-    vertexStatus[node]=BLACK;
+    ctx->vertexStatus[node]=BLACK;
     return multipleCalls;
 }
 
@@ -592,53 +596,54 @@ bool isLengthFiniteTarjan(DFA *M, int var, int *indices)
     int node;
     int SCCcount=0;
     bool sccFound = false;
+    SCCContext ctx;
     
     // we need sink just for printing
     int sink = find_sink(M);
     assert(sink >= 0);
     
     // convert dfa->graph, if there is any self cycle, stop and return
-    if (dfa_to_graph(M)){
+    if (dfa_to_graph(&ctx, M)){
         return false;
     }
 
     
-    vertexStatus=(int*) malloc(numOfNodes*sizeof(int));
-    secondDFSrestarts=(int*) malloc(numOfNodes*sizeof(int));
-    if (!vertexStatus || !secondDFSrestarts)
+    ctx.vertexStatus=(int*) malloc(ctx.numOfNodes*sizeof(int));
+    ctx.secondDFSrestarts=(int*) malloc(ctx.numOfNodes*sizeof(int));
+    if (!ctx.vertexStatus || !ctx.secondDFSrestarts)
     {
         printf("malloc failedn");
         exit(0);
     }
     // DFS code
-    for (node=0;node<numOfNodes;node++)
-        vertexStatus[node]=WHITE;
-    finishIndex=numOfNodes;
-    for (node=0;node<numOfNodes;node++)
-        if (vertexStatus[node]==WHITE)
-            DFSvisit(node);
+    for (node=0;node<ctx.numOfNodes;node++)
+        ctx.vertexStatus[node]=WHITE;
+    ctx.finishIndex=ctx.numOfNodes;
+    for (node=0;node<ctx.numOfNodes;node++)
+        if (ctx.vertexStatus[node]==WHITE)
+            DFSvisit(&ctx, node);
     
-    reverseEdges();
+    reverseEdges(&ctx);
     
     // DFS code
-    for (node=0;node<numOfNodes;node++)
-        vertexStatus[node]=WHITE;
-    for (node=0;node<numOfNodes;node++)
-        if (vertexStatus[secondDFSrestarts[node]]==WHITE)
+    for (node=0;node<ctx.numOfNodes;node++)
+        ctx.vertexStatus[node]=WHITE;
+    for (node=0;node<ctx.numOfNodes;node++)
+        if (ctx.vertexStatus[ctx.secondDFSrestarts[node]]==WHITE)
         {
             SCCcount++;
 //            printf("Strongly Connected Component %d\n",SCCcount);
-            if(DFSvisit2(secondDFSrestarts[node], sink) == true){
+            if(DFSvisit2(&ctx, ctx.secondDFSrestarts[node], sink) == true){
 //                printf("Found a real SCC on node %d\n", node);
                 sccFound = true;
             }
             
         }
     
-    free(edgeTab);
-    free(firstEdge);
-    free(vertexStatus);
-    free(secondDFSrestarts);
+    free(ctx.edgeTab);
+    free(ctx.firstEdge);
+    free(ctx.vertexStatus);
+    free(ctx.secondDFSrestarts);
     return !sccFound;
 }
 
@@ -0,0 +1,265 @@
+/*
+ * Stranger
+ * Copyright (C) 2013-2014 University of California Santa Barbara.
+ *
+ * Modifications Copyright SAP SE. 2020-2022.  All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ *
+ * Authors: Thomas Barber
+ */
+
+/*
+ * Per thread pools for the memory MONA allocates through mem_alloc, i.e. DFA
+ * headers, the state arrays f and q and the node tables of the BDD managers.
+ *
+ * When configured with --enable-mem-pool this file defines the functions of
+ * MONA's mem layer itself. libstranger is looked up before libmonamem, so
+ * these definitions are used by MONA's DFA and BDD packages as well.
+ *
+ * Pooled blocks are ordinary malloc blocks which are kept on a free list of
+ * the freeing thread instead of being handed back to malloc. The size class
+ * of a block is derived from malloc_usable_size, so blocks do not need a
+ * header and it stays legal to release mem_alloc'ed memory with free() and
+ * malloc'ed memory with mem_free(), which happens in a few places.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stranger.h"
+
+#ifdef STRANGER_MEM_POOL
+
+#include <malloc.h>
+#include <pthread.h>
+
+// Size classes are 4 steps per power of two, from 32 bytes to 1.75 MiB
+#define MIN_SHIFT 5
+#define MAX_SHIFT 20
+#define NUM_CLASSES ((MAX_SHIFT - MIN_SHIFT + 1) * 4)
+// Limits for the blocks a single thread keeps around
+#define MAX_BLOCKS_PER_CLASS 64
+#define MAX_CACHED_BYTES ((size_t) 16 << 20)
+
+typedef enum {POOL_UNUSED, POOL_ACTIVE, POOL_RETIRED} PoolStatus;
+
+typedef struct _ThreadPool {
+    void *heads[NUM_CLASSES];
+    unsigned counts[NUM_CLASSES];
+    PoolStatus status;
+    MemPoolStats stats;
+    struct _ThreadPool *prev, *next;
+} ThreadPool;
+
+static __thread ThreadPool threadPool;
+
+static pthread_mutex_t poolsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t poolKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t poolKey;
+// Live pools and the statistics of pools of finished threads
+static ThreadPool *pools = NULL;
+static MemPoolStats retiredStats;
+
+static int floorLog2(size_t n) {
+    return (int) (sizeof(unsigned long) * 8 - 1) - __builtin_clzl((unsigned long) n);
+}
+
+static size_t classSize(int c) {
+    int p = MIN_SHIFT + c / 4;
+    return ((size_t) 1 << p) + (size_t) (c % 4) * ((size_t) 1 << (p - 2));
+}
+
+// Smallest class holding size bytes, NUM_CLASSES if it is too large
+static int classForRequest(size_t size) {
+    size_t t;
+    int p, c;
+    if (size <= ((size_t) 1 << MIN_SHIFT))
+        return 0;
+    t = size - 1;
+    p = floorLog2(t);
+    c = (p - MIN_SHIFT) * 4 + (int) ((t >> (p - 2)) & 3) + 1;
+    return c < NUM_CLASSES ? c : NUM_CLASSES;
+}
+
+// Largest class fitting into a block of size bytes, -1 if there is none
+static int classForBlock(size_t size) {
+    int p, c;
+    if (size < ((size_t) 1 << MIN_SHIFT))
+        return -1;
+    p = floorLog2(size);
+    c = (p - MIN_SHIFT) * 4 + (int) ((size >> (p - 2)) & 3);
+    return c < NUM_CLASSES ? c : -1;
+}
+
+static void addStats(MemPoolStats *to, const MemPoolStats *from) {
+    to->allocs += from->allocs;
+    to->hits += from->hits;
+    to->frees += from->frees;
+    to->cached += from->cached;
+    to->large += from->large;
+    to->cachedBytes += from->cachedBytes;
+}
+
+static void releasePool(void *arg) {
+    ThreadPool *pool = (ThreadPool *) arg;
+    int c;
+    for (c = 0; c < NUM_CLASSES; c++) {
+        while (pool->heads[c] != NULL) {
+            void *block = pool->heads[c];
+            pool->heads[c] = *(void **) block;
+            free(block);
+        }
+        pool->counts[c] = 0;
+    }
+    pool->stats.cachedBytes = 0;
+
+    pthread_mutex_lock(&poolsLock);
+    if (pool->prev != NULL)
+        pool->prev->next = pool->next;
+    else
+        pools = pool->next;
+    if (pool->next != NULL)
+        pool->next->prev = pool->prev;
+    addStats(&retiredStats, &pool->stats);
+    pthread_mutex_unlock(&poolsLock);
+
+    // Blocks freed by later thread destructors go straight to malloc
+    pool->status = POOL_RETIRED;
+}
+
+static void createPoolKey(void) {
+    pthread_key_create(&poolKey, releasePool);
+}
+
+static ThreadPool *getPool(void) {
+    ThreadPool *pool = &threadPool;
+    if (pool->status == POOL_UNUSED) {
+        pthread_once(&poolKeyOnce, createPoolKey);
+        pthread_setspecific(poolKey, pool);
+        pthread_mutex_lock(&poolsLock);
+        pool->prev = NULL;
+        pool->next = pools;
+        if (pools != NULL)
+            pools->prev = pool;
+        pools = pool;
+        pthread_mutex_unlock(&poolsLock);
+        pool->status = POOL_ACTIVE;
+    }
+    return pool->status == POOL_ACTIVE ? pool : NULL;
+}
+
+static void outOfMemory(size_t size) {
+    fprintf(stderr, "\n*** Out of memory, unable to allocate %lu bytes ***\n", (unsigned long) size);
+    abort();
+}
+
+void *mem_alloc(size_t size) {
+    ThreadPool *pool = getPool();
+    int c = classForRequest(size);
+    void *block;
+
+    if (pool != NULL) {
+        pool->stats.allocs++;
+        if (c == NUM_CLASSES) {
+            pool->stats.large++;
+        } else if (pool->heads[c] != NULL) {
+            block = pool->heads[c];
+            pool->heads[c] = *(void **) block;
+            pool->counts[c]--;
+            pool->stats.cachedBytes -= malloc_usable_size(block);
+            pool->stats.hits++;
+            return block;
+        }
+    }
+    // Round up to the class size so the block can be reused for the class
+    block = malloc(c == NUM_CLASSES ? size : classSize(c));
+    if (block == NULL)
+        outOfMemory(size);
+    return block;
+}
+
+void *mem_resize(void *p, size_t size) {
+    void *block;
+    if (p == NULL)
+        return mem_alloc(size);
+    block = realloc(p, size);
+    if (block == NULL && size != 0)
+        outOfMemory(size);
+    return block;
+}
+
+void mem_free(void *p) {
+    ThreadPool *pool;
+    size_t size;
+    int c;
+
+    if (p == NULL)
+        return;
+    pool = getPool();
+    if (pool == NULL) {
+        free(p);
+        return;
+    }
+    pool->stats.frees++;
+    size = malloc_usable_size(p);
+    c = classForBlock(size);
+    if (c < 0 || pool->counts[c] >= MAX_BLOCKS_PER_CLASS
+        || pool->stats.cachedBytes + size > MAX_CACHED_BYTES) {
+        free(p);
+        return;
+    }
+    *(void **) p = pool->heads[c];
+    pool->heads[c] = p;
+    pool->counts[c]++;
+    pool->stats.cachedBytes += size;
+    pool->stats.cached++;
+}
+
+void mem_zero(void *p, size_t size) {
+    memset(p, 0, size);
+}
+
+void mem_copy(void *to, void *from, size_t size) {
+    memcpy(to, from, size);
+}
+
+int memPoolEnabled(void) {
+    return 1;
+}
+
+void memPoolGetStats(MemPoolStats *stats) {
+    ThreadPool *pool;
+    pthread_mutex_lock(&poolsLock);
+    *stats = retiredStats;
+    // Counters of running threads are read without synchronisation, the
+    // numbers are only used for reporting
+    for (pool = pools; pool != NULL; pool = pool->next)
+        addStats(stats, &pool->stats);
+    pthread_mutex_unlock(&poolsLock);
+}
+
+#else
+
+int memPoolEnabled(void) {
+    return 0;
+}
+
+void memPoolGetStats(MemPoolStats *stats) {
+    memset(stats, 0, sizeof(MemPoolStats));
+}
+
+#endif
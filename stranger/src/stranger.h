@@ -251,6 +251,18 @@ extern "C" {
     
     DFA *dfa_intersect(DFA *M1, DFA *M2);
 
+    /*
+     * Same as dfa_intersect and dfa_union_with_emptycheck, but the product
+     * is only minimized if it has more than max_states states. *minimized
+     * tells whether the result is minimal. Inputs do not need to be minimal.
+     */
+    DFA *dfa_intersect_lazy(DFA *M1, DFA *M2, int max_states, int *minimized);
+    DFA *dfa_union_lazy(DFA *M1, DFA *M2, int max_states, int *minimized, int var, int *indices);
+
+    // n-ary versions of dfa_union_with_emptycheck and dfa_concat
+    DFA *dfa_union_all(DFA **M, int n, int var, int *indices);
+    DFA *dfa_concat_all(DFA **M, int n, int var, int *indices);
+
     DFA *dfa_product_impl(DFA *M1, DFA *M2);
     
     DFA *dfa_negate(DFA *M1, int var, int *indices);
@@ -288,6 +300,8 @@ extern "C" {
     DFA *dfa_closure_extrabit(DFA *M1,int var,int *indices); // added by Muath to be used by java StrangerLibrary
     
     DFA *dfaWiden(DFA *a, DFA *d); // added by Muath to be used by java StrangerLibrary
+    // coarse = 1 selects the coarse widening which guarantees termination, dfaWiden is the precise one
+    DFA *dfaWidenMode(DFA *a, DFA *d, int coarse);
     
     DFA* dfa_pre_concat_const(DFA* ML, const char* str, int pos, int var, int* indices);
     DFA* dfa_pre_concat(DFA* ML, DFA* MR, int pos, int var, int* indices);
@@ -344,6 +358,13 @@ extern "C" {
     char *isSingleton(DFA *M, int var, int *indices);
     
     int checkMembership(DFA* M, char* string, int var, int* indices);
+
+    /*
+     * returns a table of M->ns * 256 successor states:
+     * table[s * 256 + c] is the state reached from s on byte c.
+     * Caller must free the table.
+     */
+    int *dfaGetDenseTransitionTable(DFA *M, int var, int *indices);
     
     /**
      * A string automaton that accepts anything between start and end
@@ -399,6 +420,10 @@ extern "C" {
     void dfaPrintGraphvizFile(DFA *a, const char *filename, int no_free_vars, unsigned *offsets);
     void dfaExportBddTable(DFA *a, const char *file_name, int var);
     DFA *dfaImportBddTable(const char* file_name, int var) ;
+    // Versioned binary format which is mapped on import (see dfa_binary.c),
+    // export returns 1 on success, import NULL if the file is not valid
+    int dfaExportBinary(DFA *a, const char *file_name, int var);
+    DFA *dfaImportBinary(const char *file_name, int var);
 
     void __export(bdd_manager *bddm, unsigned p, Table *table);
 
@@ -494,11 +519,39 @@ extern "C" {
     DFA *dfaJsonStringify(DFA *inputAuto, int var, int *indices);
     DFA *dfaJsonParse(DFA *inputAuto, int var, int *indices);
 
+    // Statistics of the pools behind MONA's mem_alloc (see mem_pool.c)
+    typedef struct _MemPoolStats {
+        unsigned long allocs;   // calls to mem_alloc
+        unsigned long hits;     // allocations served from a pool
+        unsigned long frees;    // calls to mem_free
+        unsigned long cached;   // freed blocks kept in a pool
+        unsigned long large;    // allocations too large for the pools
+        size_t cachedBytes;     // bytes currently held in pools
+    } MemPoolStats;
+    // returns true (1) if libstranger was configured with --enable-mem-pool
+    int memPoolEnabled(void);
+    void memPoolGetStats(MemPoolStats *stats);
+
+    // Products through a per thread, hash-consed BDD node store (see bdd_store.c)
+    typedef struct _BddStoreStats {
+        unsigned long products;     // products computed in a store
+        unsigned long created;      // nodes added to a store
+        unsigned long shared;       // nodes found in a store instead
+        unsigned long lookups;      // apply cache lookups
+        unsigned long hits;         // apply cache hits
+        unsigned long collections;  // times a store was collected
+    } BddStoreStats;
+    DFA *dfaProductShared(DFA *a, DFA *b, dfaProductType ff);
+    // n-ary product, ff has to be dfaAND or dfaOR. Uses the store only if it
+    // is switched on, otherwise it is a chain of dfaProduct
+    DFA *dfaProductAll(DFA **dfas, int n, dfaProductType ff);
+    void bddStoreSetEnabled(int enabled);
+    int bddStoreIsEnabled(void);
+    void bddStoreGetStats(BddStoreStats *stats);
+
     //Utility function
     int getVar();
     int* getIndices();
-    void setPreciseWiden();
-    void setCoarseWiden();
     void flush_output();
     DFA *test_project(DFA *M, int var, int *oldindices, int len, int fast);
     
@@ -32,10 +32,6 @@
 
  *********************************************************************************/
 
-int xx1, xx2;
-
-int *corresP; //used by dfaEquivalence
-
 // A DFA that accepts everything except for the null (empty) string
 DFA *dfaNotNullString() {
 
@@ -63,7 +59,8 @@ DFA *dfaOnlyNullString() {
 }
 
 //recursively checks if state sa of a is equivalent to state sb of b
-int checK(DFA *a, DFA *b, bdd_ptr sa, bdd_ptr sb) {
+//corresP maps each state of a to its matched state of b, or -1
+static int checK(int *corresP, DFA *a, DFA *b, bdd_ptr sa, bdd_ptr sb) {
 	int leafa, leafb, nexta, nextb;
 	bdd_manager *abddm, *bbddm;
 	unsigned indexa, indexb;
@@ -81,7 +78,7 @@ int checK(DFA *a, DFA *b, bdd_ptr sa, bdd_ptr sb) {
 			if (a->f[nexta] != b->f[nextb])
 				return 0;
 			corresP[nexta] = nextb;
-			if (!checK(a, b, a->q[nexta], b->q[nextb]))
+			if (!checK(corresP, a, b, a->q[nexta], b->q[nextb]))
 				return 0;
 		} else
 			return corresP[nexta] == nextb;
@@ -92,8 +89,8 @@ int checK(DFA *a, DFA *b, bdd_ptr sa, bdd_ptr sb) {
 		LOAD_index(&bbddm->node_table[sb], indexb);
 		if (indexa != indexb)
 			return 0;
-		return checK(a, b, bdd_then(abddm, sa), bdd_then(bbddm, sb)) && checK(
-				a, b, bdd_else(abddm, sa), bdd_else(bbddm, sb));
+		return checK(corresP, a, b, bdd_then(abddm, sa), bdd_then(bbddm, sb))
+				&& checK(corresP, a, b, bdd_else(abddm, sa), bdd_else(bbddm, sb));
 	}
 	return 1;
 }
@@ -101,6 +98,7 @@ int checK(DFA *a, DFA *b, bdd_ptr sa, bdd_ptr sb) {
 //checks if L(A)=L(B)
 int dfaEquivalence(DFA *A, DFA *B) {
 	int i, nsa, nsb;
+	int *corresP;
 	DFA *a, *b, *temp, *t;
 
 	if ((A->f[A->s] == 1) && (B->f[B->s] == -1)) {
@@ -130,23 +128,34 @@ int dfaEquivalence(DFA *A, DFA *B) {
 	for (i = 0; i < nsa; i++)
 		corresP[i] = -1;
 	corresP[a->s] = b->s;
-	i = checK(a, b, a->q[a->s], b->q[b->s]);
+	i = checK(corresP, a, b, a->q[a->s], b->q[b->s]);
 	free(corresP);
 	dfaFree(a);
 	dfaFree(b);
 	return i;
 }
 
-//#define maxl 1000
-int maxl;
-int *corresPc, *corresPcc, *corresPPc;
-int **corresPl, **corresPll, **corresPPl;
-int SINKa, SINKb;
-int added;
-int hi;
-char **done;
+/*
+ * Working state of one dfaWiden call. Keeping it per call instead of in file
+ * level globals lets several threads widen at the same time.
+ */
+typedef struct _WidenContext {
+	// 1 means the coarse widening which guarantees termination
+	int coarse;
+	int maxl;
+	int *corresP;
+	int *corresPc, *corresPcc, *corresPPc;
+	int **corresPl, **corresPll, **corresPPl;
+	int SINKa, SINKb;
+	int added;
+	char **done;
+	int *classRepC;
+	int numClasses;
+} WidenContext;
 
-void check22(DFA *a, bdd_ptr sa, bdd_ptr sb) {
+int find_sink(DFA *a);
+
+static void check22(WidenContext *ctx, DFA *a, bdd_ptr sa, bdd_ptr sb) {
 	int leafa, leafb, nexta, nextb, i;
 	bdd_manager *abddm;
 	unsigned indexa, indexb;
@@ -159,64 +168,52 @@ void check22(DFA *a, bdd_ptr sa, bdd_ptr sb) {
 	if (leafa && leafb) { //both are leaf BDD nodes poining to next state
 		nexta = bdd_leaf_value(abddm, sa);
 		nextb = bdd_leaf_value(abddm, sb);
-		if ((nexta == SINKb) || (nextb == SINKb))
+		if ((nexta == ctx->SINKb) || (nextb == ctx->SINKb))
 			return;
-		for (i = 0; (i < corresPcc[nexta]) && (corresPll[i][nexta] != nextb); i++)
+		for (i = 0; (i < ctx->corresPcc[nexta]) && (ctx->corresPll[i][nexta] != nextb); i++)
 			;
-		if (i >= maxl) {
+		if (i >= ctx->maxl) {
 			printf("Limit exeeded. Increase maxl.\n");
 			exit(0);
-		} else if (i == corresPcc[nexta]) {
+		} else if (i == ctx->corresPcc[nexta]) {
 			//    if(nexta>=hi)
-			added = 1;
-			corresPll[corresPcc[nexta]++][nexta] = nextb;
-			if (!done[nexta][nextb] && !done[nextb][nexta]) {
-				done[nexta][nextb] = 1;
-				check22(a, a->q[nexta], a->q[nextb]);
+			ctx->added = 1;
+			ctx->corresPll[ctx->corresPcc[nexta]++][nexta] = nextb;
+			if (!ctx->done[nexta][nextb] && !ctx->done[nextb][nexta]) {
+				ctx->done[nexta][nextb] = 1;
+				check22(ctx, a, a->q[nexta], a->q[nextb]);
 			}
 		}
 		return;
 	} else if (leafa) {
-		check22(a, sa, bdd_then(abddm, sb));
-		check22(a, sa, bdd_else(abddm, sb));
+		check22(ctx, a, sa, bdd_then(abddm, sb));
+		check22(ctx, a, sa, bdd_else(abddm, sb));
 		return;
 	} else if (leafb) {
-		check22(a, bdd_then(abddm, sa), sb);
-		check22(a, bdd_else(abddm, sa), sb);
+		check22(ctx, a, bdd_then(abddm, sa), sb);
+		check22(ctx, a, bdd_else(abddm, sa), sb);
 		return;
 	} else { //both are internal BDD nodes
 		LOAD_index(&abddm->node_table[sa], indexa);
 		LOAD_index(&abddm->node_table[sb], indexb);
 		if (indexa == indexb) {
-			check22(a, bdd_then(abddm, sa), bdd_then(abddm, sb));
-			check22(a, bdd_else(abddm, sa), bdd_else(abddm, sb));
+			check22(ctx, a, bdd_then(abddm, sa), bdd_then(abddm, sb));
+			check22(ctx, a, bdd_else(abddm, sa), bdd_else(abddm, sb));
 			return;
 		} else if (indexa < indexb) {
-			check22(a, bdd_then(abddm, sa), sb);
-			check22(a, bdd_else(abddm, sa), sb);
+			check22(ctx, a, bdd_then(abddm, sa), sb);
+			check22(ctx, a, bdd_else(abddm, sa), sb);
 			return;
 		} else {
-			check22(a, sa, bdd_then(abddm, sb));
-			check22(a, sa, bdd_else(abddm, sb));
+			check22(ctx, a, sa, bdd_then(abddm, sb));
+			check22(ctx, a, sa, bdd_else(abddm, sb));
 			return;
 		}
 	}
 	return;
 }
-// this is a flag for the type of widening we should run
-// 1 means the coarse widening which guarantees termination
-int _COARSEWIDEN = 0;
-
-void setCoarseWiden(){
-	_COARSEWIDEN = 1;
-}
-
-void setPreciseWiden(){
-	_COARSEWIDEN = 0;
-}
-
 //used by dfaClasses
-void check2(DFA *a, DFA *b, bdd_ptr sa, bdd_ptr sb) {
+static void check2(WidenContext *ctx, DFA *a, DFA *b, bdd_ptr sa, bdd_ptr sb) {
 	int leafa, leafb, nexta, nextb, i;
 	bdd_manager *abddm, *bbddm;
 	unsigned indexa, indexb;
@@ -230,53 +227,49 @@ void check2(DFA *a, DFA *b, bdd_ptr sa, bdd_ptr sb) {
 	if (leafa && leafb) { //both are leaf BDD nodes poining to next state
 		nexta = bdd_leaf_value(abddm, sa);
 		nextb = bdd_leaf_value(bbddm, sb);
-		if (((nexta == SINKa) || (nextb == SINKb)) && (!_COARSEWIDEN))
+		if (((nexta == ctx->SINKa) || (nextb == ctx->SINKb)) && (!ctx->coarse))
 			return;
-		for (i = 0; (i < corresPc[nexta]) && (corresPl[i][nexta] != nextb); i++)
+		for (i = 0; (i < ctx->corresPc[nexta]) && (ctx->corresPl[i][nexta] != nextb); i++)
 			;
-		if (i >= maxl) {
+		if (i >= ctx->maxl) {
 			printf("Limit exeeded. Increase maxl.\n");
 			exit(0);
-		} else if (i == corresPc[nexta]) {
-			corresPl[corresPc[nexta]++][nexta] = nextb;
-			check2(a, b, a->q[nexta], b->q[nextb]);
+		} else if (i == ctx->corresPc[nexta]) {
+			ctx->corresPl[ctx->corresPc[nexta]++][nexta] = nextb;
+			check2(ctx, a, b, a->q[nexta], b->q[nextb]);
 			//    for(i-=1;i>=0;i--)
-			//      check22(b,b->q[corresPl[i][nexta]],b->q[nextb]);
+			//      check22(ctx, b,b->q[ctx->corresPl[i][nexta]],b->q[nextb]);
 		}
 		return;
 	} else if (leafa) {
-		check2(a, b, sa, bdd_then(bbddm, sb));
-		check2(a, b, sa, bdd_else(bbddm, sb));
+		check2(ctx, a, b, sa, bdd_then(bbddm, sb));
+		check2(ctx, a, b, sa, bdd_else(bbddm, sb));
 		return;
 	} else if (leafb) {
-		check2(a, b, bdd_then(abddm, sa), sb);
-		check2(a, b, bdd_else(abddm, sa), sb);
+		check2(ctx, a, b, bdd_then(abddm, sa), sb);
+		check2(ctx, a, b, bdd_else(abddm, sa), sb);
 		return;
 	} else { //both are internal BDD nodes
 		LOAD_index(&abddm->node_table[sa], indexa);
 		LOAD_index(&bbddm->node_table[sb], indexb);
 		if (indexa == indexb) {
-			check2(a, b, bdd_then(abddm, sa), bdd_then(bbddm, sb));
-			check2(a, b, bdd_else(abddm, sa), bdd_else(bbddm, sb));
+			check2(ctx, a, b, bdd_then(abddm, sa), bdd_then(bbddm, sb));
+			check2(ctx, a, b, bdd_else(abddm, sa), bdd_else(bbddm, sb));
 			return;
 		} else if (indexa < indexb) {
-			check2(a, b, bdd_then(abddm, sa), sb);
-			check2(a, b, bdd_else(abddm, sa), sb);
+			check2(ctx, a, b, bdd_then(abddm, sa), sb);
+			check2(ctx, a, b, bdd_else(abddm, sa), sb);
 			return;
 		} else {
-			check2(a, b, sa, bdd_then(bbddm, sb));
-			check2(a, b, sa, bdd_else(bbddm, sb));
+			check2(ctx, a, b, sa, bdd_then(bbddm, sb));
+			check2(ctx, a, b, sa, bdd_else(bbddm, sb));
 			return;
 		}
 	}
 	return;
 }
 
-int *classRepA, *classRepB, *classRepC;
-int find_sink(DFA *a);
-int numClasses;
-
-int detail(DFA *a, DFA *b, bdd_ptr sa, bdd_ptr sb) {
+static int detail(DFA *a, DFA *b, bdd_ptr sa, bdd_ptr sb) {
 	int leafa, leafb;
 	bdd_manager *abddm, *bbddm;
 	unsigned indexa, indexb;
@@ -314,7 +307,7 @@ int detail(DFA *a, DFA *b, bdd_ptr sa, bdd_ptr sb) {
 	}
 }
 
-void dfaClasses(DFA *A, DFA *B) {
+static void dfaClasses(WidenContext *ctx, DFA *A, DFA *B) {
 	int i, j, k, l, nsa, nsb;
 	DFA *a, *b, *temp, *t;
 	int *visiteda, *visitedb;
@@ -341,37 +334,37 @@ void dfaClasses(DFA *A, DFA *B) {
 	nsa = a->ns;
 	nsb = b->ns;
 
-	maxl = b->ns;
+	ctx->maxl = b->ns;
 
 	//find "forward corresponding" states
-	corresPc = (int *) malloc((nsa + nsb) * sizeof(int));
-	corresPl = (int **) malloc(maxl * sizeof(int *));
-	done = (char **) malloc(maxl * sizeof(char *));
-	corresPcc = corresPc + nsa;
-	corresPll = (int **) malloc(maxl * sizeof(int *));
-	for (i = 0; i < maxl; i++)
-		corresPl[i] = (int *) malloc((nsa + nsb) * sizeof(int));
-	for (i = 0; i < maxl; i++)
-		done[i] = (char *) malloc(nsb * sizeof(char));
-	for (i = 0; i < maxl; i++)
-		for (j = 0; j < maxl; j++)
-			done[i][j] = 0;
-	for (i = 0; i < maxl; i++)
-		corresPll[i] = corresPl[i] + nsa;
+	ctx->corresPc = (int *) malloc((nsa + nsb) * sizeof(int));
+	ctx->corresPl = (int **) malloc(ctx->maxl * sizeof(int *));
+	ctx->done = (char **) malloc(ctx->maxl * sizeof(char *));
+	ctx->corresPcc = ctx->corresPc + nsa;
+	ctx->corresPll = (int **) malloc(ctx->maxl * sizeof(int *));
+	for (i = 0; i < ctx->maxl; i++)
+		ctx->corresPl[i] = (int *) malloc((nsa + nsb) * sizeof(int));
+	for (i = 0; i < ctx->maxl; i++)
+		ctx->done[i] = (char *) malloc(nsb * sizeof(char));
+	for (i = 0; i < ctx->maxl; i++)
+		for (j = 0; j < ctx->maxl; j++)
+			ctx->done[i][j] = 0;
+	for (i = 0; i < ctx->maxl; i++)
+		ctx->corresPll[i] = ctx->corresPl[i] + nsa;
 	for (i = 0; i < nsa; i++)
-		corresPc[i] = 0;
+		ctx->corresPc[i] = 0;
 	for (i = 0; i < nsb; i++)
-		corresPcc[i] = 1;
+		ctx->corresPcc[i] = 1;
 	for (i = 0; i < nsb; i++)
-		corresPll[0][i] = i;
-	corresPc[a->s] = 1;
-	corresPl[0][a->s] = b->s;
-	SINKa = find_sink(a);
-	SINKb = find_sink(b);
-	check2(a, b, a->q[a->s], b->q[b->s]);
+		ctx->corresPll[0][i] = i;
+	ctx->corresPc[a->s] = 1;
+	ctx->corresPl[0][a->s] = b->s;
+	ctx->SINKa = find_sink(a);
+	ctx->SINKb = find_sink(b);
+	check2(ctx, a, b, a->q[a->s], b->q[b->s]);
 
 	//find equivalent states
-	corresP = (int *) malloc(nsa * sizeof(int));
+	ctx->corresP = (int *) malloc(nsa * sizeof(int));
 	visiteda = (int *) malloc(nsa * sizeof(int));
 	visitedb = (int *) malloc(nsb * sizeof(int));
 
@@ -393,25 +386,25 @@ void dfaClasses(DFA *A, DFA *B) {
 				break;
 			if (a->f[i] == b->f[j]) {
 				for (k = 0; k < nsa; k++)
-					corresP[k] = -1;
-				corresP[i] = j;
-				if (checK(a, b, a->q[i], b->q[j])) {
+					ctx->corresP[k] = -1;
+				ctx->corresP[i] = j;
+				if (checK(ctx->corresP, a, b, a->q[i], b->q[j])) {
 					for (k = 0; k < nsa; k++)
-						if (corresP[k] != -1) {
+						if (ctx->corresP[k] != -1) {
 							visiteda[k] = 1;
-							visitedb[corresP[k]] = 1;
-							//printf("%d<=>%d\n",k,corresP[k]);
+							visitedb[ctx->corresP[k]] = 1;
+							//printf("%d<=>%d\n",k,ctx->corresP[k]);
 							//also modify corresPc and corresPl
-							for (l = 0; (l < corresPc[k]) && (corresPl[l][k]
-									!= corresP[k]); l++)
+							for (l = 0; (l < ctx->corresPc[k]) && (ctx->corresPl[l][k]
+									!= ctx->corresP[k]); l++)
 								;
-							if (l >= maxl) {
+							if (l >= ctx->maxl) {
 								printf("Limit exeeded. Increase maxl.\n");
 								exit(0);
-							} else if (l == corresPc[k]) {
-								corresPl[corresPc[k]++][k] = corresP[k];
+							} else if (l == ctx->corresPc[k]) {
+								ctx->corresPl[ctx->corresPc[k]++][k] = ctx->corresP[k];
 								//               for(l-=1;l>=0;l--)
-								//                 check22(b,b->q[corresPl[l][k]],b->q[corresP[k]]);
+								//                 check22(ctx, b,b->q[ctx->corresPl[l][k]],b->q[ctx->corresP[k]]);
 							}
 						}
 					j = nsb;
@@ -426,69 +419,69 @@ void dfaClasses(DFA *A, DFA *B) {
 	do {
 
 		//merge classes
-		added = 0;
+		ctx->added = 0;
 
 		for (i = nsa + nsb - 1; i > 0; i--) {
 			for (j = i - 1; j >= 0; j--) {
 				l = 0;
-				for (k = 0; k < corresPc[i]; k++) {
-					for (l = 0; (l < corresPc[j]) && (corresPl[k][i]
-							!= corresPl[l][j]); l++)
+				for (k = 0; k < ctx->corresPc[i]; k++) {
+					for (l = 0; (l < ctx->corresPc[j]) && (ctx->corresPl[k][i]
+							!= ctx->corresPl[l][j]); l++)
 						;
-					if (l < corresPc[j])
+					if (l < ctx->corresPc[j])
 						break;
 				}
-				if (k < corresPc[i]) {
-					for (k = 0; k < corresPc[i]; k++) {
-						for (l = 0; (l < corresPc[j]) && (corresPl[k][i]
-								!= corresPl[l][j]); l++)
+				if (k < ctx->corresPc[i]) {
+					for (k = 0; k < ctx->corresPc[i]; k++) {
+						for (l = 0; (l < ctx->corresPc[j]) && (ctx->corresPl[k][i]
+								!= ctx->corresPl[l][j]); l++)
 							;
-						if (l == corresPc[j]) {
-							if (l >= maxl) {
+						if (l == ctx->corresPc[j]) {
+							if (l >= ctx->maxl) {
 								printf("Limit exeeded. Increase maxl.\n");
 								exit(0);
 							}
-							corresPl[l][j] = corresPl[k][i];
-							corresPc[j]++;
+							ctx->corresPl[l][j] = ctx->corresPl[k][i];
+							ctx->corresPc[j]++;
 
 							/*
 							 //Here begins the mess
 							 for(l-=1;l>=0;l--)
-							 if(!done[corresPl[l][j]][corresPl[k][i]]&&!done[corresPl[k][i]][corresPl[l][j]]){
-							 done[corresPl[l][j]][corresPl[k][i]]=1;
+							 if(!ctx->done[ctx->corresPl[l][j]][ctx->corresPl[k][i]]&&!ctx->done[ctx->corresPl[k][i]][ctx->corresPl[l][j]]){
+							 ctx->done[ctx->corresPl[l][j]][ctx->corresPl[k][i]]=1;
 							 hi=i-nsa;
-							 check22(b,b->q[corresPl[l][j]],b->q[corresPl[k][i]]);
+							 check22(ctx, b,b->q[ctx->corresPl[l][j]],b->q[ctx->corresPl[k][i]]);
 							 }
 							 */
 
 						}
 					}
 					if (i < nsa)
-						corresPc[i] = 0;
+						ctx->corresPc[i] = 0;
 					j = -1;
 				}
 			}
 		}
 
-		added = 0;
+		ctx->added = 0;
 		for (k = 0; k < nsa + nsb; k++)
-			for (i = 0; (i < corresPc[k] - 1); i++)
-				for (j = i + 1; j < corresPc[k]; j++)
-					if (!done[corresPl[i][k]][corresPl[j][k]]
-							&& !done[corresPl[j][k]][corresPl[i][k]]) {
-						done[corresPl[i][k]][corresPl[j][k]] = 1;
-						check22(b, b->q[corresPl[i][k]], b->q[corresPl[j][k]]);
+			for (i = 0; (i < ctx->corresPc[k] - 1); i++)
+				for (j = i + 1; j < ctx->corresPc[k]; j++)
+					if (!ctx->done[ctx->corresPl[i][k]][ctx->corresPl[j][k]]
+							&& !ctx->done[ctx->corresPl[j][k]][ctx->corresPl[i][k]]) {
+						ctx->done[ctx->corresPl[i][k]][ctx->corresPl[j][k]] = 1;
+						check22(ctx, b, b->q[ctx->corresPl[i][k]], b->q[ctx->corresPl[j][k]]);
 					}
 
-	} while (added == 1);
+	} while (ctx->added == 1);
 
 	/*
 	 //make accepting classes, accepting
 	 for(i=0;i<nsa;i++){
-	 if((corresPc[i]>0)&&(b->f[corresPl[0][i]]!=1)){
-	 for(j=1;j<corresPc[i];j++){
-	 if(b->f[corresPl[j][i]]==1){
-	 b->f[corresPl[0][i]]=1;
+	 if((ctx->corresPc[i]>0)&&(b->f[ctx->corresPl[0][i]]!=1)){
+	 for(j=1;j<ctx->corresPc[i];j++){
+	 if(b->f[ctx->corresPl[j][i]]==1){
+	 b->f[ctx->corresPl[0][i]]=1;
 	 break;
 	 }
 	 }
@@ -496,44 +489,44 @@ void dfaClasses(DFA *A, DFA *B) {
 	 }
 	 */
 
-	corresPPc = (int *) malloc(maxl * sizeof(int));
-	corresPPl = (int **) malloc(maxl * sizeof(int *));
-	for (i = 0; i < maxl; i++)
-		corresPPl[i] = (int *) malloc(maxl * sizeof(int));
-	classRepC = (int *) malloc(nsb * sizeof(int));
+	ctx->corresPPc = (int *) malloc(ctx->maxl * sizeof(int));
+	ctx->corresPPl = (int **) malloc(ctx->maxl * sizeof(int *));
+	for (i = 0; i < ctx->maxl; i++)
+		ctx->corresPPl[i] = (int *) malloc(ctx->maxl * sizeof(int));
+	ctx->classRepC = (int *) malloc(nsb * sizeof(int));
 	for (i = 0; i < nsb; i++)
-		classRepC[i] = -1;
+		ctx->classRepC[i] = -1;
 	j = 0;
 	for (i = 0; i < nsa; i++)
-		if (corresPc[i] > 0) {
-			for (k = 0; k < corresPc[i]; k++) {
-				corresPPl[k][j] = corresPl[k][i];
-				classRepC[corresPPl[k][j]] = j;
+		if (ctx->corresPc[i] > 0) {
+			for (k = 0; k < ctx->corresPc[i]; k++) {
+				ctx->corresPPl[k][j] = ctx->corresPl[k][i];
+				ctx->classRepC[ctx->corresPPl[k][j]] = j;
 			}
-			corresPPc[j] = corresPc[i];
+			ctx->corresPPc[j] = ctx->corresPc[i];
 			j++;
 		}
 
 	for (i = 0; i < nsb; i++)
-		if (classRepC[i] == -1) {
-			if (corresPcc[i] > 1) {
-				for (k = 0; k < corresPcc[i]; k++) {
-					corresPPl[k][j] = corresPll[k][i];
-					classRepC[corresPPl[k][j]] = j;
+		if (ctx->classRepC[i] == -1) {
+			if (ctx->corresPcc[i] > 1) {
+				for (k = 0; k < ctx->corresPcc[i]; k++) {
+					ctx->corresPPl[k][j] = ctx->corresPll[k][i];
+					ctx->classRepC[ctx->corresPPl[k][j]] = j;
 				}
-				corresPPc[j] = corresPcc[i];
+				ctx->corresPPc[j] = ctx->corresPcc[i];
 				j++;
 			}
 		}
 
 	for (i = 0; i < nsb; i++)
-		if (classRepC[i] == -1) {
-			corresPPc[j] = 1;
-			corresPPl[0][j] = i;
-			classRepC[i] = j;
+		if (ctx->classRepC[i] == -1) {
+			ctx->corresPPc[j] = 1;
+			ctx->corresPPl[0][j] = i;
+			ctx->classRepC[i] = j;
 			j++;
 		}
-	numClasses = j;
+	ctx->numClasses = j;
 
 	/*
 	 //define class representatives
@@ -545,9 +538,9 @@ void dfaClasses(DFA *A, DFA *B) {
 	 classRepA[i]=-1;
 	 }
 	 for(i=0;i<nsa;i++)
-	 for(j=0;j<corresPc[i];j++){
-	 classRepB[corresPl[j][i]]=corresPl[0][i];
-	 classRepA[corresPl[j][i]]=i;
+	 for(j=0;j<ctx->corresPc[i];j++){
+	 classRepB[ctx->corresPl[j][i]]=ctx->corresPl[0][i];
+	 classRepA[ctx->corresPl[j][i]]=i;
 	 }
 	 for(i=0;i<nsb;i++){
 	 if(b->f[classRepB[i]]==1)
@@ -556,129 +549,18 @@ void dfaClasses(DFA *A, DFA *B) {
 	 */
 
 	//clear the mess
-	free(corresP);
+	free(ctx->corresP);
 	free(visiteda);
 	free(visitedb);
-	for (i = 0; i < maxl; i++)
-		free(done[i]);
-	free(done);
+	for (i = 0; i < ctx->maxl; i++)
+		free(ctx->done[i]);
+	free(ctx->done);
 	dfaFree(a);
 	dfaFree(b);
 	return;
 }
 
-int fromS;
-int fromPath[50];
-int fromIndy[50];
-int *fromIndex;
-int fromCount;
-int at;
-
-int nonsink(bdd_manager *abddm, bdd_ptr sa) {
-	unsigned l, r, index;
-
-	LOAD_lri(&abddm->node_table[sa], l, r, index);
-	if (index == BDD_LEAF_INDEX) {
-		if (l == SINKb)
-			return -1;
-		else
-			return classRepB[l];
-	}
-
-	else {
-
-		while ((fromIndex[at] < index) && (at <= fromCount))
-			at++;
-
-		if (at <= fromCount) {
-			if (fromPath[at++] == 0)
-				return nonsink(abddm, l);
-			else
-				return nonsink(abddm, r);
-		}
-
-		else {
-			if ((nonsink(abddm, l) == -1) && (nonsink(abddm, r) == -1))
-				return -1;
-			else
-				return -2;
-		}
-	}
-}
-
-int torepcaller;
-bdd_manager *cbddm;
-
-bdd_ptr torep(DFA *a, bdd_ptr sa) {
-	unsigned l, r, index;
-	int dest, i, tempdest;
-
-	bdd_manager *abddm;
-	bdd_ptr L, R;
-	int split;
-
-	abddm = a->bddm;
-
-	LOAD_lri(&abddm->node_table[sa], l, r, index);
-	if (index == BDD_LEAF_INDEX) {
-		dest = classRepB[l];
-		if (dest == SINKb) {
-			if (classRepA[fromS] != -1) {
-				split = 0;
-				for (i = 1; i < corresPc[classRepA[fromS]]; i++) {
-					at = 0;
-					tempdest = nonsink(abddm,
-							a->q[corresPl[i][classRepA[fromS]]]);
-					if (tempdest >= 0) {
-						return bdd_find_leaf_hashed_add_root(cbddm, tempdest);
-					} else if (tempdest == -2)
-						split = 1;
-				}
-				if (split) {
-					fromCount++;
-					fromIndex[fromCount] = fromIndex[fromCount - 1] + 2;
-					fromPath[fromCount] = 0;
-					L = torep(a, sa);
-					torepcaller = sa;
-					fromPath[fromCount] = 1;
-					R = torep(a, sa);
-					fromCount--;
-					return bdd_find_node_hashed_add_root(cbddm, L, R,
-							fromIndex[fromCount + 1]);
-				}
-			}
-		}
-		return bdd_find_leaf_hashed_add_root(cbddm, dest);
-	} else if (index == fromIndex[fromCount] + 2) {
-		torepcaller = sa;
-		fromCount++;
-		fromIndex[fromCount] = index;
-		fromPath[fromCount] = 0;
-		L = torep(a, l);
-		torepcaller = sa;
-		fromPath[fromCount] = 1;
-		R = torep(a, r);
-		fromCount--;
-		return bdd_find_node_hashed_add_root(cbddm, L, R, index);
-	} else {
-		fromCount++;
-		fromIndex[fromCount] = fromIndex[fromCount - 1] + 2;
-		fromPath[fromCount] = 0;
-		L = torep(a, sa);
-		torepcaller = sa;
-		fromPath[fromCount] = 1;
-		R = torep(a, sa);
-		fromCount--;
-		return bdd_find_node_hashed_add_root(cbddm, L, R, fromIndex[fromCount
-				+ 1]);
-
-	}
-}
-
-int *reachable;
-int reachc;
-
-void reach(DFA *a, bdd_ptr sa) {
+static void reach(DFA *a, bdd_ptr sa, int *reachable, int *reachc) {
 	unsigned l, r, index;
 
 	LOAD_lri(&(a->bddm)->node_table[sa], l, r, index);
@@ -686,18 +568,16 @@ void reach(DFA *a, bdd_ptr sa) {
 	if (index == BDD_LEAF_INDEX) {
 		if (reachable[l] == 0) {
 			reachable[l] = 1;
-			reachc++;
-			reach(a, a->q[l]);
+			(*reachc)++;
+			reach(a, a->q[l], reachable, reachc);
 		}
 	} else {
-		reach(a, r);
-		reach(a, l);
+		reach(a, r, reachable, reachc);
+		reach(a, l, reachable, reachc);
 	}
 }
 
-int *ren;
-
-void reName(bdd_manager *abddm, bdd_ptr sa) {
+static void reName(bdd_manager *abddm, bdd_ptr sa, int *ren) {
 	unsigned l, r, index;
 
 	if ((&abddm->node_table[sa])->mark)
@@ -710,8 +590,8 @@ void reName(bdd_manager *abddm, bdd_ptr sa) {
 		}
 		return;
 	} else {
-		reName(abddm, r);
-		reName(abddm, l);
+		reName(abddm, r, ren);
+		reName(abddm, l, ren);
 		return;
 	}
 }
@@ -719,6 +599,8 @@ void reName(bdd_manager *abddm, bdd_ptr sa) {
 DFA *dfaClean(DFA *a) {
 	DFA *c;
 	int i, j;
+	int *reachable, *ren;
+	int reachc;
 
 
 
@@ -728,7 +610,7 @@ DFA *dfaClean(DFA *a) {
 		reachable[i] = 0;
 	reachable[a->s] = 1;
 	reachc = 1;
-	reach(a, a->q[a->s]);
+	reach(a, a->q[a->s], reachable, &reachc);
 
 	c = dfaMake(reachc);
 	c->ns = reachc;
@@ -754,18 +636,20 @@ DFA *dfaClean(DFA *a) {
 			j++;
 	bdd_prepare_apply1(c->bddm);
 	for (i = 0; i < c->ns; i++)
-		reName(c->bddm, c->q[i]);
+		reName(c->bddm, c->q[i], ren);
 
 	free(ren);
 	free(reachable);
 	return c;
 }
 
-int SINK5;
-int num5;
-int *indices5;
+typedef struct _Project5Context {
+	int sink;
+	int num;
+	int *indices;
+} Project5Context;
 
-bdd_ptr visit5(DFA *a, bdd_ptr sa, bdd_ptr sb) {
+static bdd_ptr visit5(Project5Context *ctx, DFA *a, bdd_ptr sa, bdd_ptr sb) {
 	bdd_ptr la, ra, indexa, lb, rb, indexb, L, R;
 	int i;
 
@@ -773,62 +657,62 @@ bdd_ptr visit5(DFA *a, bdd_ptr sa, bdd_ptr sb) {
 	LOAD_lri(&a->bddm->node_table[sb], lb, rb, indexb);
 
 	if (indexa == BDD_LEAF_INDEX && indexb == BDD_LEAF_INDEX) {
-		if (la != SINK5)
+		if (la != ctx->sink)
 			return bdd_find_leaf_hashed_add_root(a->bddm, la);
 		else
 			return bdd_find_leaf_hashed_add_root(a->bddm, lb);
 	}
 
 	else if (indexa == BDD_LEAF_INDEX) {
-		L = visit5(a, sa, lb);
-		R = visit5(a, sa, rb);
-		for (i = 0; (i < num5) && (indices5[i] != indexb); i++)
+		L = visit5(ctx, a, sa, lb);
+		R = visit5(ctx, a, sa, rb);
+		for (i = 0; (i < ctx->num) && (ctx->indices[i] != indexb); i++)
 			;
-		if (i == num5)
+		if (i == ctx->num)
 			return bdd_find_node_hashed_add_root(a->bddm, L, R, indexb);
 		else
-			return visit5(a, L, R);
+			return visit5(ctx, a, L, R);
 	}
 
 	else if (indexb == BDD_LEAF_INDEX) {
-		L = visit5(a, la, sb);
-		R = visit5(a, ra, sb);
-		for (i = 0; (i < num5) && (indices5[i] != indexa); i++)
+		L = visit5(ctx, a, la, sb);
+		R = visit5(ctx, a, ra, sb);
+		for (i = 0; (i < ctx->num) && (ctx->indices[i] != indexa); i++)
 			;
-		if (i == num5)
+		if (i == ctx->num)
 			return bdd_find_node_hashed_add_root(a->bddm, L, R, indexa);
 		else
-			return visit5(a, L, R);
+			return visit5(ctx, a, L, R);
 	}
 
 	else {
 		if (indexa < indexb) {
-			L = visit5(a, la, sb);
-			R = visit5(a, ra, sb);
-			for (i = 0; (i < num5) && (indices5[i] != indexa); i++)
+			L = visit5(ctx, a, la, sb);
+			R = visit5(ctx, a, ra, sb);
+			for (i = 0; (i < ctx->num) && (ctx->indices[i] != indexa); i++)
 				;
-			if (i == num5)
+			if (i == ctx->num)
 				return bdd_find_node_hashed_add_root(a->bddm, L, R, indexa);
 			else
-				return visit5(a, L, R);
+				return visit5(ctx, a, L, R);
 		} else if (indexb < indexa) {
-			L = visit5(a, sa, lb);
-			R = visit5(a, sa, rb);
-			for (i = 0; (i < num5) && (indices5[i] != indexb); i++)
+			L = visit5(ctx, a, sa, lb);
+			R = visit5(ctx, a, sa, rb);
+			for (i = 0; (i < ctx->num) && (ctx->indices[i] != indexb); i++)
 				;
-			if (i == num5)
+			if (i == ctx->num)
 				return bdd_find_node_hashed_add_root(a->bddm, L, R, indexb);
 			else
-				return visit5(a, L, R);
+				return visit5(ctx, a, L, R);
 		} else {
-			L = visit5(a, la, lb);
-			R = visit5(a, ra, rb);
-			for (i = 0; (i < num5) && (indices5[i] != indexb); i++)
+			L = visit5(ctx, a, la, lb);
+			R = visit5(ctx, a, ra, rb);
+			for (i = 0; (i < ctx->num) && (ctx->indices[i] != indexb); i++)
 				;
-			if (i == num5)
+			if (i == ctx->num)
 				return bdd_find_node_hashed_add_root(a->bddm, L, R, indexb);
 			else
-				return visit5(a, L, R);
+				return visit5(ctx, a, L, R);
 		}
 	}
 }
@@ -836,20 +720,22 @@ bdd_ptr visit5(DFA *a, bdd_ptr sa, bdd_ptr sb) {
 void project5(DFA *a, int num, int *indices) {
 	//DFA *d;
 	int i;
+	Project5Context ctx5;
+	Project5Context *ctx = &ctx5;
 
-	num5 = num;
-	indices5 = indices;
-	SINK5 = find_sink(a);
+	ctx->num = num;
+	ctx->indices = indices;
+	ctx->sink = find_sink(a);
 
 	//d=dfaMake(a->ns);
 	//d->ns=a->ns;
 	//d->s=a->s;
 	for (i = 0; i < a->ns; i++) {
-		a->q[i] = visit5(a, a->q[i], a->q[i]);
+		a->q[i] = visit5(ctx, a, a->q[i], a->q[i]);
 	}
 }
 
-bdd_ptr merge1(DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
+static bdd_ptr merge1(int sink, DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
 	bdd_ptr la, lb, ra, rb, indexa, indexb;
 	bdd_ptr L, R;
 
@@ -857,7 +743,7 @@ bdd_ptr merge1(DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
 	LOAD_lri(&a->bddm->node_table[sb], lb, rb, indexb);
 
 	if (indexa == BDD_LEAF_INDEX && indexb == BDD_LEAF_INDEX) {
-		if (la != SINKa) {
+		if (la != sink) {
 			return bdd_find_leaf_hashed_add_root(d->bddm, la);
 		} else {
 			return bdd_find_leaf_hashed_add_root(d->bddm, lb);
@@ -865,35 +751,35 @@ bdd_ptr merge1(DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
 	}
 
 	else if (indexa == BDD_LEAF_INDEX) {
-		L = merge1(a, d, sa, lb);
-		R = merge1(a, d, sa, rb);
+		L = merge1(sink, a, d, sa, lb);
+		R = merge1(sink, a, d, sa, rb);
 		return bdd_find_node_hashed_add_root(d->bddm, L, R, indexb);
 	}
 
 	else if (indexb == BDD_LEAF_INDEX) {
-		L = merge1(a, d, la, sb);
-		R = merge1(a, d, ra, sb);
+		L = merge1(sink, a, d, la, sb);
+		R = merge1(sink, a, d, ra, sb);
 		return bdd_find_node_hashed_add_root(d->bddm, L, R, indexa);
 	}
 
 	else {
 		if (indexa < indexb) {
-			L = merge1(a, d, la, sb);
-			R = merge1(a, d, ra, sb);
+			L = merge1(sink, a, d, la, sb);
+			R = merge1(sink, a, d, ra, sb);
 			return bdd_find_node_hashed_add_root(d->bddm, L, R, indexa);
 		} else if (indexb < indexa) {
-			L = merge1(a, d, sa, lb);
-			R = merge1(a, d, sa, rb);
+			L = merge1(sink, a, d, sa, lb);
+			R = merge1(sink, a, d, sa, rb);
 			return bdd_find_node_hashed_add_root(d->bddm, L, R, indexb);
 		} else {
-			L = merge1(a, d, la, lb);
-			R = merge1(a, d, ra, rb);
+			L = merge1(sink, a, d, la, lb);
+			R = merge1(sink, a, d, ra, rb);
 			return bdd_find_node_hashed_add_root(d->bddm, L, R, indexa);
 		}
 	}
 }
 
-bdd_ptr visit6(DFA *a, DFA *d, bdd_ptr sa, unsigned index) {
+static bdd_ptr visit6(int sink, DFA *a, DFA *d, bdd_ptr sa, unsigned index) {
 	bdd_ptr la, ra, indexa;
 	bdd_ptr L, R;
 
@@ -904,13 +790,13 @@ bdd_ptr visit6(DFA *a, DFA *d, bdd_ptr sa, unsigned index) {
 	}
 
 	else if (indexa == index) {
-		L = merge1(a, d, la, ra);
+		L = merge1(sink, a, d, la, ra);
 		return L;
 	}
 
 	else {
-		L = visit6(a, d, la, index);
-		R = visit6(a, d, ra, index);
+		L = visit6(sink, a, d, la, index);
+		R = visit6(sink, a, d, ra, index);
 		return bdd_find_node_hashed_add_root(d->bddm, L, R, indexa);
 	}
 }
@@ -918,20 +804,20 @@ bdd_ptr visit6(DFA *a, DFA *d, bdd_ptr sa, unsigned index) {
 DFA *project6(DFA *a, unsigned index) {
 	DFA *d;
 	int i;
+	int sink = find_sink(a);
 
-	SINKa = find_sink(a);
 	d = dfaMake(a->ns);
 	d->ns = a->ns;
 	d->s = a->s;
 	for (i = 0; i < a->ns; i++) {
-		d->q[i] = visit6(a, d, a->q[i], index);
+		d->q[i] = visit6(sink, a, d, a->q[i], index);
 		d->f[i] = a->f[i];
 	}
 	return d;
 }
 
 //merge nodes sa and sb of DFA a in a "new" node in DFA d
-bdd_ptr merge(DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
+static bdd_ptr merge(WidenContext *ctx, DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
 	bdd_ptr la, lb, ra, rb, indexa, indexb;
 	bdd_ptr L, R;
 
@@ -939,14 +825,13 @@ bdd_ptr merge(DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
 	LOAD_lri(&a->bddm->node_table[sb], lb, rb, indexb);
 
 	if (indexa == BDD_LEAF_INDEX && indexb == BDD_LEAF_INDEX) {
-		if (la != SINKb) {
+		if (la != ctx->SINKb) {
 			if (a == d)
 				L = la;
 			else {
-				L = classRepC[la];
-				if ((lb != SINKb) && (classRepC[la] != classRepC[lb])) {
+				L = ctx->classRepC[la];
+				if ((lb != ctx->SINKb) && (ctx->classRepC[la] != ctx->classRepC[lb])) {
 					printf("Classes inconsistent\n");
-					//          printf("We got a problem here. %d goes to %d, but %d goes to %d\n",xx1,la,xx2,lb);
 					// char *names[10]={"x","x","x","x","x","x","x","x","x","x"};
 					// int ind[10]={0,2,4,6,8,10,12,14,16,18};
 					//          dfaPrint(a,10,names,ind);
@@ -958,84 +843,83 @@ bdd_ptr merge(DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
 			if (a == d)
 				L = lb;
 			else
-				L = classRepC[lb];
+				L = ctx->classRepC[lb];
 			return bdd_find_leaf_hashed_add_root(d->bddm, L);
 		}
 	}
 
 	else if (indexa == BDD_LEAF_INDEX) {
-		L = merge(a, d, sa, lb);
-		R = merge(a, d, sa, rb);
+		L = merge(ctx, a, d, sa, lb);
+		R = merge(ctx, a, d, sa, rb);
 		return bdd_find_node_hashed_add_root(d->bddm, L, R, indexb);
 	}
 
 	else if (indexb == BDD_LEAF_INDEX) {
-		L = merge(a, d, la, sb);
-		R = merge(a, d, ra, sb);
+		L = merge(ctx, a, d, la, sb);
+		R = merge(ctx, a, d, ra, sb);
 		return bdd_find_node_hashed_add_root(d->bddm, L, R, indexa);
 	}
 
 	else {
 		if (indexa < indexb) {
-			L = merge(a, d, la, sb);
-			R = merge(a, d, ra, sb);
+			L = merge(ctx, a, d, la, sb);
+			R = merge(ctx, a, d, ra, sb);
 			return bdd_find_node_hashed_add_root(d->bddm, L, R, indexa);
 		} else if (indexb < indexa) {
-			L = merge(a, d, sa, lb);
-			R = merge(a, d, sa, rb);
+			L = merge(ctx, a, d, sa, lb);
+			R = merge(ctx, a, d, sa, rb);
 			return bdd_find_node_hashed_add_root(d->bddm, L, R, indexb);
 		} else {
-			L = merge(a, d, la, lb);
-			R = merge(a, d, ra, rb);
+			L = merge(ctx, a, d, la, lb);
+			R = merge(ctx, a, d, ra, rb);
 			return bdd_find_node_hashed_add_root(d->bddm, L, R, indexa);
 		}
 	}
 }
 
-bdd_ptr merge_single(DFA *a, DFA *d, bdd_ptr sa) {
+static bdd_ptr merge_single(WidenContext *ctx, DFA *a, DFA *d, bdd_ptr sa) {
 	bdd_ptr la, ra, indexa;
 
 	LOAD_lri(&a->bddm->node_table[sa], la, ra, indexa);
 
 	if (indexa == BDD_LEAF_INDEX) {
-		return bdd_find_leaf_hashed_add_root(d->bddm, classRepC[la]);
+		return bdd_find_leaf_hashed_add_root(d->bddm, ctx->classRepC[la]);
 	}
 
 	else {
-		return bdd_find_node_hashed_add_root(d->bddm, merge_single(a, d, la),
-				merge_single(a, d, ra), indexa);
+		return bdd_find_node_hashed_add_root(d->bddm, merge_single(ctx, a, d, la),
+				merge_single(ctx, a, d, ra), indexa);
 	}
 }
 
 //d is larger
-DFA *dfaWiden(DFA *a, DFA *d) {
+//coarse selects the coarse widening which guarantees termination
+DFA *dfaWidenMode(DFA *a, DFA *d, int coarse) {
 	DFA *c, *b;
 	int i, j;
+	WidenContext widenCtx;
+	WidenContext *ctx = &widenCtx;
 
+	ctx->coarse = coarse;
 	b = dfaCopy(d);
-	dfaClasses(a, b);
-	c = dfaMake(numClasses);
-	cbddm = c->bddm;
-	c->ns = numClasses;
-	c->s = classRepC[b->s];
+	dfaClasses(ctx, a, b);
+	c = dfaMake(ctx->numClasses);
+	c->ns = ctx->numClasses;
+	c->s = ctx->classRepC[b->s];
 
 	//printf("# of b nodes before merge: %d\n",bdd_size(b->bddm));
 	//printf("# of c nodes before merge: %d\n",bdd_size(c->bddm));
 	//printf("MONA memory:%d\n",mem_allocated());
 
-	for (i = 0; i < numClasses; i++) {
-		if (corresPPc[i] == 1)
-			c->q[i] = merge_single(b, c, b->q[corresPPl[0][i]]);
+	for (i = 0; i < ctx->numClasses; i++) {
+		if (ctx->corresPPc[i] == 1)
+			c->q[i] = merge_single(ctx, b, c, b->q[ctx->corresPPl[0][i]]);
 		else {
-			c->q[i] = b->q[corresPPl[0][i]];
-			for (j = 1; j < corresPPc[i] - 1; j++) {
-				xx1 = i;
-				xx2 = corresPPl[j][i];
-				c->q[i] = merge(b, b, c->q[i], b->q[corresPPl[j][i]]);
+			c->q[i] = b->q[ctx->corresPPl[0][i]];
+			for (j = 1; j < ctx->corresPPc[i] - 1; j++) {
+				c->q[i] = merge(ctx, b, b, c->q[i], b->q[ctx->corresPPl[j][i]]);
 			}
-			xx1 = i;
-			xx2 = corresPPl[j][i];
-			c->q[i] = merge(b, c, c->q[i], b->q[corresPPl[j][i]]);
+			c->q[i] = merge(ctx, b, c, c->q[i], b->q[ctx->corresPPl[j][i]]);
 		}
 	}
 
@@ -1043,119 +927,132 @@ DFA *dfaWiden(DFA *a, DFA *d) {
 	//printf("# of c nodes after merge: %d\n",bdd_size(c->bddm));
 //	printf("MONA memory:%d\n",mem_allocated());
 
-	for (i = 0; i < numClasses; i++) {
+	for (i = 0; i < ctx->numClasses; i++) {
 		c->f[i] = -1;
-		for (j = 0; j < corresPPc[i]; j++)
-			if (b->f[corresPPl[j][i]] == 1) {
+		for (j = 0; j < ctx->corresPPc[i]; j++)
+			if (b->f[ctx->corresPPl[j][i]] == 1) {
 				c->f[i] = 1;
 				break;
 			}
 	}
 
-	free(classRepC);
-	free(corresPPc);
-	for (i = 0; i < maxl; i++)
-		free(corresPPl[i]);
+	free(ctx->classRepC);
+	free(ctx->corresPPc);
+	for (i = 0; i < ctx->maxl; i++)
+		free(ctx->corresPPl[i]);
 
 	//free(classRepA);
 	//free(classRepB);
-	free(corresPc);
-	for (i = 0; i < maxl; i++)
-		free(corresPl[i]);
+	free(ctx->corresPc);
+	for (i = 0; i < ctx->maxl; i++)
+		free(ctx->corresPl[i]);
 	dfaFree(b);
 	b = dfaClean(c);
 	dfaFree(c);
 	return b;
 }
 
-static int **preds; /* preds[i] is the set of predecessors of i */
-static int *predalloc, *predused; /* allocated/used size of preds[i] */
+//d is larger
+DFA *dfaWiden(DFA *a, DFA *d) {
+	return dfaWidenMode(a, d, 0);
+}
 
-static int current_state;
+#define MAXV 50
 
-void successors0(bdd_manager *bddm, bdd_ptr p) {
+/*
+ * Working state of the prefix closure functions, one per call
+ */
+typedef struct _PredContext {
+	int **preds; /* preds[i] is the set of predecessors of i */
+	int *predalloc, *predused; /* allocated/used size of preds[i] */
+	int current_state;
+	int label[MAXV];//this array hold a path from the root to a leaf
+	//0 is low, 1 is high, 2 is don't care
+	//MAXV is the maximum number of variables, can be set accordingly
+	int numnexts;
+	int *nexts;
+	DFA *autom;
+	bdd_ptr target;
+	int *clone;
+} PredContext;
+
+static void successors0(PredContext *ctx, bdd_manager *bddm, bdd_ptr p) {
 	if (bdd_is_leaf(bddm, p)) {
 		int i;
 		int s = bdd_leaf_value(bddm, p); /* current_state is a predecessor of s */
 
-		for (i = 0; i < predused[s]; i++)
+		for (i = 0; i < ctx->predused[s]; i++)
 			/* already there? */
-			if (preds[s][i] == current_state)
+			if (ctx->preds[s][i] == ctx->current_state)
 				return;
 
-		if (predalloc[s] == predused[s]) { /* need to reallocate? */
-			predalloc[s] = predalloc[s] * 2 + 8;
-			preds[s] = (int *) mem_resize(preds[s], sizeof(int) * predalloc[s]);
+		if (ctx->predalloc[s] == ctx->predused[s]) { /* need to reallocate? */
+			ctx->predalloc[s] = ctx->predalloc[s] * 2 + 8;
+			ctx->preds[s] = (int *) mem_resize(ctx->preds[s], sizeof(int) * ctx->predalloc[s]);
 		}
 
-		preds[s][predused[s]++] = current_state;
+		ctx->preds[s][ctx->predused[s]++] = ctx->current_state;
 	} else {
-		successors0(bddm, bdd_else(bddm, p));
+		successors0(ctx, bddm, bdd_else(bddm, p));
 	}
 
 }
 
 void dfaPrefixClose0(DFA *a) {
+	PredContext predCtx;
+	PredContext *ctx = &predCtx;
 	unsigned i;
 	int *queue = (int *) mem_alloc(sizeof(int) * a->ns);
 	int queueused = 0, next = 0;
 
-	predalloc = (int *) mem_alloc(sizeof(int) * a->ns);
-	predused = (int *) mem_alloc(sizeof(int) * a->ns);
-	preds = (int **) mem_alloc(sizeof(int *) * a->ns);
+	ctx->predalloc = (int *) mem_alloc(sizeof(int) * a->ns);
+	ctx->predused = (int *) mem_alloc(sizeof(int) * a->ns);
+	ctx->preds = (int **) mem_alloc(sizeof(int *) * a->ns);
 	for (i = 0; i < a->ns; i++) {
-		predalloc[i] = predused[i] = 0;
-		preds[i] = 0;
+		ctx->predalloc[i] = ctx->predused[i] = 0;
+		ctx->preds[i] = 0;
 	}
 
 	/* find predecessor sets and initialize queue with final states */
 	for (i = 0; i < a->ns; i++) {
-		current_state = i;
-		successors0(a->bddm, a->q[i]);
+		ctx->current_state = i;
+		successors0(ctx, a->bddm, a->q[i]);
 		if (a->f[i] == 1)
 			queue[queueused++] = i;
 	}
 
 	/* color */
 	while (next < queueused) {
-		for (i = 0; i < predused[queue[next]]; i++)
-			if (a->f[preds[queue[next]][i]] != 1) {
-				a->f[preds[queue[next]][i]] = 1;
-				queue[queueused++] = preds[queue[next]][i];
+		for (i = 0; i < ctx->predused[queue[next]]; i++)
+			if (a->f[ctx->preds[queue[next]][i]] != 1) {
+				a->f[ctx->preds[queue[next]][i]] = 1;
+				queue[queueused++] = ctx->preds[queue[next]][i];
 			}
 		next++;
 	}
 
 	for (i = 0; i < a->ns; i++)
-		mem_free(preds[i]);
-	mem_free(preds);
-	mem_free(predused);
-	mem_free(predalloc);
+		mem_free(ctx->preds[i]);
+	mem_free(ctx->preds);
+	mem_free(ctx->predused);
+	mem_free(ctx->predalloc);
 	mem_free(queue);
 }
 
-#define MAXV 50
-int label[MAXV];//this array hold a path from the root to a leaf
-//0 is low, 1 is high, 2 is don't care
-//MAXV is the maximum number of variables, can be set accordingly
-int numnexts;
-int *nexts;
-DFA *autom;
-
-void toaccepting(bdd_manager *abddm, bdd_ptr sa) {
+static void toaccepting(PredContext *ctx, bdd_manager *abddm, bdd_ptr sa) {
 	unsigned index;
 
 	if (bdd_is_leaf(abddm, sa)) {
-		nexts[numnexts++] = bdd_leaf_value(abddm, sa);
+		ctx->nexts[ctx->numnexts++] = bdd_leaf_value(abddm, sa);
 	} else { //not a leaf
 		LOAD_index(&abddm->node_table[sa], index);
-		if (label[index] == 0)
-			toaccepting(abddm, bdd_else(abddm, sa));
-		if (label[index] == 1)
-			toaccepting(abddm, bdd_then(abddm, sa));
-		if (label[index] == 2) {
-			toaccepting(abddm, bdd_else(abddm, sa));
-			toaccepting(abddm, bdd_then(abddm, sa));
+		if (ctx->label[index] == 0)
+			toaccepting(ctx, abddm, bdd_else(abddm, sa));
+		if (ctx->label[index] == 1)
+			toaccepting(ctx, abddm, bdd_then(abddm, sa));
+		if (ctx->label[index] == 2) {
+			toaccepting(ctx, abddm, bdd_else(abddm, sa));
+			toaccepting(ctx, abddm, bdd_then(abddm, sa));
 		}
 	}
 }
@@ -1163,85 +1060,87 @@ void toaccepting(bdd_manager *abddm, bdd_ptr sa) {
 //Idea: krata to monopati apo th riza mexri ekei pou eisai twra
 //an eisai fyllo s, kame evaluate to monopati sth next state n
 //bale to s stous preds tou n
-void successors1(bdd_manager *bddm, bdd_ptr p) {
+static void successors1(PredContext *ctx, bdd_manager *bddm, bdd_ptr p) {
 	unsigned ind;
 	if (bdd_is_leaf(bddm, p)) {
 		int i, j;
 		int s = bdd_leaf_value(bddm, p); /* current_state is a predecessor of s*/
-		//    printf("%d,",current_state);
+		//    printf("%d,",ctx->current_state);
 		//    for(i=0;i<MAXV;i++)
-		//      printf("%d",label[i]);
+		//      printf("%d",ctx->label[i]);
 		//    printf(",%d\n",s);
 
-		numnexts = 0;
-		toaccepting(bddm, autom->q[s]);
-		for (j = 0; j < numnexts; j++) {
-			for (i = 0; i < predused[nexts[j]]; i++)
+		ctx->numnexts = 0;
+		toaccepting(ctx, bddm, ctx->autom->q[s]);
+		for (j = 0; j < ctx->numnexts; j++) {
+			for (i = 0; i < ctx->predused[ctx->nexts[j]]; i++)
 				/* already there? */
-				if (preds[nexts[j]][i] == s)
+				if (ctx->preds[ctx->nexts[j]][i] == s)
 					break;
-			if (i < predused[nexts[j]])
+			if (i < ctx->predused[ctx->nexts[j]])
 				continue;
 
-			if (predalloc[nexts[j]] == predused[nexts[j]]) { /* need to reallocate? */
-				predalloc[nexts[j]] = predalloc[nexts[j]] * 2 + 8;
-				preds[nexts[j]] = (int *) mem_resize(preds[nexts[j]],
-						sizeof(int) * predalloc[nexts[j]]);
+			if (ctx->predalloc[ctx->nexts[j]] == ctx->predused[ctx->nexts[j]]) { /* need to reallocate? */
+				ctx->predalloc[ctx->nexts[j]] = ctx->predalloc[ctx->nexts[j]] * 2 + 8;
+				ctx->preds[ctx->nexts[j]] = (int *) mem_resize(ctx->preds[ctx->nexts[j]],
+						sizeof(int) * ctx->predalloc[ctx->nexts[j]]);
 			}
-			preds[nexts[j]][predused[nexts[j]]++] = s;
+			ctx->preds[ctx->nexts[j]][ctx->predused[ctx->nexts[j]]++] = s;
 		}
 	} else {
 		ind = bdd_ifindex(bddm, p);
-		label[ind] = 0;
-		successors1(bddm, bdd_else(bddm, p));
-		label[ind] = 1;
-		successors1(bddm, bdd_then(bddm, p));
-		label[ind] = 2;
+		ctx->label[ind] = 0;
+		successors1(ctx, bddm, bdd_else(bddm, p));
+		ctx->label[ind] = 1;
+		successors1(ctx, bddm, bdd_then(bddm, p));
+		ctx->label[ind] = 2;
 	}
 
 }
 
 void dfaPrefixClose1(DFA *a) {
+	PredContext predCtx;
+	PredContext *ctx = &predCtx;
 	unsigned i;
 	int *queue = (int *) mem_alloc(sizeof(int) * a->ns);
 	int queueused = 0, next = 0;
 
 	for (i = 0; i < MAXV; i++)
-		label[i] = 2;
-	autom = a;
-	nexts = (int *) mem_alloc(sizeof(int) * a->ns);
-	predalloc = (int *) mem_alloc(sizeof(int) * a->ns);
-	predused = (int *) mem_alloc(sizeof(int) * a->ns);
-	preds = (int **) mem_alloc(sizeof(int *) * a->ns);
+		ctx->label[i] = 2;
+	ctx->autom = a;
+	ctx->nexts = (int *) mem_alloc(sizeof(int) * a->ns);
+	ctx->predalloc = (int *) mem_alloc(sizeof(int) * a->ns);
+	ctx->predused = (int *) mem_alloc(sizeof(int) * a->ns);
+	ctx->preds = (int **) mem_alloc(sizeof(int *) * a->ns);
 	for (i = 0; i < a->ns; i++) {
-		predalloc[i] = predused[i] = 0;
-		preds[i] = 0;
+		ctx->predalloc[i] = ctx->predused[i] = 0;
+		ctx->preds[i] = 0;
 	}
 
 	/* find predecessor sets and initialize queue with final states */
 	for (i = 0; i < a->ns; i++) {
-		current_state = i;
-		successors1(a->bddm, a->q[i]);
+		ctx->current_state = i;
+		successors1(ctx, a->bddm, a->q[i]);
 		if (a->f[i] == 1)
 			queue[queueused++] = i;
 	}
 
 	/* color */
 	while (next < queueused) {
-		for (i = 0; i < predused[queue[next]]; i++)
-			if (a->f[preds[queue[next]][i]] != 1) {
-				a->f[preds[queue[next]][i]] = 1;
-				queue[queueused++] = preds[queue[next]][i];
+		for (i = 0; i < ctx->predused[queue[next]]; i++)
+			if (a->f[ctx->preds[queue[next]][i]] != 1) {
+				a->f[ctx->preds[queue[next]][i]] = 1;
+				queue[queueused++] = ctx->preds[queue[next]][i];
 			}
 		next++;
 	}
 
 	for (i = 0; i < a->ns; i++)
-		mem_free(preds[i]);
-	mem_free(nexts);
-	mem_free(preds);
-	mem_free(predused);
-	mem_free(predalloc);
+		mem_free(ctx->preds[i]);
+	mem_free(ctx->nexts);
+	mem_free(ctx->preds);
+	mem_free(ctx->predused);
+	mem_free(ctx->predalloc);
 	mem_free(queue);
 }
 
@@ -1286,10 +1185,7 @@ DFA *dfaBoolVar(int b) {
 	return dfaBuild(builder, "-+-");
 }
 
-bdd_ptr target;
-int *clone;
-
-bdd_ptr merge2(DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
+static bdd_ptr merge2(PredContext *ctx, DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
 	bdd_ptr la, lb, ra, rb, indexa, indexb, to;
 	bdd_ptr L, R;
 
@@ -1297,11 +1193,11 @@ bdd_ptr merge2(DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
 	LOAD_lri(&a->bddm->node_table[sb], lb, rb, indexb);
 
 	if (indexa == BDD_LEAF_INDEX && indexb == BDD_LEAF_INDEX) {
-		if (a->f[lb] == 1 && la == target) {
+		if (a->f[lb] == 1 && la == ctx->target) {
 			if (a->q[lb] == a->q[la])
 				to = lb;
 			else
-				to = clone[la];
+				to = ctx->clone[la];
 			return bdd_find_leaf_hashed_add_root(d->bddm, to);
 		} else {
 			return bdd_find_leaf_hashed_add_root(d->bddm, la);
@@ -1309,81 +1205,83 @@ bdd_ptr merge2(DFA *a, DFA *d, bdd_ptr sa, bdd_ptr sb) {
 	}
 
 	else if (indexa == BDD_LEAF_INDEX) {
-		L = merge2(a, d, sa, lb);
-		R = merge2(a, d, sa, rb);
+		L = merge2(ctx, a, d, sa, lb);
+		R = merge2(ctx, a, d, sa, rb);
 		return bdd_find_node_hashed_add_root(d->bddm, L, R, indexb);
 	}
 
 	else if (indexb == BDD_LEAF_INDEX) {
-		L = merge2(a, d, la, sb);
-		R = merge2(a, d, ra, sb);
+		L = merge2(ctx, a, d, la, sb);
+		R = merge2(ctx, a, d, ra, sb);
 		return bdd_find_node_hashed_add_root(d->bddm, L, R, indexa);
 	}
 
 	else {
 		if (indexa < indexb) {
-			L = merge2(a, d, la, sb);
-			R = merge2(a, d, ra, sb);
+			L = merge2(ctx, a, d, la, sb);
+			R = merge2(ctx, a, d, ra, sb);
 			return bdd_find_node_hashed_add_root(d->bddm, L, R, indexa);
 		} else if (indexb < indexa) {
-			L = merge2(a, d, sa, lb);
-			R = merge2(a, d, sa, rb);
+			L = merge2(ctx, a, d, sa, lb);
+			R = merge2(ctx, a, d, sa, rb);
 			return bdd_find_node_hashed_add_root(d->bddm, L, R, indexb);
 		} else {
-			L = merge2(a, d, la, lb);
-			R = merge2(a, d, ra, rb);
+			L = merge2(ctx, a, d, la, lb);
+			R = merge2(ctx, a, d, ra, rb);
 			return bdd_find_node_hashed_add_root(d->bddm, L, R, indexa);
 		}
 	}
 }
 
-void successorz(DFA *a, bdd_ptr p) {
+static void successorz(PredContext *ctx, DFA *a, bdd_ptr p) {
 	bdd_manager *bddm = a->bddm;
 	if (bdd_is_leaf(bddm, p)) {
 		int i;
 		int s = bdd_leaf_value(bddm, p); /* current_state is a predecessor of s */
-		if (a->f[s] != 1 && s != current_state) {
-			for (i = 0; i < predused[s]; i++)
+		if (a->f[s] != 1 && s != ctx->current_state) {
+			for (i = 0; i < ctx->predused[s]; i++)
 				/* already there? */
-				if (preds[s][i] == current_state)
+				if (ctx->preds[s][i] == ctx->current_state)
 					return;
 
-			if (predalloc[s] == predused[s]) { /* need to reallocate? */
-				predalloc[s] = predalloc[s] * 2 + 8;
-				preds[s] = (int *) mem_resize(preds[s], sizeof(int)
-						* predalloc[s]);
+			if (ctx->predalloc[s] == ctx->predused[s]) { /* need to reallocate? */
+				ctx->predalloc[s] = ctx->predalloc[s] * 2 + 8;
+				ctx->preds[s] = (int *) mem_resize(ctx->preds[s], sizeof(int)
+						* ctx->predalloc[s]);
 			}
-			preds[s][predused[s]++] = current_state;
+			ctx->preds[s][ctx->predused[s]++] = ctx->current_state;
 		}
 	} else {
-		successorz(a, bdd_else(bddm, p));
-		successorz(a, bdd_then(bddm, p));
+		successorz(ctx, a, bdd_else(bddm, p));
+		successorz(ctx, a, bdd_then(bddm, p));
 	}
 
 }
 
 
 DFA * dfaPrefixClose3(DFA *a) {
+	PredContext predCtx;
+	PredContext *ctx = &predCtx;
 	int i, j;
 	DFA *c;
 
-	predalloc = (int *) mem_alloc(sizeof(int) * a->ns);
-	predused = (int *) mem_alloc(sizeof(int) * a->ns);
-	preds = (int **) mem_alloc(sizeof(int *) * a->ns);
+	ctx->predalloc = (int *) mem_alloc(sizeof(int) * a->ns);
+	ctx->predused = (int *) mem_alloc(sizeof(int) * a->ns);
+	ctx->preds = (int **) mem_alloc(sizeof(int *) * a->ns);
 	for (i = 0; i < a->ns; i++) {
-		predalloc[i] = predused[i] = 0;
-		preds[i] = 0;
+		ctx->predalloc[i] = ctx->predused[i] = 0;
+		ctx->preds[i] = 0;
 	}
 
 	/* find predecessor sets */
 	for (i = 0; i < a->ns; i++)
 		if (a->f[i] != 1) {
-			current_state = i;
-			successorz(a, a->q[i]);
+			ctx->current_state = i;
+			successorz(ctx, a, a->q[i]);
 		}
 
 	int cns = a->ns;
-	clone = (int *) malloc(cns * sizeof(int));
+	ctx->clone = (int *) malloc(cns * sizeof(int));
 	for (i = 0; i < a->ns; i++)
 		if (a->f[i] != 1)
 			cns++;
@@ -1401,23 +1299,23 @@ DFA * dfaPrefixClose3(DFA *a) {
 		if (a->f[i] != 1) {
 			c->q[j] = c->q[i];
 			c->f[j] = 1;
-			clone[i] = j;
+			ctx->clone[i] = j;
 			j++;
 		}
 
 	for (i = 0; i < a->ns; i++) {
-		for (j = 0; j < predused[i]; j++) {
-			target = i;
-			c->q[preds[i][j]] = merge2(c, c, c->q[preds[i][j]], c->q[i]);
+		for (j = 0; j < ctx->predused[i]; j++) {
+			ctx->target = i;
+			c->q[ctx->preds[i][j]] = merge2(ctx, c, c, c->q[ctx->preds[i][j]], c->q[i]);
 		}
 	}
 
 	DFA *d = dfaClean(c);
 	dfaFree(c);
-	free(clone);
-	mem_free(preds);
-	mem_free(predused);
-	mem_free(predalloc);
+	free(ctx->clone);
+	mem_free(ctx->preds);
+	mem_free(ctx->predused);
+	mem_free(ctx->predalloc);
 
 	return d;
 }